@@ -0,0 +1,154 @@
+#include "AllocationCounter.h"
+
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define ALLOCATION_COUNTER_SANITIZED 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer) || __has_feature(memory_sanitizer)
+#define ALLOCATION_COUNTER_SANITIZED 1
+#endif
+#endif
+
+static thread_local bool counted = false;
+static uint64_t allocation_count = 0;
+static uint64_t allocated_bytes = 0;
+static int64_t bytes_in_use = 0;
+
+void AllocationCounter::start() {
+    counted = true;
+}
+
+void AllocationCounter::stop() {
+    counted = false;
+}
+
+AllocationCount AllocationCounter::get_count() {
+    return {allocation_count, allocated_bytes, bytes_in_use};
+}
+
+bool AllocationCounter::counts_in_use() {
+#ifdef ALLOCATION_COUNTER_SANITIZED
+    return false;
+#else
+    return true;
+#endif
+}
+
+void AllocationCounter::reset() {
+    allocation_count = 0;
+    allocated_bytes = 0;
+    bytes_in_use = 0;
+}
+
+void AllocationCounter::count(const size_t size) {
+    if (counted) {
+        allocation_count++;
+        allocated_bytes += size;
+    }
+}
+
+#ifndef ALLOCATION_COUNTER_SANITIZED
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+void __libc_free(void *pointer);
+
+// The usable size of a block allocated or freed on a counted thread: what the thread really holds, unlike the
+// heap figures of mallinfo2, which also count other threads' arenas and the blocks cached for reuse.
+static size_t held(void *pointer) {
+    return counted && pointer != nullptr ? malloc_usable_size(pointer) : 0;
+}
+
+// glibc lets a program replace malloc, calloc, realloc and free together; its other allocation functions
+// keep working with them. cJSON grows printed text with realloc when it is given the default hooks, so
+// counting here sees that path instead of turning it off.
+void *malloc(const size_t size) {
+    AllocationCounter::count(size);
+    void *pointer = __libc_malloc(size);
+    bytes_in_use += static_cast<int64_t>(held(pointer));
+    return pointer;
+}
+
+void *calloc(const size_t count, const size_t size) {
+    AllocationCounter::count(count * size);
+    void *pointer = __libc_calloc(count, size);
+    bytes_in_use += static_cast<int64_t>(held(pointer));
+    return pointer;
+}
+
+void *realloc(void *pointer, const size_t size) {
+    AllocationCounter::count(size);
+    const size_t released = held(pointer);
+    void *reallocated = __libc_realloc(pointer, size);
+    // A failed reallocation keeps the block; a reallocation to size 0 frees it.
+    if (reallocated != nullptr || size == 0) {
+        bytes_in_use -= static_cast<int64_t>(released);
+    }
+    bytes_in_use += static_cast<int64_t>(held(reallocated));
+    return reallocated;
+}
+
+void free(void *pointer) {
+    bytes_in_use -= static_cast<int64_t>(held(pointer));
+    __libc_free(pointer);
+}
+}
+#endif
+
+static void *counted_new(size_t size) {
+#ifdef ALLOCATION_COUNTER_SANITIZED
+    AllocationCounter::count(size);
+#endif
+    if (size == 0) {
+        size = 1;
+    }
+    void *pointer = malloc(size);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+static void *counted_new(const size_t size, const std::nothrow_t &) noexcept {
+#ifdef ALLOCATION_COUNTER_SANITIZED
+    AllocationCounter::count(size);
+#endif
+    return malloc(size == 0 ? 1 : size);
+}
+
+// The replaced allocation functions are only linked into the benchmark programs.
+void *operator new(const size_t size) {
+    return counted_new(size);
+}
+
+void *operator new[](const size_t size) {
+    return counted_new(size);
+}
+
+void *operator new(const size_t size, const std::nothrow_t &tag) noexcept {
+    return counted_new(size, tag);
+}
+
+void *operator new[](const size_t size, const std::nothrow_t &tag) noexcept {
+    return counted_new(size, tag);
+}
+
+void operator delete(void *pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept {
+    free(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept {
+    free(pointer);
+}
@@ -0,0 +1,68 @@
+#ifndef YEELIGHTARDUINO_ALLOCATIONCOUNTER_H
+#define YEELIGHTARDUINO_ALLOCATIONCOUNTER_H
+
+/**
+ * @file AllocationCounter.h
+ * @brief Counts the heap allocations of chosen threads, for the benchmark programs of the host build.
+ *
+ * Linking AllocationCounter.cpp replaces `malloc`, `calloc` and `realloc` (forwarding to glibc) and the
+ * allocation functions of C++, so allocations made by `operator new`, by cJSON and by the C library are all
+ * counted, growth through `realloc` included, whichever allocator hooks cJSON is given. The bytes the counted
+ * threads hold are tracked too, from the usable size of each block they allocate and free. Sanitizer builds keep
+ * the allocator of the sanitizer and only count `operator new`, without the bytes held.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Allocations counted since the last reset.
+ */
+struct AllocationCount
+{
+    uint64_t allocations; /**< Calls that allocated, reallocations included */
+    uint64_t bytes;       /**< Bytes requested by those calls */
+    int64_t in_use;       /**< Bytes held: allocated minus freed by counted threads, in usable sizes */
+};
+
+/**
+ * @class AllocationCounter
+ * @brief Turns the counting on and off per thread, and reads the counts.
+ */
+class AllocationCounter {
+public:
+    /**
+     * @brief Starts counting the allocations of the calling thread.
+     */
+    static void start();
+
+    /**
+     * @brief Stops counting the allocations of the calling thread.
+     */
+    static void stop();
+
+    /**
+     * @brief Returns the allocations counted since the last reset, on every counted thread.
+     * @return The counts.
+     */
+    static AllocationCount get_count();
+
+    /**
+     * @brief Tells whether the bytes held are tracked, which they are not in sanitizer builds.
+     * @return True if AllocationCount::in_use is meaningful.
+     */
+    static bool counts_in_use();
+
+    /**
+     * @brief Sets the counts back to zero.
+     */
+    static void reset();
+
+    /**
+     * @brief Counts an allocation if it is made on a counted thread. Called by the allocation functions.
+     * @param size The size in bytes.
+     */
+    static void count(size_t size);
+};
+
+#endif
@@ -0,0 +1,89 @@
+#include "FleetLinks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+/**
+ * @brief Time allowed for connecting and for closing every link.
+ */
+static constexpr uint64_t LINK_TIMEOUT_US = 10000000;
+
+uint64_t bench_now_us() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint32_t frame_color(const uint64_t frame) {
+    return static_cast<uint32_t>(frame % 0xFFFFFF) + 1;
+}
+
+bool parse_frame(const char *line, uint32_t &frame) {
+    const char *params = strstr(line, "\"params\":[");
+    if (params == nullptr || strstr(line, "\"set_rgb\"") == nullptr) {
+        return false;
+    }
+    frame = static_cast<uint32_t>(strtoul(params + 10, nullptr, 10)) - 1;
+    return true;
+}
+
+template<typename Predicate>
+static bool wait_all(const std::vector<std::unique_ptr<Yeelight> > &links, Predicate ready) {
+    const uint64_t deadline = bench_now_us() + LINK_TIMEOUT_US;
+    for (;;) {
+        if (std::all_of(links.begin(), links.end(), ready)) {
+            return true;
+        }
+        if (bench_now_us() >= deadline) {
+            return false;
+        }
+        delay(1);
+    }
+}
+
+std::vector<std::unique_ptr<Yeelight> > open_links(const FleetSimulator &fleet, const size_t bulbs,
+                                                   const uint8_t connections) {
+    std::vector<std::unique_ptr<Yeelight> > links;
+    YeelightDevice device{};
+    device.model = "color";
+    device.supported_methods = Yeelight::parseSupportedMethods(SimulatedBulb::default_support("color"));
+    for (size_t bulb = 0; bulb < bulbs; bulb++) {
+        unsigned address[4] = {};
+        sscanf(fleet.get_address(bulb).c_str(), "%u.%u.%u.%u", &address[0], &address[1], &address[2], &address[3]);
+        for (int i = 0; i < 4; i++) {
+            device.ip[i] = static_cast<uint8_t>(address[i]);
+        }
+        device.port = fleet.get_port(bulb);
+        for (uint8_t connection = 0; connection < connections; connection++) {
+            links.emplace_back(new Yeelight(device));
+        }
+    }
+    wait_all(links, [](const std::unique_ptr<Yeelight> &link) { return link->is_connected(); });
+    return links;
+}
+
+bool enable_music(std::vector<std::unique_ptr<Yeelight> > &links) {
+    for (auto &link: links) {
+        link->set_music_mode(true);
+    }
+    return wait_all(links, [](const std::unique_ptr<Yeelight> &link) { return link->is_connected_music(); });
+}
+
+void wait_quiet(const FleetSimulator &fleet, const uint32_t quiet_ms) {
+    uint64_t executed = fleet.get_command_count();
+    for (uint64_t quiet = bench_now_us() + quiet_ms * 1000ULL; bench_now_us() < quiet;) {
+        delay(10);
+        if (fleet.get_command_count() != executed) {
+            executed = fleet.get_command_count();
+            quiet = bench_now_us() + quiet_ms * 1000ULL;
+        }
+    }
+}
+
+void wait_closed(const FleetSimulator &fleet) {
+    for (const uint64_t deadline = bench_now_us() + LINK_TIMEOUT_US;
+         fleet.get_connection_count() != 0 && bench_now_us() < deadline;) {
+        delay(5);
+    }
+}
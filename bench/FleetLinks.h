@@ -0,0 +1,65 @@
+#ifndef YEELIGHTARDUINO_FLEETLINKS_H
+#define YEELIGHTARDUINO_FLEETLINKS_H
+
+/**
+ * @file FleetLinks.h
+ * @brief Connects the library to a simulated fleet, for the end-to-end benchmarks.
+ */
+
+#include <FleetSimulator.h>
+#include <Yeelight.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Returns a monotonic time.
+ * @return The time in microseconds.
+ */
+uint64_t bench_now_us();
+
+/**
+ * @brief Returns the color carrying a frame number, so the bulb executing it can tell which frame it is.
+ * @param frame The frame number.
+ * @return The color: the number plus 1 (0 is not a valid color), modulo 0xFFFFFF.
+ */
+uint32_t frame_color(uint64_t frame);
+
+/**
+ * @brief Reads the frame number back from a `set_rgb` request line.
+ * @param line The request line, as executed by the bulb.
+ * @param frame Receives the frame number, modulo 0xFFFFFF.
+ * @return True if the line was a `set_rgb` request.
+ */
+bool parse_frame(const char *line, uint32_t &frame);
+
+/**
+ * @brief Opens Yeelight objects to the first bulbs of a fleet and waits until they are connected.
+ * @param fleet The simulated fleet.
+ * @param bulbs The number of bulbs.
+ * @param connections The number of Yeelight objects (connections) per bulb.
+ * @return The objects, `connections` per bulb in bulb order.
+ */
+std::vector<std::unique_ptr<Yeelight> > open_links(const FleetSimulator &fleet, size_t bulbs, uint8_t connections);
+
+/**
+ * @brief Enables music mode on every link and waits until the bulbs have dialed back.
+ * @param links The links.
+ * @return True if every link is in music mode.
+ */
+bool enable_music(std::vector<std::unique_ptr<Yeelight> > &links);
+
+/**
+ * @brief Waits until the simulator has executed no request for a while, so buffered frames have arrived.
+ * @param fleet The simulated fleet.
+ * @param quiet_ms The time without any executed request.
+ */
+void wait_quiet(const FleetSimulator &fleet, uint32_t quiet_ms);
+
+/**
+ * @brief Waits until the simulator has seen every connection close, after the links were destroyed.
+ * @param fleet The simulated fleet.
+ */
+void wait_closed(const FleetSimulator &fleet);
+
+#endif
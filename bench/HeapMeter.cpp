@@ -0,0 +1,43 @@
+#include "HeapMeter.h"
+
+#include "AllocationCounter.h"
+
+#include <algorithm>
+#include <malloc.h>
+
+HeapMeter::HeapMeter() {
+    AllocationCounter::reset();
+    AllocationCounter::start();
+}
+
+HeapMeter::~HeapMeter() {
+    AllocationCounter::stop();
+}
+
+bool HeapMeter::is_supported() {
+    return AllocationCounter::counts_in_use();
+}
+
+HeapSample HeapMeter::sample() {
+    const struct mallinfo2 info = mallinfo2();
+    const AllocationCount allocated = AllocationCounter::get_count();
+    HeapSample sample{};
+    // Blocks allocated before the meter started and freed since can take the count below zero.
+    sample.in_use = allocated.in_use > 0 ? static_cast<uint64_t>(allocated.in_use) : 0;
+    sample.heap_size = info.arena;
+    sample.free_bytes = info.fordblks;
+    sample.fragmentation = info.arena == 0 ? 0 : static_cast<double>(info.fordblks) / static_cast<double>(info.arena);
+    sample.allocations = allocated.allocations;
+    sample.allocated = allocated.bytes;
+    peak_in_use = std::max(peak_in_use, sample.in_use);
+    peak_heap_size = std::max(peak_heap_size, sample.heap_size);
+    return sample;
+}
+
+uint64_t HeapMeter::get_peak_in_use() const {
+    return peak_in_use;
+}
+
+uint64_t HeapMeter::get_peak_heap_size() const {
+    return peak_heap_size;
+}
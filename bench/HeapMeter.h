@@ -0,0 +1,75 @@
+#ifndef YEELIGHTARDUINO_HEAPMETER_H
+#define YEELIGHTARDUINO_HEAPMETER_H
+
+/**
+ * @file HeapMeter.h
+ * @brief Measures the heap of the controller thread, for soak runs on the host build.
+ *
+ * The bytes in use are those held by the metered thread, counted as it allocates and frees (see
+ * AllocationCounter.h): simulators running on their own threads, and the blocks glibc caches for reuse, are left
+ * out. The other heap figures come from glibc mallinfo2 and cover the whole process, every arena included.
+ * Sanitizer builds replace the allocator, so the bytes in use cannot be counted: see is_supported().
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief The state of the heap at one point.
+ */
+struct HeapSample
+{
+    uint64_t in_use;        /**< Bytes allocated by the metered thread and not freed */
+    uint64_t heap_size;     /**< Bytes obtained from the system, by the whole process */
+    uint64_t free_bytes;    /**< Bytes free inside the heap of the whole process */
+    double fragmentation;   /**< Share of the heap that is free but held, from 0 to 1 */
+    uint64_t allocations;   /**< Allocations counted since the meter started */
+    uint64_t allocated;     /**< Bytes allocated since the meter started */
+};
+
+/**
+ * @class HeapMeter
+ * @brief Counts the allocations of the thread that creates it and samples the heap.
+ */
+class HeapMeter {
+public:
+    /**
+     * @brief Starts counting the allocations of the calling thread.
+     */
+    HeapMeter();
+
+    /**
+     * @brief Stops counting.
+     */
+    ~HeapMeter();
+
+    /**
+     * @brief Tells whether the bytes in use can be counted, which they cannot in sanitizer builds.
+     * @return True if the samples measure the bytes in use.
+     */
+    static bool is_supported();
+
+    /**
+     * @brief Samples the heap, and keeps its high-water marks.
+     * @return The sample.
+     */
+    HeapSample sample();
+
+    /**
+     * @brief Returns the largest number of bytes in use seen by sample().
+     * @return The bytes.
+     */
+    uint64_t get_peak_in_use() const;
+
+    /**
+     * @brief Returns the largest heap size seen by sample().
+     * @return The bytes.
+     */
+    uint64_t get_peak_heap_size() const;
+
+private:
+    uint64_t peak_in_use = 0;
+    uint64_t peak_heap_size = 0;
+};
+
+#endif
@@ -0,0 +1,139 @@
+#include "LatencyHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief Values are clamped below 2^MAX_BITS µs (about 50 days).
+ */
+static constexpr uint8_t MAX_BITS = 42;
+
+/**
+ * @brief Percentile levels printed per halving of the remaining distance to 100%, as in HdrHistogram.
+ */
+static constexpr int TICKS_PER_HALF = 5;
+
+LatencyHistogram::LatencyHistogram(const uint8_t precision_bits) : precision_bits(precision_bits),
+                                                                   sub_buckets(1ULL << precision_bits) {
+    // Values below 2 sub_buckets are exact; each further doubling adds one bucket of sub_buckets entries.
+    counts.assign(static_cast<size_t>(sub_buckets * (MAX_BITS - precision_bits + 1)), 0);
+}
+
+void LatencyHistogram::record(uint64_t value_us) {
+    value_us = std::min<uint64_t>(value_us, (1ULL << MAX_BITS) - 1);
+    counts[index_of(value_us)]++;
+    total++;
+    largest = std::max(largest, value_us);
+    sum += static_cast<double>(value_us);
+    sum_squares += static_cast<double>(value_us) * static_cast<double>(value_us);
+}
+
+void LatencyHistogram::add(const LatencyHistogram &other) {
+    if (other.precision_bits != precision_bits) {
+        return;
+    }
+    for (size_t i = 0; i < counts.size(); i++) {
+        counts[i] += other.counts[i];
+    }
+    total += other.total;
+    largest = std::max(largest, other.largest);
+    sum += other.sum;
+    sum_squares += other.sum_squares;
+}
+
+void LatencyHistogram::reset() {
+    std::fill(counts.begin(), counts.end(), 0);
+    total = 0;
+    largest = 0;
+    sum = 0;
+    sum_squares = 0;
+}
+
+uint64_t LatencyHistogram::count() const {
+    return total;
+}
+
+uint64_t LatencyHistogram::percentile(const double percentile) const {
+    if (total == 0) {
+        return 0;
+    }
+    const double clamped = std::min(std::max(percentile, 0.0), 100.0);
+    const auto target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(clamped / 100.0 *
+                                                                               static_cast<double>(total))));
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < counts.size(); i++) {
+        cumulative += counts[i];
+        if (cumulative >= target) {
+            return std::min(highest_at(i), largest);
+        }
+    }
+    return largest;
+}
+
+uint64_t LatencyHistogram::max() const {
+    return largest;
+}
+
+double LatencyHistogram::mean() const {
+    return total == 0 ? 0 : sum / static_cast<double>(total);
+}
+
+void LatencyHistogram::print_hgrm(FILE *output) const {
+    fprintf(output, "%12s %14s %10s %14s\n\n", "Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+    uint64_t cumulative = 0;
+    double level = 0;
+    for (size_t i = 0; i < counts.size() && total != 0; i++) {
+        if (counts[i] == 0) {
+            continue;
+        }
+        cumulative += counts[i];
+        const double value = static_cast<double>(std::min(highest_at(i), largest)) / 1000.0;
+        if (cumulative == total) {
+            fprintf(output, "%12.3f %1.12f %10llu\n", value, 1.0, static_cast<unsigned long long>(cumulative));
+            break;
+        }
+        const double reached = 100.0 * static_cast<double>(cumulative) / static_cast<double>(total);
+        while (level <= reached) {
+            fprintf(output, "%12.3f %1.12f %10llu %14.2f\n", value, level / 100.0,
+                    static_cast<unsigned long long>(cumulative), 1.0 / (1.0 - level / 100.0));
+            // Levels get denser towards 100%: TICKS_PER_HALF per halving of the remaining distance.
+            const double half_distance = std::pow(2.0, std::floor(std::log2(100.0 / (100.0 - level))) + 1);
+            level += 100.0 / (TICKS_PER_HALF * half_distance);
+        }
+    }
+    const double average = mean();
+    const double deviation = total == 0
+                                 ? 0
+                                 : std::sqrt(std::max(0.0, sum_squares / static_cast<double>(total) -
+                                                           average * average));
+    fprintf(output, "#[Mean    = %12.3f, StdDeviation   = %12.3f]\n", average / 1000.0, deviation / 1000.0);
+    fprintf(output, "#[Max     = %12.3f, Total count    = %12llu]\n", static_cast<double>(largest) / 1000.0,
+            static_cast<unsigned long long>(total));
+    fprintf(output, "#[Buckets = %12d, SubBuckets     = %12llu]\n", MAX_BITS - precision_bits,
+            static_cast<unsigned long long>(2 * sub_buckets));
+}
+
+size_t LatencyHistogram::index_of(const uint64_t value) const {
+    if (value < 2 * sub_buckets) {
+        return static_cast<size_t>(value);
+    }
+    // From 2^(precision_bits + shift), values are kept to a width of 2^shift.
+    const int shift = 63 - __builtin_clzll(value) - precision_bits;
+    return static_cast<size_t>(sub_buckets * shift + (value >> shift));
+}
+
+uint64_t LatencyHistogram::lowest_at(const size_t index) const {
+    if (index < 2 * sub_buckets) {
+        return index;
+    }
+    const uint64_t shift = index / sub_buckets - 1;
+    return (index - sub_buckets * shift) << shift;
+}
+
+uint64_t LatencyHistogram::highest_at(const size_t index) const {
+    if (index < 2 * sub_buckets) {
+        return index;
+    }
+    const uint64_t shift = index / sub_buckets - 1;
+    return lowest_at(index) + (1ULL << shift) - 1;
+}
@@ -0,0 +1,91 @@
+#ifndef YEELIGHTARDUINO_LATENCYHISTOGRAM_H
+#define YEELIGHTARDUINO_LATENCYHISTOGRAM_H
+
+/**
+ * @file LatencyHistogram.h
+ * @brief A high dynamic range histogram of latencies, in the layout of HdrHistogram.
+ *
+ * Values are counted in buckets that double in width, each split into the same number of sub-buckets, so
+ * every recorded value is kept with a fixed relative precision from 1 µs to hours, in constant memory.
+ * The percentile distribution is printed in the `.hgrm` format of HdrHistogram, which its plotting tools
+ * read.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+class LatencyHistogram {
+public:
+    /**
+     * @brief Constructs an empty histogram.
+     * @param precision_bits The sub-bucket bits: values are kept within 1/2^precision_bits (10 for 3
+     * significant digits, 7 for 2, with 8 times less memory).
+     */
+    explicit LatencyHistogram(uint8_t precision_bits = 10);
+
+    /**
+     * @brief Records a value.
+     * @param value_us The value in microseconds.
+     */
+    void record(uint64_t value_us);
+
+    /**
+     * @brief Adds the counts of another histogram of the same precision.
+     * @param other The histogram.
+     */
+    void add(const LatencyHistogram &other);
+
+    /**
+     * @brief Forgets every recorded value.
+     */
+    void reset();
+
+    /**
+     * @brief Returns the number of recorded values.
+     * @return The count.
+     */
+    uint64_t count() const;
+
+    /**
+     * @brief Returns the value at a percentile.
+     * @param percentile The percentile, from 0 to 100.
+     * @return The highest value equivalent to the value at the percentile, in microseconds, or 0 if empty.
+     */
+    uint64_t percentile(double percentile) const;
+
+    /**
+     * @brief Returns the largest recorded value.
+     * @return The value in microseconds.
+     */
+    uint64_t max() const;
+
+    /**
+     * @brief Returns the mean of the recorded values.
+     * @return The mean in microseconds.
+     */
+    double mean() const;
+
+    /**
+     * @brief Prints the percentile distribution in the `.hgrm` format, in milliseconds.
+     * @param output The stream to print to.
+     */
+    void print_hgrm(FILE *output) const;
+
+private:
+    uint8_t precision_bits;
+    uint64_t sub_buckets;
+    std::vector<uint64_t> counts;
+    uint64_t total = 0;
+    uint64_t largest = 0;
+    double sum = 0;
+    double sum_squares = 0;
+
+    size_t index_of(uint64_t value) const;
+
+    uint64_t lowest_at(size_t index) const;
+
+    uint64_t highest_at(size_t index) const;
+};
+
+#endif
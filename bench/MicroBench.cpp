@@ -0,0 +1,87 @@
+#include "MicroBench.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+MicroBench::MicroBench(const int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        const char *argument = argv[i];
+        if (strncmp(argument, "--filter=", 9) == 0) {
+            filter = argument + 9;
+        } else if (strncmp(argument, "--min-time=", 11) == 0 && atoi(argument + 11) > 0) {
+            min_time = atoi(argument + 11) / 1000.0;
+        } else if (strcmp(argument, "--format=table") == 0) {
+            format = MICROBENCH_TABLE;
+        } else if (strcmp(argument, "--format=json") == 0) {
+            format = MICROBENCH_JSON;
+        } else if (strcmp(argument, "--format=csv") == 0) {
+            format = MICROBENCH_CSV;
+        } else {
+            fprintf(stderr, "usage: %s [--filter=TEXT] [--min-time=MS] [--format=table|json|csv]\n", argv[0]);
+            options_valid = false;
+            return;
+        }
+    }
+    // cJSON keeps its default allocator, whose calls are counted with the others.
+    AllocationCounter::start();
+}
+
+bool MicroBench::valid() const {
+    return options_valid;
+}
+
+const std::vector<MicroBenchResult> &MicroBench::get_results() const {
+    return results;
+}
+
+static void print_json_string(const std::string &text) {
+    putchar('"');
+    for (const char c: text) {
+        if (c == '"' || c == '\\') {
+            putchar('\\');
+        }
+        putchar(c);
+    }
+    putchar('"');
+}
+
+void MicroBench::report() const {
+    switch (format) {
+        case MICROBENCH_TABLE: {
+            size_t width = 9;
+            for (const auto &result: results) {
+                width = std::max(width, result.name.size());
+            }
+            printf("%-*s %14s %12s %12s %10s\n", static_cast<int>(width), "benchmark", "iterations", "ns/op",
+                   "bytes/op", "allocs/op");
+            for (const auto &result: results) {
+                printf("%-*s %14llu %12.1f %12.1f %10.2f\n", static_cast<int>(width), result.name.c_str(),
+                       static_cast<unsigned long long>(result.iterations), result.ns_per_op, result.bytes_per_op,
+                       result.allocations_per_op);
+            }
+            break;
+        }
+        case MICROBENCH_JSON:
+            printf("{\"benchmarks\":[");
+            for (size_t i = 0; i < results.size(); i++) {
+                const auto &result = results[i];
+                printf(i == 0 ? "\n  {\"name\":" : ",\n  {\"name\":");
+                print_json_string(result.name);
+                printf(",\"iterations\":%llu,\"ns_per_op\":%.3f,\"bytes_per_op\":%.3f,\"allocs_per_op\":%.3f}",
+                       static_cast<unsigned long long>(result.iterations), result.ns_per_op, result.bytes_per_op,
+                       result.allocations_per_op);
+            }
+            printf("\n]}\n");
+            break;
+        case MICROBENCH_CSV:
+            printf("name,iterations,ns_per_op,bytes_per_op,allocs_per_op\n");
+            for (const auto &result: results) {
+                printf("%s,%llu,%.3f,%.3f,%.3f\n", result.name.c_str(),
+                       static_cast<unsigned long long>(result.iterations), result.ns_per_op, result.bytes_per_op,
+                       result.allocations_per_op);
+            }
+            break;
+    }
+}
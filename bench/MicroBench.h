@@ -0,0 +1,126 @@
+#ifndef YEELIGHTARDUINO_MICROBENCH_H
+#define YEELIGHTARDUINO_MICROBENCH_H
+
+/**
+ * @file MicroBench.h
+ * @brief A self-contained microbenchmark harness for the host build.
+ *
+ * Each benchmark is timed over enough iterations to run for a minimum time, while every heap allocation of
+ * the benchmark thread is counted (see AllocationCounter.h), cJSON reallocations included. The results are printed as a table, as JSON or as CSV, so runs can
+ * be compared by scripts.
+ */
+
+#include "AllocationCounter.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The measurements of one benchmark.
+ */
+struct MicroBenchResult
+{
+    std::string name;          /**< Benchmark name */
+    uint64_t iterations;       /**< Iterations of the measured run */
+    double ns_per_op;          /**< Nanoseconds per iteration */
+    double bytes_per_op;       /**< Bytes allocated per iteration */
+    double allocations_per_op; /**< Allocations per iteration */
+};
+
+/**
+ * @brief Enumeration of the report formats of MicroBench.
+ */
+enum MicroBenchFormat
+{
+    MICROBENCH_TABLE, /**< Aligned columns, for reading */
+    MICROBENCH_JSON,  /**< One JSON document */
+    MICROBENCH_CSV    /**< A header line, then one line per benchmark */
+};
+
+/**
+ * @class MicroBench
+ * @brief Runs benchmarks selected on the command line and reports their results.
+ */
+class MicroBench {
+public:
+    /**
+     * @brief Parses the options: `--filter=TEXT` (run the benchmarks whose name contains TEXT),
+     * `--min-time=MS` (minimum measured time per benchmark, 200 by default) and `--format=table|json|csv`.
+     * @param argc The argument count.
+     * @param argv The arguments.
+     */
+    MicroBench(int argc, char **argv);
+
+    /**
+     * @brief Checks whether the options were valid.
+     * @return False if an option was not understood (the usage was printed).
+     */
+    bool valid() const;
+
+    /**
+     * @brief Runs a benchmark.
+     * @param name The benchmark name.
+     * @param body Called with an iteration count; runs the measured operation that many times.
+     */
+    template<typename Body>
+    void run(const std::string &name, Body body) {
+        if (!filter.empty() && name.find(filter) == std::string::npos) {
+            return;
+        }
+        body(1);
+        // Grow the batch until it is long enough to time, then size the measured run from it.
+        uint64_t iterations = 1;
+        double elapsed = time(body, iterations);
+        while (elapsed < 0.01 && iterations < (1ULL << 40)) {
+            iterations *= elapsed < 0.001 ? 10 : 2;
+            elapsed = time(body, iterations);
+        }
+        if (elapsed < min_time) {
+            iterations = static_cast<uint64_t>(static_cast<double>(iterations) * min_time / elapsed) + 1;
+        }
+        AllocationCounter::reset();
+        elapsed = time(body, iterations);
+        const AllocationCount allocated = AllocationCounter::get_count();
+        const auto count = static_cast<double>(iterations);
+        results.push_back({name, iterations, elapsed * 1e9 / count, static_cast<double>(allocated.bytes) / count,
+                           static_cast<double>(allocated.allocations) / count});
+    }
+
+    /**
+     * @brief Prints the results in the selected format.
+     */
+    void report() const;
+
+    /**
+     * @brief Returns the results of the benchmarks run so far.
+     * @return The results.
+     */
+    const std::vector<MicroBenchResult> &get_results() const;
+
+    /**
+     * @brief Keeps a value alive, so the computation that produced it is not optimized away.
+     * @param value The value.
+     */
+    template<typename T>
+    static void keep(const T &value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+private:
+    std::string filter;
+    double min_time = 0.2;
+    MicroBenchFormat format = MICROBENCH_TABLE;
+    bool options_valid = true;
+    std::vector<MicroBenchResult> results;
+
+    template<typename Body>
+    static double time(Body &body, const uint64_t iterations) {
+        const auto start = std::chrono::steady_clock::now();
+        body(iterations);
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+#endif
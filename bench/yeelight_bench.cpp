@@ -0,0 +1,202 @@
+/**
+ * @file yeelight_bench.cpp
+ * @brief Microbenchmarks of command serialization, response parsing, discovery parsing and flow building.
+ *
+ * Usage: yeelight-bench [--filter=TEXT] [--min-time=MS] [--format=table|json|csv]
+ */
+
+#include "MicroBench.h"
+#include <Flow.h>
+#include <FlowDefault.h>
+#include <Yeelight.h>
+
+/**
+ * @brief Reaches the private serialization and parsing paths of Yeelight.
+ */
+class YeelightBenchmark {
+public:
+    explicit YeelightBenchmark(MicroBench &bench) : bench(bench) {
+        // Every method is supported, so no command falls back to another or stops at the support check.
+        bulb.supported_methods = Yeelight::parseSupportedMethods(
+            "get_prop set_ct_abx set_rgb set_hsv set_bright set_power toggle set_default start_cf stop_cf set_scene "
+            "cron_add cron_get cron_del set_adjust set_music set_name bg_set_rgb bg_set_hsv bg_set_ct_abx "
+            "bg_start_cf bg_stop_cf bg_set_scene bg_set_default bg_set_power bg_set_bright bg_set_adjust bg_toggle "
+            "dev_toggle adjust_bright adjust_ct adjust_color bg_adjust_bright bg_adjust_ct bg_adjust_color");
+        bulb.set_capture(&frames);
+        bulb.property_requests[PROPERTY_ID] = Yeelight::ALL_PROPERTIES;
+    }
+
+    void commands() {
+        flow_expression flow[4] = {{1000, FLOW_COLOR, 0xFF0000, 100}, {1000, FLOW_COLOR, 0x00FF00, 100},
+                                   {1000, FLOW_COLOR_TEMPERATURE, 2700, 50}, {500, FLOW_SLEEP, 0, 0}};
+        const uint8_t host[4] = {192, 168, 1, 10};
+        command("set_music_command", [&] { return bulb.set_music_command(true, host, 55443); });
+        command("start_cf_command", [&] { return bulb.start_cf_command(0, FLOW_RECOVER, 4, flow); });
+        command("stop_cf_command", [&] { return bulb.stop_cf_command(); });
+        command("bg_set_power_command", [&] { return bulb.bg_set_power_command(true); });
+        command("set_power_command", [&] { return bulb.set_power_command(true); });
+        command("bg_toggle_command", [&] { return bulb.bg_toggle_command(); });
+        command("toggle_command", [&] { return bulb.toggle_command(); });
+        command("dev_toggle_command", [&] { return bulb.dev_toggle_command(); });
+        command("set_ct_abx_command", [&] { return bulb.set_ct_abx_command(4000); });
+        command("set_scene_ct_command", [&] { return bulb.set_scene_ct_command(4000, 80); });
+        command("bg_set_ct_abx_command", [&] { return bulb.bg_set_ct_abx_command(4000); });
+        command("bg_set_scene_ct_command", [&] { return bulb.bg_set_scene_ct_command(4000, 80); });
+        command("set_scene_rgb_command", [&] { return bulb.set_scene_rgb_command(255, 128, 0, 80); });
+        command("bg_set_rgb_command", [&] { return bulb.bg_set_rgb_command(255, 128, 0); });
+        command("bg_set_scene_rgb_command", [&] { return bulb.bg_set_scene_rgb_command(255, 128, 0, 80); });
+        command("set_rgb_command", [&] { return bulb.set_rgb_command(255, 128, 0); });
+        command("set_bright_command", [&] { return bulb.set_bright_command(80); });
+        command("bg_set_bright_command", [&] { return bulb.bg_set_bright_command(80); });
+        command("set_scene_hsv_command", [&] { return bulb.set_scene_hsv_command(300, 70, 80); });
+        command("set_hsv_command", [&] { return bulb.set_hsv_command(300, 70); });
+        command("bg_set_hsv_command", [&] { return bulb.bg_set_hsv_command(300, 70); });
+        command("bg_set_scene_hsv_command", [&] { return bulb.bg_set_scene_hsv_command(300, 70, 80); });
+        command("set_scene_auto_delay_off_command", [&] { return bulb.set_scene_auto_delay_off_command(50, 15); });
+        command("bg_set_scene_auto_delay_off_command",
+                [&] { return bulb.bg_set_scene_auto_delay_off_command(50, 15); });
+        command("cron_add_command", [&] { return bulb.cron_add_command(15); });
+        command("cron_del_command", [&] { return bulb.cron_del_command(); });
+        command("set_name_command", [&] { return bulb.set_name_command("living room"); });
+        command("adjust_bright_command", [&] { return bulb.adjust_bright_command(-20, 500); });
+        command("adjust_ct_command", [&] { return bulb.adjust_ct_command(-20, 500); });
+        command("adjust_color_command", [&] { return bulb.adjust_color_command(20, 500); });
+        command("bg_adjust_bright_command", [&] { return bulb.bg_adjust_bright_command(-20, 500); });
+        command("bg_adjust_ct_command", [&] { return bulb.bg_adjust_ct_command(-20, 500); });
+        command("bg_adjust_color_command", [&] { return bulb.bg_adjust_color_command(20, 500); });
+        command("bg_start_cf_command", [&] { return bulb.bg_start_cf_command(0, FLOW_RECOVER, 4, flow); });
+        command("bg_stop_cf_command", [&] { return bulb.bg_stop_cf_command(); });
+        command("set_scene_cf_command", [&] { return bulb.set_scene_cf_command(0, FLOW_RECOVER, 4, flow); });
+        command("bg_set_scene_cf_command", [&] { return bulb.bg_set_scene_cf_command(0, FLOW_RECOVER, 4, flow); });
+    }
+
+    void responses() {
+        parse("onData/ok", "{\"id\":1, \"result\":[\"ok\"]}\r\n");
+        parse("onData/get_prop",
+              "{\"id\":2, \"result\":[\"on\",\"100\",\"4000\",\"16711680\",\"359\",\"100\",\"2\",\"0\",\"0\",\"0\","
+              "\"living room\",\"off\",\"0\",\"4000\",\"2\",\"50\",\"65280\",\"120\",\"80\",\"0\",\"0\"]}\r\n");
+        parse("onData/props", "{\"method\":\"props\",\"params\":{\"power\":\"on\",\"bright\":\"10\"}}\r\n");
+        parse("onData/props_color",
+              "{\"method\":\"props\",\"params\":{\"rgb\":16711680,\"hue\":0,\"sat\":100,\"color_mode\":1,"
+              "\"bright\":80}}\r\n");
+        parse("onData/error", "{\"id\":1, \"error\":{\"code\":-1, \"message\":\"client quota exceeded\"}}\r\n");
+    }
+
+    static void discovery(MicroBench &bench) {
+        const char *response =
+                "HTTP/1.1 200 OK\r\n"
+                "Cache-Control: max-age=3600\r\n"
+                "Date: \r\n"
+                "Ext: \r\n"
+                "Location: yeelight://192.168.1.239:55443\r\n"
+                "Server: POSIX UPnP/1.0 YGLC/1\r\n"
+                "id: 0x000000000015243f\r\n"
+                "model: color\r\n"
+                "fw_ver: 18\r\n"
+                "support: get_prop set_default set_power toggle set_bright start_cf stop_cf set_scene cron_add "
+                "cron_get cron_del set_ct_abx set_rgb set_hsv set_adjust adjust_bright adjust_ct adjust_color "
+                "set_music set_name\r\n"
+                "power: on\r\n"
+                "bright: 100\r\n"
+                "color_mode: 2\r\n"
+                "ct: 4000\r\n"
+                "rgb: 16711680\r\n"
+                "hue: 100\r\n"
+                "sat: 35\r\n"
+                "name: living room\r\n";
+        bench.run("parseDiscoveryResponse", [&](const uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                const YeelightDevice device = Yeelight::parseDiscoveryResponse(response);
+                MicroBench::keep(device.port);
+            }
+        });
+    }
+
+private:
+    static constexpr uint16_t PROPERTY_ID = 2;
+
+    MicroBench &bench;
+    Yeelight bulb;
+    std::vector<CommandFrame> frames;
+
+    template<typename Command>
+    void command(const char *name, Command call) {
+        // Captured, the command is serialized into a frame instead of being sent.
+        bench.run(std::string("serialize/") + name, [&](const uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                MicroBench::keep(call());
+                frames.clear();
+            }
+        });
+    }
+
+    void parse(const char *name, const char *line) {
+        const size_t length = strlen(line);
+        bench.run(name, [&](const uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                bulb.onData(nullptr, line, length);
+            }
+        });
+    }
+};
+
+static void flows(MicroBench &bench) {
+    bench.run("Flow::add_hsv", [](const uint64_t iterations) {
+        // A flow of 16 steps is built per 16 iterations, as a preset would.
+        Flow flow;
+        for (uint64_t i = 0; i < iterations; i++) {
+            if (i % 16 == 0) {
+                flow = Flow();
+            }
+            flow.add_hsv(500, static_cast<uint16_t>(i % 360), 100, 80);
+        }
+        MicroBench::keep(flow.get_size());
+    });
+    const auto preset = [&bench](const char *name, Flow (*build)()) {
+        bench.run(std::string("FlowDefault::") + name, [build](const uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                const Flow flow = build();
+                MicroBench::keep(flow.get_size());
+            }
+        });
+    };
+    preset("disco", [] { return FlowDefault::disco(); });
+    preset("temp", [] { return FlowDefault::temp(); });
+    preset("strobe", [] { return FlowDefault::strobe(); });
+    preset("pulse", [] { return FlowDefault::pulse(255, 0, 0); });
+    preset("strobeColor", [] { return FlowDefault::strobeColor(); });
+    preset("alarm", [] { return FlowDefault::alarm(); });
+    preset("police", [] { return FlowDefault::police(); });
+    preset("police2", [] { return FlowDefault::police2(); });
+    preset("lsd", [] { return FlowDefault::lsd(); });
+    preset("christmas", [] { return FlowDefault::christmas(); });
+    preset("rgb", [] { return FlowDefault::rgb(); });
+    preset("randomLoop", [] { return FlowDefault::randomLoop(); });
+    preset("slowdown", [] { return FlowDefault::slowdown(); });
+    preset("home", [] { return FlowDefault::home(); });
+    preset("nightMode", [] { return FlowDefault::nightMode(); });
+    preset("dateNight", [] { return FlowDefault::dateNight(); });
+    preset("movie", [] { return FlowDefault::movie(); });
+    preset("sunrise", [] { return FlowDefault::sunrise(); });
+    preset("sunset", [] { return FlowDefault::sunset(); });
+    preset("romance", [] { return FlowDefault::romance(); });
+    preset("happyBirthday", [] { return FlowDefault::happyBirthday(); });
+    preset("candleFlicker", [] { return FlowDefault::candleFlicker(); });
+    preset("teaTime", [] { return FlowDefault::teaTime(); });
+}
+
+int main(int argc, char **argv) {
+    MicroBench bench(argc, argv);
+    if (!bench.valid()) {
+        return 2;
+    }
+    {
+        YeelightBenchmark benchmark(bench);
+        benchmark.commands();
+        benchmark.responses();
+    }
+    YeelightBenchmark::discovery(bench);
+    flows(bench);
+    bench.report();
+    return 0;
+}
@@ -0,0 +1,459 @@
+/**
+ * @file yeelight_e2e.cpp
+ * @brief End-to-end throughput and latency of the library against a simulated fleet.
+ *
+ * Every scenario streams `set_rgb` commands for a fixed time and measures commands per second and the latency
+ * of each command, per bulb and over the fleet:
+ * - sync: each command waits for its reply (send_command), connections are served in turn;
+ * - async: up to `--depth` commands in flight per connection (send_command_async / poll_response);
+ * - music: commands are only written; the latency is the time until the bulb executes them.
+ * Sync and async run with one connection per bulb and with a pool of `--pool` connections per bulb (one
+ * Yeelight per connection); music mode has a single connection per bulb by design.
+ *
+ * Usage: yeelight-bench-e2e [--bulbs=1,10,100,1000] [--modes=sync,async,music] [--pool=4] [--depth=4]
+ *                           [--duration=MS] [--port=20100] [--hdr-dir=DIR] [--record=LOG]
+ *                           [--format=table|json]
+ *
+ * `--record` writes the traffic of every scenario to a wire log, to be replayed with yeelight-replay.
+ */
+
+#include "FleetLinks.h"
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <HostLoop.h>
+#include <WireRecorder.h>
+
+/**
+ * @brief Enumeration of the ways commands are sent.
+ */
+enum E2eMode
+{
+    E2E_SYNC,  /**< One command at a time per connection, waiting for the reply */
+    E2E_ASYNC, /**< Several commands in flight per connection */
+    E2E_MUSIC  /**< Music mode: written without replies */
+};
+
+static const char *const mode_names[] = {"sync", "async", "music"};
+
+struct E2eOptions
+{
+    std::vector<size_t> bulbs{1, 10, 100, 1000};
+    std::vector<E2eMode> modes{E2E_SYNC, E2E_ASYNC, E2E_MUSIC};
+    uint8_t pool = 4;
+    uint8_t depth = 4;
+    uint32_t duration = 2000;
+    uint16_t port = 20100;
+    std::string hdr_dir;
+    std::string record;
+    bool json = false;
+};
+
+/**
+ * @brief The wire log of a run, drained from the event loop while scenarios run.
+ */
+struct WireLog
+{
+    WireRecorder recorder{1 << 20};
+    FILE *file = nullptr;
+};
+
+static void write_log(void *arg, const uint8_t *data, const size_t size) {
+    fwrite(data, 1, size, static_cast<FILE *>(arg));
+}
+
+static void drain_periodically(WireLog *log) {
+    if (log->file == nullptr) {
+        return;
+    }
+    log->recorder.drain(write_log, log->file);
+    host_schedule(10000, [log] { drain_periodically(log); });
+}
+
+/**
+ * @brief Latencies of a scenario, over the fleet (3 significant digits) and per bulb (2).
+ */
+struct E2eLatencies
+{
+    LatencyHistogram fleet{10};
+    std::vector<LatencyHistogram> bulbs;
+
+    explicit E2eLatencies(const size_t count) : bulbs(count, LatencyHistogram(7)) {
+    }
+
+    void record(const size_t bulb, const uint64_t latency_us) {
+        fleet.record(latency_us);
+        bulbs[bulb].record(latency_us);
+    }
+};
+
+struct E2eResult
+{
+    std::string name;
+    size_t bulbs;
+    uint8_t connections;
+    uint64_t sent;
+    uint64_t completed;
+    uint64_t failed;
+    double seconds;
+    LatencyHistogram fleet;
+    uint64_t bulb_p50;
+    uint64_t bulb_p99;
+};
+
+/**
+ * @brief Send times of music frames, by bulb and frame number, read back when the bulb executes the frame.
+ */
+static constexpr size_t MUSIC_RING = 4096;
+
+struct MusicTrace
+{
+    std::vector<std::atomic<uint64_t> > sent;
+    E2eLatencies *latencies;
+};
+
+static void trace_music(void *arg, const size_t bulb, const char *line) {
+    auto *trace = static_cast<MusicTrace *>(arg);
+    uint32_t frame;
+    if (!parse_frame(line, frame)) {
+        return;
+    }
+    const uint64_t now = bench_now_us();
+    const uint64_t sent = trace->sent[bulb * MUSIC_RING + frame % MUSIC_RING].load(std::memory_order_acquire);
+    if (sent != 0 && now >= sent) {
+        trace->latencies->record(bulb, now - sent);
+    }
+}
+
+static bool parse_list(const char *text, std::vector<size_t> &values) {
+    values.clear();
+    for (const char *p = text; *p != '\0';) {
+        char *end;
+        const unsigned long value = strtoul(p, &end, 10);
+        if (end == p || value == 0) {
+            return false;
+        }
+        values.push_back(value);
+        p = *end == ',' ? end + 1 : end;
+        if (*end != ',' && *end != '\0') {
+            return false;
+        }
+    }
+    return !values.empty();
+}
+
+static bool parse_modes(const char *text, std::vector<E2eMode> &modes) {
+    modes.clear();
+    for (const char *p = text; *p != '\0';) {
+        const size_t length = strcspn(p, ",");
+        uint8_t mode = E2E_SYNC;
+        // Whole names only: "sync" is part of "async".
+        while (mode <= E2E_MUSIC && (strlen(mode_names[mode]) != length || strncmp(p, mode_names[mode], length) != 0)) {
+            mode++;
+        }
+        if (mode > E2E_MUSIC) {
+            return false;
+        }
+        if (std::find(modes.begin(), modes.end(), static_cast<E2eMode>(mode)) == modes.end()) {
+            modes.push_back(static_cast<E2eMode>(mode));
+        }
+        p += length;
+        p = *p == ',' ? p + 1 : p;
+    }
+    return !modes.empty();
+}
+
+static bool parse_options(const int argc, char **argv, E2eOptions &options) {
+    for (int i = 1; i < argc; i++) {
+        const char *argument = argv[i];
+        const char *value = strchr(argument, '=');
+        value = value == nullptr ? "" : value + 1;
+        if (strncmp(argument, "--bulbs=", 8) == 0) {
+            if (!parse_list(value, options.bulbs)) {
+                return false;
+            }
+        } else if (strncmp(argument, "--modes=", 8) == 0) {
+            if (!parse_modes(value, options.modes)) {
+                return false;
+            }
+        } else if (strncmp(argument, "--pool=", 7) == 0 && atoi(value) > 0) {
+            options.pool = static_cast<uint8_t>(std::min(atoi(value), 4));
+        } else if (strncmp(argument, "--depth=", 8) == 0 && atoi(value) > 0) {
+            options.depth = static_cast<uint8_t>(std::min(atoi(value), 255));
+        } else if (strncmp(argument, "--duration=", 11) == 0 && atoi(value) > 0) {
+            options.duration = static_cast<uint32_t>(atoi(value));
+        } else if (strncmp(argument, "--port=", 7) == 0 && atoi(value) > 0) {
+            options.port = static_cast<uint16_t>(atoi(value));
+        } else if (strncmp(argument, "--hdr-dir=", 10) == 0) {
+            options.hdr_dir = value;
+        } else if (strncmp(argument, "--record=", 9) == 0 && *value != '\0') {
+            options.record = value;
+        } else if (strcmp(argument, "--format=json") == 0 || strcmp(argument, "--format=table") == 0) {
+            options.json = strcmp(value, "json") == 0;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void run_sync(std::vector<std::unique_ptr<Yeelight> > &links, const uint8_t connections, const uint64_t end,
+                     E2eResult &result, E2eLatencies &latencies) {
+    uint64_t frame = 0;
+    while (bench_now_us() < end) {
+        for (size_t i = 0; i < links.size() && bench_now_us() < end; i++) {
+            const uint32_t color = frame_color(frame++);
+            const uint64_t start = bench_now_us();
+            const ResponseType response = links[i]->set_rgb_color(color >> 16, color >> 8 & 0xFF, color & 0xFF,
+                                                                  EFFECT_SUDDEN);
+            result.sent++;
+            if (response != SUCCESS) {
+                result.failed++;
+                continue;
+            }
+            result.completed++;
+            latencies.record(i / connections, bench_now_us() - start);
+        }
+    }
+}
+
+static void run_async(std::vector<std::unique_ptr<Yeelight> > &links, const uint8_t connections, const uint8_t depth,
+                      const uint64_t end, E2eResult &result, E2eLatencies &latencies) {
+    struct in_flight
+    {
+        uint16_t id;
+        uint64_t sent;
+    };
+    std::vector<std::deque<in_flight> > pending(links.size());
+    uint64_t frame = 0;
+    const uint64_t drain_end = end + 5000000;
+    for (bool open = true;;) {
+        const uint64_t now = bench_now_us();
+        open = open && now < end;
+        size_t outstanding = 0;
+        for (size_t i = 0; i < links.size(); i++) {
+            // Replies arrive in order on a connection, so only the oldest commands need checking.
+            while (!pending[i].empty()) {
+                const ResponseType response = links[i]->poll_response(pending[i].front().id);
+                if (response == PENDING && now < pending[i].front().sent + 5000000) {
+                    break;
+                }
+                if (response == SUCCESS) {
+                    result.completed++;
+                    latencies.record(i / connections, bench_now_us() - pending[i].front().sent);
+                } else {
+                    result.failed++;
+                    if (response == PENDING) {
+                        links[i]->forget_response(pending[i].front().id);
+                    }
+                }
+                pending[i].pop_front();
+            }
+            while (open && pending[i].size() < depth) {
+                const uint32_t color = frame_color(frame++);
+                cJSON *params = cJSON_CreateArray();
+                cJSON_AddItemToArray(params, cJSON_CreateNumber(color));
+                cJSON_AddItemToArray(params, cJSON_CreateString("sudden"));
+                cJSON_AddItemToArray(params, cJSON_CreateNumber(30));
+                uint16_t id = 0;
+                const uint64_t sent = bench_now_us();
+                result.sent++;
+                if (links[i]->send_command_async("set_rgb", params, id) != SUCCESS || id == 0) {
+                    result.failed++;
+                    break;
+                }
+                pending[i].push_back({id, sent});
+            }
+            outstanding += pending[i].size();
+        }
+        if (!open && (outstanding == 0 || now > drain_end)) {
+            result.failed += outstanding;
+            return;
+        }
+        yield();
+    }
+}
+
+static void run_music(std::vector<std::unique_ptr<Yeelight> > &links, FleetSimulator &fleet, const uint64_t end,
+                      E2eResult &result, MusicTrace &trace) {
+    std::vector<uint64_t> frames(links.size(), 0);
+    while (bench_now_us() < end) {
+        for (size_t bulb = 0; bulb < links.size(); bulb++) {
+            const uint64_t frame = frames[bulb]++;
+            const uint32_t color = frame_color(frame);
+            trace.sent[bulb * MUSIC_RING + (color - 1) % MUSIC_RING].store(bench_now_us(), std::memory_order_release);
+            result.sent++;
+            if (links[bulb]->set_rgb_color(color >> 16, color >> 8 & 0xFF, color & 0xFF, EFFECT_SUDDEN) != SUCCESS) {
+                result.failed++;
+            }
+        }
+        yield();
+    }
+    // Frames still buffered are given a moment to arrive.
+    wait_quiet(fleet, 200);
+}
+
+static E2eResult run_scenario(FleetSimulator &fleet, const E2eOptions &options, const size_t bulbs,
+                              const E2eMode mode, const uint8_t connections, WireLog *log) {
+    E2eResult result{std::string(mode_names[mode]) + (connections > 1 ? "/pool" : "/single"), bulbs, connections, 0,
+                     0, 0, 0, LatencyHistogram(10), 0, 0};
+    E2eLatencies latencies(bulbs);
+    MusicTrace trace{std::vector<std::atomic<uint64_t> >(mode == E2E_MUSIC ? bulbs * MUSIC_RING : 0), &latencies};
+    {
+        auto links = open_links(fleet, bulbs, connections);
+        if (log != nullptr) {
+            for (const auto &link: links) {
+                link->set_recorder(&log->recorder);
+            }
+        }
+        if (mode == E2E_MUSIC) {
+            enable_music(links);
+            fleet.set_command_hook(trace_music, &trace);
+        }
+        const uint64_t executed = fleet.get_command_count();
+        const uint64_t start = bench_now_us();
+        const uint64_t end = start + options.duration * 1000ULL;
+        switch (mode) {
+            case E2E_SYNC:
+                run_sync(links, connections, end, result, latencies);
+                break;
+            case E2E_ASYNC:
+                run_async(links, connections, options.depth, end, result, latencies);
+                break;
+            case E2E_MUSIC:
+                run_music(links, fleet, end, result, trace);
+                // Removing the hook waits for the simulator thread, which then no longer touches the trace.
+                fleet.set_command_hook(nullptr, nullptr);
+                result.completed = fleet.get_command_count() - executed;
+                break;
+        }
+        result.seconds = static_cast<double>(options.duration) / 1000.0;
+    }
+    // The simulator sees the connections close before the next scenario opens its own.
+    wait_closed(fleet);
+    result.fleet.add(latencies.fleet);
+    std::vector<uint64_t> p50;
+    uint64_t worst_p99 = 0;
+    for (const auto &histogram: latencies.bulbs) {
+        if (histogram.count() != 0) {
+            p50.push_back(histogram.percentile(50));
+            worst_p99 = std::max(worst_p99, histogram.percentile(99));
+        }
+    }
+    if (!p50.empty()) {
+        std::nth_element(p50.begin(), p50.begin() + static_cast<std::ptrdiff_t>(p50.size() / 2), p50.end());
+        result.bulb_p50 = p50[p50.size() / 2];
+        result.bulb_p99 = worst_p99;
+    }
+    return result;
+}
+
+static double ms(const uint64_t us) {
+    return static_cast<double>(us) / 1000.0;
+}
+
+static void write_hgrm(const E2eOptions &options, const E2eResult &result) {
+    if (options.hdr_dir.empty()) {
+        return;
+    }
+    std::string path = options.hdr_dir + "/" + result.name + "-" + std::to_string(result.bulbs) + ".hgrm";
+    std::replace(path.begin() + static_cast<std::ptrdiff_t>(options.hdr_dir.size()) + 1, path.end(), '/', '-');
+    FILE *output = fopen(path.c_str(), "w");
+    if (output == nullptr) {
+        fprintf(stderr, "cannot write %s\n", path.c_str());
+        return;
+    }
+    result.fleet.print_hgrm(output);
+    fclose(output);
+}
+
+static void report(const E2eOptions &options, const std::vector<E2eResult> &results) {
+    if (options.json) {
+        printf("{\"scenarios\":[");
+        for (size_t i = 0; i < results.size(); i++) {
+            const auto &result = results[i];
+            printf("%s\n  {\"name\":\"%s\",\"bulbs\":%zu,\"connections_per_bulb\":%u,\"sent\":%llu,"
+                   "\"completed\":%llu,\"failed\":%llu,\"commands_per_second\":%.1f,\"p50_ms\":%.3f,"
+                   "\"p99_ms\":%.3f,\"p999_ms\":%.3f,\"max_ms\":%.3f,\"bulb_median_p50_ms\":%.3f,"
+                   "\"bulb_worst_p99_ms\":%.3f}", i == 0 ? "" : ",", result.name.c_str(), result.bulbs,
+                   result.connections, static_cast<unsigned long long>(result.sent),
+                   static_cast<unsigned long long>(result.completed), static_cast<unsigned long long>(result.failed),
+                   static_cast<double>(result.completed) / result.seconds, ms(result.fleet.percentile(50)),
+                   ms(result.fleet.percentile(99)), ms(result.fleet.percentile(99.9)), ms(result.fleet.max()),
+                   ms(result.bulb_p50), ms(result.bulb_p99));
+        }
+        printf("\n]}\n");
+        return;
+    }
+    printf("%-13s %6s %5s %9s %9s %7s %10s %9s %9s %9s %9s %10s %10s\n", "scenario", "bulbs", "conns", "sent",
+           "completed", "failed", "cmd/s", "p50 ms", "p99 ms", "p99.9 ms", "max ms", "bulb p50", "bulb p99");
+    for (const auto &result: results) {
+        printf("%-13s %6zu %5u %9llu %9llu %7llu %10.1f %9.3f %9.3f %9.3f %9.3f %10.3f %10.3f\n",
+               result.name.c_str(), result.bulbs, result.connections, static_cast<unsigned long long>(result.sent),
+               static_cast<unsigned long long>(result.completed), static_cast<unsigned long long>(result.failed),
+               static_cast<double>(result.completed) / result.seconds, ms(result.fleet.percentile(50)),
+               ms(result.fleet.percentile(99)), ms(result.fleet.percentile(99.9)), ms(result.fleet.max()),
+               ms(result.bulb_p50), ms(result.bulb_p99));
+    }
+}
+
+int main(int argc, char **argv) {
+    E2eOptions options;
+    if (!parse_options(argc, argv, options)) {
+        fprintf(stderr, "usage: %s [--bulbs=1,10,100,1000] [--modes=sync,async,music] [--pool=4] [--depth=4]\n"
+                "       [--duration=MS] [--port=20100] [--hdr-dir=DIR] [--record=LOG] [--format=table|json]\n",
+                argv[0]);
+        return 2;
+    }
+    WireLog log;
+    if (!options.record.empty()) {
+        log.file = fopen(options.record.c_str(), "wb");
+        if (log.file == nullptr) {
+            fprintf(stderr, "cannot write %s\n", options.record.c_str());
+            return 1;
+        }
+        drain_periodically(&log);
+    }
+    std::vector<E2eResult> results;
+    for (const size_t bulbs: options.bulbs) {
+        FleetSimulator fleet(bulbs, "color", SIM_DISTINCT_ADDRESSES, "127.1.0.1", options.port);
+        // Quotas would cap every scenario at 144 commands per minute per bulb.
+        fleet.set_quota(0, 0);
+        fleet.set_ssdp(false);
+        if (!fleet.start()) {
+            fprintf(stderr, "cannot start a fleet of %zu bulbs on port %u\n", bulbs, options.port);
+            return 1;
+        }
+        std::vector<uint8_t> pools{1};
+        if (options.pool > 1) {
+            pools.push_back(options.pool);
+        }
+        for (const E2eMode mode: options.modes) {
+            for (const uint8_t connections: pools) {
+                // Music mode has one connection per bulb.
+                if (connections > 1 && mode == E2E_MUSIC) {
+                    continue;
+                }
+                results.push_back(run_scenario(fleet, options, bulbs, mode, connections,
+                                               log.file == nullptr ? nullptr : &log));
+                write_hgrm(options, results.back());
+                fprintf(stderr, "%s, %zu bulbs: %llu commands\n", results.back().name.c_str(), bulbs,
+                        static_cast<unsigned long long>(results.back().completed));
+            }
+        }
+        fleet.stop();
+    }
+    if (log.file != nullptr) {
+        log.recorder.drain(write_log, log.file);
+        fclose(log.file);
+        // Stops the drain task.
+        log.file = nullptr;
+        if (log.recorder.get_dropped() != 0) {
+            fprintf(stderr, "%u records dropped from %s\n", log.recorder.get_dropped(), options.record.c_str());
+        }
+    }
+    report(options, results);
+    return 0;
+}
@@ -0,0 +1,303 @@
+/**
+ * @file yeelight_music.cpp
+ * @brief The sustained frame rate of music mode, against a simulated fleet.
+ *
+ * Every bulb gets a stream of color frames (set_rgb_color in music mode) paced at a fixed rate, and the rate is
+ * raised step by step. Each step measures, per stream count:
+ * - frames delivered (executed by the bulb) and dropped: rejected by the library (send buffer full), late (the
+ *   controller fell a whole frame behind, so an effect would skip to the current frame) or lost on the way;
+ * - the latency of each frame, from set_rgb_color until the bulb executes it;
+ * - the CPU time of the controller thread per frame, the simulator running on its own thread.
+ * A rate is sustained when at least 99% of the frames are delivered with a p99 latency within `--max-latency`.
+ *
+ * Usage: yeelight-bench-music [--streams=1,10,100] [--rates=10,25,50,100,250,500,1000] [--duration=MS]
+ *                             [--max-latency=MS] [--port=20200] [--hdr-dir=DIR] [--format=table|json]
+ */
+
+#include "FleetLinks.h"
+#include "LatencyHistogram.h"
+#include <atomic>
+#include <cstring>
+#include <sys/resource.h>
+#include <unistd.h>
+
+struct MusicOptions
+{
+    std::vector<size_t> streams{1, 10, 100};
+    std::vector<size_t> rates{10, 25, 50, 100, 250, 500, 1000};
+    uint32_t duration = 2000;
+    uint32_t max_latency = 50;
+    uint16_t port = 20200;
+    std::string hdr_dir;
+    bool json = false;
+};
+
+/**
+ * @brief The frames of one step, all streams together.
+ */
+struct MusicStep
+{
+    size_t streams;
+    size_t rate;             /**< Target frames per second per stream */
+    uint64_t scheduled = 0;  /**< Frame slots that came due */
+    uint64_t sent = 0;       /**< Frames written to the music connection */
+    uint64_t rejected = 0;   /**< Frames the library refused to write */
+    uint64_t late = 0;       /**< Frames skipped because their slot had passed */
+    uint64_t delivered = 0;  /**< Frames executed by the bulbs */
+    double seconds = 0;
+    double cpu_us = 0;       /**< CPU time of the controller thread */
+    LatencyHistogram latency{10};
+};
+
+/**
+ * @brief Send times of frames, by stream and frame number, read back when the bulb executes the frame.
+ */
+static constexpr size_t FRAME_RING = 4096;
+
+struct FrameTrace
+{
+    std::vector<std::atomic<uint64_t> > sent;
+    std::atomic<uint64_t> delivered{0};
+    LatencyHistogram latency{10};
+
+    explicit FrameTrace(const size_t streams) : sent(streams * FRAME_RING) {
+    }
+};
+
+static void trace_frame(void *arg, const size_t bulb, const char *line) {
+    auto *trace = static_cast<FrameTrace *>(arg);
+    uint32_t frame;
+    if (!parse_frame(line, frame)) {
+        return;
+    }
+    const uint64_t now = bench_now_us();
+    // Each frame is counted once, even if the slot is reused later.
+    const uint64_t sent = trace->sent[bulb * FRAME_RING + frame % FRAME_RING].exchange(0, std::memory_order_acq_rel);
+    if (sent != 0 && now >= sent) {
+        trace->delivered.fetch_add(1, std::memory_order_relaxed);
+        trace->latency.record(now - sent);
+    }
+}
+
+static double thread_cpu_us() {
+    rusage usage{};
+    getrusage(RUSAGE_THREAD, &usage);
+    return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e6 +
+           static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+/**
+ * @brief Waits for the next frame slot while serving the connections, without spinning.
+ */
+static void wait_until(const uint64_t due) {
+    yield();
+    const uint64_t now = bench_now_us();
+    if (due >= now + 1000) {
+        delay(static_cast<unsigned long>((due - now) / 1000));
+    } else if (due > now) {
+        usleep(static_cast<useconds_t>(due - now));
+    }
+}
+
+static void run_step(std::vector<std::unique_ptr<Yeelight> > &links, FleetSimulator &fleet,
+                     const MusicOptions &options, MusicStep &step) {
+    FrameTrace trace(links.size());
+    fleet.set_command_hook(trace_frame, &trace);
+    const double period = 1e6 / static_cast<double>(step.rate);
+    std::vector<uint64_t> frames(links.size(), 0);
+    const double cpu = thread_cpu_us();
+    const uint64_t start = bench_now_us();
+    const uint64_t end = start + options.duration * 1000ULL;
+    for (uint64_t now = start; now < end; now = bench_now_us()) {
+        uint64_t next = end;
+        for (size_t stream = 0; stream < links.size(); stream++) {
+            // Streams are spread over the period, as independent effects would be.
+            const double offset = period * static_cast<double>(stream) / static_cast<double>(links.size());
+            auto due = static_cast<uint64_t>(static_cast<double>(start) + offset +
+                                             period * static_cast<double>(frames[stream]));
+            if (due <= now) {
+                // Slots that ended before now are stale: an effect skips to the current frame.
+                const auto behind = static_cast<uint64_t>(static_cast<double>(now - due) / period);
+                step.late += behind;
+                frames[stream] += behind;
+                const uint32_t color = frame_color(frames[stream]);
+                trace.sent[stream * FRAME_RING + frames[stream] % FRAME_RING].store(bench_now_us(),
+                                                                                    std::memory_order_release);
+                if (links[stream]->set_rgb_color(color >> 16, color >> 8 & 0xFF, color & 0xFF, EFFECT_SUDDEN) ==
+                    SUCCESS) {
+                    step.sent++;
+                } else {
+                    trace.sent[stream * FRAME_RING + frames[stream] % FRAME_RING].store(0, std::memory_order_release);
+                    step.rejected++;
+                }
+                frames[stream]++;
+                due = static_cast<uint64_t>(static_cast<double>(start) + offset +
+                                            period * static_cast<double>(frames[stream]));
+            }
+            next = std::min(next, due);
+        }
+        wait_until(next);
+    }
+    step.cpu_us = thread_cpu_us() - cpu;
+    step.seconds = static_cast<double>(bench_now_us() - start) / 1e6;
+    wait_quiet(fleet, 200);
+    // Removing the hook waits for the simulator thread, which then no longer touches the trace.
+    fleet.set_command_hook(nullptr, nullptr);
+    step.scheduled = step.sent + step.rejected + step.late;
+    step.delivered = trace.delivered.load();
+    step.latency.add(trace.latency);
+}
+
+static bool sustained(const MusicOptions &options, const MusicStep &step) {
+    return step.scheduled != 0 && static_cast<double>(step.delivered) >= 0.99 * static_cast<double>(step.scheduled) &&
+           step.latency.percentile(99) <= options.max_latency * 1000ULL;
+}
+
+static bool parse_list(const char *text, std::vector<size_t> &values) {
+    values.clear();
+    for (const char *p = text; *p != '\0';) {
+        char *end;
+        const unsigned long value = strtoul(p, &end, 10);
+        if (end == p || value == 0) {
+            return false;
+        }
+        values.push_back(value);
+        p = *end == ',' ? end + 1 : end;
+        if (*end != ',' && *end != '\0') {
+            return false;
+        }
+    }
+    return !values.empty();
+}
+
+static bool parse_options(const int argc, char **argv, MusicOptions &options) {
+    for (int i = 1; i < argc; i++) {
+        const char *argument = argv[i];
+        const char *value = strchr(argument, '=');
+        value = value == nullptr ? "" : value + 1;
+        if (strncmp(argument, "--streams=", 10) == 0) {
+            if (!parse_list(value, options.streams)) {
+                return false;
+            }
+        } else if (strncmp(argument, "--rates=", 8) == 0) {
+            if (!parse_list(value, options.rates)) {
+                return false;
+            }
+        } else if (strncmp(argument, "--duration=", 11) == 0 && atoi(value) > 0) {
+            options.duration = static_cast<uint32_t>(atoi(value));
+        } else if (strncmp(argument, "--max-latency=", 14) == 0 && atoi(value) > 0) {
+            options.max_latency = static_cast<uint32_t>(atoi(value));
+        } else if (strncmp(argument, "--port=", 7) == 0 && atoi(value) > 0) {
+            options.port = static_cast<uint16_t>(atoi(value));
+        } else if (strncmp(argument, "--hdr-dir=", 10) == 0) {
+            options.hdr_dir = value;
+        } else if (strcmp(argument, "--format=json") == 0 || strcmp(argument, "--format=table") == 0) {
+            options.json = strcmp(value, "json") == 0;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+static double ms(const uint64_t us) {
+    return static_cast<double>(us) / 1000.0;
+}
+
+static double per_frame(const MusicStep &step) {
+    const uint64_t attempted = step.sent + step.rejected;
+    return attempted == 0 ? 0 : step.cpu_us / static_cast<double>(attempted);
+}
+
+static void write_hgrm(const MusicOptions &options, const MusicStep &step) {
+    if (options.hdr_dir.empty()) {
+        return;
+    }
+    const std::string path = options.hdr_dir + "/music-" + std::to_string(step.streams) + "x" +
+                             std::to_string(step.rate) + ".hgrm";
+    FILE *output = fopen(path.c_str(), "w");
+    if (output == nullptr) {
+        fprintf(stderr, "cannot write %s\n", path.c_str());
+        return;
+    }
+    step.latency.print_hgrm(output);
+    fclose(output);
+}
+
+static void report(const MusicOptions &options, const std::vector<MusicStep> &steps) {
+    if (options.json) {
+        printf("{\"steps\":[");
+        for (size_t i = 0; i < steps.size(); i++) {
+            const auto &step = steps[i];
+            printf("%s\n  {\"streams\":%zu,\"rate\":%zu,\"scheduled\":%llu,\"sent\":%llu,\"rejected\":%llu,"
+                   "\"late\":%llu,\"delivered\":%llu,\"delivered_per_stream_per_second\":%.1f,\"p50_ms\":%.3f,"
+                   "\"p99_ms\":%.3f,\"max_ms\":%.3f,\"cpu_us_per_frame\":%.2f,\"cpu_percent\":%.1f,"
+                   "\"sustained\":%s}", i == 0 ? "" : ",", step.streams, step.rate,
+                   static_cast<unsigned long long>(step.scheduled), static_cast<unsigned long long>(step.sent),
+                   static_cast<unsigned long long>(step.rejected), static_cast<unsigned long long>(step.late),
+                   static_cast<unsigned long long>(step.delivered),
+                   static_cast<double>(step.delivered) / step.seconds / static_cast<double>(step.streams),
+                   ms(step.latency.percentile(50)), ms(step.latency.percentile(99)), ms(step.latency.max()),
+                   per_frame(step), step.cpu_us / step.seconds / 1e4, sustained(options, step) ? "true" : "false");
+        }
+        printf("\n]}\n");
+        return;
+    }
+    printf("%7s %6s %9s %9s %8s %8s %9s %9s %9s %9s %9s %8s %6s %s\n", "streams", "fps", "scheduled", "sent",
+           "rejected", "late", "delivered", "fps/strm", "p50 ms", "p99 ms", "max ms", "cpu us", "cpu %", "sustained");
+    for (const auto &step: steps) {
+        printf("%7zu %6zu %9llu %9llu %8llu %8llu %9llu %9.1f %9.3f %9.3f %9.3f %8.2f %6.1f %s\n", step.streams,
+               step.rate, static_cast<unsigned long long>(step.scheduled), static_cast<unsigned long long>(step.sent),
+               static_cast<unsigned long long>(step.rejected), static_cast<unsigned long long>(step.late),
+               static_cast<unsigned long long>(step.delivered),
+               static_cast<double>(step.delivered) / step.seconds / static_cast<double>(step.streams),
+               ms(step.latency.percentile(50)), ms(step.latency.percentile(99)), ms(step.latency.max()),
+               per_frame(step), step.cpu_us / step.seconds / 1e4, sustained(options, step) ? "yes" : "no");
+    }
+    for (const size_t streams: options.streams) {
+        size_t ceiling = 0;
+        for (const auto &step: steps) {
+            if (step.streams == streams && sustained(options, step)) {
+                ceiling = std::max(ceiling, step.rate);
+            }
+        }
+        printf("%zu streams: sustained up to %zu frames/s per stream\n", streams, ceiling);
+    }
+}
+
+int main(int argc, char **argv) {
+    MusicOptions options;
+    if (!parse_options(argc, argv, options)) {
+        fprintf(stderr, "usage: %s [--streams=1,10,100] [--rates=10,25,50,100,250,500,1000] [--duration=MS]\n"
+                "       [--max-latency=MS] [--port=20200] [--hdr-dir=DIR] [--format=table|json]\n", argv[0]);
+        return 2;
+    }
+    std::vector<MusicStep> steps;
+    for (const size_t streams: options.streams) {
+        FleetSimulator fleet(streams, "color", SIM_DISTINCT_ADDRESSES, "127.1.0.1", options.port);
+        fleet.set_ssdp(false);
+        if (!fleet.start()) {
+            fprintf(stderr, "cannot start a fleet of %zu bulbs on port %u\n", streams, options.port);
+            return 1;
+        }
+        {
+            auto links = open_links(fleet, streams, 1);
+            if (!enable_music(links)) {
+                fprintf(stderr, "music mode could not be enabled on every one of %zu bulbs\n", streams);
+                return 1;
+            }
+            for (const size_t rate: options.rates) {
+                steps.push_back(MusicStep{streams, rate});
+                run_step(links, fleet, options, steps.back());
+                write_hgrm(options, steps.back());
+                fprintf(stderr, "%zu streams at %zu frames/s: %llu of %llu delivered\n", streams, rate,
+                        static_cast<unsigned long long>(steps.back().delivered),
+                        static_cast<unsigned long long>(steps.back().scheduled));
+            }
+        }
+        wait_closed(fleet);
+        fleet.stop();
+    }
+    report(options, steps);
+    return 0;
+}
@@ -0,0 +1,319 @@
+/**
+ * @file yeelight_replay.cpp
+ * @brief Replays a wire log (see WireRecorder) through the library, for profiling and regression benchmarks.
+ *
+ * Every device of the log gets a Yeelight that talks to no one. Sent frames go through the command path again:
+ * they are parsed back into a method and parameters and passed to send_command, which serializes them in
+ * capture mode (see Yeelight::set_capture). Received data is fed to onData in the chunks it arrived in, and
+ * the responses to the replayed commands are collected with poll_response. The log is replayed at its
+ * recorded pace (`--speed=1`) or as fast as possible (`--speed=max`, the default), `--repeat` times.
+ *
+ * The digest hashes the frames serialized and the responses collected: two runs of the same log by the same
+ * library give the same digest, so a change of behavior shows up next to the change of speed.
+ *
+ * Usage: yeelight-replay LOG [--speed=1|max] [--repeat=N] [--format=table|json]
+ */
+
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <WireRecorder.h>
+#include <Yeelight.h>
+
+struct ReplayOptions
+{
+    const char *path = nullptr;
+    bool paced = false;
+    uint32_t repeat = 1;
+    bool json = false;
+};
+
+/**
+ * @brief Time and volume of one path through the library.
+ */
+struct ReplayPath
+{
+    uint64_t records = 0;
+    uint64_t operations = 0;
+    uint64_t bytes = 0;
+    uint64_t ns = 0;
+};
+
+struct ReplayResult
+{
+    size_t devices = 0;
+    double log_seconds = 0;
+    double seconds = 0;
+    ReplayPath sent;
+    ReplayPath received;
+    uint64_t responses = 0;
+    uint64_t unanswered = 0;
+    uint64_t digest = 14695981039346656037ULL;
+};
+
+static uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static void hash(uint64_t &digest, const void *data, const size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        digest = (digest ^ static_cast<const uint8_t *>(data)[i]) * 1099511628211ULL;
+    }
+}
+
+/**
+ * @brief Commands that were replayed and not answered yet are forgotten beyond this many per device.
+ */
+static constexpr size_t MAX_PENDING = 256;
+
+class WireReplayer {
+public:
+    explicit WireReplayer(ReplayResult &result) : result(result) {
+    }
+
+    void sent(const WireRecord &record) {
+        replay_device &device = find(record.ip);
+        result.sent.records++;
+        result.sent.bytes += record.size;
+        const char *text = reinterpret_cast<const char *>(record.data);
+        for (size_t start = 0; start < record.size;) {
+            const char *end = static_cast<const char *>(memchr(text + start, '\n', record.size - start));
+            const size_t length = end == nullptr ? record.size - start : static_cast<size_t>(end - text) - start;
+            line.assign(text + start, length);
+            start += length + 1;
+            command(device, record.music);
+        }
+    }
+
+    void received(const WireRecord &record) {
+        replay_device &device = find(record.ip);
+        result.received.records++;
+        result.received.operations++;
+        result.received.bytes += record.size;
+        const uint64_t start = now_ns();
+        device.bulb->onData(nullptr, record.data, record.size);
+        // Responses come back in order, except for those of commands that timed out.
+        for (auto id = device.pending.begin(); id != device.pending.end();) {
+            const ResponseType response = device.bulb->poll_response(*id);
+            if (response == PENDING) {
+                ++id;
+                continue;
+            }
+            result.responses++;
+            hash(result.digest, &response, sizeof(response));
+            id = device.pending.erase(id);
+        }
+        result.received.ns += now_ns() - start;
+    }
+
+    void finish() {
+        for (auto &device: devices) {
+            result.unanswered += device.second.pending.size();
+        }
+        result.devices = devices.size();
+    }
+
+private:
+    struct replay_device
+    {
+        std::unique_ptr<Yeelight> bulb;
+        std::vector<CommandFrame> frames;
+        std::deque<uint16_t> pending;
+    };
+
+    ReplayResult &result;
+    std::map<uint32_t, replay_device> devices;
+    std::string line;
+
+    replay_device &find(const uint8_t ip[4]) {
+        uint32_t key;
+        memcpy(&key, ip, sizeof(key));
+        replay_device &device = devices[key];
+        if (device.bulb == nullptr) {
+            device.bulb.reset(new Yeelight());
+            memcpy(device.bulb->ip, ip, 4);
+            // Every method is supported, so no replayed command stops at the support check.
+            device.bulb->supported_methods = Yeelight::parseSupportedMethods(
+                "get_prop set_ct_abx set_rgb set_hsv set_bright set_power toggle set_default start_cf stop_cf "
+                "set_scene cron_add cron_get cron_del set_adjust set_music set_name bg_set_rgb bg_set_hsv "
+                "bg_set_ct_abx bg_start_cf bg_stop_cf bg_set_scene bg_set_default bg_set_power bg_set_bright "
+                "bg_set_adjust bg_toggle dev_toggle adjust_bright adjust_ct adjust_color bg_adjust_bright "
+                "bg_adjust_ct bg_adjust_color");
+            device.bulb->set_capture(&device.frames);
+        }
+        return device;
+    }
+
+    void command(replay_device &device, const bool music) {
+        if (line.empty() || line == "\r") {
+            return;
+        }
+        cJSON *root = cJSON_Parse(line.c_str());
+        const cJSON *method = cJSON_GetObjectItem(root, "method");
+        const cJSON *id = cJSON_GetObjectItem(root, "id");
+        const cJSON *arguments = cJSON_GetObjectItem(root, "params");
+        if (!cJSON_IsString(method) || arguments == nullptr) {
+            cJSON_Delete(root);
+            return;
+        }
+        // send_command takes ownership of its parameters: they are copied out of the line.
+        char *printed = cJSON_PrintUnformatted(arguments);
+        cJSON *params = printed == nullptr ? nullptr : cJSON_Parse(printed);
+        cJSON_free(printed);
+        if (params == nullptr) {
+            cJSON_Delete(root);
+            return;
+        }
+        // Responses to get_prop are matched with the properties requested, in YeelightProp order.
+        if (!music && cJSON_IsNumber(id) && strcmp(method->valuestring, "get_prop") == 0) {
+            uint32_t mask = 0;
+            for (const cJSON *name = params->child; name != nullptr; name = name->next) {
+                for (uint8_t prop = 0; prop < PROP_COUNT && cJSON_IsString(name); prop++) {
+                    if (strcmp(name->valuestring, Yeelight::get_property_name(static_cast<YeelightProp>(prop))) ==
+                        0) {
+                        mask |= 1UL << prop;
+                    }
+                }
+            }
+            device.bulb->property_requests[static_cast<uint16_t>(id->valueint)] = mask;
+        }
+        device.frames.clear();
+        result.sent.operations++;
+        const uint64_t start = now_ns();
+        device.bulb->send_command(method->valuestring, params);
+        result.sent.ns += now_ns() - start;
+        for (const auto &frame: device.frames) {
+            hash(result.digest, frame.method.data(), frame.method.size());
+            hash(result.digest, frame.params.data(), frame.params.size());
+        }
+        // Music mode commands have no responses.
+        if (!music && cJSON_IsNumber(id)) {
+            if (device.pending.size() == MAX_PENDING) {
+                device.bulb->forget_response(device.pending.front());
+                device.pending.pop_front();
+            }
+            device.pending.push_back(static_cast<uint16_t>(id->valueint));
+        }
+        cJSON_Delete(root);
+    }
+};
+
+static bool parse_options(const int argc, char **argv, ReplayOptions &options) {
+    for (int i = 1; i < argc; i++) {
+        const char *argument = argv[i];
+        const char *value = strchr(argument, '=');
+        value = value == nullptr ? "" : value + 1;
+        if (strcmp(argument, "--speed=1") == 0 || strcmp(argument, "--speed=max") == 0) {
+            options.paced = strcmp(value, "1") == 0;
+        } else if (strncmp(argument, "--repeat=", 9) == 0 && atoi(value) > 0) {
+            options.repeat = static_cast<uint32_t>(atoi(value));
+        } else if (strcmp(argument, "--format=json") == 0 || strcmp(argument, "--format=table") == 0) {
+            options.json = strcmp(value, "json") == 0;
+        } else if (argument[0] != '-' && options.path == nullptr) {
+            options.path = argument;
+        } else {
+            return false;
+        }
+    }
+    return options.path != nullptr;
+}
+
+static bool read_log(const char *path, std::vector<uint8_t> &log) {
+    FILE *input = fopen(path, "rb");
+    if (input == nullptr) {
+        return false;
+    }
+    uint8_t buffer[65536];
+    for (size_t read; (read = fread(buffer, 1, sizeof(buffer), input)) > 0;) {
+        log.insert(log.end(), buffer, buffer + read);
+    }
+    fclose(input);
+    return true;
+}
+
+static double per_operation(const ReplayPath &path) {
+    return path.operations == 0 ? 0 : static_cast<double>(path.ns) / static_cast<double>(path.operations);
+}
+
+static void report(const ReplayOptions &options, const ReplayResult &result) {
+    if (options.json) {
+        printf("{\"devices\":%zu,\"log_seconds\":%.3f,\"seconds\":%.3f,\"digest\":\"%016llx\",\"responses\":%llu,"
+               "\"unanswered\":%llu,\"paths\":[", result.devices, result.log_seconds, result.seconds,
+               static_cast<unsigned long long>(result.digest), static_cast<unsigned long long>(result.responses),
+               static_cast<unsigned long long>(result.unanswered));
+        const ReplayPath *paths[] = {&result.sent, &result.received};
+        const char *names[] = {"send", "receive"};
+        for (uint8_t i = 0; i < 2; i++) {
+            printf("%s\n  {\"name\":\"%s\",\"records\":%llu,\"operations\":%llu,\"bytes\":%llu,\"ns_per_op\":%.1f}",
+                   i == 0 ? "" : ",", names[i], static_cast<unsigned long long>(paths[i]->records),
+                   static_cast<unsigned long long>(paths[i]->operations),
+                   static_cast<unsigned long long>(paths[i]->bytes), per_operation(*paths[i]));
+        }
+        printf("\n]}\n");
+        return;
+    }
+    printf("%zu devices, %.3f s of traffic replayed in %.3f s, %llu responses, %llu unanswered, digest %016llx\n",
+           result.devices, result.log_seconds, result.seconds, static_cast<unsigned long long>(result.responses),
+           static_cast<unsigned long long>(result.unanswered), static_cast<unsigned long long>(result.digest));
+    printf("%-8s %10s %10s %12s %10s\n", "path", "records", "ops", "bytes", "ns/op");
+    printf("%-8s %10llu %10llu %12llu %10.1f\n", "send", static_cast<unsigned long long>(result.sent.records),
+           static_cast<unsigned long long>(result.sent.operations), static_cast<unsigned long long>(result.sent.bytes),
+           per_operation(result.sent));
+    printf("%-8s %10llu %10llu %12llu %10.1f\n", "receive", static_cast<unsigned long long>(result.received.records),
+           static_cast<unsigned long long>(result.received.operations),
+           static_cast<unsigned long long>(result.received.bytes), per_operation(result.received));
+}
+
+int main(int argc, char **argv) {
+    ReplayOptions options;
+    if (!parse_options(argc, argv, options)) {
+        fprintf(stderr, "usage: %s LOG [--speed=1|max] [--repeat=N] [--format=table|json]\n", argv[0]);
+        return 2;
+    }
+    std::vector<uint8_t> log;
+    if (!read_log(options.path, log)) {
+        fprintf(stderr, "cannot read %s\n", options.path);
+        return 1;
+    }
+    std::vector<WireRecord> records;
+    size_t offset = 0;
+    for (WireRecord record{}; WireRecorder::decode(log.data(), log.size(), offset, record);) {
+        records.push_back(record);
+    }
+    if (offset == 0 || offset != log.size()) {
+        fprintf(stderr, "%s: %s at byte %zu\n", options.path, offset == 0 ? "not a wire log" : "malformed record",
+                offset);
+        return 1;
+    }
+
+    ReplayResult result;
+    if (!records.empty()) {
+        result.log_seconds = static_cast<double>(records.back().time_us) / 1e6 * options.repeat;
+    }
+    {
+        WireReplayer replayer(result);
+        const uint64_t start = now_ns();
+        for (uint32_t pass = 0; pass < options.repeat; pass++) {
+            const auto pass_start = std::chrono::steady_clock::now();
+            for (const WireRecord &record: records) {
+                if (options.paced) {
+                    std::this_thread::sleep_until(pass_start + std::chrono::microseconds(record.time_us));
+                }
+                if (record.direction == WIRE_SENT) {
+                    replayer.sent(record);
+                } else {
+                    replayer.received(record);
+                }
+            }
+        }
+        result.seconds = static_cast<double>(now_ns() - start) / 1e9;
+        replayer.finish();
+    }
+    report(options, result);
+    return 0;
+}
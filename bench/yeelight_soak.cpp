@@ -0,0 +1,436 @@
+/**
+ * @file yeelight_soak.cpp
+ * @brief A soak run of the library against a simulated fleet, failing if the heap grows.
+ *
+ * Millions of commands are sent in rounds over every bulb: pipelined set_rgb commands (send_command_async),
+ * a synchronous set_brightness, property reads and, now and then, a music mode session. Every command changes
+ * the bulb, which notifies its properties back. A FaultTransport splits replies, drops some of them (their
+ * commands time out) and cuts connections in the middle of replies (the library reconnects). The host clock
+ * runs `--time-scale` times faster than real time, so timeouts and polling delays cost little.
+ *
+ * Every few rounds a Scene and a YeelightGroup broadcast go to the whole fleet with a timeout shorter than
+ * the latency their replies are given, while more responses are dropped: the commands they give up on must
+ * not leave late replies behind in the devices. These faults stay with `--no-faults`, which only turns off
+ * the others: without disconnects, nothing clears what a device leaks until the end of the run.
+ *
+ * The bytes in use of the controller thread are counted as it allocates and frees (HeapMeter), so the
+ * simulator thread and the blocks glibc keeps for reuse do not show as growth; sanitizer builds, whose
+ * allocator cannot be counted, refuse to run. The heap is sampled at `--checkpoints` points. After the first
+ * `--warmup` percent of the commands, the heap in use must level off: the run fails if the trend of the heap
+ * in use over the remaining checkpoints (a least-squares line) grows by more than `--max-growth` over those
+ * commands. It also fails if, once every command has been collected or given up on, the devices still hold
+ * more than one unclaimed response each (Yeelight::get_unclaimed_responses): such a leak is bounded by the
+ * 16-bit command ids, which wrap and overwrite it, so the heap levels off and growth alone misses it.
+ *
+ * Usage: yeelight-soak [--bulbs=10] [--commands=2000000] [--time-scale=100] [--checkpoints=20] [--warmup=10]
+ *                      [--max-growth=KB] [--seed=N] [--no-faults] [--port=20300] [--format=table|json]
+ */
+
+#include "FleetLinks.h"
+#include "HeapMeter.h"
+#include <FaultTransport.h>
+#include <HostLoop.h>
+#include <Scene.h>
+#include <YeelightGroup.h>
+#include <algorithm>
+#include <cstring>
+#include <deque>
+
+struct SoakOptions
+{
+    size_t bulbs = 10;
+    uint64_t commands = 2000000;
+    double time_scale = 100;
+    uint32_t checkpoints = 20;
+    uint32_t warmup = 10;
+    uint64_t max_growth = 16 * 1024;
+    uint64_t seed = 1;
+    bool faults = true;
+    uint16_t port = 20300;
+    bool json = false;
+};
+
+/**
+ * @brief Commands in flight per bulb, and the time (of the host clock) after which one is given up.
+ */
+static constexpr uint8_t DEPTH = 8;
+static constexpr unsigned long REPLY_TIMEOUT_MS = 5000;
+
+/**
+ * @brief The response drop rate of the run, outside of scene phases.
+ */
+static constexpr double RESPONSE_DROP_RATE = 0.0002;
+
+/**
+ * @brief Rounds between synchronous property reads, asynchronous ones and music mode sessions.
+ */
+static constexpr uint64_t REFRESH_ROUNDS = 16;
+static constexpr uint64_t REQUEST_ROUNDS = 64;
+static constexpr uint64_t MUSIC_ROUNDS = 500;
+static constexpr uint8_t MUSIC_FRAMES = 50;
+
+/**
+ * @brief Rounds between scene and broadcast phases, their timeout, and the faults while they run: the
+ * response drop rate and the latency of replies (Pareto, in microseconds), mostly beyond the timeout.
+ */
+static constexpr uint64_t SCENE_ROUNDS = 16;
+static constexpr uint32_t SCENE_TIMEOUT_MS = 5;
+static constexpr double SCENE_DROP_RATE = 0.02;
+static constexpr uint32_t SCENE_LATENCY_US = 5000;
+static constexpr uint32_t SCENE_LATENCY_SPREAD_US = 2000;
+
+struct SoakCounters
+{
+    uint64_t commands = 0;
+    uint64_t completed = 0;
+    uint64_t failed = 0;
+    uint64_t timeouts = 0;
+    uint64_t music_sessions = 0;
+    uint64_t scene_phases = 0;
+};
+
+struct SoakCheckpoint
+{
+    uint64_t commands;
+    unsigned long simulated_ms;
+    HeapSample heap;
+};
+
+/**
+ * @brief A command sent with send_command_async, waiting for its response.
+ */
+struct soak_pending
+{
+    uint16_t id;
+    unsigned long sent;
+};
+
+static bool parse_options(const int argc, char **argv, SoakOptions &options) {
+    for (int i = 1; i < argc; i++) {
+        const char *argument = argv[i];
+        const char *value = strchr(argument, '=');
+        value = value == nullptr ? "" : value + 1;
+        if (strncmp(argument, "--bulbs=", 8) == 0 && atoi(value) > 0) {
+            options.bulbs = static_cast<size_t>(atoi(value));
+        } else if (strncmp(argument, "--commands=", 11) == 0 && atoll(value) > 0) {
+            options.commands = static_cast<uint64_t>(atoll(value));
+        } else if (strncmp(argument, "--time-scale=", 13) == 0 && atof(value) > 0) {
+            options.time_scale = atof(value);
+        } else if (strncmp(argument, "--checkpoints=", 14) == 0 && atoi(value) >= 4) {
+            options.checkpoints = static_cast<uint32_t>(atoi(value));
+        } else if (strncmp(argument, "--warmup=", 9) == 0 && atoi(value) >= 0 && atoi(value) < 100) {
+            options.warmup = static_cast<uint32_t>(atoi(value));
+        } else if (strncmp(argument, "--max-growth=", 13) == 0 && atoll(value) >= 0) {
+            options.max_growth = static_cast<uint64_t>(atoll(value)) * 1024;
+        } else if (strncmp(argument, "--seed=", 7) == 0) {
+            options.seed = static_cast<uint64_t>(atoll(value));
+        } else if (strcmp(argument, "--no-faults") == 0) {
+            options.faults = false;
+        } else if (strncmp(argument, "--port=", 7) == 0 && atoi(value) > 0) {
+            options.port = static_cast<uint16_t>(atoi(value));
+        } else if (strcmp(argument, "--format=json") == 0 || strcmp(argument, "--format=table") == 0) {
+            options.json = strcmp(value, "json") == 0;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Sends up to DEPTH set_rgb commands to a bulb and collects the responses that arrived.
+ */
+static void pipeline(Yeelight &link, std::deque<soak_pending> &pending, SoakCounters &counters) {
+    while (!pending.empty()) {
+        const ResponseType response = link.poll_response(pending.front().id);
+        if (response == PENDING) {
+            if (millis() - pending.front().sent < REPLY_TIMEOUT_MS) {
+                break;
+            }
+            link.forget_response(pending.front().id);
+            counters.timeouts++;
+        } else if (response == SUCCESS) {
+            counters.completed++;
+        } else {
+            counters.failed++;
+        }
+        pending.pop_front();
+    }
+    while (pending.size() < DEPTH) {
+        const uint32_t color = frame_color(counters.commands);
+        cJSON *params = cJSON_CreateArray();
+        cJSON_AddItemToArray(params, cJSON_CreateNumber(color));
+        cJSON_AddItemToArray(params, cJSON_CreateString("sudden"));
+        cJSON_AddItemToArray(params, cJSON_CreateNumber(30));
+        uint16_t id = 0;
+        counters.commands++;
+        if (link.send_command_async("set_rgb", params, id) != SUCCESS || id == 0) {
+            // Mostly a connection being reestablished: the next round tries again.
+            counters.failed++;
+            return;
+        }
+        pending.push_back({id, millis()});
+    }
+}
+
+static void count(const ResponseType response, SoakCounters &counters) {
+    counters.commands++;
+    if (response == SUCCESS) {
+        counters.completed++;
+    } else if (response == TIMEOUT) {
+        counters.timeouts++;
+    } else {
+        counters.failed++;
+    }
+}
+
+static void music_session(Yeelight &link, std::deque<soak_pending> &pending, SoakCounters &counters) {
+    // Responses still pending are lost when the main connection closes for music mode.
+    for (const soak_pending &command: pending) {
+        link.forget_response(command.id);
+    }
+    pending.clear();
+    if (link.set_music_mode(true) != SUCCESS) {
+        counters.failed++;
+        return;
+    }
+    for (const unsigned long start = millis(); !link.is_connected_music() && millis() - start < 1000;) {
+        delay(1);
+    }
+    for (uint8_t frame = 0; frame < MUSIC_FRAMES; frame++) {
+        const uint32_t color = frame_color(frame);
+        count(link.set_rgb_color(color >> 16, color >> 8 & 0xFF, color & 0xFF, EFFECT_SUDDEN), counters);
+        yield();
+    }
+    count(link.set_music_mode(false), counters);
+    counters.music_sessions++;
+}
+
+/**
+ * @brief Applies a scene and broadcasts a command to every bulb, giving up on the replies that are late.
+ */
+static void scene_phase(Scene &scene, YeelightGroup &group, const uint64_t phase, FaultTransport &faults,
+                        const double drop_rate, SoakCounters &counters) {
+    faults.set_response_drop_rate(SCENE_DROP_RATE);
+    faults.set_latency(LATENCY_PARETO, SCENE_LATENCY_US, SCENE_LATENCY_SPREAD_US);
+    const size_t bulbs = scene.size();
+    for (size_t i = 0; i < bulbs; i++) {
+        const uint32_t color = frame_color(phase * bulbs + i);
+        scene.set(i, {true, COLOR_MODE_RGB, color, 0, 0, 0, static_cast<uint8_t>(phase % 100 + 1)});
+    }
+    scene.apply(SCENE_TIMEOUT_MS);
+    for (size_t i = 0; i < bulbs; i++) {
+        count(scene.get_outcome(i), counters);
+    }
+    cJSON *params = cJSON_CreateArray();
+    cJSON_AddItemToArray(params, cJSON_CreateNumber(static_cast<double>(phase % 100 + 1)));
+    cJSON_AddItemToArray(params, cJSON_CreateString("sudden"));
+    cJSON_AddItemToArray(params, cJSON_CreateNumber(30));
+    group.broadcast("set_bright", params, SCENE_TIMEOUT_MS);
+    for (size_t i = 0; i < bulbs; i++) {
+        count(group.get_result(i), counters);
+    }
+    faults.set_response_drop_rate(drop_rate);
+    faults.set_latency(LATENCY_NONE, 0);
+    counters.scene_phases++;
+}
+
+static double kb(const uint64_t bytes) {
+    return static_cast<double>(bytes) / 1024.0;
+}
+
+/**
+ * @brief Fits a line through the heap in use at the checkpoints after the warmup (least squares over the
+ * commands sent), and projects it over those commands.
+ * @return The growth in bytes, or 0 if the heap shrank.
+ */
+static uint64_t heap_growth(const SoakOptions &options, const std::vector<SoakCheckpoint> &checkpoints) {
+    std::vector<const SoakCheckpoint *> measured;
+    for (const auto &checkpoint: checkpoints) {
+        if (checkpoint.commands * 100 >= options.commands * options.warmup) {
+            measured.push_back(&checkpoint);
+        }
+    }
+    if (measured.size() < 4) {
+        return 0;
+    }
+    // A slope rather than early and late extremes: a leak shows as a steady trend however small each step,
+    // while a heap that only moves with the load averages out.
+    double mean_commands = 0;
+    double mean_in_use = 0;
+    for (const SoakCheckpoint *checkpoint: measured) {
+        mean_commands += static_cast<double>(checkpoint->commands);
+        mean_in_use += static_cast<double>(checkpoint->heap.in_use);
+    }
+    mean_commands /= static_cast<double>(measured.size());
+    mean_in_use /= static_cast<double>(measured.size());
+    double covariance = 0;
+    double variance = 0;
+    for (const SoakCheckpoint *checkpoint: measured) {
+        const double commands = static_cast<double>(checkpoint->commands) - mean_commands;
+        covariance += commands * (static_cast<double>(checkpoint->heap.in_use) - mean_in_use);
+        variance += commands * commands;
+    }
+    if (variance <= 0) {
+        return 0;
+    }
+    const double span = static_cast<double>(measured.back()->commands - measured.front()->commands);
+    const double growth = covariance / variance * span;
+    return growth > 0 ? static_cast<uint64_t>(growth) : 0;
+}
+
+static void report(const SoakOptions &options, const std::vector<SoakCheckpoint> &checkpoints,
+                   const SoakCounters &counters, const HeapMeter &meter, const FleetSimulator &fleet,
+                   const FaultTransport &faults, const uint64_t growth, const size_t unclaimed, const bool passed) {
+    const SoakCheckpoint &last = checkpoints.back();
+    const double allocations = last.commands == 0
+                                   ? 0
+                                   : static_cast<double>(last.heap.allocations) / static_cast<double>(last.commands);
+    if (options.json) {
+        printf("{\"checkpoints\":[");
+        for (size_t i = 0; i < checkpoints.size(); i++) {
+            const auto &checkpoint = checkpoints[i];
+            printf("%s\n  {\"commands\":%llu,\"simulated_ms\":%lu,\"in_use\":%llu,\"heap_size\":%llu,"
+                   "\"free\":%llu,\"fragmentation\":%.4f,\"allocations\":%llu}", i == 0 ? "" : ",",
+                   static_cast<unsigned long long>(checkpoint.commands), checkpoint.simulated_ms,
+                   static_cast<unsigned long long>(checkpoint.heap.in_use),
+                   static_cast<unsigned long long>(checkpoint.heap.heap_size),
+                   static_cast<unsigned long long>(checkpoint.heap.free_bytes), checkpoint.heap.fragmentation,
+                   static_cast<unsigned long long>(checkpoint.heap.allocations));
+        }
+        printf("\n],\"commands\":%llu,\"completed\":%llu,\"failed\":%llu,\"timeouts\":%llu,\"notifications\":%llu,"
+               "\"disconnects\":%u,\"music_sessions\":%llu,\"scene_phases\":%llu,\"peak_in_use\":%llu,\"peak_heap_size\":%llu,"
+               "\"allocations_per_command\":%.2f,\"growth\":%llu,\"unclaimed_responses\":%zu,\"passed\":%s}\n",
+               static_cast<unsigned long long>(counters.commands), static_cast<unsigned long long>(counters.completed),
+               static_cast<unsigned long long>(counters.failed), static_cast<unsigned long long>(counters.timeouts),
+               static_cast<unsigned long long>(fleet.get_notification_count()), faults.get_disconnects(),
+               static_cast<unsigned long long>(counters.music_sessions),
+               static_cast<unsigned long long>(counters.scene_phases),
+               static_cast<unsigned long long>(meter.get_peak_in_use()),
+               static_cast<unsigned long long>(meter.get_peak_heap_size()), allocations,
+               static_cast<unsigned long long>(growth), unclaimed, passed ? "true" : "false");
+        return;
+    }
+    printf("%10s %12s %12s %12s %10s %7s %14s\n", "commands", "simulated s", "in use KB", "heap KB", "free KB",
+           "frag %", "allocations");
+    for (const auto &checkpoint: checkpoints) {
+        printf("%10llu %12.1f %12.1f %12.1f %10.1f %7.2f %14llu\n",
+               static_cast<unsigned long long>(checkpoint.commands),
+               static_cast<double>(checkpoint.simulated_ms) / 1000.0, kb(checkpoint.heap.in_use),
+               kb(checkpoint.heap.heap_size), kb(checkpoint.heap.free_bytes), checkpoint.heap.fragmentation * 100,
+               static_cast<unsigned long long>(checkpoint.heap.allocations));
+    }
+    printf("commands %llu (completed %llu, failed %llu, timed out %llu), notifications %llu, disconnects %u, "
+           "music sessions %llu, scene phases %llu\n", static_cast<unsigned long long>(counters.commands),
+           static_cast<unsigned long long>(counters.completed), static_cast<unsigned long long>(counters.failed),
+           static_cast<unsigned long long>(counters.timeouts),
+           static_cast<unsigned long long>(fleet.get_notification_count()), faults.get_disconnects(),
+           static_cast<unsigned long long>(counters.music_sessions),
+           static_cast<unsigned long long>(counters.scene_phases));
+    printf("heap high-water %.1f KB in use, %.1f KB obtained; %.2f allocations per command\n",
+           kb(meter.get_peak_in_use()), kb(meter.get_peak_heap_size()), allocations);
+    printf("heap growth after warmup: %.1f KB (limit %.1f KB), unclaimed responses %zu (limit %zu): %s\n",
+           kb(growth), kb(options.max_growth), unclaimed, options.bulbs, passed ? "PASS" : "FAIL");
+}
+
+int main(int argc, char **argv) {
+    SoakOptions options;
+    if (!parse_options(argc, argv, options)) {
+        fprintf(stderr, "usage: %s [--bulbs=10] [--commands=2000000] [--time-scale=100] [--checkpoints=20]\n"
+                "       [--warmup=10] [--max-growth=KB] [--seed=N] [--no-faults] [--port=20300]\n"
+                "       [--format=table|json]\n", argv[0]);
+        return 2;
+    }
+    if (!HeapMeter::is_supported()) {
+        // The bytes in use would read as zero throughout, and the run would pass without measuring anything.
+        fprintf(stderr, "the heap in use cannot be counted under a sanitizer: build yeelight-soak without "
+                "YEELIGHT_SANITIZE\n");
+        return 2;
+    }
+    // Started first, so blocks the controller allocated earlier are not freed under the meter.
+    HeapMeter meter;
+    FleetSimulator fleet(options.bulbs, "color", SIM_DISTINCT_ADDRESSES, "127.1.0.1", options.port);
+    fleet.set_quota(0, 0);
+    fleet.set_ssdp(false);
+    if (!fleet.start()) {
+        fprintf(stderr, "cannot start a fleet of %zu bulbs on port %u\n", options.bulbs, options.port);
+        return 1;
+    }
+    FaultTransport faults(options.seed);
+    if (options.faults) {
+        faults.set_split_rate(0.05);
+        faults.set_response_drop_rate(RESPONSE_DROP_RATE);
+        faults.set_disconnect_rate(0.0002);
+    }
+    FaultTransport::install(&faults);
+    host_set_time_scale(options.time_scale);
+    std::vector<SoakCheckpoint> checkpoints;
+    // Reserved up front: growing the vector during the run would count as heap growth.
+    checkpoints.reserve(options.checkpoints + 2);
+    SoakCounters counters;
+    bool passed;
+    uint64_t growth;
+    {
+        auto links = open_links(fleet, options.bulbs, 1);
+        std::vector<std::deque<soak_pending> > pending(links.size());
+        Scene scene(links.size());
+        YeelightGroup group(links.size());
+        for (const auto &link: links) {
+            scene.add(link.get(), LightState{true, COLOR_MODE_RGB, 0xFFFFFF, 0, 0, 0, 100}, MAIN_LIGHT);
+            group.add(link.get());
+        }
+        const unsigned long start = millis();
+        uint64_t next_checkpoint = 0;
+        for (uint64_t round = 0; counters.commands < options.commands; round++) {
+            for (size_t bulb = 0; bulb < links.size(); bulb++) {
+                pipeline(*links[bulb], pending[bulb], counters);
+            }
+            Yeelight &link = *links[round % links.size()];
+            count(link.set_brightness(static_cast<uint8_t>(round % 100 + 1), EFFECT_SUDDEN), counters);
+            if (round % REFRESH_ROUNDS == 0) {
+                count(link.refreshProperties(), counters);
+            }
+            if (round % REQUEST_ROUNDS == 0) {
+                uint16_t id = 0;
+                counters.commands++;
+                if (link.request_properties(Yeelight::ALL_PROPERTIES, id) == SUCCESS) {
+                    pending[round % links.size()].push_back({id, millis()});
+                } else {
+                    counters.failed++;
+                }
+            }
+            if (round % SCENE_ROUNDS == SCENE_ROUNDS / 2) {
+                scene_phase(scene, group, round / SCENE_ROUNDS, faults, options.faults ? RESPONSE_DROP_RATE : 0,
+                            counters);
+            }
+            if (round % MUSIC_ROUNDS == MUSIC_ROUNDS - 1) {
+                music_session(link, pending[round % links.size()], counters);
+            }
+            yield();
+            if (counters.commands >= next_checkpoint) {
+                checkpoints.push_back({counters.commands, millis() - start, meter.sample()});
+                next_checkpoint += options.commands / options.checkpoints;
+            } else {
+                meter.sample();
+            }
+        }
+        for (size_t bulb = 0; bulb < links.size(); bulb++) {
+            for (const soak_pending &command: pending[bulb]) {
+                links[bulb]->forget_response(command.id);
+            }
+        }
+        // Late replies still in flight arrive before the responses are counted.
+        delay(REPLY_TIMEOUT_MS);
+        size_t unclaimed = 0;
+        for (const auto &link: links) {
+            unclaimed += link->get_unclaimed_responses();
+        }
+        checkpoints.push_back({counters.commands, millis() - start, meter.sample()});
+        growth = heap_growth(options, checkpoints);
+        passed = growth <= options.max_growth && unclaimed <= options.bulbs;
+        report(options, checkpoints, counters, meter, fleet, faults, growth, unclaimed, passed);
+    }
+    FaultTransport::install(nullptr);
+    fleet.stop();
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,49 @@
+#include "Yeelight.h"
+#include "ColorPipeline.h"
+#include <WiFi.h>
+
+const uint8_t deskIp[] = {192, 168, 1, 100};
+const uint8_t stripIp[] = {192, 168, 1, 101};
+Yeelight desk;
+Yeelight strip;
+ColorPipeline pipeline(2);
+
+const uint32_t colors[] = {0xFF0000, 0xFF8000, 0x00FF00, 0x0080FF, 0x8000FF};
+uint8_t current = 0;
+
+void setup() {
+    Serial.begin(115200);
+
+    // Connect to WiFi (replace with your network credentials)
+    WiFi.begin("YourWiFiSSID", "YourWiFiPassword");
+    while (WiFi.status() != WL_CONNECTED) {
+        delay(500);
+        Serial.print(".");
+    }
+    Serial.println("Connected to WiFi!");
+
+    // Connect to the bulbs
+    if (desk.connect(deskIp) != ResponseType::SUCCESS || strip.connect(stripIp) != ResponseType::SUCCESS) {
+        Serial.println("Error connecting to bulbs.");
+    }
+
+    // The desk lamp renders colors as expected
+    pipeline.add(&desk);
+
+    // The light strip is too blue and too bright in the mid tones: reduce blue and darken with a gamma curve
+    ColorCalibration stripCalibration;
+    stripCalibration.matrix[8] = 0.85f;
+    stripCalibration.offset[0] = 0.02f;
+    stripCalibration.gamma = 1.3f;
+    pipeline.add(&strip, AUTO, stripCalibration);
+}
+
+void loop() {
+    // Both lights show the same color, corrected per device
+    pipeline.set_all(colors[current]);
+    pipeline.process();
+    Serial.printf("Desk: %06X, strip: %06X\n", pipeline.get_output(0), pipeline.get_output(1));
+    pipeline.apply(EFFECT_SMOOTH, 500);
+    current = (current + 1) % 5;
+    delay(3000);
+}
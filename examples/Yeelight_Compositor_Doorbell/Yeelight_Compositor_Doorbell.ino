@@ -0,0 +1,44 @@
+#include "Yeelight.h"
+#include "Compositor.h"
+#include <WiFi.h>
+
+const uint8_t ip[] = {192, 168, 1, 100};
+const int doorbellPin = 0;
+Yeelight bulb;
+Compositor compositor(&bulb);
+
+void setup() {
+    Serial.begin(115200);
+    pinMode(doorbellPin, INPUT_PULLUP);
+
+    // Connect to WiFi (replace with your network credentials)
+    WiFi.begin("YourWiFiSSID", "YourWiFiPassword");
+    while (WiFi.status() != WL_CONNECTED) {
+        delay(500);
+        Serial.print(".");
+    }
+    Serial.println("Connected to WiFi!");
+
+    // Connect to the bulb
+    if (bulb.connect(ip) == ResponseType::SUCCESS) {
+        Serial.println("Connected to Yeelight bulb.");
+    } else {
+        Serial.println("Error connecting to bulb.");
+    }
+
+    // Base scene: warm white at 60%
+    compositor.add_layer(LAYER_BASE, {true, COLOR_MODE_COLOR_TEMPERATURE, 0, 2700, 0, 0, 60});
+
+    // Ambient effect: dim everything to 50% of the base brightness
+    compositor.add_layer(LAYER_EFFECT, {true, COLOR_MODE_UNKNOWN, 0, 0, 0, 0, 50}, BLEND_MULTIPLY_BRIGHTNESS);
+}
+
+void loop() {
+    // Doorbell: flash red for 3 seconds, then the light returns to the layers below on its own
+    if (digitalRead(doorbellPin) == LOW) {
+        compositor.add_layer(LAYER_ALERT, {true, COLOR_MODE_RGB, 0xFF0000, 0, 0, 0, 100}, BLEND_REPLACE, 3000);
+        Serial.println("Doorbell!");
+        delay(200);
+    }
+    compositor.loop();
+}
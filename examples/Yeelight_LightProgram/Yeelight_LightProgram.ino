@@ -0,0 +1,57 @@
+#include "Yeelight.h"
+#include "LightProgram.h"
+#include "LightProgramCompiler.h"
+#include <WiFi.h>
+
+const uint8_t ip[] = {192, 168, 1, 100};
+Yeelight bulb;
+LightProgramScheduler scheduler;
+std::vector<uint8_t> program;
+
+// Pulses between warm white and blue three times, then keeps the light dim while it stays on
+const char *source = R"(
+power on
+fade 500
+loop 3
+    ct 2700
+    wait 1000
+    rgb 0 0 255
+    wait 1000
+end
+waitfor bright > 50 10000
+if power == on
+    bright 20
+end
+)";
+
+void setup() {
+    Serial.begin(115200);
+
+    // Connect to WiFi (replace with your network credentials)
+    WiFi.begin("YourWiFiSSID", "YourWiFiPassword");
+    while (WiFi.status() != WL_CONNECTED) {
+        delay(500);
+        Serial.print(".");
+    }
+    Serial.println("Connected to WiFi!");
+
+    // Connect to the bulb
+    if (bulb.connect(ip) == ResponseType::SUCCESS) {
+        Serial.println("Connected to Yeelight bulb.");
+    } else {
+        Serial.println("Error connecting to bulb.");
+    }
+
+    // Compile the program and start it
+    LightProgramCompiler compiler;
+    if (!compiler.compile(source, program)) {
+        Serial.printf("Line %u: %s\n", compiler.get_error_line(), compiler.get_error().c_str());
+        return;
+    }
+    Serial.printf("Compiled %u bytes.\n", static_cast<unsigned>(program.size()));
+    scheduler.start(program.data(), program.size(), &bulb);
+}
+
+void loop() {
+    scheduler.loop();
+}
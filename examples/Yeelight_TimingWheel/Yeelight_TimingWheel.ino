@@ -0,0 +1,51 @@
+#include "Yeelight.h"
+#include "TimingWheel.h"
+#include <WiFi.h>
+
+const uint8_t ip[] = {192, 168, 1, 100};
+Yeelight bulb;
+TimingWheel timers(32);
+
+// Refreshes the cached properties every 30 seconds
+void refresh(void *arg) {
+    static_cast<Yeelight *>(arg)->refreshProperties();
+}
+
+// Dims the light one step at a time until it is off
+void fadeStep(void *arg) {
+    auto *light = static_cast<Yeelight *>(arg);
+    const uint8_t bright = light->getProperties().bright;
+    if (bright <= 10) {
+        light->set_power(false);
+        return;
+    }
+    light->set_brightness(bright - 10, EFFECT_SMOOTH, 1000);
+    timers.schedule(1500, fadeStep, light);
+}
+
+void setup() {
+    Serial.begin(115200);
+
+    // Connect to WiFi (replace with your network credentials)
+    WiFi.begin("YourWiFiSSID", "YourWiFiPassword");
+    while (WiFi.status() != WL_CONNECTED) {
+        delay(500);
+        Serial.print(".");
+    }
+    Serial.println("Connected to WiFi!");
+
+    // Connect to the bulb
+    if (bulb.connect(ip) == ResponseType::SUCCESS) {
+        Serial.println("Connected to Yeelight bulb.");
+    } else {
+        Serial.println("Error connecting to bulb.");
+    }
+
+    // Poll the bulb periodically and start a slow fade-out in one minute
+    timers.schedule(30000, refresh, &bulb, 30000);
+    timers.schedule(60000, fadeStep, &bulb);
+}
+
+void loop() {
+    timers.loop();
+}
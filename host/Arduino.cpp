@@ -0,0 +1,112 @@
+#include "Arduino.h"
+#include "HostLoop.h"
+
+#include <cstdarg>
+
+HostSerial Serial;
+
+// The clocks start at the first call, like at boot on the ESP32. unsigned long is 64 bits wide here, so they do
+// not wrap: a 32-bit wrap would break the `millis() - start` arithmetic of callers keeping unsigned long.
+static uint64_t elapsed_us() {
+    static const uint64_t start = host_now_us();
+    return host_now_us() - start;
+}
+
+unsigned long millis() {
+    return static_cast<unsigned long>(elapsed_us() / 1000);
+}
+
+unsigned long micros() {
+    return static_cast<unsigned long>(elapsed_us());
+}
+
+void delay(const unsigned long ms) {
+    const uint64_t end = host_now_us() + ms * 1000;
+    host_poll(0);
+    for (uint64_t now = host_now_us(); now < end; now = host_now_us()) {
+        host_poll(static_cast<int>((end - now + 999) / 1000));
+    }
+}
+
+void delayMicroseconds(const unsigned int us) {
+    const uint64_t end = host_now_us() + us;
+    while (host_now_us() < end) {
+    }
+}
+
+void yield() {
+    host_poll(0);
+}
+
+long random(const long max) {
+    return max <= 0 ? 0 : static_cast<long>(rand() % max);
+}
+
+long random(const long min, const long max) {
+    return max <= min ? min : min + random(max - min);
+}
+
+void randomSeed(const unsigned long seed) {
+    srand(static_cast<unsigned int>(seed));
+}
+
+std::string IPAddress::toString() const {
+    char text[16];
+    snprintf(text, sizeof(text), "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+    return text;
+}
+
+String::String(const double value, const unsigned int decimals) {
+    char text[64];
+    snprintf(text, sizeof(text), "%.*f", static_cast<int>(decimals), value);
+    assign(text);
+}
+
+size_t HostSerial::print(const char *text) {
+    return fputs(text, stdout) < 0 ? 0 : strlen(text);
+}
+
+size_t HostSerial::print(const char value) {
+    return putchar(value) == EOF ? 0 : 1;
+}
+
+size_t HostSerial::print(const int value, const int base) {
+    return print(static_cast<long>(value), base);
+}
+
+size_t HostSerial::print(const unsigned int value, const int base) {
+    return print(static_cast<unsigned long>(value), base);
+}
+
+size_t HostSerial::print(const long value, const int base) {
+    if (value < 0 && base == DEC) {
+        return print('-') + print(static_cast<unsigned long>(-value), base);
+    }
+    return print(static_cast<unsigned long>(value), base);
+}
+
+size_t HostSerial::print(unsigned long value, const int base) {
+    char text[8 * sizeof(value) + 1];
+    char *digit = text + sizeof(text) - 1;
+    *digit = '\0';
+    do {
+        const unsigned long remainder = value % static_cast<unsigned long>(base);
+        *--digit = static_cast<char>(remainder < 10 ? '0' + remainder : 'A' + remainder - 10);
+        value /= static_cast<unsigned long>(base);
+    } while (value != 0);
+    return print(digit);
+}
+
+size_t HostSerial::print(const double value, const int decimals) {
+    char text[64];
+    snprintf(text, sizeof(text), "%.*f", decimals, value);
+    return print(text);
+}
+
+size_t HostSerial::printf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    const int length = vprintf(format, args);
+    va_end(args);
+    return length < 0 ? 0 : static_cast<size_t>(length);
+}
@@ -0,0 +1,177 @@
+#ifndef YEELIGHTARDUINO_HOST_ARDUINO_H
+#define YEELIGHTARDUINO_HOST_ARDUINO_H
+
+/**
+ * @file Arduino.h
+ * @brief Host stand-in for the parts of the Arduino core used by the library and its examples.
+ *
+ * Time comes from the monotonic clock. delay() and yield() run the host event loop (see HostLoop.h), which
+ * plays the role of the AsyncTCP task.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+unsigned long millis();
+
+unsigned long micros();
+
+void delay(unsigned long ms);
+
+void delayMicroseconds(unsigned int us);
+
+void yield();
+
+long random(long max);
+
+long random(long min, long max);
+
+void randomSeed(unsigned long seed);
+
+/**
+ * @brief An IPv4 address, stored in network order like on the ESP32.
+ */
+class IPAddress {
+public:
+    IPAddress() = default;
+
+    IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth) : bytes{first, second, third, fourth} {
+    }
+
+    /**
+     * @brief Constructs an address from its network-order 32-bit value (as in `in_addr.s_addr`).
+     * @param address The address.
+     */
+    explicit IPAddress(uint32_t address) {
+        memcpy(bytes, &address, sizeof(bytes));
+    }
+
+    uint8_t operator[](const int index) const {
+        return bytes[index];
+    }
+
+    uint8_t &operator[](const int index) {
+        return bytes[index];
+    }
+
+    explicit operator uint32_t() const {
+        uint32_t address;
+        memcpy(&address, bytes, sizeof(address));
+        return address;
+    }
+
+    bool operator==(const IPAddress &other) const {
+        return memcmp(bytes, other.bytes, sizeof(bytes)) == 0;
+    }
+
+    std::string toString() const;
+
+private:
+    uint8_t bytes[4] = {};
+};
+
+/**
+ * @brief A minimal Arduino String.
+ */
+class String : public std::string {
+public:
+    String() = default;
+
+    String(const char *text) : std::string(text == nullptr ? "" : text) {
+    }
+
+    String(const std::string &text) : std::string(text) {
+    }
+
+    String(int value) : std::string(std::to_string(value)) {
+    }
+
+    String(unsigned int value) : std::string(std::to_string(value)) {
+    }
+
+    String(long value) : std::string(std::to_string(value)) {
+    }
+
+    String(unsigned long value) : std::string(std::to_string(value)) {
+    }
+
+    String(double value, unsigned int decimals = 2);
+
+    int toInt() const {
+        return atoi(c_str());
+    }
+};
+
+/**
+ * @brief A serial port writing to the standard output.
+ */
+class HostSerial {
+public:
+    void begin(unsigned long) {
+    }
+
+    void flush() {
+        fflush(stdout);
+    }
+
+    int available() const {
+        return 0;
+    }
+
+    int read() {
+        return -1;
+    }
+
+    size_t print(const char *text);
+
+    size_t print(const std::string &text) {
+        return print(text.c_str());
+    }
+
+    size_t print(char value);
+
+    size_t print(int value, int base = 10);
+
+    size_t print(unsigned int value, int base = 10);
+
+    size_t print(long value, int base = 10);
+
+    size_t print(unsigned long value, int base = 10);
+
+    size_t print(double value, int decimals = 2);
+
+    size_t print(const IPAddress &address) {
+        return print(address.toString());
+    }
+
+    size_t println() {
+        return print("\n");
+    }
+
+    template<typename T>
+    size_t println(const T &value) {
+        return print(value) + println();
+    }
+
+    template<typename T>
+    size_t println(const T &value, int format) {
+        return print(value, format) + println();
+    }
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+extern HostSerial Serial;
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#endif
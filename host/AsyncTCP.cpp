@@ -0,0 +1,417 @@
+#include "AsyncTCP.h"
+
+#include "FaultTransport.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/**
+ * @brief The receive chunk size, one TCP segment like lwIP delivers.
+ */
+static constexpr size_t RECEIVE_CHUNK = 1460;
+
+/**
+ * @brief The number of chunks read per event before other sockets get their turn.
+ */
+static constexpr int RECEIVE_BURST = 16;
+
+/**
+ * @brief The send buffer size, the default of lwIP on the ESP32 (4 segments).
+ */
+static constexpr size_t SEND_BUFFER = 5744;
+
+static void set_nonblocking(const int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
+static int8_t to_error(const int error) {
+    // AsyncTCP reports lwIP error codes; the closest ones are used.
+    switch (error) {
+        case ECONNREFUSED: return -14; // ERR_RST
+        case ECONNRESET: return -14;   // ERR_RST
+        case ETIMEDOUT: return -3;     // ERR_TIMEOUT
+        case EHOSTUNREACH:
+        case ENETUNREACH: return -4; // ERR_RTE
+        default: return -15;         // ERR_CLSD
+    }
+}
+
+AsyncClient::AsyncClient(const int fd) : fd(fd), state(fd < 0 ? CLIENT_DISCONNECTED : CLIENT_CONNECTED) {
+    if (fd < 0) {
+        return;
+    }
+    set_nonblocking(fd);
+    sockaddr_in peer{};
+    socklen_t length = sizeof(peer);
+    if (getpeername(fd, reinterpret_cast<sockaddr *>(&peer), &length) == 0) {
+        remote_ip = IPAddress(peer.sin_addr.s_addr);
+        remote_port = ntohs(peer.sin_port);
+    }
+    host_watch(this);
+}
+
+AsyncClient::~AsyncClient() {
+    // Like AsyncTCP, destroying a client closes its connection without calling back.
+    if (fd >= 0) {
+        host_unwatch(this);
+        ::close(fd);
+    }
+    if (faults != nullptr) {
+        faults->forget(this);
+    }
+}
+
+bool AsyncClient::connect(const IPAddress ip, const uint16_t port) {
+    if (fd >= 0) {
+        return false;
+    }
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+    set_nonblocking(fd);
+    configure();
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = static_cast<uint32_t>(ip);
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 && errno != EINPROGRESS) {
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    // Even an immediate success is reported from the event loop, as on the ESP32.
+    remote_ip = ip;
+    remote_port = port;
+    state = CLIENT_CONNECTING;
+    faults = FaultTransport::installed();
+    host_watch(this);
+    return true;
+}
+
+bool AsyncClient::connect(const char *host, const uint16_t port) {
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *result = nullptr;
+    if (getaddrinfo(host, nullptr, &hints, &result) != 0 || result == nullptr) {
+        return false;
+    }
+    const IPAddress ip(reinterpret_cast<sockaddr_in *>(result->ai_addr)->sin_addr.s_addr);
+    freeaddrinfo(result);
+    return connect(ip, port);
+}
+
+void AsyncClient::close(bool) {
+    if (fd < 0) {
+        return;
+    }
+    host_unwatch(this);
+    ::close(fd);
+    fd = -1;
+    state = CLIENT_DISCONNECTED;
+    output.clear();
+    if (faults != nullptr) {
+        faults->forget(this);
+        faults = nullptr;
+    }
+    // Last: the callback may delete this client.
+    if (disconnect_cb) {
+        disconnect_cb(disconnect_arg, this);
+    }
+}
+
+bool AsyncClient::connected() const {
+    return state == CLIENT_CONNECTED;
+}
+
+bool AsyncClient::connecting() const {
+    return state == CLIENT_CONNECTING;
+}
+
+bool AsyncClient::disconnected() const {
+    return state == CLIENT_DISCONNECTED;
+}
+
+size_t AsyncClient::space() const {
+    if (!connected()) {
+        return 0;
+    }
+    // Data waiting for the socket counts against the buffer, like unacknowledged data in lwIP.
+    const size_t space = output.size() < SEND_BUFFER ? SEND_BUFFER - output.size() : 0;
+    return faults != nullptr ? faults->space(this, space) : space;
+}
+
+size_t AsyncClient::add(const char *data, const size_t size, uint8_t) {
+    if (!connected() || data == nullptr) {
+        return 0;
+    }
+    if (faults != nullptr) {
+        return faults->write(this, data, size, output.size() < SEND_BUFFER ? SEND_BUFFER - output.size() : 0);
+    }
+    output.append(data, size);
+    host_update(this);
+    return size;
+}
+
+bool AsyncClient::send() {
+    while (!output.empty()) {
+        const ssize_t sent = ::send(fd, output.data(), output.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0) {
+            // The rest goes out when the socket is writable; errors are reported by the event loop.
+            host_update(this);
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        output.erase(0, static_cast<size_t>(sent));
+    }
+    host_update(this);
+    return true;
+}
+
+size_t AsyncClient::write(const char *data) {
+    return data == nullptr ? 0 : write(data, strlen(data));
+}
+
+size_t AsyncClient::write(const char *data, const size_t size, const uint8_t apiflags) {
+    const size_t added = add(data, size, apiflags);
+    if (added == 0 || (apiflags & ASYNC_WRITE_FLAG_MORE) != 0) {
+        return added;
+    }
+    return send() ? added : 0;
+}
+
+void AsyncClient::setNoDelay(const bool nodelay) {
+    this->nodelay = nodelay;
+    configure();
+}
+
+void AsyncClient::setKeepAlive(const uint32_t ms, const uint8_t cnt) {
+    keepalive = ms;
+    keepalive_count = cnt;
+    configure();
+}
+
+IPAddress AsyncClient::remoteIP() const {
+    return remote_ip;
+}
+
+uint16_t AsyncClient::remotePort() const {
+    return remote_port;
+}
+
+IPAddress AsyncClient::localIP() const {
+    sockaddr_in local{};
+    socklen_t length = sizeof(local);
+    if (fd < 0 || getsockname(fd, reinterpret_cast<sockaddr *>(&local), &length) != 0) {
+        return {};
+    }
+    return IPAddress(local.sin_addr.s_addr);
+}
+
+uint16_t AsyncClient::localPort() const {
+    sockaddr_in local{};
+    socklen_t length = sizeof(local);
+    if (fd < 0 || getsockname(fd, reinterpret_cast<sockaddr *>(&local), &length) != 0) {
+        return 0;
+    }
+    return ntohs(local.sin_port);
+}
+
+void AsyncClient::onConnect(AcConnectHandler cb, void *arg) {
+    connect_cb = std::move(cb);
+    connect_arg = arg;
+}
+
+void AsyncClient::onDisconnect(AcConnectHandler cb, void *arg) {
+    disconnect_cb = std::move(cb);
+    disconnect_arg = arg;
+}
+
+void AsyncClient::onData(AcDataHandler cb, void *arg) {
+    data_cb = std::move(cb);
+    data_arg = arg;
+}
+
+void AsyncClient::onError(AcErrorHandler cb, void *arg) {
+    error_cb = std::move(cb);
+    error_arg = arg;
+}
+
+int AsyncClient::poll_fd() const {
+    return fd;
+}
+
+short AsyncClient::poll_events() const {
+    if (state == CLIENT_CONNECTING) {
+        return POLLOUT;
+    }
+    return static_cast<short>(output.empty() ? POLLIN : POLLIN | POLLOUT);
+}
+
+void AsyncClient::on_poll(const short revents) {
+    const uint64_t serial = host_serial(this);
+    if (state == CLIENT_CONNECTING) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0) {
+            fail(error);
+            return;
+        }
+        state = CLIENT_CONNECTED;
+        configure();
+        host_update(this);
+        if (connect_cb) {
+            connect_cb(connect_arg, this);
+        }
+        return;
+    }
+    if (revents & POLLOUT) {
+        send();
+    }
+    if ((revents & (POLLIN | POLLHUP | POLLERR)) == 0) {
+        return;
+    }
+    char buffer[RECEIVE_CHUNK];
+    for (int chunk = 0; chunk < RECEIVE_BURST && host_watched(this, serial); chunk++) {
+        const ssize_t received = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (received > 0) {
+            if (faults != nullptr) {
+                faults->read(this, buffer, static_cast<size_t>(received));
+            } else {
+                receive(buffer, static_cast<size_t>(received));
+            }
+            continue;
+        }
+        if (received == 0) {
+            close();
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            fail(errno);
+        }
+        return;
+    }
+}
+
+void AsyncClient::configure() const {
+    if (fd < 0) {
+        return;
+    }
+    const int flag = nodelay ? 1 : 0;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    const int enabled = keepalive != 0 ? 1 : 0;
+    setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &enabled, sizeof(enabled));
+    if (enabled) {
+        const int seconds = keepalive < 1000 ? 1 : static_cast<int>(keepalive / 1000);
+        const int count = keepalive_count == 0 ? 1 : keepalive_count;
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &seconds, sizeof(seconds));
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &seconds, sizeof(seconds));
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+    }
+}
+
+void AsyncClient::transmit(const char *data, const size_t size) {
+    output.append(data, size);
+    host_update(this);
+}
+
+void AsyncClient::receive(const char *data, const size_t size) {
+    if (data_cb) {
+        data_cb(data_arg, this, const_cast<char *>(data), size);
+    }
+}
+
+void AsyncClient::fail(const int error) {
+    const uint64_t serial = host_serial(this);
+    if (error_cb) {
+        error_cb(error_arg, this, to_error(error));
+    }
+    if (host_watched(this, serial)) {
+        close();
+    }
+}
+
+AsyncServer::AsyncServer(const uint16_t port) : port(port) {
+}
+
+AsyncServer::AsyncServer(const IPAddress address, const uint16_t port) : address(address), port(port) {
+}
+
+AsyncServer::~AsyncServer() {
+    end();
+}
+
+void AsyncServer::onClient(AcConnectHandler cb, void *arg) {
+    client_cb = std::move(cb);
+    client_arg = arg;
+}
+
+void AsyncServer::begin() {
+    if (fd >= 0) {
+        return;
+    }
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return;
+    }
+    set_nonblocking(fd);
+    const int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_port = htons(port);
+    local.sin_addr.s_addr = static_cast<uint32_t>(address);
+    if (bind(fd, reinterpret_cast<sockaddr *>(&local), sizeof(local)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        ::close(fd);
+        fd = -1;
+        return;
+    }
+    host_watch(this);
+}
+
+void AsyncServer::end() {
+    if (fd >= 0) {
+        host_unwatch(this);
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+void AsyncServer::setNoDelay(const bool nodelay) {
+    this->nodelay = nodelay;
+}
+
+uint8_t AsyncServer::status() const {
+    return fd >= 0 ? 1 : 0;
+}
+
+int AsyncServer::poll_fd() const {
+    return fd;
+}
+
+short AsyncServer::poll_events() const {
+    return POLLIN;
+}
+
+void AsyncServer::on_poll(short) {
+    const uint64_t serial = host_serial(this);
+    while (host_watched(this, serial)) {
+        const int accepted = accept(fd, nullptr, nullptr);
+        if (accepted < 0) {
+            return;
+        }
+        auto *client = new AsyncClient(accepted);
+        client->setNoDelay(nodelay);
+        if (client_cb) {
+            client_cb(client_arg, client);
+        } else {
+            delete client;
+        }
+    }
+}
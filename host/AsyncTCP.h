@@ -0,0 +1,177 @@
+#ifndef YEELIGHTARDUINO_HOST_ASYNCTCP_H
+#define YEELIGHTARDUINO_HOST_ASYNCTCP_H
+
+/**
+ * @file AsyncTCP.h
+ * @brief Host stand-in for AsyncTCP, backed by non-blocking POSIX sockets.
+ *
+ * The API and callback semantics follow AsyncTCP: connect() returns at once and onConnect follows, onData
+ * receives the bytes as they arrive, and onDisconnect follows every close, whether local, remote or caused
+ * by an error (after onError). Callbacks run from the host event loop (see HostLoop.h) and may delete the
+ * client. Connections opened with connect() while a FaultTransport is installed go through it.
+ */
+
+#include <Arduino.h>
+#include <functional>
+#include "HostLoop.h"
+
+#define ASYNC_WRITE_FLAG_COPY 0x01
+#define ASYNC_WRITE_FLAG_MORE 0x02
+
+class AsyncClient;
+
+class FaultTransport;
+
+typedef std::function<void(void *, AsyncClient *)> AcConnectHandler;
+typedef std::function<void(void *, AsyncClient *, void *data, size_t len)> AcDataHandler;
+typedef std::function<void(void *, AsyncClient *, int8_t error)> AcErrorHandler;
+
+class AsyncClient : public HostPollable {
+public:
+    /**
+     * @brief Constructs a client, unconnected or wrapping a connected socket.
+     * @param fd A connected socket (taken over), or -1.
+     */
+    explicit AsyncClient(int fd = -1);
+
+    ~AsyncClient() override;
+
+    AsyncClient(const AsyncClient &) = delete;
+
+    AsyncClient &operator=(const AsyncClient &) = delete;
+
+    bool connect(IPAddress ip, uint16_t port);
+
+    bool connect(const char *host, uint16_t port);
+
+    void close(bool now = false);
+
+    void stop() {
+        close(false);
+    }
+
+    bool connected() const;
+
+    bool connecting() const;
+
+    bool disconnected() const;
+
+    bool freeable() const {
+        return disconnected();
+    }
+
+    size_t space() const;
+
+    size_t add(const char *data, size_t size, uint8_t apiflags = ASYNC_WRITE_FLAG_COPY);
+
+    bool send();
+
+    size_t write(const char *data);
+
+    size_t write(const char *data, size_t size, uint8_t apiflags = ASYNC_WRITE_FLAG_COPY);
+
+    void setNoDelay(bool nodelay);
+
+    void setKeepAlive(uint32_t ms, uint8_t cnt);
+
+    IPAddress remoteIP() const;
+
+    uint16_t remotePort() const;
+
+    IPAddress localIP() const;
+
+    uint16_t localPort() const;
+
+    void onConnect(AcConnectHandler cb, void *arg = nullptr);
+
+    void onDisconnect(AcConnectHandler cb, void *arg = nullptr);
+
+    void onData(AcDataHandler cb, void *arg = nullptr);
+
+    void onError(AcErrorHandler cb, void *arg = nullptr);
+
+    int poll_fd() const override;
+
+    short poll_events() const override;
+
+    void on_poll(short revents) override;
+
+private:
+    friend class FaultTransport;
+
+    enum client_state
+    {
+        CLIENT_DISCONNECTED,
+        CLIENT_CONNECTING,
+        CLIENT_CONNECTED
+    };
+
+    int fd;
+    client_state state;
+    std::string output;
+    IPAddress remote_ip;
+    uint16_t remote_port = 0;
+    uint32_t keepalive = 0;
+    uint8_t keepalive_count = 0;
+    bool nodelay = false;
+    AcConnectHandler connect_cb;
+    void *connect_arg = nullptr;
+    AcConnectHandler disconnect_cb;
+    void *disconnect_arg = nullptr;
+    AcDataHandler data_cb;
+    void *data_arg = nullptr;
+    AcErrorHandler error_cb;
+    void *error_arg = nullptr;
+    FaultTransport *faults = nullptr;
+
+    void configure() const;
+
+    void transmit(const char *data, size_t size);
+
+    void receive(const char *data, size_t size);
+
+    void fail(int error);
+};
+
+class AsyncServer : public HostPollable {
+public:
+    explicit AsyncServer(uint16_t port);
+
+    AsyncServer(IPAddress address, uint16_t port);
+
+    ~AsyncServer() override;
+
+    AsyncServer(const AsyncServer &) = delete;
+
+    AsyncServer &operator=(const AsyncServer &) = delete;
+
+    void onClient(AcConnectHandler cb, void *arg);
+
+    void begin();
+
+    void end();
+
+    void setNoDelay(bool nodelay);
+
+    /**
+     * @brief Returns the listening state.
+     * @return 1 (LISTEN) while listening, 0 (CLOSED) otherwise.
+     */
+    uint8_t status() const;
+
+    int poll_fd() const override;
+
+    short poll_events() const override;
+
+    void on_poll(short revents) override;
+
+private:
+    int fd = -1;
+    IPAddress address;
+    uint16_t port;
+    bool nodelay = false;
+    AcConnectHandler client_cb;
+    void *client_arg = nullptr;
+};
+
+#endif
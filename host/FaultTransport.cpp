@@ -0,0 +1,283 @@
+#include "FaultTransport.h"
+
+#include "AsyncTCP.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+/**
+ * @brief The free space reported by a nearly full send buffer is below this.
+ */
+static constexpr size_t NEARLY_FULL = 32;
+
+static FaultTransport *installed_transport = nullptr;
+
+static double clamp_rate(const double rate) {
+    return rate < 0 ? 0 : rate > 1 ? 1 : rate;
+}
+
+FaultTransport::FaultTransport(const uint64_t seed) : seed(seed), self(std::make_shared<FaultTransport *>(this)) {
+}
+
+FaultTransport::~FaultTransport() {
+    if (installed_transport == this) {
+        installed_transport = nullptr;
+    }
+}
+
+void FaultTransport::install(FaultTransport *transport) {
+    installed_transport = transport;
+}
+
+FaultTransport *FaultTransport::installed() {
+    return installed_transport;
+}
+
+void FaultTransport::set_latency(const FaultLatency distribution, const uint32_t base_us, const uint32_t spread_us) {
+    latency = distribution;
+    this->base_us = base_us;
+    this->spread_us = spread_us;
+}
+
+void FaultTransport::set_request_drop_rate(const double rate) {
+    request_drop_rate = clamp_rate(rate);
+}
+
+void FaultTransport::set_response_drop_rate(const double rate) {
+    response_drop_rate = clamp_rate(rate);
+}
+
+void FaultTransport::set_partial_write_rate(const double rate) {
+    partial_write_rate = clamp_rate(rate);
+}
+
+void FaultTransport::set_split_rate(const double rate, const uint8_t max_pieces) {
+    split_rate = clamp_rate(rate);
+    this->max_pieces = std::max<uint8_t>(max_pieces, 2);
+}
+
+void FaultTransport::set_disconnect_rate(const double rate) {
+    disconnect_rate = clamp_rate(rate);
+}
+
+void FaultTransport::set_quota_error_rate(const double rate) {
+    quota_error_rate = clamp_rate(rate);
+}
+
+uint32_t FaultTransport::get_dropped_requests() const {
+    return dropped_requests;
+}
+
+uint32_t FaultTransport::get_dropped_responses() const {
+    return dropped_responses;
+}
+
+uint32_t FaultTransport::get_partial_writes() const {
+    return partial_writes;
+}
+
+uint32_t FaultTransport::get_split_reads() const {
+    return split_reads;
+}
+
+uint32_t FaultTransport::get_disconnects() const {
+    return disconnects;
+}
+
+uint32_t FaultTransport::get_quota_errors() const {
+    return quota_errors;
+}
+
+size_t FaultTransport::space(const AsyncClient *client, const size_t space) {
+    client_state &connection = state(client);
+    if (space == 0 || !roll(connection.send_random, partial_write_rate)) {
+        connection.write_limit = SIZE_MAX;
+        return space;
+    }
+    // The next add() honours the reported space, as AsyncTCP's does.
+    connection.write_limit = next(connection.send_random) % std::min(space, NEARLY_FULL);
+    partial_writes++;
+    return connection.write_limit;
+}
+
+size_t FaultTransport::write(AsyncClient *client, const char *data, const size_t size, const size_t space) {
+    client_state &connection = state(client);
+    size_t accepted = std::min(size, space);
+    if (connection.write_limit != SIZE_MAX) {
+        accepted = std::min(accepted, connection.write_limit);
+        connection.write_limit = SIZE_MAX;
+    } else if (accepted > 0 && roll(connection.send_random, partial_write_rate)) {
+        // Written without asking for the space first: the buffer is found nearly full.
+        accepted = next(connection.send_random) % std::min(accepted, NEARLY_FULL);
+        partial_writes++;
+    }
+    connection.request.append(data, accepted);
+    size_t start = 0;
+    size_t end;
+    while ((end = connection.request.find('\n', start)) != std::string::npos) {
+        forward(client, connection.request.substr(start, end + 1 - start));
+        start = end + 1;
+    }
+    connection.request.erase(0, start);
+    return accepted;
+}
+
+void FaultTransport::read(AsyncClient *client, const char *data, const size_t size) {
+    client_state &connection = state(client);
+    connection.response.append(data, size);
+    size_t start = 0;
+    size_t end;
+    while ((end = connection.response.find('\n', start)) != std::string::npos) {
+        receive(client, connection.response.substr(start, end + 1 - start));
+        start = end + 1;
+    }
+    connection.response.erase(0, start);
+}
+
+void FaultTransport::forget(const AsyncClient *client) {
+    clients.erase(client);
+}
+
+static uint64_t mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+FaultTransport::client_state &FaultTransport::state(const AsyncClient *client) {
+    const auto found = clients.find(client);
+    if (found != clients.end()) {
+        return found->second;
+    }
+    // Each direction of each connection gets its own stream, so a connection's traffic only moves its own faults.
+    const uint64_t ordinal = connections++;
+    client_state &connection = clients[client];
+    connection.send_random = mix(seed ^ mix(2 * ordinal + 1));
+    connection.receive_random = mix(seed ^ mix(2 * ordinal + 2));
+    return connection;
+}
+
+uint64_t FaultTransport::next(uint64_t &random) {
+    // splitmix64: small, fast and the same on every platform.
+    return mix(random += 0x9E3779B97F4A7C15ULL);
+}
+
+double FaultTransport::uniform(uint64_t &random) {
+    return static_cast<double>(next(random) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+bool FaultTransport::roll(uint64_t &random, const double rate) {
+    // Nothing is drawn for a disabled fault, so enabling one fault does not change when the others happen.
+    return rate > 0 && uniform(random) < rate;
+}
+
+uint64_t FaultTransport::sample_latency(uint64_t &random) const {
+    switch (latency) {
+        case LATENCY_NONE:
+            return 0;
+        case LATENCY_FIXED:
+            return base_us;
+        case LATENCY_UNIFORM:
+            return base_us + static_cast<uint64_t>(uniform(random) * spread_us);
+        case LATENCY_EXPONENTIAL:
+            return base_us + static_cast<uint64_t>(-std::log(1.0 - uniform(random)) * spread_us);
+        case LATENCY_PARETO: {
+            const double tail = spread_us / std::pow(1.0 - uniform(random), 1.0 / 1.5);
+            return base_us + static_cast<uint64_t>(std::min(tail, 100.0 * spread_us));
+        }
+    }
+    return 0;
+}
+
+void FaultTransport::forward(AsyncClient *client, const std::string &line) {
+    client_state &connection = state(client);
+    if (roll(connection.send_random, quota_error_rate)) {
+        // Answered as the device does when the quota is used up; requests without an id get no answer.
+        const char *id = strstr(line.c_str(), "\"id\":");
+        quota_errors++;
+        if (id != nullptr) {
+            std::string reply = "{\"id\":";
+            reply += std::to_string(strtoul(id + 5, nullptr, 10));
+            reply += ", \"error\":{\"code\":-1, \"message\":\"client quota exceeded\"}}\r\n";
+            if (!connection.closing) {
+                enqueue(client, connection, connection.send_random, std::move(reply), false);
+            }
+        }
+        return;
+    }
+    if (roll(connection.send_random, request_drop_rate)) {
+        dropped_requests++;
+        return;
+    }
+    client->transmit(line.data(), line.size());
+}
+
+void FaultTransport::receive(AsyncClient *client, const std::string &line) {
+    client_state &connection = state(client);
+    uint64_t &random = connection.receive_random;
+    if (connection.closing) {
+        return;
+    }
+    if (roll(random, response_drop_rate)) {
+        dropped_responses++;
+        return;
+    }
+    if (roll(random, disconnect_rate)) {
+        disconnects++;
+        connection.closing = true;
+        enqueue(client, connection, random, line.substr(0, next(random) % line.size()), true);
+        return;
+    }
+    if (line.size() < 2 || !roll(random, split_rate)) {
+        enqueue(client, connection, random, line, false);
+        return;
+    }
+    split_reads++;
+    size_t pieces = 2 + next(random) % (max_pieces - 1);
+    pieces = std::min(pieces, line.size());
+    size_t start = 0;
+    for (size_t piece = 1; piece < pieces; piece++) {
+        // Each piece takes at least one byte and leaves at least one for every later piece.
+        const size_t room = line.size() - start - (pieces - piece);
+        const size_t length = 1 + next(random) % room;
+        enqueue(client, connection, random, line.substr(start, length), false);
+        start += length;
+    }
+    enqueue(client, connection, random, line.substr(start), false);
+}
+
+void FaultTransport::enqueue(AsyncClient *client, client_state &connection, uint64_t &random, std::string data,
+                             const bool close_after) {
+    const uint64_t now = host_now_us();
+    // Never before the previous delivery: the connection stays in order.
+    connection.delivered_us = std::max(now + sample_latency(random), connection.delivered_us);
+    connection.deliveries.push_back({std::move(data), close_after});
+    const uint64_t serial = host_serial(client);
+    const std::weak_ptr<FaultTransport *> transport = self;
+    host_schedule(connection.delivered_us - now, [transport, client, serial]() {
+        const auto alive = transport.lock();
+        if (alive) {
+            (*alive)->deliver(client, serial);
+        }
+    });
+}
+
+void FaultTransport::deliver(AsyncClient *client, const uint64_t serial) {
+    if (!host_watched(client, serial)) {
+        return;
+    }
+    const auto connection = clients.find(client);
+    if (connection == clients.end() || connection->second.deliveries.empty()) {
+        return;
+    }
+    // Every delivery has its own task, and tasks run in due order: the oldest pending one is due.
+    pending_delivery delivery = std::move(connection->second.deliveries.front());
+    connection->second.deliveries.pop_front();
+    if (!delivery.data.empty()) {
+        client->receive(delivery.data.data(), delivery.data.size());
+    }
+    if (delivery.close_after && host_watched(client, serial)) {
+        client->close();
+    }
+}
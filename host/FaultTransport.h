@@ -0,0 +1,225 @@
+#ifndef YEELIGHTARDUINO_HOST_FAULTTRANSPORT_H
+#define YEELIGHTARDUINO_HOST_FAULTTRANSPORT_H
+
+/**
+ * @file FaultTransport.h
+ * @brief Reproducible network faults for the host AsyncClient.
+ *
+ * Once installed, a FaultTransport sits between every AsyncClient opened with connect() and its socket. It
+ * delays and splits what the client receives, drops request and response lines, reports a full send buffer
+ * (so add() accepts only part of a write), closes connections in the middle of a response and answers
+ * requests with the devices' `client quota exceeded` error. Every connection draws its decisions from two
+ * generators, one per direction, derived from the seed given at construction and the order in which the
+ * connections were opened: with the same seed and the same traffic, the same faults happen, and the traffic
+ * of one connection does not move the faults of another.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+class AsyncClient;
+
+/**
+ * @brief Enumeration of the latency distributions of a FaultTransport.
+ */
+enum FaultLatency
+{
+    LATENCY_NONE,        /**< No added latency */
+    LATENCY_FIXED,       /**< base */
+    LATENCY_UNIFORM,     /**< base plus a uniform value in [0, spread] */
+    LATENCY_EXPONENTIAL, /**< base plus an exponential value of mean spread */
+    LATENCY_PARETO       /**< base plus a Pareto tail (shape 1.5) of scale spread, capped at 100 spread */
+};
+
+/**
+ * @class FaultTransport
+ * @brief Injects seeded network faults into the host AsyncClient connections.
+ *
+ * Requests are forwarded and responses delivered one line at a time, so a fault hits a whole command or
+ * reply, as on a real network where the device answers with one segment per line. Received lines are
+ * delivered in order, each after its sampled latency but never before the previous one. When the peer
+ * closes, lines still delayed are lost. The transport must outlive the connections opened while it was
+ * installed; deliveries still pending when it is destroyed are dropped.
+ */
+class FaultTransport {
+public:
+    /**
+     * @brief Constructs a transport that injects no faults until configured.
+     * @param seed The seed the fault generators of the connections are derived from.
+     */
+    explicit FaultTransport(uint64_t seed = 1);
+
+    ~FaultTransport();
+
+    FaultTransport(const FaultTransport &) = delete;
+
+    FaultTransport &operator=(const FaultTransport &) = delete;
+
+    /**
+     * @brief Installs a transport for the connections opened from now on.
+     * @param transport The transport, or nullptr to stop injecting faults.
+     */
+    static void install(FaultTransport *transport);
+
+    /**
+     * @brief Returns the installed transport.
+     * @return The transport, or nullptr.
+     */
+    static FaultTransport *installed();
+
+    /**
+     * @brief Sets the latency added to every received chunk, in the order the chunks arrived.
+     * @param distribution The distribution.
+     * @param base_us The base latency in microseconds.
+     * @param spread_us The spread of the distribution in microseconds.
+     */
+    void set_latency(FaultLatency distribution, uint32_t base_us, uint32_t spread_us = 0);
+
+    /**
+     * @brief Sets the probability that a request line is never sent.
+     * @param rate The probability, from 0 to 1.
+     */
+    void set_request_drop_rate(double rate);
+
+    /**
+     * @brief Sets the probability that a received line is never delivered.
+     * @param rate The probability, from 0 to 1.
+     */
+    void set_response_drop_rate(double rate);
+
+    /**
+     * @brief Sets the probability that space() reports a nearly full send buffer, which add() then honours.
+     * @param rate The probability, from 0 to 1, per call to space() or add().
+     */
+    void set_partial_write_rate(double rate);
+
+    /**
+     * @brief Sets the probability that a received chunk is delivered in several onData calls.
+     * @param rate The probability, from 0 to 1.
+     * @param max_pieces The maximum number of pieces.
+     */
+    void set_split_rate(double rate, uint8_t max_pieces = 4);
+
+    /**
+     * @brief Sets the probability that the connection closes in the middle of a received line.
+     * @param rate The probability, from 0 to 1, per line.
+     */
+    void set_disconnect_rate(double rate);
+
+    /**
+     * @brief Sets the probability that a request is answered with the `client quota exceeded` error
+     * instead of being sent.
+     * @param rate The probability, from 0 to 1.
+     */
+    void set_quota_error_rate(double rate);
+
+    uint32_t get_dropped_requests() const;
+
+    uint32_t get_dropped_responses() const;
+
+    uint32_t get_partial_writes() const;
+
+    uint32_t get_split_reads() const;
+
+    uint32_t get_disconnects() const;
+
+    uint32_t get_quota_errors() const;
+
+    /**
+     * @brief Filters the free space of a client's send buffer. Called by AsyncClient.
+     * @param client The client.
+     * @param space The real free space.
+     * @return The space to report.
+     */
+    size_t space(const AsyncClient *client, size_t space);
+
+    /**
+     * @brief Takes bytes written by a client, forwarding whole request lines. Called by AsyncClient.
+     * @param client The client.
+     * @param data The bytes.
+     * @param size The number of bytes.
+     * @param space The real free space of the send buffer.
+     * @return The number of bytes accepted.
+     */
+    size_t write(AsyncClient *client, const char *data, size_t size, size_t space);
+
+    /**
+     * @brief Takes bytes received by a client, scheduling their delivery. Called by AsyncClient.
+     * @param client The client.
+     * @param data The bytes.
+     * @param size The number of bytes.
+     */
+    void read(AsyncClient *client, const char *data, size_t size);
+
+    /**
+     * @brief Forgets a client that closed. Called by AsyncClient.
+     * @param client The client.
+     */
+    void forget(const AsyncClient *client);
+
+private:
+    struct pending_delivery
+    {
+        std::string data;
+        bool close_after;
+    };
+
+    struct client_state
+    {
+        std::string request;
+        std::string response;
+        std::deque<pending_delivery> deliveries;
+        uint64_t delivered_us = 0;
+        size_t write_limit = SIZE_MAX;
+        bool closing = false;
+        uint64_t send_random = 0;
+        uint64_t receive_random = 0;
+    };
+
+    uint64_t seed;
+    uint64_t connections = 0;
+    FaultLatency latency = LATENCY_NONE;
+    uint32_t base_us = 0;
+    uint32_t spread_us = 0;
+    double request_drop_rate = 0;
+    double response_drop_rate = 0;
+    double partial_write_rate = 0;
+    double split_rate = 0;
+    uint8_t max_pieces = 4;
+    double disconnect_rate = 0;
+    double quota_error_rate = 0;
+    uint32_t dropped_requests = 0;
+    uint32_t dropped_responses = 0;
+    uint32_t partial_writes = 0;
+    uint32_t split_reads = 0;
+    uint32_t disconnects = 0;
+    uint32_t quota_errors = 0;
+    std::unordered_map<const AsyncClient *, client_state> clients;
+    // Pending deliveries hold a weak reference, so they are dropped once the transport is gone.
+    std::shared_ptr<FaultTransport *> self;
+
+    client_state &state(const AsyncClient *client);
+
+    static uint64_t next(uint64_t &random);
+
+    static double uniform(uint64_t &random);
+
+    static bool roll(uint64_t &random, double rate);
+
+    uint64_t sample_latency(uint64_t &random) const;
+
+    void forward(AsyncClient *client, const std::string &line);
+
+    void receive(AsyncClient *client, const std::string &line);
+
+    void enqueue(AsyncClient *client, client_state &connection, uint64_t &random, std::string data,
+                 bool close_after);
+
+    void deliver(AsyncClient *client, uint64_t serial);
+};
+
+#endif
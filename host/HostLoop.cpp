@@ -0,0 +1,221 @@
+#include "HostLoop.h"
+
+#include <cstddef>
+#include <ctime>
+#include <map>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief A watched object: its serial, the events its socket is registered for, and whether they may have
+ * changed since.
+ */
+struct watched_object
+{
+    uint64_t serial;
+    short events;
+    bool updated;
+};
+
+static std::unordered_map<const HostPollable *, watched_object> &watched() {
+    static std::unordered_map<const HostPollable *, watched_object> objects;
+    return objects;
+}
+
+/**
+ * @brief The watched objects by serial, which the epoll events carry: an object deleted by a callback is no
+ * longer found, even if another one reuses its address.
+ */
+static std::unordered_map<uint64_t, HostPollable *> &serials() {
+    static std::unordered_map<uint64_t, HostPollable *> objects;
+    return objects;
+}
+
+/**
+ * @brief The objects whose events may have changed, applied before the loop waits.
+ */
+static std::vector<HostPollable *> &updated() {
+    static std::vector<HostPollable *> objects;
+    return objects;
+}
+
+static uint64_t next_serial = 1;
+
+static int epoll_descriptor() {
+    static const int descriptor = epoll_create1(EPOLL_CLOEXEC);
+    return descriptor;
+}
+
+static std::multimap<uint64_t, std::function<void()>> &scheduled() {
+    static std::multimap<uint64_t, std::function<void()>> tasks;
+    return tasks;
+}
+
+static uint64_t real_us() {
+    timespec now{};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000 + static_cast<uint64_t>(now.tv_nsec) / 1000;
+}
+
+/**
+ * @brief The host clock runs at `scale` from the point where the scale last changed.
+ */
+struct host_clock
+{
+    double scale = 1;
+    uint64_t since_real = real_us();
+    uint64_t since = since_real;
+};
+
+static host_clock &clock_state() {
+    static host_clock state;
+    return state;
+}
+
+uint64_t host_now_us() {
+    const host_clock &state = clock_state();
+    return state.since + static_cast<uint64_t>(static_cast<double>(real_us() - state.since_real) * state.scale);
+}
+
+void host_set_time_scale(const double scale) {
+    if (scale <= 0) {
+        return;
+    }
+    host_clock &state = clock_state();
+    state.since = host_now_us();
+    state.since_real = real_us();
+    state.scale = scale;
+}
+
+void host_schedule(const uint64_t delay_us, std::function<void()> task) {
+    // multimap inserts after the equal keys, which keeps tasks due together in order.
+    scheduled().emplace(host_now_us() + delay_us, std::move(task));
+}
+
+static int run_scheduled() {
+    int ran = 0;
+    const uint64_t now = host_now_us();
+    // Only the tasks due now: tasks they schedule wait for the next poll.
+    std::vector<std::function<void()>> due;
+    auto &tasks = scheduled();
+    while (!tasks.empty() && tasks.begin()->first <= now) {
+        due.push_back(std::move(tasks.begin()->second));
+        tasks.erase(tasks.begin());
+    }
+    for (const auto &task: due) {
+        task();
+        ran++;
+    }
+    return ran;
+}
+
+void host_watch(HostPollable *pollable) {
+    host_unwatch(pollable);
+    const uint64_t serial = next_serial++;
+    const short events = pollable->poll_events();
+    watched()[pollable] = {serial, events, false};
+    serials()[serial] = pollable;
+    const int fd = pollable->poll_fd();
+    if (fd >= 0) {
+        // POLLIN and POLLOUT have the values of EPOLLIN and EPOLLOUT.
+        epoll_event event{};
+        event.events = static_cast<uint32_t>(events);
+        event.data.u64 = serial;
+        epoll_ctl(epoll_descriptor(), EPOLL_CTL_ADD, fd, &event);
+    }
+}
+
+void host_update(HostPollable *pollable) {
+    // Only marked here: a write usually leaves nothing for the socket, so by the time the loop waits the events
+    // are back to what they were and the epoll set is left alone.
+    const auto object = watched().find(pollable);
+    if (object != watched().end() && !object->second.updated) {
+        object->second.updated = true;
+        updated().push_back(pollable);
+    }
+}
+
+static void apply_updates() {
+    for (HostPollable *pollable: updated()) {
+        // Objects unwatched since are not found; an object reusing the address is only checked again.
+        const auto object = watched().find(pollable);
+        if (object == watched().end() || !object->second.updated) {
+            continue;
+        }
+        object->second.updated = false;
+        const short events = pollable->poll_events();
+        const int fd = pollable->poll_fd();
+        if (events == object->second.events || fd < 0) {
+            continue;
+        }
+        object->second.events = events;
+        epoll_event event{};
+        event.events = static_cast<uint32_t>(events);
+        event.data.u64 = object->second.serial;
+        epoll_ctl(epoll_descriptor(), EPOLL_CTL_MOD, fd, &event);
+    }
+    updated().clear();
+}
+
+void host_unwatch(HostPollable *pollable) {
+    const auto object = watched().find(pollable);
+    if (object == watched().end()) {
+        return;
+    }
+    // Called before the socket is closed, so it is still open to be removed from the set.
+    const int fd = pollable->poll_fd();
+    if (fd >= 0) {
+        epoll_ctl(epoll_descriptor(), EPOLL_CTL_DEL, fd, nullptr);
+    }
+    serials().erase(object->second.serial);
+    watched().erase(object);
+}
+
+bool host_watched(const HostPollable *pollable, const uint64_t serial) {
+    const auto object = watched().find(pollable);
+    return object != watched().end() && object->second.serial == serial;
+}
+
+uint64_t host_serial(const HostPollable *pollable) {
+    const auto object = watched().find(pollable);
+    return object == watched().end() ? 0 : object->second.serial;
+}
+
+int host_poll(const int timeout) {
+    apply_updates();
+    int64_t timeout_us = timeout < 0 ? -1 : static_cast<int64_t>(timeout) * 1000;
+    if (!scheduled().empty()) {
+        const uint64_t now = host_now_us();
+        const uint64_t next = scheduled().begin()->first;
+        const int64_t until = next <= now ? 0 : static_cast<int64_t>(next - now);
+        if (timeout_us < 0 || until < timeout_us) {
+            timeout_us = until;
+        }
+    }
+    // The wait is in real time, to the microsecond: a scaled clock makes waits of a few microseconds common.
+    timespec wait{};
+    if (timeout_us > 0) {
+        const auto real_wait = static_cast<int64_t>(static_cast<double>(timeout_us) / clock_state().scale);
+        wait.tv_sec = real_wait / 1000000;
+        wait.tv_nsec = real_wait % 1000000 * 1000;
+    }
+    const timespec *wait_for = timeout_us < 0 ? nullptr : &wait;
+    int dispatched = 0;
+    // epoll_wait only takes milliseconds: the wait itself is a ppoll on the epoll descriptor.
+    pollfd ready{epoll_descriptor(), POLLIN, 0};
+    if (timeout_us == 0 || ppoll(&ready, 1, wait_for, nullptr) > 0) {
+        epoll_event events[256];
+        const int count = epoll_wait(epoll_descriptor(), events, 256, 0);
+        for (int i = 0; i < count; i++) {
+            // Callbacks may delete objects: each is looked up by serial before dispatch.
+            const auto object = serials().find(events[i].data.u64);
+            if (object != serials().end()) {
+                object->second->on_poll(static_cast<short>(events[i].events));
+                dispatched++;
+            }
+        }
+    }
+    return dispatched + run_scheduled();
+}
@@ -0,0 +1,108 @@
+#ifndef YEELIGHTARDUINO_HOSTLOOP_H
+#define YEELIGHTARDUINO_HOSTLOOP_H
+
+#include <cstdint>
+#include <functional>
+
+/**
+ * @file HostLoop.h
+ * @brief The event loop behind the host stand-ins of AsyncTCP.
+ *
+ * On the ESP32, AsyncTCP runs its callbacks on a separate task. On the host they run from this loop instead,
+ * on the caller's thread, whenever the program waits: delay() and yield() process pending socket events,
+ * so the library sees the same callbacks without any locking. Programs that never call delay() or yield()
+ * can call host_poll() themselves.
+ */
+
+/**
+ * @brief An object whose socket is watched by the host event loop.
+ */
+class HostPollable {
+public:
+    virtual ~HostPollable() = default;
+
+    /**
+     * @brief Returns the socket to watch, or -1 for none.
+     * @return The file descriptor.
+     */
+    virtual int poll_fd() const = 0;
+
+    /**
+     * @brief Returns the poll events to wait for. When they change, the object calls host_update().
+     * @return A combination of POLLIN and POLLOUT.
+     */
+    virtual short poll_events() const = 0;
+
+    /**
+     * @brief Handles the events reported for the socket. The object may delete itself.
+     * @param revents The events reported by poll().
+     */
+    virtual void on_poll(short revents) = 0;
+};
+
+/**
+ * @brief Starts watching an object. Its socket must be open: the loop keeps it in an epoll set, so waiting costs
+ * the same however many objects are watched.
+ * @param pollable The object.
+ */
+void host_watch(HostPollable *pollable);
+
+/**
+ * @brief Tells the loop that the events an object waits for (poll_events) may have changed. They are read again
+ * before the loop next waits, so it is cheap enough to call on every write.
+ * @param pollable The object.
+ */
+void host_update(HostPollable *pollable);
+
+/**
+ * @brief Stops watching an object. Safe to call from its own on_poll.
+ * @param pollable The object.
+ */
+void host_unwatch(HostPollable *pollable);
+
+/**
+ * @brief Checks whether an object is still watched, e.g. after calling a user callback that may delete it.
+ * @param pollable The object.
+ * @param serial The serial returned by host_serial before the callback.
+ * @return True if the same object is still watched.
+ */
+bool host_watched(const HostPollable *pollable, uint64_t serial);
+
+/**
+ * @brief Returns the serial of a watched object, which changes if its address is reused by another object.
+ * @param pollable The object.
+ * @return The serial, or 0 if the object is not watched.
+ */
+uint64_t host_serial(const HostPollable *pollable);
+
+/**
+ * @brief Returns the time of the host clock, behind millis(), micros(), delay() and host_schedule(). It is
+ * monotonic, and runs faster than real time once scaled.
+ * @return The time in microseconds.
+ */
+uint64_t host_now_us();
+
+/**
+ * @brief Makes the host clock run faster (or slower) than real time, e.g. to run hours of timeouts and polling
+ * intervals in minutes. Socket I/O keeps its real speed, so a scale much larger than the ratio of the shortest
+ * timeout to the network round trip turns replies into timeouts.
+ * @param scale Simulated microseconds per real microsecond (1 for real time).
+ */
+void host_set_time_scale(double scale);
+
+/**
+ * @brief Runs a task from the event loop once a delay has elapsed. Tasks due at the same time run in the
+ * order they were scheduled.
+ * @param delay_us The delay in microseconds of the host clock (0 for the next poll).
+ * @param task The task.
+ */
+void host_schedule(uint64_t delay_us, std::function<void()> task);
+
+/**
+ * @brief Waits for socket events and scheduled tasks, and dispatches them.
+ * @param timeout The maximum time to wait in milliseconds of the host clock (0 to only dispatch what is pending).
+ * @return The number of objects that had events and tasks that ran.
+ */
+int host_poll(int timeout);
+
+#endif
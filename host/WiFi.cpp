@@ -0,0 +1,147 @@
+#include "WiFi.h"
+#include "WiFiUdp.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+WiFiClass WiFi;
+
+IPAddress WiFiClass::localIP() const {
+    const char *configured = getenv("YEELIGHT_HOST_IP");
+    in_addr address{};
+    if (configured == nullptr || inet_pton(AF_INET, configured, &address) != 1) {
+        return {127, 0, 0, 1};
+    }
+    return IPAddress(address.s_addr);
+}
+
+WiFiUDP::~WiFiUDP() {
+    stop();
+}
+
+uint8_t WiFiUDP::begin(const uint16_t port) {
+    stop();
+    fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return 0;
+    }
+    const int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse));
+    const unsigned char loop = 1;
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    // Like lwIP, deliver multicast only to sockets that joined the group: the search sent from this socket
+    // must not come back to it when a local simulator has joined.
+    const int all = 0;
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_ALL, &all, sizeof(all));
+    in_addr interface{};
+    interface.s_addr = static_cast<uint32_t>(WiFi.localIP());
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface));
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_port = htons(port);
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(fd, reinterpret_cast<sockaddr *>(&local), sizeof(local)) != 0) {
+        stop();
+        return 0;
+    }
+    return 1;
+}
+
+void WiFiUDP::stop() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    input.clear();
+    input_position = 0;
+}
+
+int WiFiUDP::beginPacket(const IPAddress ip, const uint16_t port) {
+    destination = ip;
+    destination_port = port;
+    output.clear();
+    return fd >= 0 ? 1 : 0;
+}
+
+int WiFiUDP::endPacket() {
+    if (fd < 0) {
+        return 0;
+    }
+    sockaddr_in remote{};
+    remote.sin_family = AF_INET;
+    remote.sin_port = htons(destination_port);
+    remote.sin_addr.s_addr = static_cast<uint32_t>(destination);
+    const ssize_t sent = sendto(fd, output.data(), output.size(), 0, reinterpret_cast<sockaddr *>(&remote),
+                                sizeof(remote));
+    output.clear();
+    return sent < 0 ? 0 : 1;
+}
+
+size_t WiFiUDP::write(const uint8_t byte) {
+    output.push_back(byte);
+    return 1;
+}
+
+size_t WiFiUDP::write(const uint8_t *data, const size_t size) {
+    output.insert(output.end(), data, data + size);
+    return size;
+}
+
+size_t WiFiUDP::print(const char *text) {
+    return write(reinterpret_cast<const uint8_t *>(text), strlen(text));
+}
+
+int WiFiUDP::parsePacket() {
+    input.clear();
+    input_position = 0;
+    if (fd < 0) {
+        return 0;
+    }
+    pollfd watched{fd, POLLIN, 0};
+    if (poll(&watched, 1, 1) <= 0) {
+        return 0;
+    }
+    uint8_t buffer[1500];
+    sockaddr_in remote{};
+    socklen_t length = sizeof(remote);
+    const ssize_t received = recvfrom(fd, buffer, sizeof(buffer), MSG_DONTWAIT, reinterpret_cast<sockaddr *>(&remote),
+                                      &length);
+    if (received <= 0) {
+        return 0;
+    }
+    input.assign(buffer, buffer + received);
+    source = IPAddress(remote.sin_addr.s_addr);
+    source_port = ntohs(remote.sin_port);
+    return static_cast<int>(received);
+}
+
+int WiFiUDP::available() const {
+    return static_cast<int>(input.size() - input_position);
+}
+
+int WiFiUDP::read() {
+    return input_position < input.size() ? input[input_position++] : -1;
+}
+
+int WiFiUDP::read(char *buffer, const size_t size) {
+    return read(reinterpret_cast<unsigned char *>(buffer), size);
+}
+
+int WiFiUDP::read(unsigned char *buffer, const size_t size) {
+    const size_t count = std::min(size, input.size() - input_position);
+    memcpy(buffer, input.data() + input_position, count);
+    input_position += count;
+    return static_cast<int>(count);
+}
+
+IPAddress WiFiUDP::remoteIP() const {
+    return source;
+}
+
+uint16_t WiFiUDP::remotePort() const {
+    return source_port;
+}
@@ -0,0 +1,37 @@
+#ifndef YEELIGHTARDUINO_HOST_WIFI_H
+#define YEELIGHTARDUINO_HOST_WIFI_H
+
+/**
+ * @file WiFi.h
+ * @brief Host stand-in for the ESP32 WiFi object: the station is always connected.
+ *
+ * The local address reported to devices (e.g. for music mode) is taken from the YEELIGHT_HOST_IP
+ * environment variable, 127.0.0.1 by default.
+ */
+
+#include <Arduino.h>
+#include "WiFiUdp.h"
+
+typedef enum
+{
+    WL_IDLE_STATUS = 0,
+    WL_CONNECTED = 3,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+class WiFiClass {
+public:
+    IPAddress localIP() const;
+
+    wl_status_t status() const {
+        return WL_CONNECTED;
+    }
+
+    bool isConnected() const {
+        return true;
+    }
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef YEELIGHTARDUINO_HOST_WIFIUDP_H
+#define YEELIGHTARDUINO_HOST_WIFIUDP_H
+
+/**
+ * @file WiFiUdp.h
+ * @brief Host stand-in for WiFiUDP, backed by a POSIX datagram socket.
+ *
+ * Multicast packets leave through the interface of WiFi.localIP() and are looped back to the host, so a
+ * local simulator can answer discovery. parsePacket() waits up to a millisecond for a packet, so polling
+ * loops do not spin.
+ */
+
+#include <Arduino.h>
+#include <vector>
+
+class WiFiUDP {
+public:
+    WiFiUDP() = default;
+
+    ~WiFiUDP();
+
+    WiFiUDP(const WiFiUDP &) = delete;
+
+    WiFiUDP &operator=(const WiFiUDP &) = delete;
+
+    uint8_t begin(uint16_t port);
+
+    void stop();
+
+    int beginPacket(IPAddress ip, uint16_t port);
+
+    int endPacket();
+
+    size_t write(uint8_t byte);
+
+    size_t write(const uint8_t *data, size_t size);
+
+    size_t print(const char *text);
+
+    int parsePacket();
+
+    int available() const;
+
+    int read();
+
+    int read(char *buffer, size_t size);
+
+    int read(unsigned char *buffer, size_t size);
+
+    IPAddress remoteIP() const;
+
+    uint16_t remotePort() const;
+
+private:
+    int fd = -1;
+    IPAddress destination;
+    uint16_t destination_port = 0;
+    std::vector<uint8_t> output;
+    std::vector<uint8_t> input;
+    size_t input_position = 0;
+    IPAddress source;
+    uint16_t source_port = 0;
+};
+
+#endif
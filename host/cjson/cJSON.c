@@ -0,0 +1,523 @@
+#include "cJSON.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/* Nesting limit, as in cJSON. */
+#define NESTING_LIMIT 1000
+
+static void *(*allocate)(size_t size) = malloc;
+static void (*release)(void *pointer) = free;
+/* Only used with the default allocator, as in cJSON. */
+static void *(*reallocate)(void *pointer, size_t size) = realloc;
+
+void cJSON_InitHooks(cJSON_Hooks *hooks) {
+    allocate = hooks != NULL && hooks->malloc_fn != NULL ? hooks->malloc_fn : malloc;
+    release = hooks != NULL && hooks->free_fn != NULL ? hooks->free_fn : free;
+    reallocate = allocate == malloc && release == free ? realloc : NULL;
+}
+
+static cJSON *new_item(const int type) {
+    cJSON *item = (cJSON *) allocate(sizeof(cJSON));
+    if (item != NULL) {
+        memset(item, 0, sizeof(cJSON));
+        item->type = type;
+    }
+    return item;
+}
+
+static char *duplicate(const char *string) {
+    const size_t length = strlen(string) + 1;
+    char *copy = (char *) allocate(length);
+    if (copy != NULL) {
+        memcpy(copy, string, length);
+    }
+    return copy;
+}
+
+void cJSON_Delete(cJSON *item) {
+    while (item != NULL) {
+        cJSON *next = item->next;
+        cJSON_Delete(item->child);
+        release(item->valuestring);
+        release(item->string);
+        release(item);
+        item = next;
+    }
+}
+
+void cJSON_free(void *object) {
+    release(object);
+}
+
+cJSON *cJSON_CreateNull(void) {
+    return new_item(cJSON_NULL);
+}
+
+cJSON *cJSON_CreateBool(const cJSON_bool boolean) {
+    return new_item(boolean ? cJSON_True : cJSON_False);
+}
+
+cJSON *cJSON_CreateNumber(const double num) {
+    cJSON *item = new_item(cJSON_Number);
+    if (item != NULL) {
+        item->valuedouble = num;
+        item->valueint = num >= 2147483647.0 ? 2147483647 : num <= -2147483648.0 ? (-2147483647 - 1) : (int) num;
+    }
+    return item;
+}
+
+cJSON *cJSON_CreateString(const char *string) {
+    cJSON *item = new_item(cJSON_String);
+    if (item != NULL) {
+        item->valuestring = duplicate(string);
+        if (item->valuestring == NULL) {
+            cJSON_Delete(item);
+            return NULL;
+        }
+    }
+    return item;
+}
+
+cJSON *cJSON_CreateArray(void) {
+    return new_item(cJSON_Array);
+}
+
+cJSON *cJSON_CreateObject(void) {
+    return new_item(cJSON_Object);
+}
+
+cJSON_bool cJSON_AddItemToArray(cJSON *array, cJSON *item) {
+    if (array == NULL || item == NULL || array == item) {
+        return 0;
+    }
+    if (array->child == NULL) {
+        array->child = item;
+        item->prev = item;
+        item->next = NULL;
+    } else {
+        /* As in cJSON, the first child's prev points at the last child. */
+        cJSON *last = array->child->prev;
+        last->next = item;
+        item->prev = last;
+        array->child->prev = item;
+    }
+    return 1;
+}
+
+cJSON_bool cJSON_AddItemToObject(cJSON *object, const char *string, cJSON *item) {
+    if (object == NULL || string == NULL || item == NULL) {
+        return 0;
+    }
+    char *key = duplicate(string);
+    if (key == NULL) {
+        return 0;
+    }
+    release(item->string);
+    item->string = key;
+    return cJSON_AddItemToArray(object, item);
+}
+
+int cJSON_GetArraySize(const cJSON *array) {
+    int size = 0;
+    if (array != NULL) {
+        for (const cJSON *child = array->child; child != NULL; child = child->next) {
+            size++;
+        }
+    }
+    return size;
+}
+
+cJSON *cJSON_GetArrayItem(const cJSON *array, int index) {
+    if (array == NULL || index < 0) {
+        return NULL;
+    }
+    cJSON *child = array->child;
+    while (child != NULL && index-- > 0) {
+        child = child->next;
+    }
+    return child;
+}
+
+cJSON *cJSON_GetObjectItem(const cJSON *object, const char *string) {
+    if (object == NULL || string == NULL) {
+        return NULL;
+    }
+    /* cJSON_GetObjectItem matches keys case-insensitively. */
+    for (cJSON *child = object->child; child != NULL; child = child->next) {
+        if (child->string != NULL && strcasecmp(child->string, string) == 0) {
+            return child;
+        }
+    }
+    return NULL;
+}
+
+cJSON_bool cJSON_IsBool(const cJSON *item) {
+    return item != NULL && (item->type & (cJSON_True | cJSON_False)) != 0;
+}
+
+cJSON_bool cJSON_IsNull(const cJSON *item) {
+    return item != NULL && (item->type & 0xFF) == cJSON_NULL;
+}
+
+cJSON_bool cJSON_IsNumber(const cJSON *item) {
+    return item != NULL && (item->type & 0xFF) == cJSON_Number;
+}
+
+cJSON_bool cJSON_IsString(const cJSON *item) {
+    return item != NULL && (item->type & 0xFF) == cJSON_String;
+}
+
+cJSON_bool cJSON_IsArray(const cJSON *item) {
+    return item != NULL && (item->type & 0xFF) == cJSON_Array;
+}
+
+cJSON_bool cJSON_IsObject(const cJSON *item) {
+    return item != NULL && (item->type & 0xFF) == cJSON_Object;
+}
+
+/* Parsing */
+
+typedef struct
+{
+    const char *position;
+    int depth;
+} parser;
+
+static void skip_whitespace(parser *p) {
+    while (*p->position == ' ' || *p->position == '\t' || *p->position == '\r' || *p->position == '\n') {
+        p->position++;
+    }
+}
+
+static cJSON *parse_value(parser *p);
+
+static int parse_hex4(const char *text, unsigned *value) {
+    *value = 0;
+    for (int i = 0; i < 4; i++) {
+        const char c = text[i];
+        *value <<= 4;
+        if (c >= '0' && c <= '9') {
+            *value |= (unsigned) (c - '0');
+        } else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+            *value |= (unsigned) ((c | 0x20) - 'a' + 10);
+        } else {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static char *parse_string_text(parser *p) {
+    if (*p->position != '"') {
+        return NULL;
+    }
+    const char *end = p->position + 1;
+    while (*end != '"') {
+        if (*end == '\0') {
+            return NULL;
+        }
+        end += *end == '\\' && end[1] != '\0' ? 2 : 1;
+    }
+    /* The decoded text is never longer than the escaped one. */
+    char *output = (char *) allocate((size_t) (end - p->position));
+    if (output == NULL) {
+        return NULL;
+    }
+    char *out = output;
+    for (const char *in = p->position + 1; in < end; in++) {
+        if (*in != '\\') {
+            *out++ = *in;
+            continue;
+        }
+        in++;
+        switch (*in) {
+            case 'b': *out++ = '\b'; break;
+            case 'f': *out++ = '\f'; break;
+            case 'n': *out++ = '\n'; break;
+            case 'r': *out++ = '\r'; break;
+            case 't': *out++ = '\t'; break;
+            case '"':
+            case '\\':
+            case '/': *out++ = *in; break;
+            case 'u': {
+                unsigned code;
+                if (end - in < 5 || !parse_hex4(in + 1, &code)) {
+                    release(output);
+                    return NULL;
+                }
+                in += 4;
+                if (code >= 0xD800 && code <= 0xDBFF && end - in >= 7 && in[1] == '\\' && in[2] == 'u') {
+                    unsigned low;
+                    if (parse_hex4(in + 3, &low) && low >= 0xDC00 && low <= 0xDFFF) {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        in += 6;
+                    }
+                }
+                if (code < 0x80) {
+                    *out++ = (char) code;
+                } else if (code < 0x800) {
+                    *out++ = (char) (0xC0 | code >> 6);
+                    *out++ = (char) (0x80 | (code & 0x3F));
+                } else if (code < 0x10000) {
+                    *out++ = (char) (0xE0 | code >> 12);
+                    *out++ = (char) (0x80 | (code >> 6 & 0x3F));
+                    *out++ = (char) (0x80 | (code & 0x3F));
+                } else {
+                    *out++ = (char) (0xF0 | code >> 18);
+                    *out++ = (char) (0x80 | (code >> 12 & 0x3F));
+                    *out++ = (char) (0x80 | (code >> 6 & 0x3F));
+                    *out++ = (char) (0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default:
+                release(output);
+                return NULL;
+        }
+    }
+    *out = '\0';
+    p->position = end + 1;
+    return output;
+}
+
+static cJSON *parse_container(parser *p, const int type, const char close) {
+    if (++p->depth > NESTING_LIMIT) {
+        return NULL;
+    }
+    cJSON *container = new_item(type);
+    if (container == NULL) {
+        return NULL;
+    }
+    p->position++;
+    skip_whitespace(p);
+    if (*p->position == close) {
+        p->position++;
+        p->depth--;
+        return container;
+    }
+    for (;;) {
+        char *key = NULL;
+        if (type == cJSON_Object) {
+            skip_whitespace(p);
+            key = parse_string_text(p);
+            skip_whitespace(p);
+            if (key == NULL || *p->position != ':') {
+                release(key);
+                cJSON_Delete(container);
+                return NULL;
+            }
+            p->position++;
+        }
+        cJSON *child = parse_value(p);
+        if (child == NULL) {
+            release(key);
+            cJSON_Delete(container);
+            return NULL;
+        }
+        child->string = key;
+        cJSON_AddItemToArray(container, child);
+        skip_whitespace(p);
+        if (*p->position == ',') {
+            p->position++;
+            continue;
+        }
+        if (*p->position != close) {
+            cJSON_Delete(container);
+            return NULL;
+        }
+        p->position++;
+        p->depth--;
+        return container;
+    }
+}
+
+static cJSON *parse_value(parser *p) {
+    skip_whitespace(p);
+    const char c = *p->position;
+    if (strncmp(p->position, "null", 4) == 0) {
+        p->position += 4;
+        return cJSON_CreateNull();
+    }
+    if (strncmp(p->position, "true", 4) == 0) {
+        p->position += 4;
+        return cJSON_CreateBool(1);
+    }
+    if (strncmp(p->position, "false", 5) == 0) {
+        p->position += 5;
+        return cJSON_CreateBool(0);
+    }
+    if (c == '"') {
+        char *text = parse_string_text(p);
+        cJSON *item = text != NULL ? new_item(cJSON_String) : NULL;
+        if (item == NULL) {
+            release(text);
+            return NULL;
+        }
+        item->valuestring = text;
+        return item;
+    }
+    if (c == '-' || (c >= '0' && c <= '9')) {
+        char *end;
+        const double number = strtod(p->position, &end);
+        if (end == p->position) {
+            return NULL;
+        }
+        p->position = end;
+        return cJSON_CreateNumber(number);
+    }
+    if (c == '[') {
+        return parse_container(p, cJSON_Array, ']');
+    }
+    if (c == '{') {
+        return parse_container(p, cJSON_Object, '}');
+    }
+    return NULL;
+}
+
+cJSON *cJSON_Parse(const char *value) {
+    if (value == NULL) {
+        return NULL;
+    }
+    parser p = {value, 0};
+    /* Like cJSON, trailing text after the value is ignored. */
+    return parse_value(&p);
+}
+
+/* Printing */
+
+typedef struct
+{
+    char *buffer;
+    size_t length;
+    size_t capacity;
+} printer;
+
+static int ensure(printer *p, const size_t needed) {
+    if (p->buffer == NULL) {
+        return 0;
+    }
+    if (p->length + needed + 1 <= p->capacity) {
+        return 1;
+    }
+    size_t capacity = p->capacity * 2;
+    while (capacity < p->length + needed + 1) {
+        capacity *= 2;
+    }
+    char *grown;
+    if (reallocate != NULL) {
+        grown = (char *) reallocate(p->buffer, capacity);
+    } else {
+        grown = (char *) allocate(capacity);
+        if (grown != NULL) {
+            memcpy(grown, p->buffer, p->length + 1);
+            release(p->buffer);
+        }
+    }
+    if (grown == NULL) {
+        release(p->buffer);
+        p->buffer = NULL;
+        return 0;
+    }
+    p->buffer = grown;
+    p->capacity = capacity;
+    return 1;
+}
+
+static void append(printer *p, const char *text, const size_t length) {
+    if (ensure(p, length)) {
+        memcpy(p->buffer + p->length, text, length);
+        p->length += length;
+        p->buffer[p->length] = '\0';
+    }
+}
+
+static void print_string(printer *p, const char *text) {
+    append(p, "\"", 1);
+    for (const unsigned char *c = (const unsigned char *) (text != NULL ? text : ""); *c != '\0'; c++) {
+        char escaped[8];
+        switch (*c) {
+            case '"': append(p, "\\\"", 2); break;
+            case '\\': append(p, "\\\\", 2); break;
+            case '\b': append(p, "\\b", 2); break;
+            case '\f': append(p, "\\f", 2); break;
+            case '\n': append(p, "\\n", 2); break;
+            case '\r': append(p, "\\r", 2); break;
+            case '\t': append(p, "\\t", 2); break;
+            default:
+                if (*c < 0x20) {
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", *c);
+                    append(p, escaped, 6);
+                } else {
+                    append(p, (const char *) c, 1);
+                }
+        }
+    }
+    append(p, "\"", 1);
+}
+
+static void print_number(printer *p, const double number) {
+    char text[32];
+    int length;
+    if (isnan(number) || isinf(number)) {
+        length = snprintf(text, sizeof(text), "null");
+    } else if (number == (double) (long long) number && fabs(number) < 1e15) {
+        length = snprintf(text, sizeof(text), "%lld", (long long) number);
+    } else {
+        /* Shortest of %.15g and %.17g that reads back to the same value, as cJSON does. */
+        length = snprintf(text, sizeof(text), "%1.15g", number);
+        if (strtod(text, NULL) != number) {
+            length = snprintf(text, sizeof(text), "%1.17g", number);
+        }
+    }
+    append(p, text, (size_t) length);
+}
+
+static void print_value(printer *p, const cJSON *item) {
+    switch (item->type & 0xFF) {
+        case cJSON_NULL: append(p, "null", 4); break;
+        case cJSON_False: append(p, "false", 5); break;
+        case cJSON_True: append(p, "true", 4); break;
+        case cJSON_Number: print_number(p, item->valuedouble); break;
+        case cJSON_String: print_string(p, item->valuestring); break;
+        case cJSON_Raw:
+            if (item->valuestring != NULL) {
+                append(p, item->valuestring, strlen(item->valuestring));
+            }
+            break;
+        case cJSON_Array:
+        case cJSON_Object: {
+            const int object = (item->type & 0xFF) == cJSON_Object;
+            append(p, object ? "{" : "[", 1);
+            for (const cJSON *child = item->child; child != NULL; child = child->next) {
+                if (object) {
+                    print_string(p, child->string);
+                    append(p, ":", 1);
+                }
+                print_value(p, child);
+                if (child->next != NULL) {
+                    append(p, ",", 1);
+                }
+            }
+            append(p, object ? "}" : "]", 1);
+            break;
+        }
+        default: break;
+    }
+}
+
+char *cJSON_PrintUnformatted(const cJSON *item) {
+    if (item == NULL) {
+        return NULL;
+    }
+    printer p = {(char *) allocate(256), 0, 256};
+    if (p.buffer == NULL) {
+        return NULL;
+    }
+    p.buffer[0] = '\0';
+    print_value(&p, item);
+    return p.buffer;
+}
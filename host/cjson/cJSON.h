@@ -0,0 +1,97 @@
+#ifndef YEELIGHTARDUINO_HOST_CJSON_H
+#define YEELIGHTARDUINO_HOST_CJSON_H
+
+/**
+ * @file cJSON.h
+ * @brief Minimal cJSON for offline host builds with neither the system library nor the upstream sources.
+ *
+ * Implements the subset of the cJSON API used by the library, with the same structure layout, type flags
+ * and ownership rules: items are freed with cJSON_Delete, printed text with free(). Allocations go through the
+ * functions set with cJSON_InitHooks.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define cJSON_Invalid (0)
+#define cJSON_False (1 << 0)
+#define cJSON_True (1 << 1)
+#define cJSON_NULL (1 << 2)
+#define cJSON_Number (1 << 3)
+#define cJSON_String (1 << 4)
+#define cJSON_Array (1 << 5)
+#define cJSON_Object (1 << 6)
+#define cJSON_Raw (1 << 7)
+
+typedef int cJSON_bool;
+
+typedef struct cJSON_Hooks
+{
+    void *(*malloc_fn)(size_t sz);
+    void (*free_fn)(void *ptr);
+} cJSON_Hooks;
+
+typedef struct cJSON
+{
+    struct cJSON *next;
+    struct cJSON *prev;
+    struct cJSON *child;
+    int type;
+    char *valuestring;
+    int valueint;
+    double valuedouble;
+    char *string;
+} cJSON;
+
+void cJSON_InitHooks(cJSON_Hooks *hooks);
+
+cJSON *cJSON_Parse(const char *value);
+
+char *cJSON_PrintUnformatted(const cJSON *item);
+
+void cJSON_Delete(cJSON *item);
+
+cJSON *cJSON_CreateNull(void);
+
+cJSON *cJSON_CreateBool(cJSON_bool boolean);
+
+cJSON *cJSON_CreateNumber(double num);
+
+cJSON *cJSON_CreateString(const char *string);
+
+cJSON *cJSON_CreateArray(void);
+
+cJSON *cJSON_CreateObject(void);
+
+cJSON_bool cJSON_AddItemToArray(cJSON *array, cJSON *item);
+
+cJSON_bool cJSON_AddItemToObject(cJSON *object, const char *string, cJSON *item);
+
+int cJSON_GetArraySize(const cJSON *array);
+
+cJSON *cJSON_GetArrayItem(const cJSON *array, int index);
+
+cJSON *cJSON_GetObjectItem(const cJSON *object, const char *string);
+
+cJSON_bool cJSON_IsBool(const cJSON *item);
+
+cJSON_bool cJSON_IsNull(const cJSON *item);
+
+cJSON_bool cJSON_IsNumber(const cJSON *item);
+
+cJSON_bool cJSON_IsString(const cJSON *item);
+
+cJSON_bool cJSON_IsArray(const cJSON *item);
+
+cJSON_bool cJSON_IsObject(const cJSON *item);
+
+void cJSON_free(void *object);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
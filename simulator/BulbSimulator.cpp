@@ -0,0 +1,406 @@
+#include "BulbSimulator.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/**
+ * @brief The SSDP multicast group and port used by the devices.
+ */
+static const char *const SSDP_GROUP = "239.255.255.250";
+static constexpr uint16_t SSDP_PORT = 1982;
+
+/**
+ * @brief The quota window, in milliseconds.
+ */
+static constexpr uint32_t QUOTA_WINDOW = 60000;
+
+static void set_nonblocking(const int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
+BulbSimulator::BulbSimulator(const char *model, const uint16_t port, const char *address) : address(address),
+    port(port) {
+    bulb.reset(model, 0x0000000002f0a000ULL | port);
+}
+
+BulbSimulator::~BulbSimulator() {
+    stop();
+}
+
+void BulbSimulator::set_support(const char *methods) {
+    std::lock_guard<std::mutex> guard(lock);
+    bulb.support = SimulatedBulb::parse_support(methods);
+}
+
+void BulbSimulator::set_quota(const uint16_t per_connection, const uint16_t total) {
+    std::lock_guard<std::mutex> guard(lock);
+    quota = per_connection;
+    total_quota = total;
+}
+
+void BulbSimulator::set_max_connections(const uint8_t max_connections) {
+    std::lock_guard<std::mutex> guard(lock);
+    this->max_connections = max_connections;
+}
+
+void BulbSimulator::set_ssdp(const bool enabled) {
+    std::lock_guard<std::mutex> guard(lock);
+    ssdp_enabled = enabled;
+}
+
+bool BulbSimulator::start() {
+    if (thread.joinable()) {
+        return false;
+    }
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_port = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &local.sin_addr) != 1) {
+        return false;
+    }
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    const int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (bind(listener, reinterpret_cast<sockaddr *>(&local), sizeof(local)) != 0 || listen(listener, 16) != 0) {
+        close(listener);
+        listener = -1;
+        return false;
+    }
+    socklen_t length = sizeof(local);
+    getsockname(listener, reinterpret_cast<sockaddr *>(&local), &length);
+    port = ntohs(local.sin_port);
+    set_nonblocking(listener);
+    if (ssdp_enabled) {
+        // Bound to the group address, so the unicast answers to a client on the same host are not taken from it.
+        ssdp = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        setsockopt(ssdp, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in group{};
+        group.sin_family = AF_INET;
+        group.sin_port = htons(SSDP_PORT);
+        inet_pton(AF_INET, SSDP_GROUP, &group.sin_addr);
+        ip_mreqn membership{};
+        membership.imr_multiaddr = group.sin_addr;
+        membership.imr_address = local.sin_addr;
+        if (bind(ssdp, reinterpret_cast<sockaddr *>(&group), sizeof(group)) != 0) {
+            close(ssdp);
+            ssdp = -1;
+        } else if (setsockopt(ssdp, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) != 0) {
+            // Secondary loopback addresses are not interface addresses: join on the default interface instead.
+            membership.imr_address.s_addr = htonl(INADDR_LOOPBACK);
+            setsockopt(ssdp, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership));
+        }
+    }
+    if (pipe2(wake, O_CLOEXEC | O_NONBLOCK) != 0) {
+        stop();
+        return false;
+    }
+    thread = std::thread(&BulbSimulator::run, this);
+    return true;
+}
+
+void BulbSimulator::stop() {
+    if (thread.joinable()) {
+        const char signal = 0;
+        (void) !::write(wake[1], &signal, 1);
+        thread.join();
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    for (const sim_connection &connection: connections) {
+        close(connection.fd);
+    }
+    connections.clear();
+    if (music.fd >= 0) {
+        close(music.fd);
+        music.fd = -1;
+        bulb.music_on = 0;
+    }
+    for (int *fd: {&listener, &ssdp, &wake[0], &wake[1]}) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+uint16_t BulbSimulator::get_port() const {
+    return port;
+}
+
+std::string BulbSimulator::get_property(const char *name) const {
+    std::lock_guard<std::mutex> guard(lock);
+    for (uint8_t property = 0; property < SimulatedBulb::property_count(); property++) {
+        if (strcmp(SimulatedBulb::property_name(property), name) == 0) {
+            return bulb.property(property);
+        }
+    }
+    return "";
+}
+
+SimulatedBulb BulbSimulator::get_state() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return bulb;
+}
+
+uint32_t BulbSimulator::get_command_count() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return command_count;
+}
+
+uint32_t BulbSimulator::get_rejected_count() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return rejected_count;
+}
+
+uint32_t BulbSimulator::get_notification_count() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return notification_count;
+}
+
+size_t BulbSimulator::get_connection_count() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return connections.size();
+}
+
+bool BulbSimulator::is_music_mode() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return music.fd >= 0;
+}
+
+void BulbSimulator::run() {
+    std::vector<pollfd> fds;
+    for (;;) {
+        fds.clear();
+        fds.push_back({wake[0], POLLIN, 0});
+        fds.push_back({listener, POLLIN, 0});
+        fds.push_back({ssdp, POLLIN, 0});
+        fds.push_back({music.fd, POLLIN, 0});
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            for (const sim_connection &connection: connections) {
+                fds.push_back({connection.fd, static_cast<short>(connection.output.empty() ? POLLIN : POLLIN | POLLOUT),
+                               0});
+            }
+        }
+        // The timeout bounds the delay of a cron power-off.
+        if (poll(fds.data(), fds.size(), 1000) < 0 && errno != EINTR) {
+            return;
+        }
+        if (fds[0].revents != 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        if (const uint32_t changed = bulb.tick(now())) {
+            notify(changed);
+        }
+        if (fds[1].revents != 0) {
+            accept_connection();
+        }
+        if (fds[2].revents != 0) {
+            answer_ssdp();
+        }
+        if (fds[3].revents != 0 && !read_connection(music, false)) {
+            stop_music();
+        }
+        // Connections accepted above were not polled: only the polled ones are served, by descriptor.
+        for (size_t i = 4; i < fds.size(); i++) {
+            if (fds[i].revents == 0) {
+                continue;
+            }
+            for (size_t index = 0; index < connections.size(); index++) {
+                if (connections[index].fd != fds[i].fd) {
+                    continue;
+                }
+                if (fds[i].revents & POLLOUT) {
+                    write(connections[index], "");
+                }
+                if (!read_connection(connections[index], true)) {
+                    close(connections[index].fd);
+                    connections.erase(connections.begin() + static_cast<ptrdiff_t>(index));
+                }
+                break;
+            }
+        }
+    }
+}
+
+void BulbSimulator::accept_connection() {
+    for (;;) {
+        const int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            return;
+        }
+        if (connections.size() >= max_connections) {
+            close(fd);
+            continue;
+        }
+        set_nonblocking(fd);
+        const int flag = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+        connections.push_back({fd, {}, {}, 0, 0});
+    }
+}
+
+bool BulbSimulator::read_connection(sim_connection &connection, const bool replies) {
+    char buffer[2048];
+    const ssize_t received = recv(connection.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        return false;
+    }
+    if (received < 0) {
+        return true;
+    }
+    connection.input.append(buffer, static_cast<size_t>(received));
+    size_t end;
+    while ((end = connection.input.find('\n')) != std::string::npos) {
+        std::string line = connection.input.substr(0, end);
+        connection.input.erase(0, end + 1);
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            // A request may change the connection list (music mode): the reference stays valid, as the list
+            // only grows in accept_connection().
+            execute(connection, line, replies);
+        }
+    }
+    // Devices drop connections that send endless lines.
+    return connection.input.size() <= MAX_LINE;
+}
+
+void BulbSimulator::execute(sim_connection &connection, const std::string &line, const bool replies) {
+    const uint32_t time = now();
+    std::string reply;
+    uint32_t changed;
+    std::string music_host;
+    uint16_t music_port = 0;
+    if (replies && !within_quota(connection, time)) {
+        rejected_count++;
+        const char *id = strstr(line.c_str(), "\"id\":");
+        write(connection, "{\"id\":" + std::to_string(id != nullptr ? atoi(id + 5) : 0) +
+                          ", \"error\":{\"code\":-1, \"message\":\"client quota exceeded\"}}\r\n");
+        return;
+    }
+    const SimOutcome outcome = bulb.execute(line.c_str(), time, reply, changed, music_host, music_port);
+    if (outcome == SIM_IGNORED) {
+        return;
+    }
+    command_count++;
+    // Music mode has no replies.
+    if (replies) {
+        write(connection, reply);
+    }
+    if (outcome == SIM_MUSIC_START) {
+        start_music(music_host, music_port);
+        return;
+    }
+    if (outcome == SIM_MUSIC_STOP) {
+        stop_music();
+        return;
+    }
+    if (changed != 0) {
+        notify(changed);
+    }
+}
+
+bool BulbSimulator::within_quota(sim_connection &connection, const uint32_t now) {
+    if (now - connection.window_start >= QUOTA_WINDOW) {
+        connection.window_start = now;
+        connection.window_count = 0;
+    }
+    if (now - total_window_start >= QUOTA_WINDOW) {
+        total_window_start = now;
+        total_window_count = 0;
+    }
+    if ((quota != 0 && connection.window_count >= quota) || (total_quota != 0 && total_window_count >= total_quota)) {
+        return false;
+    }
+    connection.window_count++;
+    total_window_count++;
+    return true;
+}
+
+void BulbSimulator::notify(const uint32_t changed) {
+    // Devices in music mode do not notify.
+    if (music.fd >= 0) {
+        return;
+    }
+    const std::string line = bulb.notification(changed);
+    for (sim_connection &connection: connections) {
+        write(connection, line);
+        notification_count++;
+    }
+}
+
+void BulbSimulator::start_music(const std::string &host, const uint16_t music_port) {
+    stop_music();
+    sockaddr_in remote{};
+    remote.sin_family = AF_INET;
+    remote.sin_port = htons(music_port);
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (inet_pton(AF_INET, host.c_str(), &remote.sin_addr) != 1 ||
+        connect(fd, reinterpret_cast<sockaddr *>(&remote), sizeof(remote)) != 0) {
+        close(fd);
+        bulb.music_on = 0;
+        return;
+    }
+    set_nonblocking(fd);
+    const int flag = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    music = {fd, {}, {}, 0, 0};
+}
+
+void BulbSimulator::stop_music() {
+    if (music.fd < 0) {
+        return;
+    }
+    close(music.fd);
+    music = {-1, {}, {}, 0, 0};
+    if (bulb.music_on) {
+        bulb.music_on = 0;
+        notify(1UL << 9);
+    }
+}
+
+void BulbSimulator::answer_ssdp() {
+    char request[1024];
+    sockaddr_in remote{};
+    socklen_t length = sizeof(remote);
+    const ssize_t received = recvfrom(ssdp, request, sizeof(request) - 1, MSG_DONTWAIT,
+                                      reinterpret_cast<sockaddr *>(&remote), &length);
+    if (received <= 0) {
+        return;
+    }
+    request[received] = '\0';
+    if (strncmp(request, "M-SEARCH", 8) != 0 || strstr(request, "wifi_bulb") == nullptr) {
+        return;
+    }
+    const std::string response = bulb.ssdp_response(address.c_str(), port);
+    sendto(ssdp, response.data(), response.size(), 0, reinterpret_cast<sockaddr *>(&remote), length);
+}
+
+void BulbSimulator::write(sim_connection &connection, const std::string &data) {
+    connection.output += data;
+    while (!connection.output.empty()) {
+        const ssize_t sent = send(connection.fd, connection.output.data(), connection.output.size(),
+                                  MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent <= 0) {
+            // The rest is written when the socket is writable; a broken connection is seen by the next read.
+            return;
+        }
+        connection.output.erase(0, static_cast<size_t>(sent));
+    }
+}
+
+uint32_t BulbSimulator::now() {
+    using namespace std::chrono;
+    return static_cast<uint32_t>(duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+}
@@ -0,0 +1,176 @@
+#ifndef YEELIGHTARDUINO_BULBSIMULATOR_H
+#define YEELIGHTARDUINO_BULBSIMULATOR_H
+
+#include "SimulatedBulb.h"
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class BulbSimulator
+ * @brief A Yeelight bulb on the local host, answering the LAN protocol like the real device.
+ *
+ * The simulator listens for JSON-RPC connections, answers every method of its support list (others get the
+ * "unsupported method" error), pushes `props` notifications to all connections when a property changes,
+ * enforces the per-connection and total command quotas, dials back for `set_music` and answers SSDP
+ * searches with the same response format as the devices. It runs on its own thread, so the program under
+ * test sees it as a remote device.
+ */
+class BulbSimulator {
+public:
+    /**
+     * @brief Constructs a stopped simulator.
+     * @param model The model name, which selects the default support list (see SimulatedBulb::default_support).
+     * @param port The TCP port to listen on (0 for any free port).
+     * @param address The IPv4 address to listen on.
+     */
+    explicit BulbSimulator(const char *model = "color", uint16_t port = 55443, const char *address = "127.0.0.1");
+
+    ~BulbSimulator();
+
+    BulbSimulator(const BulbSimulator &) = delete;
+
+    BulbSimulator &operator=(const BulbSimulator &) = delete;
+
+    /**
+     * @brief Replaces the support list.
+     * @param methods Method names separated by spaces, as in the SSDP `support` header.
+     */
+    void set_support(const char *methods);
+
+    /**
+     * @brief Sets the command quotas. Devices accept 60 commands per minute per connection and 144 in total.
+     * @param per_connection Commands per minute on one connection (0 for no limit).
+     * @param total Commands per minute over all connections (0 for no limit).
+     */
+    void set_quota(uint16_t per_connection, uint16_t total);
+
+    /**
+     * @brief Sets the number of simultaneous connections; further connections are closed at once.
+     * @param max_connections The number of connections (4 by default).
+     */
+    void set_max_connections(uint8_t max_connections);
+
+    /**
+     * @brief Enables answering SSDP searches on 239.255.255.250:1982. Takes effect at start().
+     * @param enabled True to answer searches (default).
+     */
+    void set_ssdp(bool enabled);
+
+    /**
+     * @brief Starts listening and serving on the simulator thread.
+     * @return False if the port could not be bound or the simulator is already running.
+     */
+    bool start();
+
+    /**
+     * @brief Stops serving and closes every connection.
+     */
+    void stop();
+
+    /**
+     * @brief Returns the TCP port, useful when constructed with port 0.
+     * @return The port the simulator listens on.
+     */
+    uint16_t get_port() const;
+
+    /**
+     * @brief Returns a property in the string form of `get_prop`.
+     * @param name The property name.
+     * @return The value, or an empty string for an unknown property.
+     */
+    std::string get_property(const char *name) const;
+
+    /**
+     * @brief Returns a copy of the bulb state.
+     * @return The state.
+     */
+    SimulatedBulb get_state() const;
+
+    /**
+     * @brief Returns the number of requests executed, on regular and music connections.
+     * @return The number of requests.
+     */
+    uint32_t get_command_count() const;
+
+    /**
+     * @brief Returns the number of requests refused because of a quota.
+     * @return The number of refused requests.
+     */
+    uint32_t get_rejected_count() const;
+
+    /**
+     * @brief Returns the number of `props` notifications sent, counting one per connection.
+     * @return The number of notifications.
+     */
+    uint32_t get_notification_count() const;
+
+    /**
+     * @brief Returns the number of open regular connections.
+     * @return The number of connections.
+     */
+    size_t get_connection_count() const;
+
+    /**
+     * @brief Checks whether the music connection is open.
+     * @return True in music mode.
+     */
+    bool is_music_mode() const;
+
+private:
+    struct sim_connection
+    {
+        int fd;
+        std::string input;
+        std::string output;
+        uint32_t window_start;
+        uint16_t window_count;
+    };
+
+    static constexpr size_t MAX_LINE = 4096;
+
+    SimulatedBulb bulb{};
+    std::string address;
+    uint16_t port;
+    uint16_t quota = 60;
+    uint16_t total_quota = 144;
+    uint8_t max_connections = 4;
+    bool ssdp_enabled = true;
+    mutable std::mutex lock;
+    std::thread thread;
+    int wake[2] = {-1, -1};
+    int listener = -1;
+    int ssdp = -1;
+    sim_connection music{-1, {}, {}, 0, 0};
+    std::vector<sim_connection> connections;
+    uint32_t total_window_start = 0;
+    uint16_t total_window_count = 0;
+    uint32_t command_count = 0;
+    uint32_t rejected_count = 0;
+    uint32_t notification_count = 0;
+
+    void run();
+
+    void accept_connection();
+
+    bool read_connection(sim_connection &connection, bool replies);
+
+    void execute(sim_connection &connection, const std::string &line, bool replies);
+
+    bool within_quota(sim_connection &connection, uint32_t now);
+
+    void notify(uint32_t changed);
+
+    void start_music(const std::string &host, uint16_t music_port);
+
+    void stop_music();
+
+    void answer_ssdp();
+
+    static void write(sim_connection &connection, const std::string &data);
+
+    static uint32_t now();
+};
+
+#endif
@@ -0,0 +1,582 @@
+#include "FleetSimulator.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static const char *const SSDP_GROUP = "239.255.255.250";
+static constexpr uint16_t SSDP_PORT = 1982;
+static constexpr uint32_t QUOTA_WINDOW = 60000;
+
+/**
+ * @brief Kinds of epoll sources, stored in the event data with the slot and descriptor.
+ */
+enum fleet_source
+{
+    SOURCE_WAKE,
+    SOURCE_SSDP,
+    SOURCE_LISTENER,
+    SOURCE_CONNECTION
+};
+
+static uint64_t event_data(const fleet_source source, const uint32_t index, const int fd) {
+    return static_cast<uint64_t>(source) << 56 | static_cast<uint64_t>(index) << 32 | static_cast<uint32_t>(fd);
+}
+
+static void set_nonblocking(const int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
+static std::string dotted(const uint32_t address) {
+    in_addr value{};
+    value.s_addr = htonl(address);
+    char text[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &value, text, sizeof(text));
+    return text;
+}
+
+FleetSimulator::FleetSimulator(const size_t count, const char *model, const SimAddressing addressing,
+                               const char *first_address, const uint16_t first_port) : addressing(addressing),
+    first_address(0), first_port(first_port), bulbs(count), first_connection(count, -1), music_connection(count, -1),
+    total_window_start(count, 0), total_window_count(count, 0), connection_count(count, 0) {
+    in_addr address{};
+    inet_pton(AF_INET, first_address, &address);
+    this->first_address = ntohl(address.s_addr);
+    for (size_t index = 0; index < count; index++) {
+        bulbs[index].reset(model, 0x0000000003f00000ULL + index);
+    }
+}
+
+FleetSimulator::~FleetSimulator() {
+    stop();
+}
+
+void FleetSimulator::set_model(const size_t index, const char *model) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (index < bulbs.size()) {
+        const uint64_t id = bulbs[index].id;
+        bulbs[index].reset(model, id);
+    }
+}
+
+void FleetSimulator::set_quota(const uint16_t per_connection, const uint16_t total) {
+    std::lock_guard<std::mutex> guard(lock);
+    quota = per_connection;
+    total_quota = total;
+}
+
+void FleetSimulator::set_max_connections(const uint8_t max_connections) {
+    std::lock_guard<std::mutex> guard(lock);
+    this->max_connections = max_connections;
+}
+
+void FleetSimulator::set_ssdp_window(const uint32_t window) {
+    std::lock_guard<std::mutex> guard(lock);
+    ssdp_window = window;
+}
+
+void FleetSimulator::set_ssdp(const bool enabled) {
+    std::lock_guard<std::mutex> guard(lock);
+    ssdp_enabled = enabled;
+}
+
+void FleetSimulator::set_command_hook(const SimCommandHook hook, void *arg) {
+    std::lock_guard<std::mutex> guard(lock);
+    command_hook = hook;
+    command_hook_arg = arg;
+}
+
+bool FleetSimulator::start() {
+    if (thread.joinable() || bulbs.empty()) {
+        return false;
+    }
+    // Every connection costs a descriptor: use all the process may have.
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll < 0 || pipe2(wake, O_CLOEXEC | O_NONBLOCK) != 0) {
+        stop();
+        return false;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = event_data(SOURCE_WAKE, 0, wake[0]);
+    epoll_ctl(epoll, EPOLL_CTL_ADD, wake[0], &event);
+    // Distinct addresses share one wildcard listener: accepted connections are routed by their local address.
+    const size_t listener_count = addressing == SIM_DISTINCT_ADDRESSES ? 1 : bulbs.size();
+    const int reuse = 1;
+    for (size_t index = 0; index < listener_count; index++) {
+        sockaddr_in local{};
+        local.sin_family = AF_INET;
+        local.sin_port = htons(static_cast<uint16_t>(first_port + (addressing == SIM_DISTINCT_PORTS ? index : 0)));
+        local.sin_addr.s_addr = addressing == SIM_DISTINCT_ADDRESSES ? htonl(INADDR_ANY) : htonl(first_address);
+        const int fd = socket(AF_INET, SOCK_STREAM, 0);
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (fd < 0 || bind(fd, reinterpret_cast<sockaddr *>(&local), sizeof(local)) != 0 ||
+            listen(fd, SOMAXCONN) != 0) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            stop();
+            return false;
+        }
+        set_nonblocking(fd);
+        listeners.push_back(fd);
+        event.data.u64 = event_data(SOURCE_LISTENER, static_cast<uint32_t>(index), fd);
+        epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event);
+    }
+    if (ssdp_enabled) {
+        ssdp = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+        setsockopt(ssdp, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        const int buffer = 4 << 20;
+        setsockopt(ssdp, SOL_SOCKET, SO_SNDBUF, &buffer, sizeof(buffer));
+        sockaddr_in group{};
+        group.sin_family = AF_INET;
+        group.sin_port = htons(SSDP_PORT);
+        inet_pton(AF_INET, SSDP_GROUP, &group.sin_addr);
+        ip_mreqn membership{};
+        membership.imr_multiaddr = group.sin_addr;
+        membership.imr_address.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(ssdp, reinterpret_cast<sockaddr *>(&group), sizeof(group)) != 0 ||
+            setsockopt(ssdp, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) != 0) {
+            close(ssdp);
+            ssdp = -1;
+        } else {
+            event.data.u64 = event_data(SOURCE_SSDP, 0, ssdp);
+            epoll_ctl(epoll, EPOLL_CTL_ADD, ssdp, &event);
+        }
+    }
+    last_tick = now();
+    thread = std::thread(&FleetSimulator::run, this);
+    return true;
+}
+
+void FleetSimulator::stop() {
+    if (thread.joinable()) {
+        const char signal = 0;
+        (void) !::write(wake[1], &signal, 1);
+        thread.join();
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    for (int32_t slot = 0; slot < static_cast<int32_t>(connections.size()); slot++) {
+        if (connections[static_cast<size_t>(slot)].fd >= 0) {
+            close_connection(slot);
+        }
+    }
+    for (const int fd: listeners) {
+        close(fd);
+    }
+    listeners.clear();
+    searches.clear();
+    for (int *fd: {&ssdp, &epoll, &wake[0], &wake[1]}) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+size_t FleetSimulator::size() const {
+    return bulbs.size();
+}
+
+std::string FleetSimulator::get_address(const size_t index) const {
+    return dotted(first_address + static_cast<uint32_t>(addressing == SIM_DISTINCT_ADDRESSES ? index : 0));
+}
+
+uint16_t FleetSimulator::get_port(const size_t index) const {
+    return static_cast<uint16_t>(first_port + (addressing == SIM_DISTINCT_PORTS ? index : 0));
+}
+
+SimulatedBulb FleetSimulator::get_state(const size_t index) const {
+    std::lock_guard<std::mutex> guard(lock);
+    return index < bulbs.size() ? bulbs[index] : SimulatedBulb{};
+}
+
+uint64_t FleetSimulator::get_command_count() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return command_count;
+}
+
+uint64_t FleetSimulator::get_rejected_count() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return rejected_count;
+}
+
+uint64_t FleetSimulator::get_notification_count() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return notification_count;
+}
+
+uint64_t FleetSimulator::get_ssdp_count() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return ssdp_count;
+}
+
+size_t FleetSimulator::get_connection_count() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return open_connections;
+}
+
+void FleetSimulator::run() {
+    epoll_event events[256];
+    int timeout = 1000;
+    for (;;) {
+        const int ready = epoll_wait(epoll, events, 256, timeout);
+        if (ready < 0 && errno != EINTR) {
+            return;
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        for (int i = 0; i < ready; i++) {
+            const uint64_t data = events[i].data.u64;
+            const auto source = static_cast<fleet_source>(data >> 56);
+            const auto index = static_cast<uint32_t>(data >> 32 & 0xFFFFFF);
+            const int fd = static_cast<int>(data & 0xFFFFFFFF);
+            if (source == SOURCE_WAKE) {
+                return;
+            }
+            if (source == SOURCE_SSDP) {
+                receive_searches();
+            } else if (source == SOURCE_LISTENER) {
+                accept_connections(fd, index);
+            } else if (index < connections.size() && connections[index].fd == fd) {
+                // The slot may have been closed, or reused, by an earlier event of this batch.
+                if (events[i].events & EPOLLOUT) {
+                    write(static_cast<int32_t>(index), "");
+                }
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                    read_connection(static_cast<int32_t>(index));
+                }
+            }
+        }
+        const uint32_t time = now();
+        // Cron is checked once per second, for all bulbs.
+        if (time - last_tick >= 1000) {
+            last_tick = time;
+            for (uint32_t bulb = 0; bulb < bulbs.size(); bulb++) {
+                if (bulbs[bulb].off_at != 0) {
+                    if (const uint32_t changed = bulbs[bulb].tick(time)) {
+                        notify(bulb, changed);
+                    }
+                }
+            }
+        }
+        timeout = answer_searches();
+    }
+}
+
+void FleetSimulator::accept_connections(const int listener, const size_t listener_index) {
+    for (;;) {
+        const int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            return;
+        }
+        size_t bulb = listener_index;
+        if (addressing == SIM_DISTINCT_ADDRESSES) {
+            sockaddr_in local{};
+            socklen_t length = sizeof(local);
+            getsockname(fd, reinterpret_cast<sockaddr *>(&local), &length);
+            bulb = ntohl(local.sin_addr.s_addr) - first_address;
+        }
+        // Connections to addresses outside the fleet, and over the per-bulb limit, are refused.
+        if (bulb >= bulbs.size() || connection_count[bulb] >= max_connections) {
+            close(fd);
+            continue;
+        }
+        set_nonblocking(fd);
+        const int flag = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+        add_connection(fd, static_cast<uint32_t>(bulb), false);
+    }
+}
+
+int32_t FleetSimulator::add_connection(const int fd, const uint32_t bulb, const bool music) {
+    int32_t slot = free_connection;
+    if (slot >= 0) {
+        free_connection = connections[static_cast<size_t>(slot)].next;
+    } else {
+        slot = static_cast<int32_t>(connections.size());
+        connections.emplace_back();
+    }
+    fleet_connection &connection = connections[static_cast<size_t>(slot)];
+    connection.fd = fd;
+    connection.bulb = bulb;
+    connection.window_start = 0;
+    connection.window_count = 0;
+    connection.music = music;
+    connection.input.clear();
+    connection.output.clear();
+    if (music) {
+        connection.next = -1;
+        music_connection[bulb] = slot;
+    } else {
+        connection.next = first_connection[bulb];
+        first_connection[bulb] = slot;
+        connection_count[bulb]++;
+    }
+    open_connections++;
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = event_data(SOURCE_CONNECTION, static_cast<uint32_t>(slot), fd);
+    epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event);
+    return slot;
+}
+
+void FleetSimulator::close_connection(const int32_t slot) {
+    fleet_connection &connection = connections[static_cast<size_t>(slot)];
+    const uint32_t bulb = connection.bulb;
+    if (connection.music) {
+        music_connection[bulb] = -1;
+    } else {
+        for (int32_t *link = &first_connection[bulb]; *link >= 0; link = &connections[static_cast<size_t>(*link)].next) {
+            if (*link == slot) {
+                *link = connection.next;
+                break;
+            }
+        }
+        connection_count[bulb]--;
+    }
+    close(connection.fd);
+    connection.fd = -1;
+    connection.input = std::string();
+    connection.output = std::string();
+    connection.next = free_connection;
+    free_connection = slot;
+    open_connections--;
+}
+
+void FleetSimulator::read_connection(const int32_t slot) {
+    char buffer[2048];
+    fleet_connection *connection = &connections[static_cast<size_t>(slot)];
+    const ssize_t received = recv(connection->fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return;
+    }
+    if (received <= 0) {
+        const uint32_t bulb = connection->bulb;
+        const bool music = connection->music;
+        close_connection(slot);
+        if (music && bulbs[bulb].music_on) {
+            bulbs[bulb].music_on = 0;
+            notify(bulb, 1UL << 9);
+        }
+        return;
+    }
+    connection->input.append(buffer, static_cast<size_t>(received));
+    const int fd = connection->fd;
+    size_t end;
+    while ((end = connection->input.find('\n')) != std::string::npos) {
+        std::string line = connection->input.substr(0, end);
+        connection->input.erase(0, end + 1);
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            execute(slot, line);
+        }
+        // Music mode may have added connections, moving the slots, or closed this one.
+        connection = &connections[static_cast<size_t>(slot)];
+        if (connection->fd != fd) {
+            return;
+        }
+    }
+    // Devices drop connections that send endless lines.
+    if (connection->input.size() > MAX_LINE) {
+        close_connection(slot);
+    }
+}
+
+void FleetSimulator::execute(const int32_t slot, const std::string &line) {
+    fleet_connection &connection = connections[static_cast<size_t>(slot)];
+    const uint32_t bulb = connection.bulb;
+    const bool replies = !connection.music;
+    const uint32_t time = now();
+    if (replies && !within_quota(connection, time)) {
+        rejected_count++;
+        const char *id = strstr(line.c_str(), "\"id\":");
+        write(slot, "{\"id\":" + std::to_string(id != nullptr ? atoi(id + 5) : 0) +
+                    ", \"error\":{\"code\":-1, \"message\":\"client quota exceeded\"}}\r\n");
+        return;
+    }
+    std::string reply;
+    uint32_t changed;
+    std::string music_host;
+    uint16_t music_port = 0;
+    const SimOutcome outcome = bulbs[bulb].execute(line.c_str(), time, reply, changed, music_host, music_port);
+    if (outcome == SIM_IGNORED) {
+        return;
+    }
+    command_count++;
+    if (command_hook != nullptr) {
+        command_hook(command_hook_arg, bulb, line.c_str());
+    }
+    if (replies) {
+        write(slot, reply);
+    }
+    if (outcome == SIM_MUSIC_START) {
+        start_music(bulb, music_host, music_port);
+    } else if (outcome == SIM_MUSIC_STOP) {
+        stop_music(bulb);
+    } else if (changed != 0) {
+        notify(bulb, changed);
+    }
+}
+
+bool FleetSimulator::within_quota(fleet_connection &connection, const uint32_t now) {
+    const uint32_t bulb = connection.bulb;
+    if (now - connection.window_start >= QUOTA_WINDOW) {
+        connection.window_start = now;
+        connection.window_count = 0;
+    }
+    if (now - total_window_start[bulb] >= QUOTA_WINDOW) {
+        total_window_start[bulb] = now;
+        total_window_count[bulb] = 0;
+    }
+    if ((quota != 0 && connection.window_count >= quota) ||
+        (total_quota != 0 && total_window_count[bulb] >= total_quota)) {
+        return false;
+    }
+    connection.window_count++;
+    total_window_count[bulb]++;
+    return true;
+}
+
+void FleetSimulator::notify(const uint32_t bulb, const uint32_t changed) {
+    // Devices in music mode do not notify.
+    if (music_connection[bulb] >= 0) {
+        return;
+    }
+    const std::string line = bulbs[bulb].notification(changed);
+    for (int32_t slot = first_connection[bulb]; slot >= 0; slot = connections[static_cast<size_t>(slot)].next) {
+        write(slot, line);
+        notification_count++;
+    }
+}
+
+void FleetSimulator::start_music(const uint32_t bulb, const std::string &host, const uint16_t music_port) {
+    stop_music(bulb);
+    sockaddr_in remote{};
+    remote.sin_family = AF_INET;
+    remote.sin_port = htons(music_port);
+    // The device dials from its own address.
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(first_address + (addressing == SIM_DISTINCT_ADDRESSES ? bulb : 0));
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || inet_pton(AF_INET, host.c_str(), &remote.sin_addr) != 1 ||
+        bind(fd, reinterpret_cast<sockaddr *>(&local), sizeof(local)) != 0 ||
+        connect(fd, reinterpret_cast<sockaddr *>(&remote), sizeof(remote)) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        bulbs[bulb].music_on = 0;
+        return;
+    }
+    set_nonblocking(fd);
+    const int flag = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    add_connection(fd, bulb, true);
+}
+
+void FleetSimulator::stop_music(const uint32_t bulb) {
+    if (music_connection[bulb] < 0) {
+        return;
+    }
+    close_connection(music_connection[bulb]);
+    if (bulbs[bulb].music_on) {
+        bulbs[bulb].music_on = 0;
+        notify(bulb, 1UL << 9);
+    }
+}
+
+void FleetSimulator::receive_searches() {
+    char request[1024];
+    for (;;) {
+        sockaddr_in remote{};
+        socklen_t length = sizeof(remote);
+        const ssize_t received = recvfrom(ssdp, request, sizeof(request) - 1, MSG_DONTWAIT,
+                                          reinterpret_cast<sockaddr *>(&remote), &length);
+        if (received <= 0) {
+            return;
+        }
+        request[received] = '\0';
+        if (strncmp(request, "M-SEARCH", 8) == 0 && strstr(request, "wifi_bulb") != nullptr) {
+            searches.push_back({ntohl(remote.sin_addr.s_addr), ntohs(remote.sin_port), now(), 0});
+        }
+    }
+}
+
+int FleetSimulator::answer_searches() {
+    const uint32_t time = now();
+    for (size_t i = 0; i < searches.size();) {
+        ssdp_search &search = searches[i];
+        const uint32_t elapsed = time - search.start;
+        // The bulbs answering by now, spread evenly over the window.
+        const size_t due = ssdp_window == 0 || elapsed >= ssdp_window
+                               ? bulbs.size()
+                               : static_cast<size_t>(static_cast<uint64_t>(bulbs.size()) * elapsed / ssdp_window);
+        sockaddr_in remote{};
+        remote.sin_family = AF_INET;
+        remote.sin_port = htons(search.port);
+        remote.sin_addr.s_addr = htonl(search.address);
+        for (; search.next < due; search.next++) {
+            const std::string response = bulbs[search.next].ssdp_response(get_address(search.next).c_str(),
+                                                                            get_port(search.next));
+            if (sendto(ssdp, response.data(), response.size(), 0, reinterpret_cast<sockaddr *>(&remote),
+                       sizeof(remote)) < 0) {
+                // The send buffer is full: the remaining answers go out on the next turn.
+                break;
+            }
+            ssdp_count++;
+        }
+        if (search.next >= bulbs.size()) {
+            searches.erase(searches.begin() + static_cast<ptrdiff_t>(i));
+        } else {
+            i++;
+        }
+    }
+    // While answers are pending, wake up every millisecond to send the next ones.
+    return searches.empty() ? 1000 : 1;
+}
+
+void FleetSimulator::write(const int32_t slot, const std::string &data) {
+    fleet_connection &connection = connections[static_cast<size_t>(slot)];
+    const bool waiting = !connection.output.empty();
+    connection.output += data;
+    while (!connection.output.empty()) {
+        const ssize_t sent = send(connection.fd, connection.output.data(), connection.output.size(),
+                                  MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent <= 0) {
+            break;
+        }
+        connection.output.erase(0, static_cast<size_t>(sent));
+    }
+    if (waiting != !connection.output.empty()) {
+        watch(slot);
+    }
+}
+
+void FleetSimulator::watch(const int32_t slot) {
+    const fleet_connection &connection = connections[static_cast<size_t>(slot)];
+    epoll_event event{};
+    event.events = connection.output.empty() ? EPOLLIN : EPOLLIN | EPOLLOUT;
+    event.data.u64 = event_data(SOURCE_CONNECTION, static_cast<uint32_t>(slot), connection.fd);
+    epoll_ctl(epoll, EPOLL_CTL_MOD, connection.fd, &event);
+}
+
+uint32_t FleetSimulator::now() {
+    using namespace std::chrono;
+    return static_cast<uint32_t>(duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+}
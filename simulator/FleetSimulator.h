@@ -0,0 +1,257 @@
+#ifndef YEELIGHTARDUINO_FLEETSIMULATOR_H
+#define YEELIGHTARDUINO_FLEETSIMULATOR_H
+
+#include "SimulatedBulb.h"
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Enumeration of the ways simulated bulbs of a fleet are told apart.
+ */
+enum SimAddressing
+{
+    SIM_DISTINCT_ADDRESSES, /**< One loopback address per bulb (127.1.0.1, 127.1.0.2...), all on the same port */
+    SIM_DISTINCT_PORTS      /**< One address for all bulbs, on consecutive ports */
+};
+
+/**
+ * @brief Called on the simulator thread for every request a bulb executes, on regular and music connections.
+ * @param arg The argument given with the hook.
+ * @param bulb The bulb index.
+ * @param line The request, without its line ending.
+ */
+typedef void (*SimCommandHook)(void *arg, size_t bulb, const char *line);
+
+/**
+ * @class FleetSimulator
+ * @brief Thousands of simulated Yeelight bulbs served by one epoll thread.
+ *
+ * Each bulb behaves like a BulbSimulator: same protocol, quotas, notifications and music dial-back. The
+ * per-bulb state lives in parallel arrays (about 100 bytes per bulb), and connection state only exists
+ * while a connection is open. With SIM_DISTINCT_ADDRESSES a single listening socket serves every bulb, the
+ * bulb being chosen by the address the client dialed, so the descriptor budget goes to connections.
+ *
+ * One SSDP search is answered for every bulb. The answers are spread over a window, as devices delay their
+ * answers, so the searcher's receive buffer is not flooded.
+ */
+class FleetSimulator {
+public:
+    /**
+     * @brief Constructs a stopped fleet.
+     * @param count The number of bulbs.
+     * @param model The model of every bulb (see set_model to mix models).
+     * @param addressing How the bulbs are told apart.
+     * @param first_address The address of the first bulb (SIM_DISTINCT_ADDRESSES) or of every bulb.
+     * @param first_port The port of every bulb (SIM_DISTINCT_ADDRESSES) or of the first bulb.
+     */
+    explicit FleetSimulator(size_t count, const char *model = "color", SimAddressing addressing = SIM_DISTINCT_ADDRESSES,
+                            const char *first_address = "127.1.0.1", uint16_t first_port = 55443);
+
+    ~FleetSimulator();
+
+    FleetSimulator(const FleetSimulator &) = delete;
+
+    FleetSimulator &operator=(const FleetSimulator &) = delete;
+
+    /**
+     * @brief Changes the model of a bulb, and its support list to the model default.
+     * @param index The bulb index.
+     * @param model The model name.
+     */
+    void set_model(size_t index, const char *model);
+
+    /**
+     * @brief Sets the command quotas of every bulb (see BulbSimulator::set_quota).
+     * @param per_connection Commands per minute on one connection (0 for no limit).
+     * @param total Commands per minute over all connections of a bulb (0 for no limit).
+     */
+    void set_quota(uint16_t per_connection, uint16_t total);
+
+    /**
+     * @brief Sets the number of simultaneous connections per bulb.
+     * @param max_connections The number of connections (4 by default).
+     */
+    void set_max_connections(uint8_t max_connections);
+
+    /**
+     * @brief Sets the window over which the answers to one SSDP search are spread.
+     * @param window The window in milliseconds (1000 by default, 0 to answer at once).
+     */
+    void set_ssdp_window(uint32_t window);
+
+    /**
+     * @brief Enables answering SSDP searches. Takes effect at start().
+     * @param enabled True to answer searches (default).
+     */
+    void set_ssdp(bool enabled);
+
+    /**
+     * @brief Sets a hook observing the executed requests, e.g. to time their arrival. The hook runs with the
+     * simulator locked, so it must not call the simulator.
+     * @param hook The hook, or nullptr.
+     * @param arg An argument passed to the hook.
+     */
+    void set_command_hook(SimCommandHook hook, void *arg);
+
+    /**
+     * @brief Raises the descriptor limit, binds the listeners and starts serving.
+     * @return False if a listener could not be bound or the fleet is already running.
+     */
+    bool start();
+
+    /**
+     * @brief Stops serving and closes every connection.
+     */
+    void stop();
+
+    /**
+     * @brief Returns the number of bulbs.
+     * @return The number of bulbs.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Returns the address of a bulb.
+     * @param index The bulb index.
+     * @return The address, in dotted form.
+     */
+    std::string get_address(size_t index) const;
+
+    /**
+     * @brief Returns the port of a bulb.
+     * @param index The bulb index.
+     * @return The port.
+     */
+    uint16_t get_port(size_t index) const;
+
+    /**
+     * @brief Returns a copy of the state of a bulb.
+     * @param index The bulb index.
+     * @return The state.
+     */
+    SimulatedBulb get_state(size_t index) const;
+
+    /**
+     * @brief Returns the number of requests executed by all bulbs.
+     * @return The number of requests.
+     */
+    uint64_t get_command_count() const;
+
+    /**
+     * @brief Returns the number of requests refused because of a quota.
+     * @return The number of refused requests.
+     */
+    uint64_t get_rejected_count() const;
+
+    /**
+     * @brief Returns the number of `props` notifications sent, counting one per connection.
+     * @return The number of notifications.
+     */
+    uint64_t get_notification_count() const;
+
+    /**
+     * @brief Returns the number of SSDP answers sent.
+     * @return The number of answers.
+     */
+    uint64_t get_ssdp_count() const;
+
+    /**
+     * @brief Returns the number of open connections, music connections included.
+     * @return The number of connections.
+     */
+    size_t get_connection_count() const;
+
+private:
+    struct fleet_connection
+    {
+        int fd;
+        uint32_t bulb;
+        int32_t next;
+        uint32_t window_start;
+        uint16_t window_count;
+        bool music;
+        std::string input;
+        std::string output;
+    };
+
+    struct ssdp_search
+    {
+        uint32_t address;
+        uint16_t port;
+        uint32_t start;
+        size_t next;
+    };
+
+    static constexpr size_t MAX_LINE = 4096;
+
+    SimAddressing addressing;
+    uint32_t first_address;
+    uint16_t first_port;
+    uint16_t quota = 60;
+    uint16_t total_quota = 144;
+    uint8_t max_connections = 4;
+    uint32_t ssdp_window = 1000;
+    bool ssdp_enabled = true;
+    SimCommandHook command_hook = nullptr;
+    void *command_hook_arg = nullptr;
+
+    // Per-bulb state, indexed by bulb.
+    std::vector<SimulatedBulb> bulbs;
+    std::vector<int32_t> first_connection;
+    std::vector<int32_t> music_connection;
+    std::vector<uint32_t> total_window_start;
+    std::vector<uint16_t> total_window_count;
+    std::vector<uint8_t> connection_count;
+    std::vector<int> listeners;
+
+    // Open connections, by slot; free slots are chained through `next`.
+    std::vector<fleet_connection> connections;
+    int32_t free_connection = -1;
+    size_t open_connections = 0;
+
+    std::vector<ssdp_search> searches;
+    mutable std::mutex lock;
+    std::thread thread;
+    int epoll = -1;
+    int wake[2] = {-1, -1};
+    int ssdp = -1;
+    uint64_t command_count = 0;
+    uint64_t rejected_count = 0;
+    uint64_t notification_count = 0;
+    uint64_t ssdp_count = 0;
+    uint32_t last_tick = 0;
+
+    void run();
+
+    void accept_connections(int listener, size_t listener_index);
+
+    int32_t add_connection(int fd, uint32_t bulb, bool music);
+
+    void close_connection(int32_t slot);
+
+    void read_connection(int32_t slot);
+
+    void execute(int32_t slot, const std::string &line);
+
+    bool within_quota(fleet_connection &connection, uint32_t now);
+
+    void notify(uint32_t bulb, uint32_t changed);
+
+    void start_music(uint32_t bulb, const std::string &host, uint16_t music_port);
+
+    void stop_music(uint32_t bulb);
+
+    void receive_searches();
+
+    int answer_searches();
+
+    void write(int32_t slot, const std::string &data);
+
+    void watch(int32_t slot);
+
+    static uint32_t now();
+};
+
+#endif
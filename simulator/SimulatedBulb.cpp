@@ -0,0 +1,597 @@
+#include "SimulatedBulb.h"
+
+#include <cJSON.h>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
+static const char *const method_names[SIM_METHOD_COUNT] = {
+    "get_prop", "set_ct_abx", "set_rgb", "set_hsv", "set_bright", "set_power", "toggle", "set_default", "start_cf",
+    "stop_cf", "set_scene", "cron_add", "cron_get", "cron_del", "set_adjust", "set_music", "set_name", "bg_set_rgb",
+    "bg_set_hsv", "bg_set_ct_abx", "bg_start_cf", "bg_stop_cf", "bg_set_scene", "bg_set_default", "bg_set_power",
+    "bg_set_bright", "bg_set_adjust", "bg_toggle", "dev_toggle", "adjust_bright", "adjust_ct", "adjust_color",
+    "bg_adjust_bright", "bg_adjust_ct", "bg_adjust_color"
+};
+
+static const char *const property_names[] = {
+    "power", "bright", "ct", "rgb", "hue", "sat", "color_mode", "flowing", "delayoff", "music_on", "name",
+    "bg_power", "bg_flowing", "bg_ct", "bg_lmode", "bg_bright", "bg_rgb", "bg_hue", "bg_sat", "nl_br", "active_mode"
+};
+
+static constexpr uint8_t PROPERTY_COUNT = sizeof(property_names) / sizeof(property_names[0]);
+
+#define SIM_MAIN_METHODS "get_prop set_default set_power toggle set_bright start_cf stop_cf set_scene cron_add " \
+                         "cron_get cron_del set_adjust adjust_bright set_name"
+#define SIM_BG_METHODS "bg_set_rgb bg_set_hsv bg_set_ct_abx bg_start_cf bg_stop_cf bg_set_scene bg_set_default " \
+                       "bg_set_power bg_set_bright bg_set_adjust bg_toggle dev_toggle bg_adjust_bright " \
+                       "bg_adjust_ct bg_adjust_color"
+
+/**
+ * @brief Support lists reported by the real devices, by model family.
+ */
+static const struct
+{
+    const char *model;
+    const char *support;
+} model_support[] = {
+    {"mono", SIM_MAIN_METHODS},
+    {"ct_bulb", SIM_MAIN_METHODS " set_ct_abx adjust_ct set_music"},
+    {"color", SIM_MAIN_METHODS " set_ct_abx set_rgb set_hsv adjust_ct adjust_color set_music"},
+    {"stripe", SIM_MAIN_METHODS " set_ct_abx set_rgb set_hsv adjust_ct adjust_color set_music"},
+    {"bslamp", SIM_MAIN_METHODS " set_ct_abx set_rgb set_hsv adjust_ct adjust_color set_music"},
+    {"lamp", SIM_MAIN_METHODS " set_ct_abx adjust_ct set_music"},
+    {"ceiling", SIM_MAIN_METHODS " set_ct_abx adjust_ct set_music"},
+    {"ceiling4", SIM_MAIN_METHODS " set_ct_abx adjust_ct set_music " SIM_BG_METHODS},
+    {"ceiling10", SIM_MAIN_METHODS " set_ct_abx adjust_ct set_music " SIM_BG_METHODS},
+};
+
+/**
+ * @brief References to the fields of one light channel, so main and background methods share their logic.
+ */
+struct sim_channel
+{
+    uint8_t &power;
+    uint8_t &bright;
+    uint8_t &color_mode;
+    uint8_t &flowing;
+    uint32_t &rgb;
+    uint16_t &ct;
+    uint16_t &hue;
+    uint8_t &sat;
+};
+
+static constexpr int ERROR_GENERAL = -1;
+
+/**
+ * @brief Reply texts, as sent by the devices.
+ */
+static const char *const UNSUPPORTED = "unsupported method";
+static const char *const INVALID = "invalid params";
+static const char *const OFF = "general error";
+
+static void reply_error(std::string &reply, const int id, const char *message) {
+    char line[128];
+    snprintf(line, sizeof(line), "{\"id\":%d, \"error\":{\"code\":%d, \"message\":\"%s\"}}\r\n", id, ERROR_GENERAL,
+             message);
+    reply = line;
+}
+
+static void reply_ok(std::string &reply, const int id) {
+    char line[40];
+    snprintf(line, sizeof(line), "{\"id\":%d, \"result\":[\"ok\"]}\r\n", id);
+    reply = line;
+}
+
+static bool number_param(const cJSON *params, const int index, long &value) {
+    const cJSON *item = cJSON_GetArrayItem(params, index);
+    if (!cJSON_IsNumber(item)) {
+        return false;
+    }
+    value = static_cast<long>(item->valuedouble);
+    return true;
+}
+
+static const char *string_param(const cJSON *params, const int index) {
+    const cJSON *item = cJSON_GetArrayItem(params, index);
+    return cJSON_IsString(item) ? item->valuestring : nullptr;
+}
+
+/**
+ * @brief Checks the effect and duration parameters that follow the value of most set methods.
+ */
+static bool valid_transition(const cJSON *params, const int index) {
+    const char *effect = string_param(params, index);
+    long duration;
+    if (effect == nullptr || !number_param(params, index + 1, duration)) {
+        return false;
+    }
+    if (strcmp(effect, "sudden") == 0) {
+        return true;
+    }
+    return strcmp(effect, "smooth") == 0 && duration >= 30;
+}
+
+static bool valid_flow(const cJSON *params, const int index) {
+    long count;
+    long action;
+    const char *expression = string_param(params, index + 2);
+    if (!number_param(params, index, count) || !number_param(params, index + 1, action) || expression == nullptr) {
+        return false;
+    }
+    size_t values = 1;
+    for (const char *c = expression; *c != '\0'; c++) {
+        values += *c == ',';
+    }
+    return count >= 0 && action >= 0 && action <= 2 && *expression != '\0' && values % 4 == 0;
+}
+
+static long clamp(const long value, const long low, const long high) {
+    return value < low ? low : value > high ? high : value;
+}
+
+void SimulatedBulb::reset(const char *model, const uint64_t id) {
+    memset(this, 0, sizeof(*this));
+    this->id = id;
+    snprintf(this->model, sizeof(this->model), "%s", model);
+    support = parse_support(default_support(model));
+    power = 1;
+    bright = 100;
+    ct = 4000;
+    rgb = 0xFFFFFF;
+    hue = 0;
+    sat = 0;
+    color_mode = 2;
+    bg_power = 0;
+    bg_bright = 100;
+    bg_ct = 4000;
+    bg_rgb = 0xFFFFFF;
+    bg_lmode = 2;
+}
+
+SimOutcome SimulatedBulb::execute(const char *line, const uint32_t now, std::string &reply, uint32_t &changed,
+                                  std::string &music_host, uint16_t &music_port) {
+    reply.clear();
+    changed = 0;
+    cJSON *root = cJSON_Parse(line);
+    const cJSON *id_item = cJSON_GetObjectItem(root, "id");
+    const cJSON *method_item = cJSON_GetObjectItem(root, "method");
+    if (!cJSON_IsNumber(id_item) || !cJSON_IsString(method_item)) {
+        cJSON_Delete(root);
+        return SIM_IGNORED;
+    }
+    const int id = id_item->valueint;
+    const cJSON *params = cJSON_GetObjectItem(root, "params");
+    int method = 0;
+    while (method < SIM_METHOD_COUNT && strcmp(method_names[method], method_item->valuestring) != 0) {
+        method++;
+    }
+    if (method == SIM_METHOD_COUNT || (support >> method & 1) == 0) {
+        reply_error(reply, id, UNSUPPORTED);
+        cJSON_Delete(root);
+        return SIM_REPLIED;
+    }
+    if (!cJSON_IsArray(params)) {
+        reply_error(reply, id, INVALID);
+        cJSON_Delete(root);
+        return SIM_REPLIED;
+    }
+    const SimulatedBulb before = *this;
+    const bool background = strncmp(method_names[method], "bg_", 3) == 0;
+    const sim_channel channel = background
+                                    ? sim_channel{bg_power, bg_bright, bg_lmode, bg_flowing, bg_rgb, bg_ct, bg_hue,
+                                                  bg_sat}
+                                    : sim_channel{power, bright, color_mode, flowing, rgb, ct, hue, sat};
+    const char *error = nullptr;
+    SimOutcome outcome = SIM_REPLIED;
+    long a;
+    long b;
+    long c;
+    switch (static_cast<SimMethod>(method)) {
+        case SIM_GET_PROP: {
+            std::string result = "{\"id\":" + std::to_string(id) + ", \"result\":[";
+            for (int i = 0; i < cJSON_GetArraySize(params); i++) {
+                const char *name = string_param(params, i);
+                uint8_t property = 0;
+                while (name != nullptr && property < PROPERTY_COUNT && strcmp(property_names[property], name) != 0) {
+                    property++;
+                }
+                // Unknown properties are answered with an empty string.
+                result += i == 0 ? "\"" : ",\"";
+                result += name != nullptr && property < PROPERTY_COUNT ? this->property(property) : "";
+                result += "\"";
+            }
+            reply = result + "]}\r\n";
+            cJSON_Delete(root);
+            return SIM_REPLIED;
+        }
+        case SIM_SET_CT_ABX:
+        case SIM_BG_SET_CT_ABX:
+            if (!number_param(params, 0, a) || a < 1700 || a > 6500 || !valid_transition(params, 1)) {
+                error = INVALID;
+            } else if (!channel.power) {
+                error = OFF;
+            } else {
+                channel.ct = static_cast<uint16_t>(a);
+                channel.color_mode = 2;
+                channel.flowing = 0;
+            }
+            break;
+        case SIM_SET_RGB:
+        case SIM_BG_SET_RGB:
+            if (!number_param(params, 0, a) || a < 0 || a > 0xFFFFFF || !valid_transition(params, 1)) {
+                error = INVALID;
+            } else if (!channel.power) {
+                error = OFF;
+            } else {
+                channel.rgb = static_cast<uint32_t>(a);
+                channel.color_mode = 1;
+                channel.flowing = 0;
+            }
+            break;
+        case SIM_SET_HSV:
+        case SIM_BG_SET_HSV:
+            if (!number_param(params, 0, a) || !number_param(params, 1, b) || a < 0 || a > 359 || b < 0 || b > 100 ||
+                !valid_transition(params, 2)) {
+                error = INVALID;
+            } else if (!channel.power) {
+                error = OFF;
+            } else {
+                channel.hue = static_cast<uint16_t>(a);
+                channel.sat = static_cast<uint8_t>(b);
+                channel.color_mode = 3;
+                channel.flowing = 0;
+            }
+            break;
+        case SIM_SET_BRIGHT:
+        case SIM_BG_SET_BRIGHT:
+            if (!number_param(params, 0, a) || a < 1 || a > 100 || !valid_transition(params, 1)) {
+                error = INVALID;
+            } else if (!channel.power) {
+                error = OFF;
+            } else {
+                channel.bright = static_cast<uint8_t>(a);
+            }
+            break;
+        case SIM_SET_POWER:
+        case SIM_BG_SET_POWER: {
+            const char *state = string_param(params, 0);
+            c = 0;
+            if (state == nullptr || (strcmp(state, "on") != 0 && strcmp(state, "off") != 0) ||
+                !valid_transition(params, 1) || (cJSON_GetArraySize(params) > 3 && !number_param(params, 3, c)) ||
+                c < 0 || c > 5) {
+                error = INVALID;
+                break;
+            }
+            channel.power = strcmp(state, "on") == 0;
+            if (channel.power && c >= 1 && c <= 3) {
+                // Modes 1-3 select CT, RGB and HSV; the protocol codes RGB as 1 and CT as 2.
+                channel.color_mode = static_cast<uint8_t>(c == 1 ? 2 : c == 2 ? 1 : 3);
+            }
+            if (!background && channel.power) {
+                active_mode = c == 5;
+                nl_br = c == 5 ? bright : 0;
+            }
+            break;
+        }
+        case SIM_TOGGLE:
+        case SIM_BG_TOGGLE:
+            channel.power = !channel.power;
+            break;
+        case SIM_DEV_TOGGLE:
+            power = !power;
+            bg_power = !bg_power;
+            break;
+        case SIM_SET_DEFAULT:
+        case SIM_BG_SET_DEFAULT:
+            break;
+        case SIM_START_CF:
+        case SIM_BG_START_CF:
+            if (!valid_flow(params, 0)) {
+                error = INVALID;
+            } else if (!channel.power) {
+                error = OFF;
+            } else {
+                channel.flowing = 1;
+            }
+            break;
+        case SIM_STOP_CF:
+        case SIM_BG_STOP_CF:
+            channel.flowing = 0;
+            break;
+        case SIM_SET_SCENE:
+        case SIM_BG_SET_SCENE: {
+            const char *type = string_param(params, 0);
+            if (type == nullptr) {
+                error = INVALID;
+            } else if (strcmp(type, "color") == 0 && number_param(params, 1, a) && number_param(params, 2, b) &&
+                       a >= 0 && a <= 0xFFFFFF && b >= 1 && b <= 100) {
+                channel.rgb = static_cast<uint32_t>(a);
+                channel.bright = static_cast<uint8_t>(b);
+                channel.color_mode = 1;
+            } else if (strcmp(type, "hsv") == 0 && number_param(params, 1, a) && number_param(params, 2, b) &&
+                       number_param(params, 3, c) && a >= 0 && a <= 359 && b >= 0 && b <= 100 && c >= 1 && c <= 100) {
+                channel.hue = static_cast<uint16_t>(a);
+                channel.sat = static_cast<uint8_t>(b);
+                channel.bright = static_cast<uint8_t>(c);
+                channel.color_mode = 3;
+            } else if (strcmp(type, "ct") == 0 && number_param(params, 1, a) && number_param(params, 2, b) &&
+                       a >= 1700 && a <= 6500 && b >= 1 && b <= 100) {
+                channel.ct = static_cast<uint16_t>(a);
+                channel.bright = static_cast<uint8_t>(b);
+                channel.color_mode = 2;
+            } else if (strcmp(type, "cf") == 0 && valid_flow(params, 1)) {
+                channel.power = 1;
+                channel.flowing = 1;
+                break;
+            } else if (strcmp(type, "auto_delay_off") == 0 && number_param(params, 1, a) &&
+                       number_param(params, 2, b) && a >= 1 && a <= 100 && b >= 1 && b <= 255) {
+                channel.bright = static_cast<uint8_t>(a);
+                delayoff = static_cast<uint8_t>(b);
+                off_at = (now + static_cast<uint32_t>(b) * 60000) | 1;
+            } else {
+                error = INVALID;
+                break;
+            }
+            channel.power = 1;
+            channel.flowing = 0;
+            break;
+        }
+        case SIM_CRON_ADD:
+            if (!number_param(params, 0, a) || !number_param(params, 1, b) || a != 0 || b < 1 || b > 255) {
+                error = INVALID;
+            } else {
+                delayoff = static_cast<uint8_t>(b);
+                off_at = (now + static_cast<uint32_t>(b) * 60000) | 1;
+            }
+            break;
+        case SIM_CRON_GET:
+            if (!number_param(params, 0, a) || a != 0) {
+                error = INVALID;
+                break;
+            }
+            reply = "{\"id\":" + std::to_string(id) + ", \"result\":[";
+            if (off_at != 0) {
+                reply += "{\"type\":0,\"delay\":" + std::to_string(delayoff) + ",\"mix\":0}";
+            }
+            reply += "]}\r\n";
+            cJSON_Delete(root);
+            return SIM_REPLIED;
+        case SIM_CRON_DEL:
+            if (!number_param(params, 0, a) || a != 0) {
+                error = INVALID;
+            } else {
+                delayoff = 0;
+                off_at = 0;
+            }
+            break;
+        case SIM_SET_ADJUST:
+        case SIM_BG_SET_ADJUST: {
+            const char *action = string_param(params, 0);
+            const char *property = string_param(params, 1);
+            if (action == nullptr || property == nullptr) {
+                error = INVALID;
+                break;
+            }
+            const bool increase = strcmp(action, "increase") == 0;
+            const bool decrease = strcmp(action, "decrease") == 0;
+            const bool circle = strcmp(action, "circle") == 0;
+            if (!channel.power) {
+                error = OFF;
+            } else if (strcmp(property, "bright") == 0 && (increase || decrease || circle)) {
+                const long next = channel.bright + (decrease ? -10 : 10);
+                channel.bright = static_cast<uint8_t>(circle && next > 100 ? 1 : clamp(next, 1, 100));
+            } else if (strcmp(property, "ct") == 0 && (increase || decrease || circle)) {
+                const long next = channel.ct + (decrease ? -500 : 500);
+                channel.ct = static_cast<uint16_t>(circle && next > 6500 ? 1700 : clamp(next, 1700, 6500));
+                channel.color_mode = 2;
+            } else if (strcmp(property, "color") == 0 && circle) {
+                channel.hue = static_cast<uint16_t>((channel.hue + 60) % 360);
+                channel.color_mode = 3;
+            } else {
+                error = INVALID;
+            }
+            break;
+        }
+        case SIM_ADJUST_BRIGHT:
+        case SIM_BG_ADJUST_BRIGHT:
+        case SIM_ADJUST_CT:
+        case SIM_BG_ADJUST_CT:
+        case SIM_ADJUST_COLOR:
+        case SIM_BG_ADJUST_COLOR:
+            if (!number_param(params, 0, a) || !number_param(params, 1, b) || a < -100 || a > 100 || b < 30) {
+                error = INVALID;
+            } else if (!channel.power) {
+                error = OFF;
+            } else if (method == SIM_ADJUST_BRIGHT || method == SIM_BG_ADJUST_BRIGHT) {
+                channel.bright = static_cast<uint8_t>(clamp(channel.bright + a, 1, 100));
+            } else if (method == SIM_ADJUST_CT || method == SIM_BG_ADJUST_CT) {
+                // The percentage is of the whole 1700-6500 K range.
+                channel.ct = static_cast<uint16_t>(clamp(channel.ct + a * 48, 1700, 6500));
+                channel.color_mode = 2;
+            } else {
+                channel.hue = static_cast<uint16_t>((channel.hue + 360 + a * 36 / 10) % 360);
+                channel.color_mode = 3;
+            }
+            break;
+        case SIM_SET_MUSIC: {
+            const char *host = string_param(params, 1);
+            if (!number_param(params, 0, a) || (a == 1 && (host == nullptr || !number_param(params, 2, b) ||
+                                                           b <= 0 || b > 65535)) || a < 0 || a > 1) {
+                error = INVALID;
+            } else if (a == 1) {
+                music_host = host;
+                music_port = static_cast<uint16_t>(b);
+                music_on = 1;
+                outcome = SIM_MUSIC_START;
+            } else {
+                music_on = 0;
+                outcome = SIM_MUSIC_STOP;
+            }
+            break;
+        }
+        case SIM_SET_NAME: {
+            const char *value = string_param(params, 0);
+            if (value == nullptr) {
+                error = INVALID;
+            } else {
+                snprintf(name, sizeof(name), "%s", value);
+            }
+            break;
+        }
+        case SIM_METHOD_COUNT:
+            break;
+    }
+    cJSON_Delete(root);
+    if (error != nullptr) {
+        *this = before;
+        reply_error(reply, id, error);
+        return SIM_REPLIED;
+    }
+    reply_ok(reply, id);
+    for (uint8_t property = 0; property < PROPERTY_COUNT; property++) {
+        if (before.property(property) != this->property(property)) {
+            changed |= 1UL << property;
+        }
+    }
+    return outcome == SIM_REPLIED && changed != 0 ? SIM_CHANGED : outcome;
+}
+
+uint32_t SimulatedBulb::tick(const uint32_t now) {
+    if (off_at == 0 || static_cast<int32_t>(now - off_at) < 0) {
+        return 0;
+    }
+    off_at = 0;
+    delayoff = 0;
+    uint32_t changed = 1UL << 8;
+    if (power) {
+        power = 0;
+        changed |= 1UL << 0;
+    }
+    return changed;
+}
+
+std::string SimulatedBulb::property(const uint8_t property) const {
+    switch (property) {
+        case 0: return power ? "on" : "off";
+        case 1: return std::to_string(bright);
+        case 2: return std::to_string(ct);
+        case 3: return std::to_string(rgb);
+        case 4: return std::to_string(hue);
+        case 5: return std::to_string(sat);
+        case 6: return std::to_string(color_mode);
+        case 7: return std::to_string(flowing);
+        case 8: return std::to_string(delayoff);
+        case 9: return std::to_string(music_on);
+        case 10: return name;
+        case 11: return bg_power ? "on" : "off";
+        case 12: return std::to_string(bg_flowing);
+        case 13: return std::to_string(bg_ct);
+        case 14: return std::to_string(bg_lmode);
+        case 15: return std::to_string(bg_bright);
+        case 16: return std::to_string(bg_rgb);
+        case 17: return std::to_string(bg_hue);
+        case 18: return std::to_string(bg_sat);
+        case 19: return std::to_string(nl_br);
+        case 20: return std::to_string(active_mode);
+        default: return "";
+    }
+}
+
+std::string SimulatedBulb::notification(const uint32_t changed) const {
+    std::string line = "{\"method\":\"props\",\"params\":{";
+    bool first = true;
+    for (uint8_t property = 0; property < PROPERTY_COUNT; property++) {
+        if ((changed >> property & 1) == 0) {
+            continue;
+        }
+        line += first ? "\"" : ",\"";
+        line += property_names[property];
+        line += "\":\"" + this->property(property) + "\"";
+        first = false;
+    }
+    return line + "}}\r\n";
+}
+
+std::string SimulatedBulb::ssdp_response(const char *address, const uint16_t port) const {
+    char response[1024];
+    snprintf(response, sizeof(response),
+             "HTTP/1.1 200 OK\r\n"
+             "Cache-Control: max-age=3600\r\n"
+             "Date: \r\n"
+             "Ext: \r\n"
+             "Location: yeelight://%s:%u\r\n"
+             "Server: POSIX UPnP/1.0 YGLC/1\r\n"
+             "id: 0x%016llx\r\n"
+             "model: %s\r\n"
+             "fw_ver: 18\r\n"
+             "support: %s\r\n"
+             "power: %s\r\n"
+             "bright: %u\r\n"
+             "color_mode: %u\r\n"
+             "ct: %u\r\n"
+             "rgb: %u\r\n"
+             "hue: %u\r\n"
+             "sat: %u\r\n"
+             "name: %s\r\n",
+             address, port, static_cast<unsigned long long>(id), model, support_list().c_str(), power ? "on" : "off",
+             bright, color_mode, ct, rgb, hue, sat, name);
+    return response;
+}
+
+std::string SimulatedBulb::support_list() const {
+    std::string list;
+    for (int method = 0; method < SIM_METHOD_COUNT; method++) {
+        if (support >> method & 1) {
+            if (!list.empty()) {
+                list += ' ';
+            }
+            list += method_names[method];
+        }
+    }
+    return list;
+}
+
+uint64_t SimulatedBulb::parse_support(const char *methods) {
+    uint64_t mask = 0;
+    const char *start = methods;
+    while (start != nullptr && *start != '\0') {
+        while (*start == ' ') {
+            start++;
+        }
+        size_t length = 0;
+        while (start[length] != '\0' && start[length] != ' ') {
+            length++;
+        }
+        for (int method = 0; method < SIM_METHOD_COUNT; method++) {
+            if (strlen(method_names[method]) == length && strncmp(method_names[method], start, length) == 0) {
+                mask |= 1ULL << method;
+            }
+        }
+        start += length;
+    }
+    return mask;
+}
+
+const char *SimulatedBulb::default_support(const char *model) {
+    // Model names carry a generation number (color1, ceiling4...): an exact match comes first, then the family.
+    size_t family = strlen(model);
+    for (int pass = 0; pass < 2; pass++) {
+        for (const auto &entry: model_support) {
+            if (strlen(entry.model) == family && strncmp(entry.model, model, family) == 0) {
+                return entry.support;
+            }
+        }
+        while (family > 0 && isdigit(static_cast<unsigned char>(model[family - 1]))) {
+            family--;
+        }
+    }
+    return model_support[2].support;
+}
+
+const char *SimulatedBulb::property_name(const uint8_t property) {
+    return property < PROPERTY_COUNT ? property_names[property] : nullptr;
+}
+
+uint8_t SimulatedBulb::property_count() {
+    return PROPERTY_COUNT;
+}
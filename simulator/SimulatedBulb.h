@@ -0,0 +1,181 @@
+#ifndef YEELIGHTARDUINO_SIMULATEDBULB_H
+#define YEELIGHTARDUINO_SIMULATEDBULB_H
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Enumeration of the LAN protocol methods, in the order of the fields of SupportedMethods.
+ */
+enum SimMethod
+{
+    SIM_GET_PROP,
+    SIM_SET_CT_ABX,
+    SIM_SET_RGB,
+    SIM_SET_HSV,
+    SIM_SET_BRIGHT,
+    SIM_SET_POWER,
+    SIM_TOGGLE,
+    SIM_SET_DEFAULT,
+    SIM_START_CF,
+    SIM_STOP_CF,
+    SIM_SET_SCENE,
+    SIM_CRON_ADD,
+    SIM_CRON_GET,
+    SIM_CRON_DEL,
+    SIM_SET_ADJUST,
+    SIM_SET_MUSIC,
+    SIM_SET_NAME,
+    SIM_BG_SET_RGB,
+    SIM_BG_SET_HSV,
+    SIM_BG_SET_CT_ABX,
+    SIM_BG_START_CF,
+    SIM_BG_STOP_CF,
+    SIM_BG_SET_SCENE,
+    SIM_BG_SET_DEFAULT,
+    SIM_BG_SET_POWER,
+    SIM_BG_SET_BRIGHT,
+    SIM_BG_SET_ADJUST,
+    SIM_BG_TOGGLE,
+    SIM_DEV_TOGGLE,
+    SIM_ADJUST_BRIGHT,
+    SIM_ADJUST_CT,
+    SIM_ADJUST_COLOR,
+    SIM_BG_ADJUST_BRIGHT,
+    SIM_BG_ADJUST_CT,
+    SIM_BG_ADJUST_COLOR,
+    SIM_METHOD_COUNT
+};
+
+/**
+ * @brief Enumeration of the outcomes of a request executed by a simulated bulb.
+ */
+enum SimOutcome
+{
+    SIM_REPLIED,     /**< The reply is ready, no state changed */
+    SIM_CHANGED,     /**< The reply is ready and properties changed: notify the connections */
+    SIM_MUSIC_START, /**< set_music was accepted: dial back to the music host and port */
+    SIM_MUSIC_STOP,  /**< set_music was accepted: close the music connection */
+    SIM_IGNORED      /**< Not a request (e.g. malformed JSON): real bulbs do not answer */
+};
+
+/**
+ * @struct SimulatedBulb
+ * @brief The state of a simulated Yeelight bulb and the protocol logic that drives it.
+ *
+ * The struct is plain data of fixed size, so fleets can keep thousands of bulbs in one array. The networking
+ * (connections, quota, music dial-back, SSDP transport) is left to the server hosting the bulb: execute()
+ * only turns a request line into its reply and reports what the server has to do next.
+ */
+struct SimulatedBulb
+{
+    uint64_t id;          /**< Device id, reported by SSDP */
+    uint64_t support;     /**< Supported methods, one bit per SimMethod */
+    char model[16];       /**< Model name */
+    char name[32];        /**< Device name, set with set_name */
+    uint32_t rgb;         /**< Main RGB color */
+    uint32_t bg_rgb;      /**< Background RGB color */
+    uint32_t off_at;      /**< Time of the cron power-off in milliseconds, 0 for none */
+    uint16_t ct;          /**< Main color temperature */
+    uint16_t bg_ct;       /**< Background color temperature */
+    uint16_t hue;         /**< Main hue */
+    uint16_t bg_hue;      /**< Background hue */
+    uint8_t power;        /**< Main power */
+    uint8_t bg_power;     /**< Background power */
+    uint8_t bright;       /**< Main brightness */
+    uint8_t bg_bright;    /**< Background brightness */
+    uint8_t sat;          /**< Main saturation */
+    uint8_t bg_sat;       /**< Background saturation */
+    uint8_t color_mode;   /**< Main color mode (1 RGB, 2 CT, 3 HSV) */
+    uint8_t bg_lmode;     /**< Background color mode */
+    uint8_t flowing;      /**< Main color flow running */
+    uint8_t bg_flowing;   /**< Background color flow running */
+    uint8_t delayoff;     /**< Cron power-off delay in minutes */
+    uint8_t music_on;     /**< Music mode active */
+    uint8_t nl_br;        /**< Night light brightness, 0 when the night light is off */
+    uint8_t active_mode;  /**< 1 in night light mode */
+
+    /**
+     * @brief Resets the bulb to its power-on state.
+     * @param model The model name, which also selects the default support list.
+     * @param id The device id.
+     */
+    void reset(const char *model, uint64_t id);
+
+    /**
+     * @brief Executes a request line.
+     * @param line The request, without the line terminator.
+     * @param now The current time in milliseconds, for cron.
+     * @param reply Receives the reply line, with its terminator (empty for SIM_IGNORED).
+     * @param changed Receives the changed properties, one bit per property (see property_name).
+     * @param music_host Receives the host to dial back for SIM_MUSIC_START.
+     * @param music_port Receives the port to dial back for SIM_MUSIC_START.
+     * @return What the server has to do next.
+     */
+    SimOutcome execute(const char *line, uint32_t now, std::string &reply, uint32_t &changed,
+                       std::string &music_host, uint16_t &music_port);
+
+    /**
+     * @brief Powers the bulb off if its cron delay has elapsed.
+     * @param now The current time in milliseconds.
+     * @return The changed properties, 0 if nothing happened.
+     */
+    uint32_t tick(uint32_t now);
+
+    /**
+     * @brief Returns a property in the string form used by get_prop.
+     * @param property The property index (see property_name).
+     * @return The value.
+     */
+    std::string property(uint8_t property) const;
+
+    /**
+     * @brief Formats a `props` notification.
+     * @param changed The properties to include, one bit per property.
+     * @return The notification line, with its terminator.
+     */
+    std::string notification(uint32_t changed) const;
+
+    /**
+     * @brief Formats the SSDP response advertising the bulb.
+     * @param address The IP address the bulb listens on.
+     * @param port The TCP port the bulb listens on.
+     * @return The response datagram.
+     */
+    std::string ssdp_response(const char *address, uint16_t port) const;
+
+    /**
+     * @brief Returns the support list in the SSDP format (method names separated by spaces).
+     * @return The support list.
+     */
+    std::string support_list() const;
+
+    /**
+     * @brief Parses a support list.
+     * @param methods Method names separated by spaces.
+     * @return The support mask, one bit per SimMethod.
+     */
+    static uint64_t parse_support(const char *methods);
+
+    /**
+     * @brief Returns the support list of a model, as reported by the real devices.
+     * @param model The model name.
+     * @return The support list.
+     */
+    static const char *default_support(const char *model);
+
+    /**
+     * @brief Returns the protocol name of a property, in the order used by `get_prop` in refreshProperties.
+     * @param property The property index.
+     * @return The name, or nullptr past the last property.
+     */
+    static const char *property_name(uint8_t property);
+
+    /**
+     * @brief Returns the number of properties.
+     * @return The number of properties.
+     */
+    static uint8_t property_count();
+};
+
+#endif
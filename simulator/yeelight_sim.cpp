@@ -0,0 +1,115 @@
+/**
+ * @file yeelight_sim.cpp
+ * @brief Runs a simulated Yeelight bulb, or a fleet of them, until interrupted.
+ *
+ * Usage: yeelight-sim [--model M] [--port P] [--address A] [--support "m1 m2 ..."] [--quota N] [--total-quota N]
+ *                     [--connections N] [--no-ssdp] [--count N [--distinct-ports] [--ssdp-window MS]]
+ *
+ * With --count, the bulbs get consecutive addresses from 127.1.0.1 (or consecutive ports with
+ * --distinct-ports) and are served by one FleetSimulator.
+ */
+
+#include "BulbSimulator.h"
+#include "FleetSimulator.h"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+static volatile sig_atomic_t running = 1;
+
+static void on_signal(int) {
+    running = 0;
+}
+
+int main(const int argc, char **argv) {
+    const char *model = "color";
+    const char *address = nullptr;
+    const char *support = nullptr;
+    long port = 55443;
+    long quota = 60;
+    long total_quota = 144;
+    long connections = 4;
+    bool ssdp = true;
+    long count = 0;
+    bool distinct_ports = false;
+    long ssdp_window = 1000;
+    for (int i = 1; i < argc; i++) {
+        const bool value = i + 1 < argc;
+        if (strcmp(argv[i], "--model") == 0 && value) {
+            model = argv[++i];
+        } else if (strcmp(argv[i], "--port") == 0 && value) {
+            port = strtol(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--address") == 0 && value) {
+            address = argv[++i];
+        } else if (strcmp(argv[i], "--support") == 0 && value) {
+            support = argv[++i];
+        } else if (strcmp(argv[i], "--quota") == 0 && value) {
+            quota = strtol(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--total-quota") == 0 && value) {
+            total_quota = strtol(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--connections") == 0 && value) {
+            connections = strtol(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--no-ssdp") == 0) {
+            ssdp = false;
+        } else if (strcmp(argv[i], "--count") == 0 && value) {
+            count = strtol(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--distinct-ports") == 0) {
+            distinct_ports = true;
+        } else if (strcmp(argv[i], "--ssdp-window") == 0 && value) {
+            ssdp_window = strtol(argv[++i], nullptr, 10);
+        } else {
+            fprintf(stderr, "usage: %s [--model M] [--port P] [--address A] [--support \"m1 m2 ...\"] [--quota N] "
+                    "[--total-quota N] [--connections N] [--no-ssdp] [--count N [--distinct-ports] [--ssdp-window MS]]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    if (count > 0) {
+        FleetSimulator fleet(static_cast<size_t>(count), model, distinct_ports ? SIM_DISTINCT_PORTS : SIM_DISTINCT_ADDRESSES,
+                             address != nullptr ? address : distinct_ports ? "127.0.0.1" : "127.1.0.1",
+                             static_cast<uint16_t>(port));
+        fleet.set_quota(static_cast<uint16_t>(quota), static_cast<uint16_t>(total_quota));
+        fleet.set_max_connections(static_cast<uint8_t>(connections));
+        fleet.set_ssdp(ssdp);
+        fleet.set_ssdp_window(static_cast<uint32_t>(ssdp_window));
+        if (!fleet.start()) {
+            fprintf(stderr, "cannot listen for %ld bulbs\n", count);
+            return 1;
+        }
+        printf("%ld %s bulbs listening from %s:%u to %s:%u\n", count, model, fleet.get_address(0).c_str(),
+               fleet.get_port(0), fleet.get_address(fleet.size() - 1).c_str(), fleet.get_port(fleet.size() - 1));
+        while (running) {
+            pause();
+        }
+        printf("%llu commands, %llu over quota, %llu notifications, %llu SSDP answers\n",
+               static_cast<unsigned long long>(fleet.get_command_count()),
+               static_cast<unsigned long long>(fleet.get_rejected_count()),
+               static_cast<unsigned long long>(fleet.get_notification_count()),
+               static_cast<unsigned long long>(fleet.get_ssdp_count()));
+        return 0;
+    }
+    BulbSimulator bulb(model, static_cast<uint16_t>(port), address != nullptr ? address : "127.0.0.1");
+    if (support != nullptr) {
+        bulb.set_support(support);
+    }
+    bulb.set_quota(static_cast<uint16_t>(quota), static_cast<uint16_t>(total_quota));
+    bulb.set_max_connections(static_cast<uint8_t>(connections));
+    bulb.set_ssdp(ssdp);
+    if (!bulb.start()) {
+        fprintf(stderr, "cannot listen on %s:%ld\n", address != nullptr ? address : "127.0.0.1", port);
+        return 1;
+    }
+    printf("%s bulb listening on %s:%u\n", model, address != nullptr ? address : "127.0.0.1", bulb.get_port());
+    while (running) {
+        pause();
+    }
+    printf("%u commands, %u over quota, %u notifications\n", bulb.get_command_count(), bulb.get_rejected_count(),
+           bulb.get_notification_count());
+    bulb.stop();
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include "BrightnessCurve.h"
+#include "ConstexprMath.h"
+
+static constexpr uint8_t LEVELS = 101;
+static constexpr uint8_t CURVES = 2;
+
+struct curve_tables
+{
+    uint8_t forward[CURVES][LEVELS];
+    uint8_t inverse[CURVES][LEVELS];
+};
+
+// Relative luminance (0-1) of a perceived level (0-100) on a non-linear curve.
+static constexpr double luminance(const BrightnessCurveType curve, const uint8_t level) {
+    const double value = level / 100.0;
+    if (curve == CURVE_GAMMA) {
+        return constexpr_pow(value, BrightnessCurve::GAMMA);
+    }
+    // CIE 1976: L* = 116 * Y^(1/3) - 16 above the linear segment, L* = 903.3 * Y below it
+    if (level > 8) {
+        const double root = (level + 16.0) / 116.0;
+        return root * root * root;
+    }
+    return level / 903.3;
+}
+
+static constexpr curve_tables build_tables() {
+    curve_tables tables{};
+    for (uint8_t c = 0; c < CURVES; c++) {
+        const auto curve = static_cast<BrightnessCurveType>(CURVE_GAMMA + c);
+        for (uint8_t level = 0; level < LEVELS; level++) {
+            const auto bright = static_cast<uint8_t>(luminance(curve, level) * 100.0 + 0.5);
+            tables.forward[c][level] = level > 0 && bright == 0 ? 1 : bright;
+        }
+        // The inverse takes the highest matching level so that relative adjustments can leave a flat step.
+        uint8_t level = 0;
+        for (uint8_t bright = 0; bright < LEVELS; bright++) {
+            while (level + 1 < LEVELS && tables.forward[c][level + 1] <= bright) {
+                level++;
+            }
+            tables.inverse[c][bright] = level;
+        }
+    }
+    return tables;
+}
+
+static constexpr curve_tables tables = build_tables();
+
+static_assert(tables.forward[0][100] == 100 && tables.forward[1][100] == 100, "curves must end at full brightness");
+static_assert(tables.forward[0][1] == 1 && tables.forward[1][1] == 1, "curves must keep the lowest level on");
+
+uint8_t BrightnessCurve::to_device(const BrightnessCurveType curve, const uint8_t level) {
+    const uint8_t clamped = level > 100 ? 100 : level;
+    if (curve == CURVE_LINEAR) {
+        return clamped;
+    }
+    return tables.forward[curve - CURVE_GAMMA][clamped];
+}
+
+uint8_t BrightnessCurve::from_device(const BrightnessCurveType curve, const uint8_t bright) {
+    const uint8_t clamped = bright > 100 ? 100 : bright;
+    if (curve == CURVE_LINEAR) {
+        return clamped;
+    }
+    return tables.inverse[curve - CURVE_GAMMA][clamped];
+}
@@ -0,0 +1,40 @@
+#ifndef YEELIGHTARDUINO_BRIGHTNESSCURVE_H
+#define YEELIGHTARDUINO_BRIGHTNESSCURVE_H
+
+#include <cstdint>
+#include "Yeelight_enums.h"
+
+/**
+ * @class BrightnessCurve
+ * @brief Maps perceived brightness levels to device brightness with tables computed at compile time.
+ *
+ * The device brightness is linear in light output, while the eye is not: the steps between low
+ * percentages look much larger than the steps between high ones. A curve spreads the levels 1-100 evenly
+ * in perceived lightness. The forward and inverse tables of every curve are generated by the compiler
+ * and live in flash, so a mapping is a single table lookup.
+ */
+class BrightnessCurve {
+public:
+    /**
+     * @brief The gamma exponent of CURVE_GAMMA.
+     */
+    static constexpr double GAMMA = 2.2;
+
+    /**
+     * @brief Converts a perceived brightness level to the device brightness.
+     * @param curve The brightness curve.
+     * @param level The perceived level (0-100, clamped). Any level above 0 maps to at least 1.
+     * @return The device brightness (0-100).
+     */
+    static uint8_t to_device(BrightnessCurveType curve, uint8_t level);
+
+    /**
+     * @brief Converts a device brightness back to a perceived brightness level.
+     * @param curve The brightness curve.
+     * @param bright The device brightness (0-100, clamped).
+     * @return The highest level whose device brightness does not exceed `bright`.
+     */
+    static uint8_t from_device(BrightnessCurveType curve, uint8_t bright);
+};
+
+#endif
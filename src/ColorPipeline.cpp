@@ -0,0 +1,194 @@
+#include "ColorPipeline.h"
+#include <cstring>
+
+// Branch-free approximations of log2 and exp2 (polynomials fitted on one octave, error below 0.02%), so
+// that the gamma step does not stop the compiler from vectorizing the pipeline loop. The clamps are done on
+// integers, which GCC vectorizes where the equivalent float comparisons would leave a branch in the loop.
+
+// Returns log2 of the value clamped to [2^-20, 1]. Non-negative floats are ordered like their bit patterns
+// and negative ones sort below them, so the clamp works directly on the bits.
+static inline float unit_log2(const float value) {
+    int32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bits = bits < 0x35800000 ? 0x35800000 : bits;
+    bits = bits > 0x3F800000 ? 0x3F800000 : bits;
+    const auto exponent = static_cast<float>((bits >> 23) - 127);
+    bits = (bits & 0x007FFFFF) | 0x3F800000;
+    float mantissa;
+    memcpy(&mantissa, &bits, sizeof(mantissa));
+    const float t = mantissa - 1.0f;
+    return exponent + 0.00020372f + t * (1.43610242f + t * (-0.66952725f + t * (0.31222615f + t * -0.07915383f)));
+}
+
+// Returns 2^x for x in [-126, 0], the range produced by a gamma exponent in [MIN_GAMMA, MAX_GAMMA].
+static inline float fast_exp2(const float x) {
+    auto whole = static_cast<int32_t>(x);
+    whole -= x < static_cast<float>(whole);
+    const float t = x - static_cast<float>(whole);
+    const float fraction = 1.00000727f + t * (0.69293141f + t * (0.24170999f + t * (0.05166703f + t * 0.01367656f)));
+    const uint32_t bits = static_cast<uint32_t>(whole + 127) << 23;
+    float scale;
+    memcpy(&scale, &bits, sizeof(scale));
+    return fraction * scale;
+}
+
+// Returns the linear value raised to the gamma exponent. The log2 clamp would turn black into (2^-20)^gamma,
+// several steps above black for small exponents, so values <= 0 are masked to exactly 0 on the integer bits.
+static inline float apply_gamma(const float linear, const float exponent) {
+    int32_t bits;
+    memcpy(&bits, &linear, sizeof(bits));
+    const float encoded = fast_exp2(exponent * unit_log2(linear));
+    int32_t result;
+    memcpy(&result, &encoded, sizeof(result));
+    result &= -static_cast<int32_t>(bits > 0);
+    float masked;
+    memcpy(&masked, &result, sizeof(masked));
+    return masked;
+}
+
+static inline uint32_t to_channel(const float value) {
+    const auto scaled = static_cast<int32_t>(value * 255.0f + 0.5f);
+    return static_cast<uint32_t>(scaled > 255 ? 255 : scaled);
+}
+
+ColorPipeline::ColorPipeline(const size_t capacity) {
+    for (std::vector<float> &channel: target) {
+        channel.reserve(capacity);
+    }
+    for (std::vector<float> &coefficient: matrix) {
+        coefficient.reserve(capacity);
+    }
+    for (std::vector<float> &channel: offset) {
+        channel.reserve(capacity);
+    }
+    gamma.reserve(capacity);
+    output.reserve(capacity);
+    sent.reserve(capacity);
+    bulbs.reserve(capacity);
+    light_types.reserve(capacity);
+}
+
+size_t ColorPipeline::add(Yeelight *bulb, const LightType lightType, const ColorCalibration &calibration) {
+    for (std::vector<float> &channel: target) {
+        channel.push_back(0);
+    }
+    for (std::vector<float> &coefficient: matrix) {
+        coefficient.push_back(0);
+    }
+    for (std::vector<float> &channel: offset) {
+        channel.push_back(0);
+    }
+    gamma.push_back(1);
+    output.push_back(0);
+    sent.push_back(0xFFFFFFFF);
+    bulbs.push_back(bulb);
+    light_types.push_back(static_cast<uint8_t>(lightType));
+    const size_t index = bulbs.size() - 1;
+    set_calibration(index, calibration);
+    return index;
+}
+
+size_t ColorPipeline::size() const {
+    return bulbs.size();
+}
+
+void ColorPipeline::clear() {
+    for (std::vector<float> &channel: target) {
+        channel.clear();
+    }
+    for (std::vector<float> &coefficient: matrix) {
+        coefficient.clear();
+    }
+    for (std::vector<float> &channel: offset) {
+        channel.clear();
+    }
+    gamma.clear();
+    output.clear();
+    sent.clear();
+    bulbs.clear();
+    light_types.clear();
+}
+
+void ColorPipeline::set_calibration(const size_t index, const ColorCalibration &calibration) {
+    if (index >= size()) {
+        return;
+    }
+    for (uint8_t i = 0; i < 9; i++) {
+        matrix[i][index] = calibration.matrix[i];
+    }
+    for (uint8_t i = 0; i < 3; i++) {
+        offset[i][index] = calibration.offset[i];
+    }
+    const float value = calibration.gamma;
+    gamma[index] = value < MIN_GAMMA ? MIN_GAMMA : value > MAX_GAMMA ? MAX_GAMMA : value;
+}
+
+void ColorPipeline::set_target(const size_t index, const uint32_t rgb) {
+    if (index >= size()) {
+        return;
+    }
+    target[0][index] = static_cast<float>(rgb >> 16 & 0xFF) / 255.0f;
+    target[1][index] = static_cast<float>(rgb >> 8 & 0xFF) / 255.0f;
+    target[2][index] = static_cast<float>(rgb & 0xFF) / 255.0f;
+}
+
+void ColorPipeline::set_target(const size_t index, const uint8_t r, const uint8_t g, const uint8_t b) {
+    set_target(index, static_cast<uint32_t>(r) << 16 | static_cast<uint32_t>(g) << 8 | b);
+}
+
+void ColorPipeline::set_all(const uint32_t rgb) {
+    for (size_t i = 0; i < size(); i++) {
+        set_target(i, rgb);
+    }
+}
+
+void ColorPipeline::process() {
+    const size_t count = size();
+    const float *__restrict r = target[0].data();
+    const float *__restrict g = target[1].data();
+    const float *__restrict b = target[2].data();
+    const float *__restrict m0 = matrix[0].data();
+    const float *__restrict m1 = matrix[1].data();
+    const float *__restrict m2 = matrix[2].data();
+    const float *__restrict m3 = matrix[3].data();
+    const float *__restrict m4 = matrix[4].data();
+    const float *__restrict m5 = matrix[5].data();
+    const float *__restrict m6 = matrix[6].data();
+    const float *__restrict m7 = matrix[7].data();
+    const float *__restrict m8 = matrix[8].data();
+    const float *__restrict o0 = offset[0].data();
+    const float *__restrict o1 = offset[1].data();
+    const float *__restrict o2 = offset[2].data();
+    const float *__restrict exponent = gamma.data();
+    uint32_t *__restrict out = output.data();
+    for (size_t i = 0; i < count; i++) {
+        const float red = apply_gamma(m0[i] * r[i] + m1[i] * g[i] + m2[i] * b[i] + o0[i], exponent[i]);
+        const float green = apply_gamma(m3[i] * r[i] + m4[i] * g[i] + m5[i] * b[i] + o1[i], exponent[i]);
+        const float blue = apply_gamma(m6[i] * r[i] + m7[i] * g[i] + m8[i] * b[i] + o2[i], exponent[i]);
+        out[i] = to_channel(red) << 16 | to_channel(green) << 8 | to_channel(blue);
+    }
+}
+
+uint32_t ColorPipeline::get_output(const size_t index) const {
+    return index < size() ? output[index] : 0;
+}
+
+const uint32_t *ColorPipeline::get_outputs() const {
+    return output.data();
+}
+
+size_t ColorPipeline::apply(const effect effect, const uint16_t duration) {
+    size_t sent_count = 0;
+    for (size_t i = 0; i < size(); i++) {
+        if (bulbs[i] == nullptr || sent[i] == output[i]) {
+            continue;
+        }
+        const uint32_t rgb = output[i];
+        if (bulbs[i]->set_rgb_color(rgb >> 16 & 0xFF, rgb >> 8 & 0xFF, rgb & 0xFF, effect, duration,
+                                    static_cast<LightType>(light_types[i])) == SUCCESS) {
+            sent[i] = rgb;
+            sent_count++;
+        }
+    }
+    return sent_count;
+}
@@ -0,0 +1,121 @@
+#ifndef YEELIGHTARDUINO_COLORPIPELINE_H
+#define YEELIGHTARDUINO_COLORPIPELINE_H
+
+#include <Yeelight.h>
+
+/**
+ * @class ColorPipeline
+ * @brief Calibrates the target colors of many devices in one batched pass.
+ *
+ * Targets, calibration matrices, white-balance offsets and gamma exponents are stored as structure of
+ * arrays, one array per component, so process() runs the same branch-free arithmetic over contiguous
+ * memory. The loops are written to be auto-vectorized (SSE/AVX/NEON) by GCC and Clang on a Linux
+ * controller; on the ESP32 the same code compiles to a plain scalar loop. The calibrated colors can be
+ * read back for streaming, or sent with `set_rgb` by apply().
+ */
+class ColorPipeline {
+public:
+    /**
+     * @brief The smallest supported gamma exponent.
+     */
+    static constexpr float MIN_GAMMA = 0.1f;
+
+    /**
+     * @brief The largest supported gamma exponent.
+     */
+    static constexpr float MAX_GAMMA = 6.0f;
+
+    /**
+     * @brief Constructs an empty pipeline.
+     * @param capacity The number of devices to reserve memory for.
+     */
+    explicit ColorPipeline(size_t capacity = 0);
+
+    /**
+     * @brief Adds a device to the pipeline.
+     * @param bulb The device the calibrated color is sent to by apply(), or nullptr for output only.
+     * @param lightType The light channel to drive.
+     * @param calibration The calibration of the device.
+     * @return The index of the device in the pipeline.
+     */
+    size_t add(Yeelight *bulb = nullptr, LightType lightType = AUTO,
+               const ColorCalibration &calibration = ColorCalibration());
+
+    /**
+     * @brief Returns the number of devices in the pipeline.
+     * @return The number of devices.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Removes all devices from the pipeline.
+     */
+    void clear();
+
+    /**
+     * @brief Replaces the calibration of a device. The gamma exponent is clamped to [MIN_GAMMA, MAX_GAMMA].
+     * @param index The index of the device.
+     * @param calibration The new calibration.
+     */
+    void set_calibration(size_t index, const ColorCalibration &calibration);
+
+    /**
+     * @brief Sets the target color of a device.
+     * @param index The index of the device.
+     * @param rgb The target color as 0xRRGGBB.
+     */
+    void set_target(size_t index, uint32_t rgb);
+
+    /**
+     * @brief Sets the target color of a device.
+     * @param index The index of the device.
+     * @param r The red component.
+     * @param g The green component.
+     * @param b The blue component.
+     */
+    void set_target(size_t index, uint8_t r, uint8_t g, uint8_t b);
+
+    /**
+     * @brief Sets the same target color on every device.
+     * @param rgb The target color as 0xRRGGBB.
+     */
+    void set_all(uint32_t rgb);
+
+    /**
+     * @brief Calibrates every target color.
+     */
+    void process();
+
+    /**
+     * @brief Returns the calibrated color of a device from the last process().
+     * @param index The index of the device.
+     * @return The calibrated color as 0xRRGGBB.
+     */
+    uint32_t get_output(size_t index) const;
+
+    /**
+     * @brief Returns the calibrated colors of all devices from the last process().
+     * @return A pointer to size() colors as 0xRRGGBB.
+     */
+    const uint32_t *get_outputs() const;
+
+    /**
+     * @brief Sends the calibrated colors that changed since the last apply() to their devices.
+     * @param effect The transition effect.
+     * @param duration The transition duration in milliseconds.
+     * @return The number of devices a command was sent to.
+     */
+    size_t apply(effect effect = EFFECT_SUDDEN, uint16_t duration = 30);
+
+private:
+    std::vector<float> target[3];
+    std::vector<float> matrix[9];
+    std::vector<float> offset[3];
+    std::vector<float> gamma;
+    std::vector<uint32_t> output;
+    std::vector<uint32_t> sent;
+    std::vector<Yeelight *> bulbs;
+    std::vector<uint8_t> light_types;
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include "ColorTemperature.h"
+#include "ConstexprMath.h"
+
+static constexpr uint16_t TABLE_SIZE = ColorTemperature::MAX_KELVIN - ColorTemperature::MIN_KELVIN + 1;
+
+static constexpr double srgb_encode(const double linear) {
+    if (linear <= 0.0) {
+        return 0.0;
+    }
+    if (linear <= 0.0031308) {
+        return 12.92 * linear;
+    }
+    return 1.055 * constexpr_pow(linear, 1.0 / 2.4) - 0.055;
+}
+
+static constexpr uint8_t to_byte(const double value) {
+    const double scaled = value * 255.0 + 0.5;
+    return static_cast<uint8_t>(scaled > 255.0 ? 255.0 : scaled < 0.0 ? 0.0 : scaled);
+}
+
+struct ct_table
+{
+    uint8_t rgb[TABLE_SIZE][3];
+};
+
+static constexpr ct_table build_table() {
+    ct_table table{};
+    for (uint16_t i = 0; i < TABLE_SIZE; i++) {
+        const double t = ColorTemperature::MIN_KELVIN + i;
+        const double t2 = t * t;
+        const double t3 = t2 * t;
+        const double x = t <= 4000.0
+                             ? -0.2661239e9 / t3 - 0.2343589e6 / t2 + 0.8776956e3 / t + 0.179910
+                             : -3.0258469e9 / t3 + 2.1070379e6 / t2 + 0.2226347e3 / t + 0.240390;
+        const double x2 = x * x;
+        const double x3 = x2 * x;
+        const double y = t <= 2222.0
+                             ? -1.1063814 * x3 - 1.34811020 * x2 + 2.18555832 * x - 0.20219683
+                             : t <= 4000.0
+                             ? -0.9549476 * x3 - 1.37418593 * x2 + 2.09137015 * x - 0.16748867
+                             : 3.0817580 * x3 - 5.87338670 * x2 + 3.75112997 * x - 0.37001483;
+        const double X = x / y;
+        const double Z = (1.0 - x - y) / y;
+        double linear[3] = {
+            3.2406 * X - 1.5372 - 0.4986 * Z,
+            -0.9689 * X + 1.8758 + 0.0415 * Z,
+            0.0557 * X - 0.2040 + 1.0570 * Z
+        };
+        double peak = 0.0;
+        for (double &channel: linear) {
+            channel = channel < 0.0 ? 0.0 : channel;
+            peak = channel > peak ? channel : peak;
+        }
+        for (uint8_t c = 0; c < 3; c++) {
+            table.rgb[i][c] = to_byte(srgb_encode(linear[c] / peak));
+        }
+    }
+    return table;
+}
+
+static constexpr ct_table table = build_table();
+
+uint32_t ColorTemperature::to_rgb(const uint16_t kelvin) {
+    const uint16_t clamped = kelvin < MIN_KELVIN ? MIN_KELVIN : kelvin > MAX_KELVIN ? MAX_KELVIN : kelvin;
+    const uint8_t *rgb = table.rgb[clamped - MIN_KELVIN];
+    return static_cast<uint32_t>(rgb[0]) << 16 | static_cast<uint32_t>(rgb[1]) << 8 | rgb[2];
+}
+
+uint16_t ColorTemperature::from_rgb(const uint32_t rgb) {
+    const int32_t channels[3] = {static_cast<int32_t>(rgb >> 16 & 0xFF), static_cast<int32_t>(rgb >> 8 & 0xFF),
+                                 static_cast<int32_t>(rgb & 0xFF)};
+    int32_t peak = channels[0] > channels[1] ? channels[0] : channels[1];
+    peak = channels[2] > peak ? channels[2] : peak;
+    if (peak == 0) {
+        return MIN_KELVIN;
+    }
+    int32_t normalized[3];
+    for (uint8_t c = 0; c < 3; c++) {
+        normalized[c] = (channels[c] * 255 + peak / 2) / peak;
+    }
+    // Green and blue both rise with the temperature while red stays at 255, so their sum orders the table.
+    const int32_t key = normalized[1] + normalized[2];
+    uint16_t low = 0;
+    uint16_t high = TABLE_SIZE;
+    while (low < high) {
+        const uint16_t middle = (low + high) / 2;
+        if (table.rgb[middle][1] + table.rgb[middle][2] < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    // Pick the closest entry among the neighbours sharing the key.
+    const uint16_t start = low < TABLE_SIZE ? low : TABLE_SIZE - 1;
+    uint16_t best = start;
+    int32_t best_distance = INT32_MAX;
+    for (uint16_t i = start > 0 ? start - 1 : 0; i < TABLE_SIZE; i++) {
+        const int32_t entry_key = table.rgb[i][1] + table.rgb[i][2];
+        if (i > start && entry_key != key) {
+            break;
+        }
+        int32_t distance = 0;
+        for (uint8_t c = 0; c < 3; c++) {
+            const int32_t difference = table.rgb[i][c] - normalized[c];
+            distance += difference * difference;
+        }
+        if (distance < best_distance) {
+            best_distance = distance;
+            best = i;
+        }
+    }
+    return MIN_KELVIN + best;
+}
+
+flow_expression ColorTemperature::to_rgb_step(const flow_expression &step) {
+    if (step.mode != FLOW_COLOR_TEMPERATURE) {
+        return step;
+    }
+    return {step.duration, FLOW_COLOR, to_rgb(static_cast<uint16_t>(step.value)), step.brightness};
+}
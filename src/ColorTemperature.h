@@ -0,0 +1,55 @@
+#ifndef YEELIGHTARDUINO_COLORTEMPERATURE_H
+#define YEELIGHTARDUINO_COLORTEMPERATURE_H
+
+#include <cstdint>
+#include "Yeelight_enums.h"
+#include "Yeelight_structs.h"
+
+/**
+ * @class ColorTemperature
+ * @brief Converts between color temperatures and RGB colors with a table computed at compile time.
+ *
+ * The table holds the sRGB color of the Planckian locus for every Kelvin from MIN_KELVIN to MAX_KELVIN
+ * (Kim et al. cubic approximation of the locus, converted through CIE XYZ, normalized to full brightness
+ * and gamma-encoded). It is generated by the compiler and lives in flash, so a conversion is a single
+ * table lookup. It is used to emulate color temperatures on channels that only support RGB.
+ */
+class ColorTemperature {
+public:
+    /**
+     * @brief The lowest color temperature in the table.
+     */
+    static constexpr uint16_t MIN_KELVIN = 1700;
+
+    /**
+     * @brief The highest color temperature in the table.
+     */
+    static constexpr uint16_t MAX_KELVIN = 6500;
+
+    /**
+     * @brief Returns the RGB color of a color temperature.
+     * @param kelvin The color temperature, clamped to [MIN_KELVIN, MAX_KELVIN].
+     * @return The color as 0xRRGGBB, with its brightest channel at 255.
+     */
+    static uint32_t to_rgb(uint16_t kelvin);
+
+    /**
+     * @brief Returns the color temperature whose color is closest to an RGB color.
+     *
+     * The color is normalized to full brightness first, so only its chromaticity matters. Colors from to_rgb
+     * come back within a few tens of Kelvin, as their channels are rounded to 8 bits.
+     *
+     * @param rgb The color as 0xRRGGBB.
+     * @return The closest color temperature in Kelvin.
+     */
+    static uint16_t from_rgb(uint32_t rgb);
+
+    /**
+     * @brief Converts a color temperature flow step into the equivalent RGB step.
+     * @param step The flow step.
+     * @return The RGB step, or the unchanged step if it is not a color temperature step.
+     */
+    static flow_expression to_rgb_step(const flow_expression &step);
+};
+
+#endif
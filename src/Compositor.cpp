@@ -0,0 +1,225 @@
+#include "Compositor.h"
+#include "ColorTemperature.h"
+
+static bool same_state(const LightState &a, const LightState &b) {
+    if (a.power != b.power) {
+        return false;
+    }
+    if (!a.power) {
+        return true;
+    }
+    return a.bright == b.bright && same_color(a, b);
+}
+
+Compositor::Compositor(Yeelight *bulb, const LightType lightType) : bulb(bulb), lightType(lightType) {
+}
+
+Compositor::Compositor(const OutputCallback callback, void *arg) : callback(callback), callback_arg(arg) {
+}
+
+int8_t Compositor::add_layer(const LayerPriority priority, const LightState &state, const BlendMode blend,
+                             const uint32_t lifetime) {
+    for (uint8_t i = 0; i < MAX_LAYERS; i++) {
+        if (!layers[i].active) {
+            layers[i].active = true;
+            layers[i].priority = priority;
+            layers[i].blend = blend;
+            layers[i].sequence = next_sequence++;
+            layers[i].added_at = millis();
+            layers[i].lifetime = lifetime;
+            layers[i].state = state;
+            dirty = true;
+            return static_cast<int8_t>(i);
+        }
+    }
+    return -1;
+}
+
+bool Compositor::update_layer(const int8_t handle, const LightState &state) {
+    if (!has_layer(handle)) {
+        return false;
+    }
+    if (!same_state(layers[handle].state, state)) {
+        layers[handle].state = state;
+        dirty = true;
+    }
+    return true;
+}
+
+bool Compositor::remove_layer(const int8_t handle) {
+    if (!has_layer(handle)) {
+        return false;
+    }
+    layers[handle].active = false;
+    dirty = true;
+    return true;
+}
+
+bool Compositor::has_layer(const int8_t handle) const {
+    return handle >= 0 && handle < MAX_LAYERS && layers[handle].active;
+}
+
+void Compositor::clear() {
+    for (Layer &layer: layers) {
+        layer.active = false;
+    }
+    dirty = true;
+}
+
+bool Compositor::loop() {
+    const auto now = millis();
+    for (Layer &layer: layers) {
+        if (layer.active && layer.lifetime != 0 && now - layer.added_at >= layer.lifetime) {
+            layer.active = false;
+            dirty = true;
+        }
+    }
+    if (!dirty) {
+        return false;
+    }
+    dirty = false;
+    const LightState state = compose();
+    if (has_output && same_state(state, output)) {
+        return false;
+    }
+    emit(state);
+    return true;
+}
+
+void Compositor::set_transition(const effect effect, const uint16_t duration) {
+    transition_effect = effect;
+    transition_duration = duration < 30 ? 30 : duration;
+}
+
+LightState Compositor::get_output() const {
+    return output;
+}
+
+uint32_t Compositor::to_rgb(const LightState &state) {
+    if (state.color_mode == COLOR_MODE_COLOR_TEMPERATURE) {
+        return ColorTemperature::to_rgb(state.ct);
+    }
+    if (state.color_mode != COLOR_MODE_HSV) {
+        return state.rgb & 0xFFFFFF;
+    }
+    const uint32_t sector = state.hue % 360 / 60;
+    const uint32_t offset = state.hue % 60;
+    const uint32_t sat = state.sat > 100 ? 100 : state.sat;
+    const uint32_t low = 255 * (100 - sat) / 100;
+    const uint32_t rising = low + (255 - low) * offset / 60;
+    const uint32_t falling = 255 - (255 - low) * offset / 60;
+    uint32_t r, g, b;
+    switch (sector) {
+        case 0: r = 255, g = rising, b = low;
+            break;
+        case 1: r = falling, g = 255, b = low;
+            break;
+        case 2: r = low, g = 255, b = rising;
+            break;
+        case 3: r = low, g = falling, b = 255;
+            break;
+        case 4: r = rising, g = low, b = 255;
+            break;
+        default: r = 255, g = low, b = falling;
+            break;
+    }
+    return r << 16 | g << 8 | b;
+}
+
+LightState Compositor::compose() const {
+    uint8_t order[MAX_LAYERS];
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < MAX_LAYERS; i++) {
+        if (!layers[i].active) {
+            continue;
+        }
+        uint8_t pos = count++;
+        while (pos > 0) {
+            const Layer &above = layers[order[pos - 1]];
+            if (above.priority < layers[i].priority ||
+                (above.priority == layers[i].priority && above.sequence < layers[i].sequence)) {
+                break;
+            }
+            order[pos] = order[pos - 1];
+            pos--;
+        }
+        order[pos] = i;
+    }
+    LightState result{};
+    for (uint8_t i = 0; i < count; i++) {
+        const Layer &layer = layers[order[i]];
+        if (layer.blend == BLEND_REPLACE) {
+            result = layer.state;
+        } else if (layer.blend == BLEND_MULTIPLY_BRIGHTNESS) {
+            if (result.power) {
+                const uint32_t scaled = static_cast<uint32_t>(result.bright) * layer.state.bright / 100;
+                result.bright = static_cast<uint8_t>(scaled < 1 ? 1 : scaled);
+            }
+        } else if (layer.state.power) {
+            if (!result.power) {
+                result = layer.state;
+                continue;
+            }
+            const uint32_t below = to_rgb(result);
+            const uint32_t added = to_rgb(layer.state);
+            uint32_t channels[3];
+            uint32_t peak = 0;
+            for (uint8_t c = 0; c < 3; c++) {
+                const uint8_t shift = 16 - 8 * c;
+                const uint32_t sum = (below >> shift & 0xFF) * result.bright + (added >> shift & 0xFF) * layer.state.
+                                     bright;
+                channels[c] = sum > 25500 ? 25500 : sum;
+                if (channels[c] > peak) {
+                    peak = channels[c];
+                }
+            }
+            if (peak == 0) {
+                continue;
+            }
+            result.color_mode = COLOR_MODE_RGB;
+            result.rgb = (channels[0] * 255 / peak) << 16 | (channels[1] * 255 / peak) << 8 | channels[2] * 255 / peak;
+            result.bright = static_cast<uint8_t>((peak + 254) / 255);
+        }
+    }
+    return result;
+}
+
+void Compositor::emit(const LightState &state) {
+    if (callback) {
+        callback(callback_arg, state);
+    } else if (bulb) {
+        apply(state);
+    }
+    output = state;
+    has_output = true;
+}
+
+void Compositor::apply(const LightState &state) {
+    if (!state.power) {
+        bulb->set_power(false, transition_effect, transition_duration, lightType);
+        return;
+    }
+    const bool was_on = has_output && output.power;
+    if (was_on && same_color(output, state)) {
+        bulb->set_brightness(state.bright, transition_effect, transition_duration, lightType);
+        return;
+    }
+    if (was_on && output.bright == state.bright) {
+        if (state.color_mode == COLOR_MODE_COLOR_TEMPERATURE) {
+            bulb->set_color_temp(state.ct, transition_effect, transition_duration, lightType);
+        } else if (state.color_mode == COLOR_MODE_HSV) {
+            bulb->set_hsv_color(state.hue, state.sat, transition_effect, transition_duration, lightType);
+        } else {
+            bulb->set_rgb_color(state.rgb >> 16 & 0xFF, state.rgb >> 8 & 0xFF, state.rgb & 0xFF, transition_effect,
+                                transition_duration, lightType);
+        }
+        return;
+    }
+    if (state.color_mode == COLOR_MODE_COLOR_TEMPERATURE) {
+        bulb->set_scene_color_temperature(state.ct, state.bright, lightType);
+    } else if (state.color_mode == COLOR_MODE_HSV) {
+        bulb->set_scene_hsv(state.hue, state.sat, state.bright, lightType);
+    } else {
+        bulb->set_scene_rgb(state.rgb >> 16 & 0xFF, state.rgb >> 8 & 0xFF, state.rgb & 0xFF, state.bright, lightType);
+    }
+}
@@ -0,0 +1,146 @@
+#ifndef YEELIGHTARDUINO_COMPOSITOR_H
+#define YEELIGHTARDUINO_COMPOSITOR_H
+
+#include <Yeelight.h>
+
+/**
+ * @class Compositor
+ * @brief Combines prioritized light layers into the state of a single light channel.
+ *
+ * Layers are stacked by priority (base scene, effects, alerts) and, within the same priority, by the order
+ * in which they were added. Each layer is blended onto the layers below it with its own blend mode and may
+ * expire after a lifetime. The composed state is only recomputed when a layer changes or expires, and it is
+ * only emitted when it differs from the previously emitted state. When a layer goes away, the state of the
+ * layers below it is emitted again, so the light returns to the underlying state without querying the device.
+ */
+class Compositor {
+public:
+    /**
+     * @brief Callback receiving every newly composed state.
+     * @param arg The user argument given to the constructor.
+     * @param state The composed state of the light channel.
+     */
+    typedef void (*OutputCallback)(void *arg, const LightState &state);
+
+    /**
+     * @brief The maximum number of layers that can be active at the same time.
+     */
+    static constexpr uint8_t MAX_LAYERS = 8;
+
+    /**
+     * @brief Constructs a compositor that applies its output directly to a Yeelight device.
+     *
+     * Outputs are sent with the cheapest command for the change: `set_power` for power-only changes,
+     * `set_bright` for brightness-only changes and a single `set_scene` otherwise. When music mode is
+     * enabled on the device, these commands are streamed over the music mode connection.
+     *
+     * @param bulb The device to drive.
+     * @param lightType The light channel to drive (main, background, or auto-detect).
+     */
+    explicit Compositor(Yeelight *bulb, LightType lightType = AUTO);
+
+    /**
+     * @brief Constructs a compositor that hands its output to a callback.
+     * @param callback The function receiving every newly composed state.
+     * @param arg A user argument passed to the callback.
+     */
+    Compositor(OutputCallback callback, void *arg);
+
+    /**
+     * @brief Adds a layer to the stack.
+     * @param priority The priority of the layer.
+     * @param state The state contributed by the layer.
+     * @param blend The way the layer is combined with the layers below it.
+     * @param lifetime The lifetime of the layer in milliseconds (0 for no expiry).
+     * @return A handle for the layer, or -1 if all layer slots are in use.
+     */
+    int8_t add_layer(LayerPriority priority, const LightState &state, BlendMode blend = BLEND_REPLACE,
+                     uint32_t lifetime = 0);
+
+    /**
+     * @brief Replaces the state contributed by a layer.
+     * @param handle The handle returned by add_layer.
+     * @param state The new state of the layer.
+     * @return True if the layer exists, otherwise false.
+     */
+    bool update_layer(int8_t handle, const LightState &state);
+
+    /**
+     * @brief Removes a layer from the stack.
+     * @param handle The handle returned by add_layer.
+     * @return True if the layer existed, otherwise false.
+     */
+    bool remove_layer(int8_t handle);
+
+    /**
+     * @brief Checks whether a layer is still on the stack (it may have expired).
+     * @param handle The handle returned by add_layer.
+     * @return True if the layer is active, otherwise false.
+     */
+    bool has_layer(int8_t handle) const;
+
+    /**
+     * @brief Removes all layers. The last emitted state is kept.
+     */
+    void clear();
+
+    /**
+     * @brief Expires layers and emits the composed state if it changed.
+     *
+     * Must be called regularly (e.g. from the sketch's `loop()`) for lifetimes to take effect.
+     *
+     * @return True if a new state was emitted, otherwise false.
+     */
+    bool loop();
+
+    /**
+     * @brief Sets the transition used when applying outputs to a Yeelight device.
+     * @param effect The transition effect (smooth or sudden).
+     * @param duration The duration of the transition in milliseconds.
+     */
+    void set_transition(effect effect, uint16_t duration);
+
+    /**
+     * @brief Returns the most recently emitted state.
+     * @return The last emitted state (all zero if nothing was emitted yet).
+     */
+    LightState get_output() const;
+
+    /**
+     * @brief Converts the color of a state to a 24-bit RGB value, whatever its color mode.
+     * @param state The state to convert.
+     * @return The RGB color of the state.
+     */
+    static uint32_t to_rgb(const LightState &state);
+
+private:
+    struct Layer {
+        bool active;
+        LayerPriority priority;
+        BlendMode blend;
+        uint32_t sequence;
+        uint32_t added_at;
+        uint32_t lifetime;
+        LightState state;
+    };
+
+    Yeelight *bulb = nullptr;
+    LightType lightType = AUTO;
+    OutputCallback callback = nullptr;
+    void *callback_arg = nullptr;
+    effect transition_effect = EFFECT_SMOOTH;
+    uint16_t transition_duration = 300;
+    Layer layers[MAX_LAYERS]{};
+    uint32_t next_sequence = 0;
+    bool dirty = false;
+    bool has_output = false;
+    LightState output{};
+
+    LightState compose() const;
+
+    void emit(const LightState &state);
+
+    void apply(const LightState &state);
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef YEELIGHTARDUINO_CONSTEXPRMATH_H
+#define YEELIGHTARDUINO_CONSTEXPRMATH_H
+
+#include <cstdint>
+
+/**
+ * @file ConstexprMath.h
+ * @brief Minimal constexpr math used to generate lookup tables at compile time.
+ *
+ * These functions favour simplicity over speed and are not meant to be called at runtime.
+ */
+
+/**
+ * @brief Computes the natural logarithm of a positive value.
+ * @param value The value.
+ * @return ln(value).
+ */
+constexpr double constexpr_log(double value) {
+    int32_t exponent = 0;
+    while (value >= 2.0) {
+        value /= 2.0;
+        exponent++;
+    }
+    while (value < 1.0) {
+        value *= 2.0;
+        exponent--;
+    }
+    // ln(v) = 2 * atanh((v - 1) / (v + 1)), converging quickly for v in [1, 2)
+    const double z = (value - 1.0) / (value + 1.0);
+    const double z2 = z * z;
+    double term = z;
+    double sum = 0.0;
+    for (int32_t n = 1; n < 40; n += 2) {
+        sum += term / n;
+        term *= z2;
+    }
+    return 2.0 * sum + exponent * 0.69314718055994530942;
+}
+
+/**
+ * @brief Computes the exponential of a value of moderate magnitude (|value| < 40).
+ * @param value The value.
+ * @return e^value.
+ */
+constexpr double constexpr_exp(const double value) {
+    // e^v = (e^(v / 64)) ^ 64, with a short Taylor series for the reduced argument
+    const double reduced = value / 64.0;
+    double term = 1.0;
+    double sum = 1.0;
+    for (int32_t n = 1; n < 16; n++) {
+        term *= reduced / n;
+        sum += term;
+    }
+    for (int32_t i = 0; i < 6; i++) {
+        sum *= sum;
+    }
+    return sum;
+}
+
+/**
+ * @brief Raises a non-negative base to a power.
+ * @param base The base.
+ * @param exponent The exponent.
+ * @return base^exponent (0 for a base of 0).
+ */
+constexpr double constexpr_pow(const double base, const double exponent) {
+    return base <= 0.0 ? 0.0 : constexpr_exp(exponent * constexpr_log(base));
+}
+
+#endif
@@ -0,0 +1,196 @@
+#include "FleetLoader.h"
+#include <ModelDatabase.h>
+
+/**
+ * @brief The delay before a failed connection attempt is retried, in milliseconds.
+ */
+static constexpr uint32_t RETRY_DELAY = 250;
+
+FleetLoader::FleetLoader(const uint8_t max_connecting) : max_connecting(max_connecting == 0 ? 1 : max_connecting) {
+}
+
+FleetLoader::~FleetLoader() {
+    for (const fleet_entry &entry: entries) {
+        delete entry.bulb;
+    }
+}
+
+size_t FleetLoader::load(const char *config) {
+    if (config == nullptr) {
+        return 0;
+    }
+    size_t added = 0;
+    while (*config != '\0') {
+        const char *end = strchr(config, '\n');
+        const size_t length = end == nullptr ? strlen(config) : static_cast<size_t>(end - config);
+        fleet_entry entry{nullptr, {}, {}, false, 0};
+        if (parse_line(config, length, entry)) {
+            entry.bulb = new Yeelight();
+            entries.push_back(entry);
+            added++;
+        }
+        config += length;
+        if (*config == '\n') {
+            config++;
+        }
+    }
+    return added;
+}
+
+size_t FleetLoader::begin(const uint32_t timeout) {
+    const uint32_t start = millis();
+    ready_time = 0;
+    resolve();
+    for (fleet_entry &entry: entries) {
+        entry.retry_at = start;
+    }
+    size_t connected = 0;
+    while (true) {
+        const uint32_t now = millis();
+        connected = 0;
+        uint8_t connecting = 0;
+        for (const fleet_entry &entry: entries) {
+            connected += entry.bulb->is_connected();
+            connecting += entry.bulb->is_connecting();
+        }
+        if (connected == entries.size()) {
+            ready_time = now - start;
+            break;
+        }
+        if (now - start >= timeout) {
+            break;
+        }
+        // Open new connections while the budget allows; attempts that failed are retried after a delay.
+        for (fleet_entry &entry: entries) {
+            if (connecting >= max_connecting) {
+                break;
+            }
+            if (entry.bulb->is_connected() || entry.bulb->is_connecting() ||
+                static_cast<int32_t>(now - entry.retry_at) < 0) {
+                continue;
+            }
+            entry.retry_at = now + RETRY_DELAY;
+            if (entry.bulb->connect(entry.device) == SUCCESS) {
+                connecting++;
+            }
+        }
+        delay(10);
+    }
+    return connected;
+}
+
+size_t FleetLoader::size() const {
+    return entries.size();
+}
+
+Yeelight *FleetLoader::get(const size_t index) const {
+    return index < entries.size() ? entries[index].bulb : nullptr;
+}
+
+bool FleetLoader::has_tag(const size_t index, const char *tag) const {
+    if (index >= entries.size() || tag == nullptr || tag[0] == '\0') {
+        return false;
+    }
+    const std::string &tags = entries[index].tags;
+    const size_t length = strlen(tag);
+    for (size_t position = 0; position <= tags.size();) {
+        size_t end = tags.find(',', position);
+        end = end == std::string::npos ? tags.size() : end;
+        if (end - position == length && tags.compare(position, length, tag) == 0) {
+            return true;
+        }
+        position = end + 1;
+    }
+    return false;
+}
+
+size_t FleetLoader::get_tagged(const char *tag, std::vector<Yeelight *> &bulbs) const {
+    size_t found = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (has_tag(i, tag)) {
+            bulbs.push_back(entries[i].bulb);
+            found++;
+        }
+    }
+    return found;
+}
+
+void FleetLoader::set_discovery_timeout(const uint32_t timeout) {
+    discovery_timeout = timeout;
+}
+
+uint32_t FleetLoader::get_ready_time() const {
+    return ready_time;
+}
+
+size_t FleetLoader::get_discovered_count() const {
+    return discovered;
+}
+
+bool FleetLoader::parse_line(const char *line, const size_t length, fleet_entry &entry) {
+    char buffer[192];
+    if (length >= sizeof(buffer)) {
+        return false;
+    }
+    memcpy(buffer, line, length);
+    buffer[length] = '\0';
+    char ip[16] = "";
+    char port[8] = "-";
+    char model[32] = "-";
+    char tags[128] = "";
+    const int fields = sscanf(buffer, " %15s %7s %31s %127s", ip, port, model, tags);
+    if (fields < 1 || ip[0] == '#') {
+        return false;
+    }
+    unsigned int octets[4];
+    char trailing;
+    if (sscanf(ip, "%u.%u.%u.%u%c", &octets[0], &octets[1], &octets[2], &octets[3], &trailing) != 4) {
+        return false;
+    }
+    for (uint8_t i = 0; i < 4; i++) {
+        if (octets[i] > 255) {
+            return false;
+        }
+        entry.device.ip[i] = static_cast<uint8_t>(octets[i]);
+    }
+    entry.device.port = 55443;
+    if (strcmp(port, "-") != 0) {
+        char *end;
+        const unsigned long value = strtoul(port, &end, 10);
+        if (*end != '\0' || value == 0 || value > 65535) {
+            return false;
+        }
+        entry.device.port = static_cast<uint16_t>(value);
+    }
+    if (strcmp(model, "-") != 0) {
+        entry.device.model = model;
+    }
+    entry.tags = tags;
+    return true;
+}
+
+void FleetLoader::resolve() {
+    discovered = 0;
+    bool missing = false;
+    for (fleet_entry &entry: entries) {
+        if (!entry.resolved) {
+            entry.resolved = ModelDatabase::lookup(entry.device.model.c_str(), entry.device.supported_methods);
+            missing = missing || !entry.resolved;
+        }
+    }
+    if (!missing) {
+        return;
+    }
+    // One discovery for all the devices whose model is unknown, instead of one per device.
+    for (const YeelightDevice &found: Yeelight::discoverYeelightDevices(static_cast<int>(discovery_timeout))) {
+        ModelDatabase::remember(found.model.c_str(), found.supported_methods);
+        for (fleet_entry &entry: entries) {
+            if (!entry.resolved && memcmp(entry.device.ip, found.ip, sizeof(found.ip)) == 0) {
+                entry.device.supported_methods = found.supported_methods;
+                entry.device.model = found.model;
+                entry.resolved = true;
+                discovered++;
+            }
+        }
+    }
+}
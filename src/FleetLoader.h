@@ -0,0 +1,123 @@
+#ifndef YEELIGHTARDUINO_FLEETLOADER_H
+#define YEELIGHTARDUINO_FLEETLOADER_H
+
+#include <Yeelight.h>
+
+/**
+ * @class FleetLoader
+ * @brief Creates and connects a whole fleet of devices at boot, from a device list.
+ *
+ * The device list has one device per line: its IP address, then optionally its port (55443 if omitted or
+ * `-`), its model (`-` if unknown) and a comma-separated list of tags. Blank lines and lines starting with
+ * `#` are ignored:
+ *
+ *     # ip            port   model   tags
+ *     192.168.1.20    55443  color4  kitchen,ceiling
+ *     192.168.1.21    -      stripe  kitchen
+ *
+ * Capabilities come from the ModelDatabase for the given model. Devices whose model is unknown are found
+ * with a single discovery shared by the whole fleet, and the capabilities learned are remembered for their
+ * model. No device waits for another: connections are opened concurrently, at most max_connecting at a time
+ * so the socket budget of the network stack is respected, and begin() returns once every device is
+ * connected or the timeout expired.
+ */
+class FleetLoader {
+public:
+    /**
+     * @brief Constructs an empty loader.
+     * @param max_connecting The maximum number of connection attempts in progress at once.
+     */
+    explicit FleetLoader(uint8_t max_connecting = 8);
+
+    /**
+     * @brief Destroys the loader and the devices it created.
+     */
+    ~FleetLoader();
+
+    FleetLoader(const FleetLoader &) = delete;
+
+    FleetLoader &operator=(const FleetLoader &) = delete;
+
+    /**
+     * @brief Adds the devices of a device list. Lines that cannot be parsed are skipped.
+     * @param config The device list, e.g. the contents of a file.
+     * @return The number of devices added.
+     */
+    size_t load(const char *config);
+
+    /**
+     * @brief Resolves the capabilities of the loaded devices and connects them.
+     * @param timeout The maximum time to wait for every device to be connected, in milliseconds.
+     * @return The number of connected devices.
+     */
+    size_t begin(uint32_t timeout = 5000);
+
+    /**
+     * @brief Returns the number of loaded devices.
+     * @return The number of devices.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Gets a loaded device.
+     * @param index The index of the device, in the order of the device list.
+     * @return The device, or nullptr for an unknown index.
+     */
+    Yeelight *get(size_t index) const;
+
+    /**
+     * @brief Checks whether a device has a tag.
+     * @param index The index of the device.
+     * @param tag The tag.
+     * @return True if the device has the tag, false otherwise.
+     */
+    bool has_tag(size_t index, const char *tag) const;
+
+    /**
+     * @brief Collects the devices that have a tag.
+     * @param tag The tag.
+     * @param bulbs Receives the devices (appended).
+     * @return The number of devices found.
+     */
+    size_t get_tagged(const char *tag, std::vector<Yeelight *> &bulbs) const;
+
+    /**
+     * @brief Sets how long the shared discovery waits for devices whose model is unknown.
+     * @param timeout The discovery time in milliseconds.
+     */
+    void set_discovery_timeout(uint32_t timeout);
+
+    /**
+     * @brief Returns the time the last begin() took until every device was connected.
+     * @return The time in milliseconds, or 0 if some devices were still not connected at the timeout.
+     */
+    uint32_t get_ready_time() const;
+
+    /**
+     * @brief Returns the number of devices whose capabilities had to be discovered in the last begin().
+     * @return The number of devices.
+     */
+    size_t get_discovered_count() const;
+
+private:
+    struct fleet_entry
+    {
+        Yeelight *bulb;
+        YeelightDevice device;
+        std::string tags;
+        bool resolved;
+        uint32_t retry_at;
+    };
+
+    std::vector<fleet_entry> entries;
+    uint8_t max_connecting;
+    uint32_t discovery_timeout = 2000;
+    uint32_t ready_time = 0;
+    size_t discovered = 0;
+
+    static bool parse_line(const char *line, size_t length, fleet_entry &entry);
+
+    void resolve();
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include "FleetSnapshot.h"
+
+FleetSnapshot::FleetSnapshot(const size_t capacity) : scene(capacity * 2) {
+    entries.reserve(capacity);
+}
+
+size_t FleetSnapshot::add(Yeelight *bulb) {
+    entries.push_back({bulb, false, false, {}, {}});
+    return entries.size() - 1;
+}
+
+size_t FleetSnapshot::size() const {
+    return entries.size();
+}
+
+void FleetSnapshot::clear() {
+    entries.clear();
+    scene.clear();
+}
+
+size_t FleetSnapshot::capture(const uint32_t timeout) {
+    const uint32_t start = millis();
+    cached = 0;
+    for (size_t index = 0; index < entries.size(); index++) {
+        snapshot_entry &entry = entries[index];
+        entry.captured = false;
+        if (entry.bulb == nullptr) {
+            continue;
+        }
+        entry.background = entry.bulb->getSupportedMethods().bg_set_power;
+        const uint32_t mask = mask_of(entry);
+        if ((entry.bulb->get_synced_properties() & mask) == mask) {
+            read_state(entry.bulb, MAIN_LIGHT, entry.main);
+            read_state(entry.bulb, BACKGROUND_LIGHT, entry.bg);
+            entry.captured = true;
+            cached++;
+        } else {
+            uint16_t id;
+            if (entry.bulb->request_properties(mask, id) == SUCCESS) {
+                pending.add(entry.bulb, id, index);
+            }
+        }
+    }
+    pending.wait(start, timeout, [](void *arg, const size_t index, const ResponseType response) {
+        snapshot_entry &entry = static_cast<FleetSnapshot *>(arg)->entries[index];
+        if (response == SUCCESS) {
+            read_state(entry.bulb, MAIN_LIGHT, entry.main);
+            read_state(entry.bulb, BACKGROUND_LIGHT, entry.bg);
+            entry.captured = true;
+        }
+    }, this);
+    // A late reply would otherwise update the properties of its device after the capture.
+    pending.forget();
+    size_t captured = 0;
+    for (const snapshot_entry &entry: entries) {
+        captured += entry.captured;
+    }
+    return captured;
+}
+
+size_t FleetSnapshot::restore(const uint32_t timeout) {
+    scene.clear();
+    // The scene indices of each device's channels, in order, so outcomes can be grouped per device.
+    std::vector<size_t> first(entries.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        snapshot_entry &entry = entries[i];
+        first[i] = scene.size();
+        if (!entry.captured) {
+            continue;
+        }
+        const uint32_t synced = entry.bulb->get_synced_properties();
+        // The saved brightness is the device's own value, so the curve is bypassed while the commands are built.
+        const BrightnessCurveType curve = entry.bulb->get_brightness_curve();
+        entry.bulb->set_brightness_curve(CURVE_LINEAR);
+        for (uint8_t channel = 0; channel < (entry.background ? 2 : 1); channel++) {
+            const LightType lightType = channel == 0 ? MAIN_LIGHT : BACKGROUND_LIGHT;
+            const uint32_t mask = channel == 0 ? MAIN_PROPERTIES : BACKGROUND_PROPERTIES;
+            const LightState &target = channel == 0 ? entry.main : entry.bg;
+            if ((synced & mask) == mask) {
+                LightState current{};
+                read_state(entry.bulb, lightType, current);
+                scene.add(entry.bulb, current, target, lightType);
+            } else {
+                scene.add(entry.bulb, target, lightType);
+            }
+        }
+        entry.bulb->set_brightness_curve(curve);
+    }
+    scene.apply(timeout);
+    size_t restored = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (!entries[i].captured) {
+            continue;
+        }
+        const size_t last = i + 1 < entries.size() ? first[i + 1] : scene.size();
+        bool success = true;
+        for (size_t index = first[i]; index < last; index++) {
+            success = success && scene.get_outcome(index) == SUCCESS;
+        }
+        restored += success;
+    }
+    return restored;
+}
+
+bool FleetSnapshot::get_state(const size_t index, const LightType lightType, LightState &state) const {
+    if (index >= entries.size() || !entries[index].captured) {
+        return false;
+    }
+    if (lightType == MAIN_LIGHT) {
+        state = entries[index].main;
+        return true;
+    }
+    if (lightType == BACKGROUND_LIGHT && entries[index].background) {
+        state = entries[index].bg;
+        return true;
+    }
+    return false;
+}
+
+size_t FleetSnapshot::get_cached_count() const {
+    return cached;
+}
+
+uint32_t FleetSnapshot::get_restore_time() const {
+    return scene.get_apply_time();
+}
+
+uint32_t FleetSnapshot::mask_of(const snapshot_entry &entry) {
+    return entry.background ? MAIN_PROPERTIES | BACKGROUND_PROPERTIES : MAIN_PROPERTIES;
+}
+
+void FleetSnapshot::read_state(Yeelight *bulb, const LightType lightType, LightState &state) {
+    const YeelightProperties properties = bulb->getProperties();
+    if (lightType == BACKGROUND_LIGHT) {
+        state = {properties.bg_power, properties.bg_color_mode, properties.bg_rgb, properties.bg_ct,
+                 properties.bg_hue, properties.bg_sat, properties.bg_bright};
+    } else {
+        state = {properties.power, properties.color_mode, properties.rgb, properties.ct, properties.hue,
+                 properties.sat, properties.bright};
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef YEELIGHTARDUINO_FLEETSNAPSHOT_H
+#define YEELIGHTARDUINO_FLEETSNAPSHOT_H
+
+#include <Yeelight.h>
+#include <PendingResponses.h>
+#include <Scene.h>
+
+/**
+ * @class FleetSnapshot
+ * @brief Saves the state of many devices and puts it back, e.g. around an alert or a temporary scene.
+ *
+ * capture() reads the state from the property cache of every device whose cache is current (see
+ * Yeelight::get_synced_properties), and fetches the others with one selective `get_prop` each, all sent
+ * before any answer is awaited. restore() compares the saved state of each channel with its current cached
+ * state and sends only the difference: nothing for an unchanged channel, `set_power` or `set_bright` when
+ * only that changed, otherwise a single `set_scene`. The commands of every device go out together, like a
+ * Scene. A channel whose current state is not known is restored with a full `set_scene`.
+ *
+ * Brightness is saved as the device brightness and sent back without the device's brightness curve, so it
+ * is restored exactly: a curve maps several device values to the same level.
+ */
+class FleetSnapshot {
+public:
+    /**
+     * @brief The properties describing the state of the main light.
+     */
+    static constexpr uint32_t MAIN_PROPERTIES = 1UL << PROP_POWER | 1UL << PROP_BRIGHT | 1UL << PROP_CT |
+                                                1UL << PROP_RGB | 1UL << PROP_HUE | 1UL << PROP_SAT |
+                                                1UL << PROP_COLOR_MODE;
+
+    /**
+     * @brief The properties describing the state of the background light.
+     */
+    static constexpr uint32_t BACKGROUND_PROPERTIES = 1UL << PROP_BG_POWER | 1UL << PROP_BG_BRIGHT |
+                                                      1UL << PROP_BG_CT | 1UL << PROP_BG_RGB | 1UL << PROP_BG_HUE |
+                                                      1UL << PROP_BG_SAT | 1UL << PROP_BG_LMODE;
+
+    /**
+     * @brief Constructs an empty snapshot.
+     * @param capacity The number of devices to reserve memory for.
+     */
+    explicit FleetSnapshot(size_t capacity = 0);
+
+    /**
+     * @brief Adds a device to the snapshot. Its state is saved by the next capture().
+     * @param bulb The device.
+     * @return The index of the device in the snapshot.
+     */
+    size_t add(Yeelight *bulb);
+
+    /**
+     * @brief Returns the number of devices in the snapshot.
+     * @return The number of devices.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Removes all devices and saved states.
+     */
+    void clear();
+
+    /**
+     * @brief Saves the current state of every device.
+     * @param timeout The maximum time to wait for the devices that must be queried, in milliseconds.
+     * @return The number of devices whose state was saved.
+     */
+    size_t capture(uint32_t timeout = 1000);
+
+    /**
+     * @brief Puts every saved device back into its saved state.
+     * @param timeout The maximum time to wait for the responses, in milliseconds.
+     * @return The number of devices restored successfully (devices without a saved state are not counted).
+     */
+    size_t restore(uint32_t timeout = 1000);
+
+    /**
+     * @brief Gets the saved state of a channel.
+     * @param index The index of the device.
+     * @param lightType The channel (MAIN_LIGHT or BACKGROUND_LIGHT).
+     * @param state Receives the saved state, with the device brightness (not a level on the curve).
+     * @return True if a state was saved for that channel, false otherwise.
+     */
+    bool get_state(size_t index, LightType lightType, LightState &state) const;
+
+    /**
+     * @brief Returns the number of devices the last capture() read from their cache without a query.
+     * @return The number of devices.
+     */
+    size_t get_cached_count() const;
+
+    /**
+     * @brief Returns the duration of the last restore().
+     * @return The time from the first command written to the last response received, in milliseconds.
+     */
+    uint32_t get_restore_time() const;
+
+private:
+    struct snapshot_entry
+    {
+        Yeelight *bulb;
+        bool captured;
+        bool background;
+        LightState main;
+        LightState bg;
+    };
+
+    std::vector<snapshot_entry> entries;
+    PendingResponses pending;
+    Scene scene;
+    size_t cached = 0;
+
+    static uint32_t mask_of(const snapshot_entry &entry);
+
+    static void read_state(Yeelight *bulb, LightType lightType, LightState &state);
+};
+
+#endif
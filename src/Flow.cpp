@@ -89,7 +89,8 @@ void Flow::add_hsv(const uint32_t duration, const uint16_t hue, const uint8_t sa
     const auto g = static_cast<uint8_t>(std::round(G));
     const auto b = static_cast<uint8_t>(std::round(B));
     const float brightness_calc = 0.299f * r + 0.587f * g + 0.114f * b;
-    const uint8_t bright = static_cast<uint8_t>(std::round((brightness_calc / 255.0) * 100.0));
+    const auto luminance = static_cast<uint8_t>(std::round((brightness_calc / 255.0) * 100.0));
+    const uint8_t bright = luminance < 1 ? 1 : luminance;
     add_rgb(duration, r, g, b, bright);
 }
 
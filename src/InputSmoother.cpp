@@ -0,0 +1,146 @@
+#include "InputSmoother.h"
+#include <BrightnessCurve.h>
+#include <ColorTemperature.h>
+
+InputSmoother::InputSmoother(Yeelight *bulb, const SmoothedInput input, const LightType lightType)
+    : bulb(bulb), group(nullptr), input(input), light_type(lightType) {
+}
+
+InputSmoother::InputSmoother(YeelightGroup *group, const SmoothedInput input, const LightType lightType)
+    : bulb(nullptr), group(group), input(input), light_type(lightType) {
+}
+
+void InputSmoother::add_delta(const int32_t delta) {
+    inputs++;
+    if (targeted) {
+        target += delta;
+    } else {
+        this->delta += delta;
+    }
+}
+
+void InputSmoother::set_target(const int32_t value) {
+    inputs++;
+    targeted = true;
+    target = value;
+    delta = 0;
+}
+
+void InputSmoother::set_interval(const uint32_t interval) {
+    this->interval = interval;
+}
+
+void InputSmoother::set_settle_time(const uint32_t settle_time) {
+    this->settle_time = settle_time;
+}
+
+bool InputSmoother::loop() {
+    if (delta == 0 && !targeted) {
+        return false;
+    }
+    const uint32_t now = millis();
+    if (sent && now - last_command < interval) {
+        return false;
+    }
+    if (estimated && now - last_command >= settle_time) {
+        // Other controllers may have changed the value since: only the cache can tell now.
+        estimated = false;
+    }
+    const int32_t low = input == INPUT_BRIGHTNESS ? 1 : ColorTemperature::MIN_KELVIN;
+    const int32_t high = input == INPUT_BRIGHTNESS ? 100 : ColorTemperature::MAX_KELVIN;
+    const uint32_t duration = interval < MIN_DURATION ? MIN_DURATION : interval > UINT16_MAX ? UINT16_MAX : interval;
+    smoother_command command{input, light_type, true, 0, static_cast<uint16_t>(duration)};
+    int32_t current = 0;
+    if (targeted) {
+        command.value = target;
+    } else if (estimated) {
+        command.value = estimate + delta;
+    } else if (cached(current)) {
+        command.value = current + delta;
+    } else {
+        // Relative commands take a percentage of the range; what does not make a whole percent waits.
+        const int32_t range = high - low + 1;
+        int32_t percentage = input == INPUT_BRIGHTNESS ? delta : delta * 100 / range;
+        percentage = percentage > 100 ? 100 : percentage < -100 ? -100 : percentage;
+        if (percentage == 0) {
+            return false;
+        }
+        command.absolute = false;
+        command.value = percentage;
+    }
+    if (command.absolute) {
+        command.value = command.value < low ? low : command.value > high ? high : command.value;
+    }
+    sent = true;
+    last_command = now;
+    if (send(command) != SUCCESS) {
+        // The input is kept and sent again after the interval.
+        return false;
+    }
+    commands++;
+    if (command.absolute) {
+        estimated = true;
+        estimate = command.value;
+        targeted = false;
+        delta = 0;
+    } else {
+        const int32_t range = high - low + 1;
+        delta -= input == INPUT_BRIGHTNESS ? command.value : command.value * range / 100;
+    }
+    return true;
+}
+
+uint32_t InputSmoother::get_input_count() const {
+    return inputs;
+}
+
+uint32_t InputSmoother::get_command_count() const {
+    return commands;
+}
+
+bool InputSmoother::cached(int32_t &value) const {
+    if (bulb == nullptr) {
+        return false;
+    }
+    const bool background = light_type == BACKGROUND_LIGHT;
+    YeelightProp prop;
+    if (input == INPUT_BRIGHTNESS) {
+        prop = background ? PROP_BG_BRIGHT : PROP_BRIGHT;
+    } else {
+        prop = background ? PROP_BG_CT : PROP_CT;
+    }
+    if ((bulb->get_synced_properties() & 1UL << prop) == 0) {
+        return false;
+    }
+    const YeelightProperties properties = bulb->getProperties();
+    if (input == INPUT_BRIGHTNESS) {
+        value = BrightnessCurve::from_device(bulb->get_brightness_curve(),
+                                             background ? properties.bg_bright : properties.bright);
+    } else {
+        value = background ? properties.bg_ct : properties.ct;
+    }
+    return true;
+}
+
+ResponseType InputSmoother::send(smoother_command &command) {
+    if (group != nullptr) {
+        return group->broadcast(execute, &command) > 0 ? SUCCESS : group->get_result(0);
+    }
+    return bulb == nullptr ? DEVICE_NOT_FOUND : execute(bulb, &command);
+}
+
+ResponseType InputSmoother::execute(Yeelight *bulb, void *arg) {
+    const auto *command = static_cast<const smoother_command *>(arg);
+    if (command->input == INPUT_BRIGHTNESS) {
+        if (command->absolute) {
+            return bulb->set_brightness(static_cast<uint8_t>(command->value), EFFECT_SMOOTH, command->duration,
+                                        command->light_type);
+        }
+        return bulb->adjust_brightness(static_cast<int8_t>(command->value), command->duration, command->light_type);
+    }
+    if (command->absolute) {
+        return bulb->set_color_temp(static_cast<uint16_t>(command->value), EFFECT_SMOOTH, command->duration,
+                                    command->light_type);
+    }
+    return bulb->adjust_color_temp(static_cast<int8_t>(command->value), command->duration, command->light_type);
+}
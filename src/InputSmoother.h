@@ -0,0 +1,121 @@
+#ifndef YEELIGHTARDUINO_INPUTSMOOTHER_H
+#define YEELIGHTARDUINO_INPUTSMOOTHER_H
+
+#include <Yeelight.h>
+#include <YeelightGroup.h>
+
+/**
+ * @class InputSmoother
+ * @brief Turns the bursts of small steps of a rotary encoder or slider into a few smooth commands.
+ *
+ * Input is accumulated and sent at most once per interval, so a fast knob costs a bounded number of
+ * commands (mind the device quota of about 60 commands per minute outside music mode). Each command uses a
+ * smooth transition as long as the interval, so the device glides from one update to the next and the knob
+ * feels continuous.
+ *
+ * When the current value is known, an absolute `set_bright` / `set_ct_abx` is sent: it is known after an
+ * absolute command (for settle_time), or when the device's cached property is current (see
+ * Yeelight::get_synced_properties). Otherwise the accumulated steps are sent as a relative `adjust_bright`
+ * / `adjust_ct`, which is right whatever the current value. Groups have no cache and use relative commands
+ * until set_target gives them an absolute value.
+ */
+class InputSmoother {
+public:
+    /**
+     * @brief The shortest transition the devices accept, in milliseconds.
+     */
+    static constexpr uint16_t MIN_DURATION = 30;
+
+    /**
+     * @brief Constructs a smoother driving a device.
+     * @param bulb The device.
+     * @param input The value driven by the input.
+     * @param lightType The light channel (MAIN_LIGHT or BACKGROUND_LIGHT).
+     */
+    explicit InputSmoother(Yeelight *bulb, SmoothedInput input = INPUT_BRIGHTNESS, LightType lightType = MAIN_LIGHT);
+
+    /**
+     * @brief Constructs a smoother driving a group of devices.
+     * @param group The group.
+     * @param input The value driven by the input.
+     * @param lightType The light channel (MAIN_LIGHT or BACKGROUND_LIGHT).
+     */
+    explicit InputSmoother(YeelightGroup *group, SmoothedInput input = INPUT_BRIGHTNESS,
+                           LightType lightType = MAIN_LIGHT);
+
+    /**
+     * @brief Adds a relative step, e.g. from an encoder.
+     * @param delta The step, in brightness levels or in Kelvin.
+     */
+    void add_delta(int32_t delta);
+
+    /**
+     * @brief Sets an absolute value, e.g. from a slider. It replaces any step not sent yet.
+     * @param value The value, in brightness levels or in Kelvin.
+     */
+    void set_target(int32_t value);
+
+    /**
+     * @brief Sets the shortest time between two commands, which is also the transition duration.
+     * @param interval The interval in milliseconds.
+     */
+    void set_interval(uint32_t interval);
+
+    /**
+     * @brief Sets how long the value set by an absolute command is trusted after the last command.
+     * @param settle_time The time in milliseconds.
+     */
+    void set_settle_time(uint32_t settle_time);
+
+    /**
+     * @brief Sends the accumulated input if the interval has elapsed.
+     * @return True if a command was sent.
+     */
+    bool loop();
+
+    /**
+     * @brief Returns the number of inputs received (steps and targets).
+     * @return The number of inputs.
+     */
+    uint32_t get_input_count() const;
+
+    /**
+     * @brief Returns the number of commands sent.
+     * @return The number of commands.
+     */
+    uint32_t get_command_count() const;
+
+private:
+    struct smoother_command
+    {
+        SmoothedInput input;
+        LightType light_type;
+        bool absolute;
+        int32_t value;
+        uint16_t duration;
+    };
+
+    Yeelight *bulb;
+    YeelightGroup *group;
+    SmoothedInput input;
+    LightType light_type;
+    int32_t delta = 0;
+    bool targeted = false;
+    int32_t target = 0;
+    bool estimated = false;
+    int32_t estimate = 0;
+    bool sent = false;
+    uint32_t last_command = 0;
+    uint32_t interval = 250;
+    uint32_t settle_time = 2000;
+    uint32_t inputs = 0;
+    uint32_t commands = 0;
+
+    bool cached(int32_t &value) const;
+
+    ResponseType send(smoother_command &command);
+
+    static ResponseType execute(Yeelight *bulb, void *arg);
+};
+
+#endif
@@ -0,0 +1,253 @@
+#include "LightProgram.h"
+
+void LightProgram::load(const uint8_t *code, const uint16_t size, Yeelight *bulb, const LightType lightType) {
+    this->code = code;
+    this->size = size;
+    this->bulb = bulb;
+    light_type = static_cast<uint8_t>(lightType);
+    pc = 0;
+    fade = 0;
+    depth = 0;
+    wake_at = 0;
+    state = code && size ? RUNNING : FAULTED;
+}
+
+void LightProgram::stop() {
+    code = nullptr;
+    bulb = nullptr;
+    state = IDLE;
+}
+
+LightProgram::State LightProgram::get_state() const {
+    return state;
+}
+
+uint16_t LightProgram::get_pc() const {
+    return pc;
+}
+
+effect LightProgram::transition_effect() const {
+    return fade >= 30 ? EFFECT_SMOOTH : EFFECT_SUDDEN;
+}
+
+uint16_t LightProgram::transition_duration() const {
+    return fade >= 30 ? fade : 30;
+}
+
+LightType LightProgram::light() const {
+    return static_cast<LightType>(light_type);
+}
+
+bool LightProgram::fetch(const uint8_t length) {
+    if (pc + length > size) {
+        state = FAULTED;
+        return false;
+    }
+    return true;
+}
+
+uint8_t LightProgram::read8() {
+    return code[pc++];
+}
+
+uint16_t LightProgram::read16() {
+    const uint16_t value = code[pc] | code[pc + 1] << 8;
+    pc += 2;
+    return value;
+}
+
+uint32_t LightProgram::read32() {
+    const uint32_t value = static_cast<uint32_t>(code[pc]) | static_cast<uint32_t>(code[pc + 1]) << 8 |
+                           static_cast<uint32_t>(code[pc + 2]) << 16 | static_cast<uint32_t>(code[pc + 3]) << 24;
+    pc += 4;
+    return value;
+}
+
+uint32_t LightProgram::property_value(const YeelightProperties &properties, const YeelightProp prop) {
+    return Yeelight::get_property_value(properties, prop);
+}
+
+bool LightProgram::matches(const uint8_t prop, const uint8_t compare, const uint32_t value) const {
+    const uint32_t current = property_value(bulb->getProperties(), static_cast<YeelightProp>(prop));
+    switch (compare) {
+        case COMPARE_EQ: return current == value;
+        case COMPARE_NE: return current != value;
+        case COMPARE_LT: return current < value;
+        case COMPARE_LE: return current <= value;
+        case COMPARE_GT: return current > value;
+        case COMPARE_GE: return current >= value;
+        default: return false;
+    }
+}
+
+LightProgram::State LightProgram::step(const uint32_t now, uint8_t budget) {
+    if (state == WAITING) {
+        if (static_cast<int32_t>(now - wake_at) < 0) {
+            return state;
+        }
+        state = RUNNING;
+    }
+    if (state == WATCHING) {
+        // The program counter was left past the operands of the PROGRAM_WAIT_PROP being watched.
+        pc -= 10;
+        const uint8_t prop = read8();
+        const uint8_t compare = read8();
+        const uint32_t value = read32();
+        const uint32_t timeout = read32();
+        if (!matches(prop, compare, value) && (timeout == 0 || static_cast<int32_t>(now - wake_at) < 0)) {
+            return state;
+        }
+        state = RUNNING;
+    }
+    while (state == RUNNING && budget-- > 0) {
+        if (!fetch(1)) {
+            break;
+        }
+        switch (read8()) {
+            case PROGRAM_END:
+                state = FINISHED;
+                break;
+            case PROGRAM_POWER:
+                if (fetch(1)) {
+                    bulb->set_power(read8() != 0, transition_effect(), transition_duration(), light());
+                }
+                break;
+            case PROGRAM_RGB:
+                if (fetch(3)) {
+                    const uint8_t r = read8();
+                    const uint8_t g = read8();
+                    const uint8_t b = read8();
+                    bulb->set_rgb_color(r, g, b, transition_effect(), transition_duration(), light());
+                }
+                break;
+            case PROGRAM_CT:
+                if (fetch(2)) {
+                    bulb->set_color_temp(read16(), transition_effect(), transition_duration(), light());
+                }
+                break;
+            case PROGRAM_HSV:
+                if (fetch(3)) {
+                    const uint16_t hue = read16();
+                    bulb->set_hsv_color(hue, read8(), transition_effect(), transition_duration(), light());
+                }
+                break;
+            case PROGRAM_BRIGHT:
+                if (fetch(1)) {
+                    bulb->set_brightness(read8(), transition_effect(), transition_duration(), light());
+                }
+                break;
+            case PROGRAM_FADE:
+                if (fetch(2)) {
+                    fade = read16();
+                }
+                break;
+            case PROGRAM_WAIT:
+                if (fetch(4)) {
+                    wake_at = now + read32();
+                    state = WAITING;
+                }
+                break;
+            case PROGRAM_WAIT_PROP:
+                if (fetch(10)) {
+                    const uint8_t prop = read8();
+                    const uint8_t compare = read8();
+                    const uint32_t value = read32();
+                    const uint32_t timeout = read32();
+                    if (!matches(prop, compare, value)) {
+                        wake_at = now + timeout;
+                        state = WATCHING;
+                    }
+                }
+                break;
+            case PROGRAM_LOOP:
+                if (fetch(2)) {
+                    if (depth >= MAX_LOOP_DEPTH) {
+                        state = FAULTED;
+                        break;
+                    }
+                    loops[depth++] = read16();
+                }
+                break;
+            case PROGRAM_NEXT:
+                if (fetch(2) && depth > 0) {
+                    const uint16_t target = read16();
+                    uint16_t &remaining = loops[depth - 1];
+                    if (remaining == 0 || --remaining > 0) {
+                        pc = target;
+                    } else {
+                        depth--;
+                    }
+                } else {
+                    state = FAULTED;
+                }
+                break;
+            case PROGRAM_JUMP:
+                if (fetch(2)) {
+                    pc = read16();
+                }
+                break;
+            case PROGRAM_BRANCH:
+                if (fetch(8)) {
+                    const uint8_t prop = read8();
+                    const uint8_t compare = read8();
+                    const uint32_t value = read32();
+                    const uint16_t target = read16();
+                    if (matches(prop, compare, value)) {
+                        pc = target;
+                    }
+                }
+                break;
+            default:
+                state = FAULTED;
+                break;
+        }
+    }
+    return state;
+}
+
+LightProgramScheduler::LightProgramScheduler(const uint16_t capacity) : programs(capacity) {
+}
+
+int16_t LightProgramScheduler::start(const uint8_t *code, const uint16_t size, Yeelight *bulb,
+                                     const LightType lightType) {
+    for (size_t i = 0; i < programs.size(); i++) {
+        const LightProgram::State state = programs[i].get_state();
+        if (state == LightProgram::IDLE || state == LightProgram::FINISHED || state == LightProgram::FAULTED) {
+            programs[i].load(code, size, bulb, lightType);
+            return static_cast<int16_t>(i);
+        }
+    }
+    return -1;
+}
+
+void LightProgramScheduler::stop(const int16_t handle) {
+    if (handle >= 0 && static_cast<size_t>(handle) < programs.size()) {
+        programs[handle].stop();
+    }
+}
+
+LightProgram::State LightProgramScheduler::get_state(const int16_t handle) const {
+    if (handle < 0 || static_cast<size_t>(handle) >= programs.size()) {
+        return LightProgram::IDLE;
+    }
+    return programs[handle].get_state();
+}
+
+uint16_t LightProgramScheduler::loop() {
+    const uint32_t now = millis();
+    uint16_t active = 0;
+    for (LightProgram &program: programs) {
+        const LightProgram::State state = program.get_state();
+        if (state == LightProgram::RUNNING || state == LightProgram::WAITING || state == LightProgram::WATCHING) {
+            const LightProgram::State after = program.step(now, budget);
+            if (after != LightProgram::FINISHED && after != LightProgram::FAULTED) {
+                active++;
+            }
+        }
+    }
+    return active;
+}
+
+void LightProgramScheduler::set_budget(const uint8_t budget) {
+    this->budget = budget == 0 ? 1 : budget;
+}
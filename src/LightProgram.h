@@ -0,0 +1,197 @@
+#ifndef YEELIGHTARDUINO_LIGHTPROGRAM_H
+#define YEELIGHTARDUINO_LIGHTPROGRAM_H
+
+#include <Yeelight.h>
+
+/**
+ * @brief Enumeration of light program instructions.
+ *
+ * Operands follow the opcode byte; multi-byte operands are little-endian. Jump targets are byte offsets
+ * from the start of the program.
+ */
+enum program_op : uint8_t
+{
+    PROGRAM_END = 0,        /**< Stops the program */
+    PROGRAM_POWER = 1,      /**< u8 on: sets the power state */
+    PROGRAM_RGB = 2,        /**< u8 r, u8 g, u8 b: sets an RGB color */
+    PROGRAM_CT = 3,         /**< u16 ct: sets a color temperature */
+    PROGRAM_HSV = 4,        /**< u16 hue, u8 sat: sets an HSV color */
+    PROGRAM_BRIGHT = 5,     /**< u8 bright: sets the brightness */
+    PROGRAM_FADE = 6,       /**< u16 ms: sets the transition of the following commands (0 for sudden) */
+    PROGRAM_WAIT = 7,       /**< u32 ms: suspends the program */
+    PROGRAM_WAIT_PROP = 8,  /**< u8 prop, u8 cmp, u32 value, u32 timeout: suspends until a property matches */
+    PROGRAM_LOOP = 9,       /**< u16 count: opens a loop (0 for forever) */
+    PROGRAM_NEXT = 10,      /**< u16 target: closes a loop, jumping back to target while iterations remain */
+    PROGRAM_JUMP = 11,      /**< u16 target: jumps unconditionally */
+    PROGRAM_BRANCH = 12     /**< u8 prop, u8 cmp, u32 value, u16 target: jumps if a property matches */
+};
+
+/**
+ * @brief Enumeration of comparisons used by property waits and branches.
+ */
+enum program_compare : uint8_t
+{
+    COMPARE_EQ, /**< Equal */
+    COMPARE_NE, /**< Not equal */
+    COMPARE_LT, /**< Less than */
+    COMPARE_LE, /**< Less than or equal */
+    COMPARE_GT, /**< Greater than */
+    COMPARE_GE  /**< Greater than or equal */
+};
+
+/**
+ * @class LightProgram
+ * @brief A single running instance of a compiled light program.
+ *
+ * The instance only holds the interpreter state (program counter, transition, wake-up time and loop
+ * counters); the bytecode itself is shared and may live in flash. Programs are stepped cooperatively by
+ * a LightProgramScheduler and never block except for the commands they send to the device.
+ */
+class LightProgram {
+public:
+    /**
+     * @brief The maximum nesting depth of loops.
+     */
+    static constexpr uint8_t MAX_LOOP_DEPTH = 3;
+
+    /**
+     * @brief Enumeration of program states.
+     */
+    enum State : uint8_t
+    {
+        IDLE,     /**< No program loaded */
+        RUNNING,  /**< Ready to execute instructions */
+        WAITING,  /**< Suspended until a point in time */
+        WATCHING, /**< Suspended until a property matches (or a timeout) */
+        FINISHED, /**< Reached the end of the program */
+        FAULTED   /**< Stopped on malformed bytecode */
+    };
+
+    /**
+     * @brief Loads a program. The bytecode is not copied and must outlive the instance.
+     * @param code A pointer to the bytecode.
+     * @param size The size of the bytecode in bytes.
+     * @param bulb The device the program controls.
+     * @param lightType The light channel the program controls.
+     */
+    void load(const uint8_t *code, uint16_t size, Yeelight *bulb, LightType lightType = AUTO);
+
+    /**
+     * @brief Executes instructions until the program suspends, ends, or uses up its budget.
+     * @param now The current time in milliseconds.
+     * @param budget The maximum number of instructions to execute.
+     * @return The state of the program after the step.
+     */
+    State step(uint32_t now, uint8_t budget = 32);
+
+    /**
+     * @brief Stops the program and frees the instance.
+     */
+    void stop();
+
+    /**
+     * @brief Returns the state of the program.
+     * @return The program state.
+     */
+    State get_state() const;
+
+    /**
+     * @brief Returns the current program counter.
+     * @return The byte offset of the next instruction.
+     */
+    uint16_t get_pc() const;
+
+    /**
+     * @brief Reads a numeric property from the cached properties of a device.
+     * @param properties The cached properties.
+     * @param prop The property to read.
+     * @return The value of the property (booleans read as 0 or 1, color modes as their protocol number).
+     */
+    static uint32_t property_value(const YeelightProperties &properties, YeelightProp prop);
+
+private:
+    const uint8_t *code = nullptr;
+    Yeelight *bulb = nullptr;
+    uint32_t wake_at = 0;
+    uint16_t size = 0;
+    uint16_t pc = 0;
+    uint16_t fade = 0;
+    uint16_t loops[MAX_LOOP_DEPTH]{};
+    uint8_t depth = 0;
+    State state = IDLE;
+    uint8_t light_type = AUTO;
+
+    effect transition_effect() const;
+
+    uint16_t transition_duration() const;
+
+    LightType light() const;
+
+    bool fetch(uint8_t length);
+
+    uint8_t read8();
+
+    uint16_t read16();
+
+    uint32_t read32();
+
+    bool matches(uint8_t prop, uint8_t compare, uint32_t value) const;
+};
+
+/**
+ * @class LightProgramScheduler
+ * @brief Runs many light programs cooperatively from the sketch's `loop()`, without threads.
+ *
+ * The scheduler owns a fixed pool of LightProgram instances allocated once at construction, so memory use
+ * is bounded by the capacity. Each call to loop() gives every runnable program one step with a bounded
+ * instruction budget, so a program that never waits cannot starve the others.
+ */
+class LightProgramScheduler {
+public:
+    /**
+     * @brief Constructs a scheduler.
+     * @param capacity The maximum number of programs that can run at the same time.
+     */
+    explicit LightProgramScheduler(uint16_t capacity = 16);
+
+    /**
+     * @brief Starts a program in a free slot.
+     * @param code A pointer to the bytecode (not copied).
+     * @param size The size of the bytecode in bytes.
+     * @param bulb The device the program controls.
+     * @param lightType The light channel the program controls.
+     * @return A handle for the program, or -1 if all slots are in use.
+     */
+    int16_t start(const uint8_t *code, uint16_t size, Yeelight *bulb, LightType lightType = AUTO);
+
+    /**
+     * @brief Stops a program and frees its slot.
+     * @param handle The handle returned by start.
+     */
+    void stop(int16_t handle);
+
+    /**
+     * @brief Returns the state of a program.
+     * @param handle The handle returned by start.
+     * @return The program state, or IDLE for an unknown handle.
+     */
+    LightProgram::State get_state(int16_t handle) const;
+
+    /**
+     * @brief Steps every runnable program once.
+     * @return The number of programs that are still active.
+     */
+    uint16_t loop();
+
+    /**
+     * @brief Sets the maximum number of instructions a program may execute per step.
+     * @param budget The instruction budget.
+     */
+    void set_budget(uint8_t budget);
+
+private:
+    std::vector<LightProgram> programs;
+    uint8_t budget = 32;
+};
+
+#endif
@@ -0,0 +1,269 @@
+#include "LightProgramCompiler.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+static const char *const compare_names[] = {"==", "!=", "<", "<=", ">", ">="};
+
+static const program_compare negated[] = {COMPARE_NE, COMPARE_EQ, COMPARE_GE, COMPARE_GT, COMPARE_LE, COMPARE_LT};
+
+enum block_type
+{
+    BLOCK_LOOP,
+    BLOCK_IF,
+    BLOCK_ELSE
+};
+
+struct block
+{
+    block_type type;
+    uint16_t address;
+};
+
+static void emit16(std::vector<uint8_t> &out, const uint16_t value) {
+    out.push_back(value & 0xFF);
+    out.push_back(value >> 8);
+}
+
+static void emit32(std::vector<uint8_t> &out, const uint32_t value) {
+    for (uint8_t i = 0; i < 4; i++) {
+        out.push_back(value >> 8 * i & 0xFF);
+    }
+}
+
+static void patch16(std::vector<uint8_t> &out, const uint16_t at, const uint16_t value) {
+    out[at] = value & 0xFF;
+    out[at + 1] = value >> 8;
+}
+
+static bool parse_number(const std::string &token, uint32_t &value) {
+    if (token == "on") {
+        value = 1;
+        return true;
+    }
+    if (token == "off") {
+        value = 0;
+        return true;
+    }
+    const char *start = token.c_str();
+    if (*start < '0' || *start > '9') {
+        // strtoul would take a sign and wrap negative numbers around.
+        return false;
+    }
+    char *end = nullptr;
+    errno = 0;
+    const unsigned long parsed = strtoul(start, &end, 0);
+    value = static_cast<uint32_t>(parsed);
+    return errno == 0 && *end == '\0' && parsed <= UINT32_MAX;
+}
+
+static int8_t parse_property(const std::string &token) {
+    for (uint8_t i = 0; i < PROP_COUNT; i++) {
+        if (token == Yeelight::get_property_name(static_cast<YeelightProp>(i))) {
+            return static_cast<int8_t>(i);
+        }
+    }
+    return -1;
+}
+
+static int8_t parse_compare(const std::string &token) {
+    for (uint8_t i = 0; i < sizeof(compare_names) / sizeof(compare_names[0]); i++) {
+        if (token == compare_names[i]) {
+            return static_cast<int8_t>(i);
+        }
+    }
+    return -1;
+}
+
+bool LightProgramCompiler::fail(const uint16_t line, const char *message) {
+    error = message;
+    error_line = line;
+    return false;
+}
+
+bool LightProgramCompiler::compile(const char *source, std::vector<uint8_t> &bytecode) {
+    bytecode.clear();
+    error.clear();
+    error_line = 0;
+    std::vector<block> blocks;
+    uint16_t line_number = 0;
+    const char *cursor = source;
+    while (*cursor) {
+        line_number++;
+        const char *line_end = strchr(cursor, '\n');
+        std::string line = line_end ? std::string(cursor, line_end - cursor) : std::string(cursor);
+        cursor = line_end ? line_end + 1 : cursor + line.size();
+        const size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+        std::vector<std::string> tokens;
+        size_t pos = 0;
+        while (pos < line.size()) {
+            const size_t start = line.find_first_not_of(" \t\r", pos);
+            if (start == std::string::npos) {
+                break;
+            }
+            const size_t end = line.find_first_of(" \t\r", start);
+            tokens.push_back(line.substr(start, end == std::string::npos ? std::string::npos : end - start));
+            pos = end == std::string::npos ? line.size() : end;
+        }
+        if (tokens.empty()) {
+            continue;
+        }
+        const std::string &op = tokens[0];
+        uint32_t values[4] = {};
+        // Statements taking numbers only accept arguments that parse; the others check their own tokens.
+        bool numeric = true;
+        for (size_t i = 1; i < tokens.size() && i <= 4; i++) {
+            numeric = parse_number(tokens[i], values[i - 1]) && numeric;
+        }
+        if (op == "power") {
+            if (tokens.size() != 2 || (tokens[1] != "on" && tokens[1] != "off")) {
+                return fail(line_number, "expected: power on|off");
+            }
+            bytecode.push_back(PROGRAM_POWER);
+            bytecode.push_back(values[0]);
+        } else if (op == "rgb") {
+            uint32_t rgb;
+            if (tokens.size() == 2 && parse_number(tokens[1], rgb) && rgb <= 0xFFFFFF) {
+                values[0] = rgb >> 16;
+                values[1] = rgb >> 8 & 0xFF;
+                values[2] = rgb & 0xFF;
+            } else if (tokens.size() != 4 || !numeric || values[0] > 255 || values[1] > 255 || values[2] > 255) {
+                return fail(line_number, "expected: rgb R G B or rgb 0xRRGGBB");
+            }
+            bytecode.push_back(PROGRAM_RGB);
+            bytecode.push_back(values[0]);
+            bytecode.push_back(values[1]);
+            bytecode.push_back(values[2]);
+        } else if (op == "ct") {
+            if (tokens.size() != 2 || !numeric) {
+                return fail(line_number, "expected: ct KELVIN");
+            }
+            if (values[0] < 1700 || values[0] > 6500) {
+                return fail(line_number, "color temperature must be 1700 to 6500");
+            }
+            bytecode.push_back(PROGRAM_CT);
+            emit16(bytecode, values[0]);
+        } else if (op == "hsv") {
+            if (tokens.size() != 3 || !numeric || values[0] > 359 || values[1] > 100) {
+                return fail(line_number, "expected: hsv HUE SAT");
+            }
+            bytecode.push_back(PROGRAM_HSV);
+            emit16(bytecode, values[0]);
+            bytecode.push_back(values[1]);
+        } else if (op == "bright") {
+            if (tokens.size() != 2 || !numeric) {
+                return fail(line_number, "expected: bright PERCENT");
+            }
+            if (values[0] < 1 || values[0] > 100) {
+                return fail(line_number, "brightness must be 1 to 100");
+            }
+            bytecode.push_back(PROGRAM_BRIGHT);
+            bytecode.push_back(values[0]);
+        } else if (op == "fade") {
+            if (tokens.size() != 2 || !numeric || values[0] > 0xFFFF) {
+                return fail(line_number, "expected: fade MS");
+            }
+            bytecode.push_back(PROGRAM_FADE);
+            emit16(bytecode, values[0]);
+        } else if (op == "wait") {
+            if (tokens.size() != 2 || !numeric) {
+                return fail(line_number, "expected: wait MS");
+            }
+            bytecode.push_back(PROGRAM_WAIT);
+            emit32(bytecode, values[0]);
+        } else if (op == "waitfor" || op == "if") {
+            const bool is_wait = op == "waitfor";
+            if (tokens.size() < 4 || tokens.size() > (is_wait ? 5u : 4u)) {
+                return fail(line_number, is_wait ? "expected: waitfor PROP CMP VALUE [MS]" : "expected: if PROP CMP VALUE");
+            }
+            const int8_t prop = parse_property(tokens[1]);
+            const int8_t compare = parse_compare(tokens[2]);
+            uint32_t value;
+            if (prop < 0) {
+                return fail(line_number, "unknown property");
+            }
+            if (compare < 0) {
+                return fail(line_number, "unknown comparison");
+            }
+            if (!parse_number(tokens[3], value)) {
+                return fail(line_number, "invalid value");
+            }
+            if (tokens.size() == 5 && !parse_number(tokens[4], values[3])) {
+                return fail(line_number, "invalid timeout");
+            }
+            if (is_wait) {
+                bytecode.push_back(PROGRAM_WAIT_PROP);
+                bytecode.push_back(prop);
+                bytecode.push_back(compare);
+                emit32(bytecode, value);
+                emit32(bytecode, tokens.size() == 5 ? values[3] : 0);
+            } else {
+                bytecode.push_back(PROGRAM_BRANCH);
+                bytecode.push_back(prop);
+                bytecode.push_back(negated[compare]);
+                emit32(bytecode, value);
+                blocks.push_back({BLOCK_IF, static_cast<uint16_t>(bytecode.size())});
+                emit16(bytecode, 0);
+            }
+        } else if (op == "else") {
+            if (blocks.empty() || blocks.back().type != BLOCK_IF) {
+                return fail(line_number, "else without if");
+            }
+            bytecode.push_back(PROGRAM_JUMP);
+            const auto jump = static_cast<uint16_t>(bytecode.size());
+            emit16(bytecode, 0);
+            patch16(bytecode, blocks.back().address, bytecode.size());
+            blocks.back() = {BLOCK_ELSE, jump};
+        } else if (op == "loop") {
+            if (tokens.size() > 2 || !numeric || values[0] > 0xFFFF) {
+                return fail(line_number, "expected: loop [COUNT]");
+            }
+            if (tokens.size() == 2 && values[0] == 0) {
+                return fail(line_number, "loop count must be positive");
+            }
+            if (std::count_if(blocks.begin(), blocks.end(), [](const block &b) { return b.type == BLOCK_LOOP; }) >=
+                LightProgram::MAX_LOOP_DEPTH) {
+                return fail(line_number, "loops nested too deeply");
+            }
+            bytecode.push_back(PROGRAM_LOOP);
+            emit16(bytecode, values[0]);
+            blocks.push_back({BLOCK_LOOP, static_cast<uint16_t>(bytecode.size())});
+        } else if (op == "end") {
+            if (blocks.empty()) {
+                return fail(line_number, "end without block");
+            }
+            const block closed = blocks.back();
+            blocks.pop_back();
+            if (closed.type == BLOCK_LOOP) {
+                bytecode.push_back(PROGRAM_NEXT);
+                emit16(bytecode, closed.address);
+            } else {
+                patch16(bytecode, closed.address, bytecode.size());
+            }
+        } else if (op == "stop") {
+            bytecode.push_back(PROGRAM_END);
+        } else {
+            return fail(line_number, "unknown statement");
+        }
+        if (bytecode.size() > 0xFFFF) {
+            return fail(line_number, "program too large");
+        }
+    }
+    if (!blocks.empty()) {
+        return fail(line_number, "missing end");
+    }
+    bytecode.push_back(PROGRAM_END);
+    return true;
+}
+
+const std::string &LightProgramCompiler::get_error() const {
+    return error;
+}
+
+uint16_t LightProgramCompiler::get_error_line() const {
+    return error_line;
+}
@@ -0,0 +1,59 @@
+#ifndef YEELIGHTARDUINO_LIGHTPROGRAMCOMPILER_H
+#define YEELIGHTARDUINO_LIGHTPROGRAMCOMPILER_H
+
+#include <LightProgram.h>
+#include <string>
+#include <vector>
+
+/**
+ * @class LightProgramCompiler
+ * @brief Compiles the light program text language into bytecode for LightProgram.
+ *
+ * The language has one statement per line; `#` starts a comment:
+ *
+ *     power on|off                  set the power state
+ *     rgb R G B | rgb 0xRRGGBB      set an RGB color
+ *     ct KELVIN                     set a color temperature (1700 to 6500)
+ *     hsv HUE SAT                   set an HSV color
+ *     bright PERCENT                set the brightness (1 to 100)
+ *     fade MS                       transition used by the following commands (0 for sudden)
+ *     wait MS                       suspend the program
+ *     waitfor PROP CMP VALUE [MS]   suspend until a property matches, with an optional timeout
+ *     loop [COUNT] ... end          repeat a block COUNT times (forever without COUNT)
+ *     if PROP CMP VALUE ... [else ...] end
+ *     stop                          end the program
+ *
+ * PROP is a `get_prop` property name (e.g. `power`, `bright`, `ct`, `rgb`), CMP is one of
+ * `== != < <= > >=` and VALUE is a number (`on`/`off` are accepted as 1/0). Programs are usually compiled
+ * on the host and embedded as byte arrays, but the compiler also runs on the device.
+ */
+class LightProgramCompiler {
+public:
+    /**
+     * @brief Compiles a program.
+     * @param source The program text.
+     * @param bytecode The vector receiving the bytecode (cleared first).
+     * @return True on success; on failure the error and its line are available from the getters.
+     */
+    bool compile(const char *source, std::vector<uint8_t> &bytecode);
+
+    /**
+     * @brief Returns the message of the last compilation error.
+     * @return The error message, empty if the last compilation succeeded.
+     */
+    const std::string &get_error() const;
+
+    /**
+     * @brief Returns the line of the last compilation error.
+     * @return The 1-based line number, 0 if the last compilation succeeded.
+     */
+    uint16_t get_error_line() const;
+
+private:
+    std::string error;
+    uint16_t error_line = 0;
+
+    bool fail(uint16_t line, const char *message);
+};
+
+#endif
@@ -0,0 +1,135 @@
+#include "LinkMonitor.h"
+
+#if defined(ESP32)
+#include <WiFi.h>
+
+/**
+ * @brief The last link state reported by Wi-Fi events (-1 before the first event).
+ */
+static volatile int8_t wifi_link = -1;
+
+static void on_wifi_event(const arduino_event_id_t event, arduino_event_info_t) {
+    // Called from the event task: only the state is recorded, loop() acts on it.
+    if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+        wifi_link = 1;
+    } else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED || event == ARDUINO_EVENT_WIFI_STA_LOST_IP) {
+        wifi_link = 0;
+    }
+}
+#endif
+
+LinkMonitor::LinkMonitor(const uint16_t capacity) {
+    entries.reserve(capacity);
+}
+
+bool LinkMonitor::add(Yeelight *bulb) {
+    if (bulb == nullptr) {
+        return false;
+    }
+    for (const link_entry &entry: entries) {
+        if (entry.bulb == bulb) {
+            return false;
+        }
+    }
+    entries.push_back({bulb, RESUME_IDLE, 0, {}});
+    return true;
+}
+
+bool LinkMonitor::remove(const Yeelight *bulb) {
+    for (auto entry = entries.begin(); entry != entries.end(); ++entry) {
+        if (entry->bulb == bulb) {
+            entry->pending.forget();
+            entries.erase(entry);
+            return true;
+        }
+    }
+    return false;
+}
+
+void LinkMonitor::begin() {
+#if defined(ESP32)
+    WiFi.onEvent(on_wifi_event);
+#endif
+}
+
+void LinkMonitor::set_link(const bool up) {
+    if (up == Yeelight::is_link_up()) {
+        return;
+    }
+    Yeelight::set_link_up(up);
+    const uint32_t now = millis();
+    uint32_t due = now;
+    for (link_entry &entry: entries) {
+        entry.pending.forget();
+        entry.state = up ? RESUME_WAITING : RESUME_IDLE;
+        entry.due = due;
+        due += stagger;
+    }
+    if (callback != nullptr) {
+        callback(arg, up);
+    }
+}
+
+void LinkMonitor::on_event(const EventCallback callback, void *arg) {
+    this->callback = callback;
+    this->arg = arg;
+}
+
+void LinkMonitor::set_stagger(const uint32_t stagger) {
+    this->stagger = stagger;
+}
+
+void LinkMonitor::set_timeout(const uint32_t timeout) {
+    this->timeout = timeout;
+}
+
+uint16_t LinkMonitor::loop() {
+#if defined(ESP32)
+    const int8_t link = wifi_link;
+    if (link >= 0) {
+        set_link(link == 1);
+    }
+#endif
+    const uint32_t now = millis();
+    uint16_t resuming = 0;
+    for (link_entry &entry: entries) {
+        Yeelight *bulb = entry.bulb;
+        const bool connected = bulb->is_connected() || bulb->is_connected_music();
+        switch (entry.state) {
+            case RESUME_IDLE: break;
+            case RESUME_WAITING:
+                if (static_cast<int32_t>(now - entry.due) < 0) {
+                    break;
+                }
+                if (!connected && !bulb->is_connecting()) {
+                    bulb->reconnect();
+                }
+                entry.state = RESUME_CONNECTING;
+                entry.due = now + timeout;
+                break;
+            case RESUME_CONNECTING:
+                if (connected) {
+                    std::vector<uint16_t> ids;
+                    bulb->flush_deferred(ids);
+                    for (const uint16_t id: ids) {
+                        entry.pending.add(bulb, id);
+                    }
+                    entry.state = RESUME_FLUSHING;
+                    entry.due = now + timeout;
+                } else if (static_cast<int32_t>(now - entry.due) >= 0) {
+                    // Retry later, behind the devices still waiting for their turn.
+                    entry.state = RESUME_WAITING;
+                    entry.due = now + timeout;
+                }
+                break;
+            case RESUME_FLUSHING:
+                if (entry.pending.poll() == 0 || static_cast<int32_t>(now - entry.due) >= 0) {
+                    entry.pending.forget();
+                    entry.state = RESUME_IDLE;
+                }
+                break;
+        }
+        resuming += entry.state != RESUME_IDLE;
+    }
+    return resuming;
+}
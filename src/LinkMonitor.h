@@ -0,0 +1,107 @@
+#ifndef YEELIGHTARDUINO_LINKMONITOR_H
+#define YEELIGHTARDUINO_LINKMONITOR_H
+
+#include <Yeelight.h>
+#include <PendingResponses.h>
+
+/**
+ * @class LinkMonitor
+ * @brief Pauses every device while the controller's network link is down and resumes them gradually.
+ *
+ * On ESP32, begin() subscribes to the station Wi-Fi events; elsewhere, or with another network interface,
+ * the link state is reported with set_link. While the link is down, devices neither reconnect nor retry,
+ * and their state commands are kept and coalesced (see Yeelight::set_link_up). When the link comes back,
+ * the monitored devices reconnect one at a time, stagger milliseconds apart, instead of all at once; each
+ * then sends the state commands it kept, so only the latest state reaches the device.
+ */
+class LinkMonitor {
+public:
+    /**
+     * @brief Callback receiving link events.
+     * @param arg The user argument given to on_event.
+     * @param up True if the link came up, false if it went down.
+     */
+    typedef void (*EventCallback)(void *arg, bool up);
+
+    /**
+     * @brief Constructs a link monitor.
+     * @param capacity The number of devices to reserve memory for.
+     */
+    explicit LinkMonitor(uint16_t capacity = 16);
+
+    /**
+     * @brief Adds a device to resume when the link comes back.
+     * @param bulb The device.
+     * @return True if the device was added, false if it was already monitored.
+     */
+    bool add(Yeelight *bulb);
+
+    /**
+     * @brief Stops resuming a device.
+     * @param bulb The device to remove.
+     * @return True if the device was removed, false if it was not monitored.
+     */
+    bool remove(const Yeelight *bulb);
+
+    /**
+     * @brief Subscribes to the station Wi-Fi events (ESP32 only; elsewhere it does nothing).
+     */
+    void begin();
+
+    /**
+     * @brief Reports the state of the network link.
+     * @param up True if the link is up, false if it is down.
+     */
+    void set_link(bool up);
+
+    /**
+     * @brief Sets the callback receiving link events.
+     * @param callback The callback, or nullptr for none.
+     * @param arg A user argument passed to the callback.
+     */
+    void on_event(EventCallback callback, void *arg = nullptr);
+
+    /**
+     * @brief Sets the delay between the reconnections of two devices after the link comes back.
+     * @param stagger The delay in milliseconds.
+     */
+    void set_stagger(uint32_t stagger);
+
+    /**
+     * @brief Sets how long a device may take to reconnect, or to answer its kept commands, before the
+     * attempt is abandoned (a failed reconnection is retried).
+     * @param timeout The timeout in milliseconds.
+     */
+    void set_timeout(uint32_t timeout);
+
+    /**
+     * @brief Applies Wi-Fi events and advances the resumption of the devices.
+     * @return The number of devices still being resumed.
+     */
+    uint16_t loop();
+
+private:
+    enum resume_state
+    {
+        RESUME_IDLE,
+        RESUME_WAITING,
+        RESUME_CONNECTING,
+        RESUME_FLUSHING
+    };
+
+    struct link_entry
+    {
+        Yeelight *bulb;
+        resume_state state;
+        uint32_t due;
+        PendingResponses pending;
+    };
+
+    std::vector<link_entry> entries;
+    EventCallback callback = nullptr;
+    void *arg = nullptr;
+    uint32_t stagger = 50;
+    uint32_t timeout = 5000;
+};
+
+#endif
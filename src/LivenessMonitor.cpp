@@ -0,0 +1,174 @@
+#include "LivenessMonitor.h"
+
+LivenessMonitor::LivenessMonitor(const uint16_t capacity) : entries(capacity) {
+}
+
+bool LivenessMonitor::add(Yeelight *bulb) {
+    if (bulb == nullptr) {
+        return false;
+    }
+    for (liveness_entry &entry: entries) {
+        if (entry.bulb != nullptr) {
+            continue;
+        }
+        const uint32_t now = millis();
+        entry.bulb = bulb;
+        entry.online = true;
+        entry.failures = 0;
+        entry.probe = 0;
+        entry.interval = min_interval;
+        entry.next_probe = now + min_interval;
+        entry.activity = bulb->get_last_activity();
+        entry.connected = bulb->is_connected() || bulb->is_connected_music();
+        entry.disconnected_at = now;
+        bulb->set_online(true);
+        bulb->set_keepalive(keepalive);
+        return true;
+    }
+    return false;
+}
+
+bool LivenessMonitor::remove(Yeelight *bulb) {
+    for (liveness_entry &entry: entries) {
+        if (entry.bulb == bulb && bulb != nullptr) {
+            if (entry.probe != 0) {
+                bulb->forget_response(entry.probe);
+            }
+            bulb->set_online(true);
+            entry.bulb = nullptr;
+            return true;
+        }
+    }
+    return false;
+}
+
+void LivenessMonitor::on_event(const EventCallback callback, void *arg) {
+    this->callback = callback;
+    this->arg = arg;
+}
+
+void LivenessMonitor::set_probe_interval(const uint32_t min_interval, const uint32_t max_interval) {
+    this->min_interval = min_interval == 0 ? 1 : min_interval;
+    this->max_interval = max_interval < this->min_interval ? this->min_interval : max_interval;
+}
+
+void LivenessMonitor::set_probe_timeout(const uint32_t timeout) {
+    probe_timeout = timeout;
+}
+
+void LivenessMonitor::set_max_failures(const uint8_t failures) {
+    max_failures = failures == 0 ? 1 : failures;
+}
+
+void LivenessMonitor::set_keepalive(const uint32_t interval) {
+    keepalive = interval;
+}
+
+bool LivenessMonitor::is_online(const Yeelight *bulb) const {
+    for (const liveness_entry &entry: entries) {
+        if (entry.bulb == bulb && bulb != nullptr) {
+            return entry.online;
+        }
+    }
+    return false;
+}
+
+uint16_t LivenessMonitor::loop() {
+    const uint32_t now = millis();
+    uint16_t online = 0;
+    for (liveness_entry &entry: entries) {
+        Yeelight *bulb = entry.bulb;
+        if (bulb == nullptr) {
+            continue;
+        }
+        if (!Yeelight::is_link_up()) {
+            // Without a link nothing can be learned about the device: its state is held until the link is back.
+            if (entry.probe != 0) {
+                bulb->forget_response(entry.probe);
+                entry.probe = 0;
+            }
+            entry.connected = false;
+            entry.disconnected_at = now;
+            entry.next_probe = now + entry.interval;
+            online += entry.online;
+            continue;
+        }
+        if (entry.probe != 0 && bulb->poll_response(entry.probe) != PENDING) {
+            // Any answer, even an error, proves the device is alive; the next probe can wait longer.
+            entry.probe = 0;
+            entry.interval = entry.interval * 2 > max_interval ? max_interval : entry.interval * 2;
+            alive(entry, now);
+        }
+        const uint32_t activity = bulb->get_last_activity();
+        if (activity != entry.activity) {
+            entry.activity = activity;
+            alive(entry, now);
+        }
+        if (bulb->is_connected() || bulb->is_connected_music()) {
+            entry.connected = true;
+        } else if (entry.connected) {
+            entry.connected = false;
+            entry.disconnected_at = now;
+        } else if (entry.online && now - entry.disconnected_at >= probe_timeout) {
+            // The connection was lost and not restored: that is enough evidence without waiting for probes.
+            entry.failures = max_failures - 1;
+            failed(entry, now);
+        }
+        if (entry.probe != 0) {
+            if (static_cast<int32_t>(now - entry.deadline) >= 0) {
+                // A late answer must not stay with the device: a recovering device would collect one per probe.
+                bulb->forget_response(entry.probe);
+                entry.probe = 0;
+                failed(entry, now);
+            }
+        } else if (static_cast<int32_t>(now - entry.next_probe) >= 0) {
+            cJSON *params = cJSON_CreateArray();
+            cJSON_AddItemToArray(params, cJSON_CreateString("power"));
+            uint16_t id;
+            if (bulb->send_command_async("get_prop", params, id) != SUCCESS) {
+                failed(entry, now);
+            } else if (id == 0) {
+                // Music mode has no replies: a frame written to the open stream is the best evidence available.
+                alive(entry, now);
+            } else {
+                entry.probe = id;
+                entry.deadline = now + probe_timeout;
+            }
+        }
+        online += entry.online;
+    }
+    return online;
+}
+
+void LivenessMonitor::alive(liveness_entry &entry, const uint32_t now) {
+    entry.failures = 0;
+    entry.next_probe = now + entry.interval;
+    set_state(entry, true);
+}
+
+void LivenessMonitor::failed(liveness_entry &entry, const uint32_t now) {
+    if (entry.failures < UINT8_MAX) {
+        entry.failures++;
+    }
+    if (entry.failures >= max_failures) {
+        set_state(entry, false);
+    }
+    // Online devices are re-probed quickly to confirm the failure; offline ones back off.
+    if (entry.online) {
+        entry.interval = min_interval;
+    } else {
+        entry.interval = entry.interval * 2 > max_interval ? max_interval : entry.interval * 2;
+    }
+    entry.next_probe = now + entry.interval;
+}
+
+void LivenessMonitor::set_state(liveness_entry &entry, const bool online) {
+    if (entry.online == online) {
+        return;
+    }
+    entry.online = online;
+    entry.bulb->set_online(online);
+    if (callback != nullptr) {
+        callback(arg, entry.bulb, online);
+    }
+}
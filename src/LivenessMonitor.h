@@ -0,0 +1,126 @@
+#ifndef YEELIGHTARDUINO_LIVENESSMONITOR_H
+#define YEELIGHTARDUINO_LIVENESSMONITOR_H
+
+#include <Yeelight.h>
+
+/**
+ * @class LivenessMonitor
+ * @brief Tracks whether devices are reachable and raises online/offline events as soon as that changes.
+ *
+ * A device is considered alive while it sends data (responses or notifications), so busy devices are never
+ * probed. Idle devices get a cheap single-property `get_prop` probe that must be answered within the probe
+ * timeout, much shorter than the command timeout. The probe interval grows while probes succeed and drops
+ * back to the minimum after a failure. A device goes offline after max_failures failed probes, or at once
+ * when its connection is lost and not restored within the probe timeout. TCP keepalive is enabled on every
+ * monitored device, so the network stack also drops connections to devices that lost power.
+ *
+ * Offline devices are marked with Yeelight::set_online(false): their blocking commands return
+ * DEVICE_OFFLINE immediately, and they keep being probed (which also reconnects them) until they answer.
+ */
+class LivenessMonitor {
+public:
+    /**
+     * @brief Callback receiving online/offline events.
+     * @param arg The user argument given to on_event.
+     * @param bulb The device whose state changed.
+     * @param online True if the device came online, false if it went offline.
+     */
+    typedef void (*EventCallback)(void *arg, Yeelight *bulb, bool online);
+
+    /**
+     * @brief Constructs a liveness monitor.
+     * @param capacity The maximum number of devices.
+     */
+    explicit LivenessMonitor(uint16_t capacity = 16);
+
+    /**
+     * @brief Starts monitoring a device. It is assumed online until proven otherwise.
+     * @param bulb The device to monitor.
+     * @return True if the device was added, false if the monitor is full.
+     */
+    bool add(Yeelight *bulb);
+
+    /**
+     * @brief Stops monitoring a device and marks it online again.
+     * @param bulb The device to remove.
+     * @return True if the device was removed, false if it was not monitored.
+     */
+    bool remove(Yeelight *bulb);
+
+    /**
+     * @brief Sets the callback receiving online/offline events.
+     * @param callback The callback, or nullptr for none.
+     * @param arg A user argument passed to the callback.
+     */
+    void on_event(EventCallback callback, void *arg = nullptr);
+
+    /**
+     * @brief Sets the range of the adaptive probe interval.
+     * @param min_interval The interval after a failure, in milliseconds.
+     * @param max_interval The interval reached after consecutive successes, in milliseconds.
+     */
+    void set_probe_interval(uint32_t min_interval, uint32_t max_interval);
+
+    /**
+     * @brief Sets how long a probe or a reconnection may take before it counts as failed.
+     * @param timeout The timeout in milliseconds.
+     */
+    void set_probe_timeout(uint32_t timeout);
+
+    /**
+     * @brief Sets the number of consecutive failed probes after which a device goes offline.
+     * @param failures The number of failures (at least 1).
+     */
+    void set_max_failures(uint8_t failures);
+
+    /**
+     * @brief Sets the TCP keepalive interval applied to the devices added afterwards.
+     * @param interval The keepalive interval in milliseconds (0 disables keepalive).
+     */
+    void set_keepalive(uint32_t interval);
+
+    /**
+     * @brief Checks whether a monitored device is online.
+     * @param bulb The device.
+     * @return True if the device is online, false if it is offline or not monitored.
+     */
+    bool is_online(const Yeelight *bulb) const;
+
+    /**
+     * @brief Updates the state of every device, sends due probes and raises events.
+     * @return The number of online devices.
+     */
+    uint16_t loop();
+
+private:
+    struct liveness_entry
+    {
+        Yeelight *bulb;
+        bool online;
+        uint8_t failures;
+        uint16_t probe;
+        uint32_t interval;
+        uint32_t next_probe;
+        uint32_t deadline;
+        uint32_t activity;
+        bool connected;
+        uint32_t disconnected_at;
+    };
+
+    std::vector<liveness_entry> entries;
+    EventCallback callback = nullptr;
+    void *arg = nullptr;
+    uint32_t min_interval = 2000;
+    uint32_t max_interval = 30000;
+    uint32_t probe_timeout = 1000;
+    uint32_t keepalive = 5000;
+    uint8_t max_failures = 2;
+
+    void alive(liveness_entry &entry, uint32_t now);
+
+    void failed(liveness_entry &entry, uint32_t now);
+
+    void set_state(liveness_entry &entry, bool online);
+};
+
+#endif
@@ -0,0 +1,69 @@
+#include "ModelDatabase.h"
+#include <Yeelight.h>
+
+std::map<std::string, SupportedMethods> ModelDatabase::cache;
+
+struct model_entry
+{
+    const char *model;
+    const char *support;
+};
+
+#define YEELIGHT_WHITE_METHODS "get_prop set_default set_power toggle set_bright start_cf stop_cf set_scene " \
+                               "cron_add cron_get cron_del set_adjust adjust_bright set_name"
+#define YEELIGHT_COLOR_METHODS YEELIGHT_WHITE_METHODS " set_ct_abx set_rgb set_hsv adjust_ct adjust_color set_music"
+#define YEELIGHT_BG_METHODS " bg_set_rgb bg_set_hsv bg_set_ct_abx bg_start_cf bg_stop_cf bg_set_scene " \
+                            "bg_set_default bg_set_power bg_set_bright bg_set_adjust bg_toggle dev_toggle " \
+                            "bg_adjust_bright bg_adjust_ct bg_adjust_color"
+
+// The method lists advertised by common models in their discovery responses.
+static const model_entry models[] = {
+    {"mono", YEELIGHT_WHITE_METHODS},
+    {"ct_bulb", YEELIGHT_WHITE_METHODS " set_ct_abx adjust_ct set_music"},
+    {"color", YEELIGHT_COLOR_METHODS},
+    {"stripe", YEELIGHT_COLOR_METHODS},
+    {"bslamp", YEELIGHT_COLOR_METHODS},
+    {"lamp", YEELIGHT_WHITE_METHODS " set_ct_abx adjust_ct set_music"},
+    {"ceiling", YEELIGHT_WHITE_METHODS " set_ct_abx adjust_ct set_music"},
+    {"ceiling4", YEELIGHT_WHITE_METHODS " set_ct_abx adjust_ct set_music" YEELIGHT_BG_METHODS},
+    {"ceiling10", YEELIGHT_WHITE_METHODS " set_ct_abx adjust_ct set_music" YEELIGHT_BG_METHODS},
+};
+
+static const model_entry *find_model(const std::string &name) {
+    for (const model_entry &entry: models) {
+        if (name == entry.model) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+bool ModelDatabase::lookup(const char *model, SupportedMethods &methods) {
+    if (model == nullptr || model[0] == '\0') {
+        return false;
+    }
+    const std::string name = model;
+    const auto cached = cache.find(name);
+    if (cached != cache.end()) {
+        methods = cached->second;
+        return true;
+    }
+    const model_entry *entry = find_model(name);
+    if (entry == nullptr) {
+        // "color4" and "ceiling3" are generations of "color" and "ceiling".
+        const size_t end = name.find_last_not_of("0123456789");
+        entry = end == std::string::npos ? nullptr : find_model(name.substr(0, end + 1));
+    }
+    if (entry == nullptr) {
+        return false;
+    }
+    methods = Yeelight::parseSupportedMethods(entry->support);
+    cache[name] = methods;
+    return true;
+}
+
+void ModelDatabase::remember(const char *model, const SupportedMethods &methods) {
+    if (model != nullptr && model[0] != '\0') {
+        cache[model] = methods;
+    }
+}
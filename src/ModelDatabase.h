@@ -0,0 +1,38 @@
+#ifndef YEELIGHTARDUINO_MODELDATABASE_H
+#define YEELIGHTARDUINO_MODELDATABASE_H
+
+#include <map>
+#include <string>
+#include "Yeelight_enums.h"
+#include "Yeelight_structs.h"
+
+/**
+ * @class ModelDatabase
+ * @brief Knows the methods supported by each Yeelight model, so devices can be set up without discovery.
+ *
+ * Lookups first use the capabilities learned at runtime (see remember), then a built-in table of common
+ * models with the method lists they advertise. Model names with a generation suffix, such as `color4` or
+ * `ceiling10`, fall back to the base model when they are not known themselves.
+ */
+class ModelDatabase {
+public:
+    /**
+     * @brief Looks up the methods supported by a model.
+     * @param model The model name, as reported by discovery.
+     * @param methods Receives the supported methods.
+     * @return True if the model is known, false otherwise.
+     */
+    static bool lookup(const char *model, SupportedMethods &methods);
+
+    /**
+     * @brief Records the methods supported by a model, e.g. from a discovery response.
+     * @param model The model name.
+     * @param methods The supported methods.
+     */
+    static void remember(const char *model, const SupportedMethods &methods);
+
+private:
+    static std::map<std::string, SupportedMethods> cache;
+};
+
+#endif
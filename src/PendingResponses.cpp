@@ -0,0 +1,46 @@
+#include "PendingResponses.h"
+
+void PendingResponses::add(Yeelight *bulb, const uint16_t id, const size_t owner) {
+    if (bulb != nullptr && id != 0) {
+        responses.push_back({bulb, id, owner});
+    }
+}
+
+size_t PendingResponses::poll(const ResponseCallback callback, void *arg) {
+    size_t kept = 0;
+    for (const pending_response &pending: responses) {
+        const ResponseType response = pending.bulb->poll_response(pending.id);
+        if (response == PENDING) {
+            responses[kept++] = pending;
+        } else if (callback != nullptr) {
+            callback(arg, pending.owner, response);
+        }
+    }
+    responses.resize(kept);
+    return kept;
+}
+
+size_t PendingResponses::wait(const uint32_t start, const uint32_t timeout, const ResponseCallback callback,
+                              void *arg) {
+    while (!responses.empty() && millis() - start < timeout) {
+        if (poll(callback, arg) > 0) {
+            delay(1);
+        }
+    }
+    return responses.size();
+}
+
+void PendingResponses::forget(const ResponseCallback callback, void *arg) {
+    // Late replies are dropped by the devices instead of being kept for a poll that never comes.
+    for (const pending_response &pending: responses) {
+        pending.bulb->forget_response(pending.id);
+        if (callback != nullptr) {
+            callback(arg, pending.owner, TIMEOUT);
+        }
+    }
+    responses.clear();
+}
+
+size_t PendingResponses::size() const {
+    return responses.size();
+}
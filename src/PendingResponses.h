@@ -0,0 +1,76 @@
+#ifndef YEELIGHTARDUINO_PENDINGRESPONSES_H
+#define YEELIGHTARDUINO_PENDINGRESPONSES_H
+
+#include <Yeelight.h>
+
+/**
+ * @class PendingResponses
+ * @brief Tracks the responses awaited from commands sent with the asynchronous methods, on any number of
+ * devices.
+ *
+ * Each response is added with an owner index chosen by the caller (e.g. the index of the device in a scene),
+ * which is handed back to the callback when the response arrives. Responses not awaited any longer must be
+ * given up with forget(): the devices then drop the late replies instead of keeping them for a poll that
+ * never comes.
+ */
+class PendingResponses {
+public:
+    /**
+     * @brief Callback receiving a response.
+     * @param arg The user argument.
+     * @param owner The owner index given to add().
+     * @param response The response, or TIMEOUT for a response given up by forget().
+     */
+    typedef void (*ResponseCallback)(void *arg, size_t owner, ResponseType response);
+
+    /**
+     * @brief Adds a response to await.
+     * @param bulb The device the command was sent to.
+     * @param id The id of the command; 0 (no response expected, e.g. in music mode) is ignored.
+     * @param owner An index passed back to the callback.
+     */
+    void add(Yeelight *bulb, uint16_t id, size_t owner = 0);
+
+    /**
+     * @brief Checks every awaited response once, without waiting.
+     * @param callback Called for each response that arrived, which is then no longer awaited; may be nullptr.
+     * @param arg A user argument passed to the callback.
+     * @return The number of responses still awaited.
+     */
+    size_t poll(ResponseCallback callback = nullptr, void *arg = nullptr);
+
+    /**
+     * @brief Polls until every response arrived or the timeout elapsed.
+     * @param start The time the commands were sent (as returned by millis()).
+     * @param timeout The time allowed from start, in milliseconds.
+     * @param callback Called for each response that arrived; may be nullptr.
+     * @param arg A user argument passed to the callback.
+     * @return The number of responses still awaited.
+     */
+    size_t wait(uint32_t start, uint32_t timeout, ResponseCallback callback = nullptr, void *arg = nullptr);
+
+    /**
+     * @brief Gives up on every response still awaited.
+     * @param callback Called with TIMEOUT for each of them; may be nullptr.
+     * @param arg A user argument passed to the callback.
+     */
+    void forget(ResponseCallback callback = nullptr, void *arg = nullptr);
+
+    /**
+     * @brief Returns the number of responses still awaited.
+     * @return The number of responses.
+     */
+    size_t size() const;
+
+private:
+    struct pending_response
+    {
+        Yeelight *bulb;
+        uint16_t id;
+        size_t owner;
+    };
+
+    std::vector<pending_response> responses;
+};
+
+#endif
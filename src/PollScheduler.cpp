@@ -0,0 +1,159 @@
+#include "PollScheduler.h"
+
+static constexpr uint32_t BACKGROUND_PROPERTIES =
+        1UL << PROP_BG_POWER | 1UL << PROP_BG_FLOWING | 1UL << PROP_BG_CT | 1UL << PROP_BG_LMODE |
+        1UL << PROP_BG_BRIGHT | 1UL << PROP_BG_RGB | 1UL << PROP_BG_HUE | 1UL << PROP_BG_SAT;
+
+PollScheduler::PollScheduler(const uint16_t capacity, const uint32_t period)
+    : entries(capacity), wheel(capacity, 100), period(period == 0 ? 1 : period), max_staleness(this->period * 4) {
+    wheel.set_budget(1);
+}
+
+bool PollScheduler::add(Yeelight *bulb, const uint32_t mask) {
+    if (bulb == nullptr) {
+        return false;
+    }
+    for (poll_entry &entry: entries) {
+        if (entry.bulb != nullptr) {
+            continue;
+        }
+        entry.owner = this;
+        entry.bulb = bulb;
+        entry.mask = mask & Yeelight::ALL_PROPERTIES;
+        if (!bulb->getSupportedMethods().bg_set_power) {
+            entry.mask &= ~BACKGROUND_PROPERTIES;
+        }
+        entry.last_full = millis() - max_staleness;
+        entry.request = 0;
+        entry.failures = 0;
+        // Golden-ratio phases: every prefix of the sequence is spread almost evenly over the period.
+        const uint32_t fraction = added++ * 2654435769UL;
+        const auto phase = static_cast<uint32_t>(static_cast<uint64_t>(fraction) * period >> 32);
+        entry.timer = wheel.schedule(phase, on_timer, &entry);
+        return true;
+    }
+    return false;
+}
+
+bool PollScheduler::remove(const Yeelight *bulb) {
+    for (poll_entry &entry: entries) {
+        if (entry.bulb == bulb && bulb != nullptr) {
+            wheel.cancel(entry.timer);
+            if (entry.request != 0) {
+                entry.bulb->forget_response(entry.request);
+            }
+            entry.bulb = nullptr;
+            return true;
+        }
+    }
+    return false;
+}
+
+void PollScheduler::set_period(const uint32_t period) {
+    this->period = period == 0 ? 1 : period;
+    max_staleness = max_staleness < this->period ? this->period : max_staleness;
+}
+
+void PollScheduler::set_quiet_factor(const uint8_t factor) {
+    quiet_factor = factor == 0 ? 1 : factor;
+}
+
+void PollScheduler::set_max_staleness(const uint32_t max_staleness) {
+    this->max_staleness = max_staleness < period ? period : max_staleness;
+}
+
+void PollScheduler::set_budget(const uint16_t budget) {
+    wheel.set_budget(budget);
+}
+
+uint16_t PollScheduler::loop() {
+    const uint32_t now = millis();
+    for (poll_entry &entry: entries) {
+        if (entry.bulb != nullptr && entry.request != 0) {
+            collect(entry, now);
+        }
+    }
+    return wheel.loop();
+}
+
+uint32_t PollScheduler::get_poll_count() const {
+    return polls;
+}
+
+uint32_t PollScheduler::get_skipped_count() const {
+    return skipped;
+}
+
+void PollScheduler::on_timer(void *arg) {
+    auto *entry = static_cast<poll_entry *>(arg);
+    entry->owner->poll(*entry);
+}
+
+void PollScheduler::poll(poll_entry &entry) {
+    Yeelight *bulb = entry.bulb;
+    const uint32_t now = millis();
+    if (!Yeelight::is_link_up()) {
+        // Nothing can be polled without a link; the phases are kept so polls stay spread once it is back.
+        skipped++;
+        entry.timer = wheel.schedule(period, on_timer, &entry);
+        return;
+    }
+    // After a failure, or once per max_staleness, everything is fetched; otherwise notifications are trusted.
+    const bool full = entry.failures > 0 || now - entry.last_full >= max_staleness;
+    const uint32_t mask = full ? entry.mask : entry.mask & ~bulb->get_notified_properties();
+    if (mask == 0) {
+        skipped++;
+        reschedule(entry, now);
+        return;
+    }
+    const ResponseType response = bulb->request_properties(mask, entry.request);
+    if (response == SUCCESS) {
+        // The answer is collected by loop(); the next poll is scheduled once it arrives or times out.
+        polls++;
+        entry.sent = now;
+        entry.requested = mask;
+        entry.timer = TimingWheel::INVALID_HANDLE;
+        return;
+    }
+    if (response == METHOD_NOT_SUPPORTED) {
+        // No get_prop, or music mode: the device is not failing, it just cannot be polled right now.
+        skipped++;
+    } else if (entry.failures < UINT8_MAX) {
+        entry.failures++;
+    }
+    reschedule(entry, now);
+}
+
+void PollScheduler::collect(poll_entry &entry, const uint32_t now) {
+    const ResponseType response = entry.bulb->poll_response(entry.request);
+    if (response == PENDING) {
+        if (now - entry.sent < entry.bulb->get_timeout()) {
+            return;
+        }
+        entry.bulb->forget_response(entry.request);
+    }
+    entry.request = 0;
+    if (response == SUCCESS) {
+        entry.failures = 0;
+        entry.last_full = entry.requested == entry.mask ? entry.sent : entry.last_full;
+    } else if (entry.failures < UINT8_MAX) {
+        entry.failures++;
+    }
+    reschedule(entry, now);
+}
+
+void PollScheduler::reschedule(poll_entry &entry, const uint32_t now) {
+    uint32_t interval = period;
+    const uint32_t notification = entry.bulb->get_last_notification();
+    if (entry.failures > 0) {
+        // A device that does not answer is polled less often, not more, so a dead one costs little.
+        const uint32_t factor = entry.failures < 4 ? 1UL << entry.failures : MAX_BACKOFF;
+        interval = period > UINT32_MAX / factor ? UINT32_MAX : period * factor;
+    } else {
+        if (notification != 0 && now - notification < max_staleness) {
+            interval = period * quiet_factor;
+        }
+        interval = interval > max_staleness ? max_staleness : interval;
+    }
+    entry.timer = wheel.schedule(interval, on_timer, &entry);
+}
@@ -0,0 +1,134 @@
+#ifndef YEELIGHTARDUINO_POLLSCHEDULER_H
+#define YEELIGHTARDUINO_POLLSCHEDULER_H
+
+#include <Yeelight.h>
+#include <TimingWheel.h>
+
+/**
+ * @class PollScheduler
+ * @brief Polls the properties of many devices, spread over time and adapted to each device's activity.
+ *
+ * Each device gets its own phase in the polling period (a golden-ratio sequence, so the polls stay evenly
+ * spread however many devices are added), and its polls are timed by a TimingWheel, so a fleet never polls
+ * in bursts. A poll only requests, with a single selective `get_prop`, the properties that were not pushed
+ * by `props` notifications since the previous poll, and is skipped when nothing is left. Polls are sent
+ * with request_properties and their answers collected by later loops, so loop() never waits for a device.
+ * Devices that sent notifications recently are polled quiet_factor times less often, and devices whose
+ * last poll failed or was not answered within the device's timeout back off, up to MAX_BACKOFF times the
+ * period, until they answer again. Devices that cannot be polled (no `get_prop`, or in music mode) are not
+ * counted as failing. Every answering device still gets a full poll at least once per max_staleness, which
+ * bounds how stale any cached property can get.
+ */
+class PollScheduler {
+public:
+    /**
+     * @brief The properties polled by default: the state of the main and background light.
+     */
+    static constexpr uint32_t DEFAULT_PROPERTIES =
+            1UL << PROP_POWER | 1UL << PROP_BRIGHT | 1UL << PROP_CT | 1UL << PROP_RGB | 1UL << PROP_HUE |
+            1UL << PROP_SAT | 1UL << PROP_COLOR_MODE | 1UL << PROP_BG_POWER | 1UL << PROP_BG_BRIGHT |
+            1UL << PROP_BG_CT | 1UL << PROP_BG_RGB | 1UL << PROP_BG_LMODE;
+
+    /**
+     * @brief The most times the polling period a failing device waits between polls.
+     */
+    static constexpr uint8_t MAX_BACKOFF = 16;
+
+    /**
+     * @brief Constructs a poll scheduler.
+     * @param capacity The maximum number of devices.
+     * @param period The polling period of a device in milliseconds.
+     */
+    explicit PollScheduler(uint16_t capacity = 16, uint32_t period = 60000);
+
+    /**
+     * @brief Adds a device. Properties of the background light are only polled if the device has one.
+     * @param bulb The device to poll.
+     * @param mask The properties to poll, as a bitmask of `1 << YeelightProp` values.
+     * @return True if the device was added, false if the scheduler is full.
+     */
+    bool add(Yeelight *bulb, uint32_t mask = DEFAULT_PROPERTIES);
+
+    /**
+     * @brief Removes a device.
+     * @param bulb The device to remove.
+     * @return True if the device was removed, false if it was not added.
+     */
+    bool remove(const Yeelight *bulb);
+
+    /**
+     * @brief Sets the polling period. It applies from the next poll of each device.
+     * @param period The polling period in milliseconds.
+     */
+    void set_period(uint32_t period);
+
+    /**
+     * @brief Sets how many times less often devices sending notifications are polled.
+     * @param factor The factor (at least 1).
+     */
+    void set_quiet_factor(uint8_t factor);
+
+    /**
+     * @brief Sets the longest time between two full polls of a device.
+     * @param max_staleness The time in milliseconds (at least the polling period).
+     */
+    void set_max_staleness(uint32_t max_staleness);
+
+    /**
+     * @brief Sets the maximum number of polls sent per loop. Answers are collected without waiting.
+     * @param budget The number of polls.
+     */
+    void set_budget(uint16_t budget);
+
+    /**
+     * @brief Collects the answers that arrived and polls the devices that are due.
+     * @return The number of devices whose poll came up (including skipped polls).
+     */
+    uint16_t loop();
+
+    /**
+     * @brief Returns the number of `get_prop` commands sent.
+     * @return The number of polls sent.
+     */
+    uint32_t get_poll_count() const;
+
+    /**
+     * @brief Returns the number of polls skipped because notifications covered every property or the link
+     * was down.
+     * @return The number of polls skipped.
+     */
+    uint32_t get_skipped_count() const;
+
+private:
+    struct poll_entry
+    {
+        PollScheduler *owner;
+        Yeelight *bulb;
+        uint32_t mask;
+        uint32_t timer;
+        uint32_t last_full;
+        uint32_t sent;
+        uint32_t requested;
+        uint16_t request;
+        uint8_t failures;
+    };
+
+    std::vector<poll_entry> entries;
+    TimingWheel wheel;
+    uint32_t period;
+    uint32_t max_staleness;
+    uint8_t quiet_factor = 4;
+    uint32_t polls = 0;
+    uint32_t skipped = 0;
+    uint32_t added = 0;
+
+    static void on_timer(void *arg);
+
+    void poll(poll_entry &entry);
+
+    void collect(poll_entry &entry, uint32_t now);
+
+    void reschedule(poll_entry &entry, uint32_t now);
+};
+
+#endif
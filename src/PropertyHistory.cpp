@@ -0,0 +1,200 @@
+#include "PropertyHistory.h"
+
+static size_t write_varint(uint8_t *out, uint32_t value) {
+    size_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = static_cast<uint8_t>(value);
+    return length;
+}
+
+static uint32_t zigzag(const uint32_t delta) {
+    const auto value = static_cast<int32_t>(delta);
+    return static_cast<uint32_t>(value) << 1 ^ static_cast<uint32_t>(value >> 31);
+}
+
+static uint32_t unzigzag(const uint32_t value) {
+    return value >> 1 ^ (0 - (value & 1));
+}
+
+PropertyHistory::PropertyHistory(Yeelight *bulb, const size_t capacity, const uint32_t mask)
+    : bulb(bulb), mask(mask & Yeelight::ALL_PROPERTIES), buffer(capacity), clock_millis(millis()),
+      clock_seconds(clock_millis / 1000), clock_remainder(clock_millis % 1000) {
+    if (bulb == nullptr) {
+        return;
+    }
+    const uint32_t time = now();
+    const uint32_t synced = bulb->get_synced_properties() & this->mask;
+    const YeelightProperties properties = bulb->getProperties();
+    for (uint8_t prop = 0; prop < PROP_COUNT; prop++) {
+        if (synced & 1UL << prop) {
+            record(static_cast<YeelightProp>(prop),
+                   Yeelight::get_property_value(properties, static_cast<YeelightProp>(prop)), time);
+        }
+    }
+    bulb->set_property_callback(on_property, this);
+}
+
+PropertyHistory::~PropertyHistory() {
+    if (bulb != nullptr) {
+        bulb->set_property_callback(nullptr);
+    }
+}
+
+void PropertyHistory::record(const YeelightProp prop, const uint32_t value, const uint32_t time) {
+    if (prop >= PROP_COUNT || (mask & 1UL << prop) == 0) {
+        return;
+    }
+    if (!started) {
+        started = true;
+        base_time = time;
+        last_time = time;
+    }
+    // A change recorded out of order is stored as simultaneous with the previous one.
+    const uint32_t elapsed = static_cast<int32_t>(time - last_time) < 0 ? 0 : time - last_time;
+    uint8_t encoded[11];
+    size_t length = write_varint(encoded, elapsed);
+    encoded[length++] = static_cast<uint8_t>(prop);
+    length += write_varint(encoded + length, zigzag(value - last_values[prop]));
+    if (length > buffer.size()) {
+        return;
+    }
+    while (buffer.size() - used < length) {
+        evict();
+    }
+    for (size_t i = 0; i < length; i++) {
+        buffer[(head + used + i) % buffer.size()] = encoded[i];
+    }
+    used += length;
+    count++;
+    last_time += elapsed;
+    last_values[prop] = value;
+}
+
+size_t PropertyHistory::query(const uint32_t from, const uint32_t to, std::vector<PropertySample> &samples) const {
+    size_t found = 0;
+    history_cursor cursor = begin();
+    PropertySample sample{};
+    while (next(cursor, sample) && sample.time <= to) {
+        if (sample.time >= from) {
+            samples.push_back(sample);
+            found++;
+        }
+    }
+    return found;
+}
+
+bool PropertyHistory::value_at(const YeelightProp prop, const uint32_t time, uint32_t &value) const {
+    uint32_t result;
+    if (prop >= PROP_COUNT || downsample(prop, time, 0, 1, &result) == 0) {
+        return false;
+    }
+    value = result;
+    return true;
+}
+
+size_t PropertyHistory::downsample(const YeelightProp prop, const uint32_t from, const uint32_t step, const size_t count,
+                                   uint32_t *values) const {
+    if (prop >= PROP_COUNT) {
+        return 0;
+    }
+    history_cursor cursor = begin();
+    PropertySample sample{};
+    bool pending = next(cursor, sample);
+    bool known = (base_known & 1UL << prop) != 0;
+    uint32_t value = base_values[prop];
+    size_t found = 0;
+    // One pass over the history: the changes are applied up to each requested time in turn.
+    for (size_t i = 0; i < count; i++) {
+        const uint32_t time = from + static_cast<uint32_t>(i) * step;
+        while (pending && sample.time <= time) {
+            if (sample.prop == prop) {
+                value = sample.value;
+                known = true;
+            }
+            pending = next(cursor, sample);
+        }
+        const bool covered = started && time >= base_time && known;
+        values[i] = covered ? value : UINT32_MAX;
+        found += covered;
+    }
+    return found;
+}
+
+size_t PropertyHistory::size() const {
+    return count;
+}
+
+uint32_t PropertyHistory::get_start_time() const {
+    return base_time;
+}
+
+size_t PropertyHistory::get_used_bytes() const {
+    return used;
+}
+
+void PropertyHistory::on_property(void *arg, Yeelight *, const YeelightProp prop, const uint32_t value) {
+    auto *history = static_cast<PropertyHistory *>(arg);
+    history->record(prop, value, history->now());
+}
+
+uint32_t PropertyHistory::now() {
+    // The unsigned difference stays right across a wrap of millis(), where millis() / 1000 would jump back.
+    const uint32_t ms = millis();
+    const uint64_t elapsed = static_cast<uint64_t>(clock_remainder) + static_cast<uint32_t>(ms - clock_millis);
+    clock_millis = ms;
+    clock_seconds += static_cast<uint32_t>(elapsed / 1000);
+    clock_remainder = static_cast<uint32_t>(elapsed % 1000);
+    return clock_seconds;
+}
+
+PropertyHistory::history_cursor PropertyHistory::begin() const {
+    history_cursor cursor{head, count, base_time, {}};
+    memcpy(cursor.values, base_values, sizeof(base_values));
+    return cursor;
+}
+
+bool PropertyHistory::next(history_cursor &cursor, PropertySample &sample) const {
+    if (cursor.remaining == 0) {
+        return false;
+    }
+    cursor.time += read_varint(cursor.position);
+    const auto prop = static_cast<YeelightProp>(read_byte(cursor.position));
+    cursor.values[prop] += unzigzag(read_varint(cursor.position));
+    cursor.remaining--;
+    sample = {cursor.time, prop, cursor.values[prop]};
+    return true;
+}
+
+uint8_t PropertyHistory::read_byte(size_t &position) const {
+    const uint8_t byte = buffer[position];
+    position = position + 1 == buffer.size() ? 0 : position + 1;
+    return byte;
+}
+
+uint32_t PropertyHistory::read_varint(size_t &position) const {
+    uint32_t value = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7) {
+        const uint8_t byte = read_byte(position);
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            break;
+        }
+    }
+    return value;
+}
+
+void PropertyHistory::evict() {
+    // The oldest change is folded into the base state, which then describes the start of the history.
+    size_t position = head;
+    base_time += read_varint(position);
+    const uint8_t prop = read_byte(position);
+    base_values[prop] += unzigzag(read_varint(position));
+    base_known |= 1UL << prop;
+    const size_t length = position > head ? position - head : position + buffer.size() - head;
+    used -= length;
+    head = position;
+    count--;
+}
@@ -0,0 +1,150 @@
+#ifndef YEELIGHTARDUINO_PROPERTYHISTORY_H
+#define YEELIGHTARDUINO_PROPERTYHISTORY_H
+
+#include <Yeelight.h>
+
+/**
+ * @class PropertyHistory
+ * @brief Records the property changes of a device in a fixed amount of memory, for charts and statistics.
+ *
+ * Every change of a tracked property, whether pushed by a `props` notification (devices notify the changes
+ * made by acknowledged commands too) or read by `get_prop`, is appended to a byte ring buffer as a varint
+ * time delta in seconds, the property, and the zigzag varint delta from the previous value of that
+ * property. A brightness step takes 3 bytes, so 512 bytes hold about 170 changes. When the buffer is full
+ * the oldest changes are folded into a base state, so the value of every property remains known at any
+ * time still covered.
+ *
+ * The history starts with the cached properties that are current (see Yeelight::get_synced_properties) and
+ * takes the device's property callback (see Yeelight::set_property_callback). Changes from the device are
+ * stamped with now(), which keeps counting seconds when millis() wraps after 49.7 days.
+ */
+class PropertyHistory {
+public:
+    /**
+     * @brief The properties recorded by default: the state of the main and background light.
+     */
+    static constexpr uint32_t DEFAULT_PROPERTIES =
+            1UL << PROP_POWER | 1UL << PROP_BRIGHT | 1UL << PROP_CT | 1UL << PROP_RGB | 1UL << PROP_HUE |
+            1UL << PROP_SAT | 1UL << PROP_COLOR_MODE | 1UL << PROP_BG_POWER | 1UL << PROP_BG_BRIGHT |
+            1UL << PROP_BG_CT | 1UL << PROP_BG_RGB | 1UL << PROP_BG_LMODE;
+
+    /**
+     * @brief Constructs a history and starts recording the changes of a device.
+     * @param bulb The device, or nullptr to feed the history with record() only.
+     * @param capacity The size of the ring buffer in bytes.
+     * @param mask The properties to record, as a bitmask of `1 << YeelightProp` values.
+     */
+    explicit PropertyHistory(Yeelight *bulb, size_t capacity = 512, uint32_t mask = DEFAULT_PROPERTIES);
+
+    /**
+     * @brief Stops recording.
+     */
+    ~PropertyHistory();
+
+    PropertyHistory(const PropertyHistory &) = delete;
+
+    PropertyHistory &operator=(const PropertyHistory &) = delete;
+
+    /**
+     * @brief Records a change. Changes must be recorded in chronological order.
+     * @param prop The property.
+     * @param value The new value.
+     * @param time The time of the change in seconds.
+     */
+    void record(YeelightProp prop, uint32_t value, uint32_t time);
+
+    /**
+     * @brief Returns the time used for the changes of the device: seconds since boot, counted without wrapping.
+     * It must be called at least once every 49.7 days (recording a change calls it) to count the wraps of
+     * millis().
+     * @return The time in seconds, to compare with the times of the history.
+     */
+    uint32_t now();
+
+    /**
+     * @brief Collects the changes recorded in a time range.
+     * @param from The start of the range in seconds (inclusive).
+     * @param to The end of the range in seconds (inclusive).
+     * @param samples Receives the changes in chronological order (appended).
+     * @return The number of changes found.
+     */
+    size_t query(uint32_t from, uint32_t to, std::vector<PropertySample> &samples) const;
+
+    /**
+     * @brief Gets the value a property had at a given time.
+     * @param prop The property.
+     * @param time The time in seconds.
+     * @param value Receives the value.
+     * @return True if the value is known, false if the time is older than the history or the property was
+     * never recorded before it.
+     */
+    bool value_at(YeelightProp prop, uint32_t time, uint32_t &value) const;
+
+    /**
+     * @brief Reads a property at evenly spaced times, e.g. one value per chart column.
+     * @param prop The property.
+     * @param from The time of the first value in seconds.
+     * @param step The time between two values in seconds.
+     * @param count The number of values.
+     * @param values Receives the values (UINT32_MAX where unknown).
+     * @return The number of known values.
+     */
+    size_t downsample(YeelightProp prop, uint32_t from, uint32_t step, size_t count, uint32_t *values) const;
+
+    /**
+     * @brief Returns the number of changes held in the buffer.
+     * @return The number of changes.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Returns the time from which the history is complete.
+     * @return The time in seconds of the oldest change held, or of the last change folded into the base.
+     */
+    uint32_t get_start_time() const;
+
+    /**
+     * @brief Returns the number of bytes used in the buffer.
+     * @return The number of bytes.
+     */
+    size_t get_used_bytes() const;
+
+private:
+    struct history_cursor
+    {
+        size_t position;
+        size_t remaining;
+        uint32_t time;
+        uint32_t values[PROP_COUNT];
+    };
+
+    Yeelight *bulb;
+    uint32_t mask;
+    std::vector<uint8_t> buffer;
+    size_t head = 0;
+    size_t used = 0;
+    size_t count = 0;
+    uint32_t base_time = 0;
+    uint32_t base_known = 0;
+    uint32_t base_values[PROP_COUNT] = {};
+    uint32_t last_time = 0;
+    uint32_t last_values[PROP_COUNT] = {};
+    bool started = false;
+    uint32_t clock_millis;
+    uint32_t clock_seconds;
+    uint32_t clock_remainder;
+
+    static void on_property(void *arg, Yeelight *bulb, YeelightProp prop, uint32_t value);
+
+    history_cursor begin() const;
+
+    bool next(history_cursor &cursor, PropertySample &sample) const;
+
+    uint8_t read_byte(size_t &position) const;
+
+    uint32_t read_varint(size_t &position) const;
+
+    void evict();
+};
+
+#endif
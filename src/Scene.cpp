@@ -0,0 +1,111 @@
+#include "Scene.h"
+
+Scene::Scene(const size_t capacity) {
+    entries.reserve(capacity);
+}
+
+size_t Scene::add(Yeelight *bulb, const LightState &state, const LightType lightType) {
+    entries.push_back({bulb, lightType, SUCCESS, SUCCESS, {}});
+    const size_t index = entries.size() - 1;
+    set(index, state);
+    return index;
+}
+
+size_t Scene::add(Yeelight *bulb, const LightState &from, const LightState &to, const LightType lightType) {
+    entries.push_back({bulb, lightType, SUCCESS, SUCCESS, {}});
+    entries.back().compiled = compile(entries.back(), to, &from);
+    return entries.size() - 1;
+}
+
+bool Scene::set(const size_t index, const LightState &state) {
+    if (index >= entries.size()) {
+        return false;
+    }
+    entries[index].compiled = compile(entries[index], state);
+    return entries[index].compiled == SUCCESS;
+}
+
+size_t Scene::size() const {
+    return entries.size();
+}
+
+void Scene::clear() {
+    entries.clear();
+}
+
+size_t Scene::apply(const uint32_t timeout) {
+    const uint32_t start = millis();
+    // Every frame is written before any response is awaited, so the devices change together.
+    for (size_t index = 0; index < entries.size(); index++) {
+        scene_entry &entry = entries[index];
+        entry.outcome = entry.compiled;
+        if (entry.outcome != SUCCESS) {
+            continue;
+        }
+        for (const CommandFrame &frame: entry.frames) {
+            uint16_t id;
+            const ResponseType response = entry.bulb->send_frame_async(frame, id);
+            if (response != SUCCESS) {
+                entry.outcome = response;
+                break;
+            }
+            pending.add(entry.bulb, id, index);
+        }
+    }
+    // The first failure of a device is its outcome; the responses still missing at the deadline are TIMEOUT.
+    const PendingResponses::ResponseCallback record = [](void *arg, const size_t index, const ResponseType response) {
+        scene_entry &entry = static_cast<Scene *>(arg)->entries[index];
+        if (response != SUCCESS && entry.outcome == SUCCESS) {
+            entry.outcome = response;
+        }
+    };
+    pending.wait(start, timeout, record, this);
+    apply_time = millis() - start;
+    pending.forget(record, this);
+    size_t succeeded = 0;
+    for (const scene_entry &entry: entries) {
+        succeeded += entry.outcome == SUCCESS;
+    }
+    return succeeded;
+}
+
+ResponseType Scene::get_outcome(const size_t index) const {
+    return index < entries.size() ? entries[index].outcome : DEVICE_NOT_FOUND;
+}
+
+uint32_t Scene::get_apply_time() const {
+    return apply_time;
+}
+
+ResponseType Scene::compile(scene_entry &entry, const LightState &state, const LightState *from) {
+    entry.frames.clear();
+    if (entry.bulb == nullptr) {
+        return DEVICE_NOT_FOUND;
+    }
+    const bool same = from != nullptr && same_color(*from, state) && from->bright == state.bright;
+    if (from != nullptr && from->power == state.power && (same || !state.power)) {
+        return SUCCESS;
+    }
+    // The device serializes the commands it would send, with its own channel and capability handling.
+    entry.bulb->set_capture(&entry.frames);
+    ResponseType response;
+    if (!state.power) {
+        response = entry.bulb->set_power(false, entry.light_type);
+    } else if (same) {
+        response = entry.bulb->set_power(true, entry.light_type);
+    } else if (from != nullptr && from->power && same_color(*from, state)) {
+        response = entry.bulb->set_brightness(state.bright, entry.light_type);
+    } else if (state.color_mode == COLOR_MODE_COLOR_TEMPERATURE) {
+        response = entry.bulb->set_scene_color_temperature(state.ct, state.bright, entry.light_type);
+    } else if (state.color_mode == COLOR_MODE_HSV) {
+        response = entry.bulb->set_scene_hsv(state.hue, state.sat, state.bright, entry.light_type);
+    } else {
+        response = entry.bulb->set_scene_rgb(state.rgb >> 16 & 0xFF, state.rgb >> 8 & 0xFF, state.rgb & 0xFF,
+                                             state.bright, entry.light_type);
+    }
+    entry.bulb->set_capture(nullptr);
+    if (response != SUCCESS) {
+        entry.frames.clear();
+    }
+    return response;
+}
@@ -0,0 +1,104 @@
+#ifndef YEELIGHTARDUINO_SCENE_H
+#define YEELIGHTARDUINO_SCENE_H
+
+#include <Yeelight.h>
+#include <PendingResponses.h>
+
+/**
+ * @class Scene
+ * @brief Applies a stored state to many devices at once, such as a "Movie" or "Dinner" scene.
+ *
+ * Each target is compiled once, when it is set, into the cheapest commands for its device: `set_power` to
+ * switch a channel off, otherwise a single `set_scene` that sets the color and brightness and switches the
+ * channel on. apply() writes the frames of every device before waiting for any response, so the whole scene
+ * changes within about one round trip, whatever the number of devices.
+ */
+class Scene {
+public:
+    /**
+     * @brief Constructs an empty scene.
+     * @param capacity The number of devices to reserve memory for.
+     */
+    explicit Scene(size_t capacity = 0);
+
+    /**
+     * @brief Adds a device and its target state.
+     * @param bulb The device.
+     * @param state The target state of the channel.
+     * @param lightType The light channel to set.
+     * @return The index of the device in the scene.
+     */
+    size_t add(Yeelight *bulb, const LightState &state, LightType lightType = AUTO);
+
+    /**
+     * @brief Adds a device whose current state is known, so only what differs is sent.
+     *
+     * A channel that is already in the target state gets no command. A change of power only, or of
+     * brightness only, is sent with `set_power` or `set_bright`; anything else is a single `set_scene`.
+     *
+     * @param bulb The device.
+     * @param from The current state of the channel.
+     * @param to The target state of the channel.
+     * @param lightType The light channel to set (MAIN_LIGHT or BACKGROUND_LIGHT).
+     * @return The index of the device in the scene.
+     */
+    size_t add(Yeelight *bulb, const LightState &from, const LightState &to, LightType lightType);
+
+    /**
+     * @brief Replaces the target state of a device.
+     * @param index The index of the device.
+     * @param state The new target state.
+     * @return True if the state was compiled, false for an unknown index or an invalid state.
+     */
+    bool set(size_t index, const LightState &state);
+
+    /**
+     * @brief Returns the number of devices in the scene.
+     * @return The number of devices.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Removes all devices from the scene.
+     */
+    void clear();
+
+    /**
+     * @brief Sends the scene to every device and waits for their responses.
+     * @param timeout The maximum time to wait for the responses, in milliseconds.
+     * @return The number of devices that applied the scene successfully.
+     */
+    size_t apply(uint32_t timeout = 1000);
+
+    /**
+     * @brief Returns the outcome of the last apply() for a device.
+     * @param index The index of the device.
+     * @return SUCCESS, the first error reported for the device, TIMEOUT if it did not answer in time, or
+     * DEVICE_NOT_FOUND for an unknown index.
+     */
+    ResponseType get_outcome(size_t index) const;
+
+    /**
+     * @brief Returns the duration of the last apply().
+     * @return The time from the first frame written to the last response received, in milliseconds.
+     */
+    uint32_t get_apply_time() const;
+
+private:
+    struct scene_entry
+    {
+        Yeelight *bulb;
+        LightType light_type;
+        ResponseType compiled;
+        ResponseType outcome;
+        std::vector<CommandFrame> frames;
+    };
+
+    std::vector<scene_entry> entries;
+    PendingResponses pending;
+    uint32_t apply_time = 0;
+
+    static ResponseType compile(scene_entry &entry, const LightState &state, const LightState *from = nullptr);
+};
+
+#endif
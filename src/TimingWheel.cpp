@@ -0,0 +1,208 @@
+#include "TimingWheel.h"
+
+static constexpr uint8_t SLOT_BITS = 6;
+static constexpr uint16_t NONE = 0xFFFF;
+static constexpr uint16_t DISPATCHING = 0xFFFE;
+static constexpr uint16_t READY = TimingWheel::LEVELS * TimingWheel::SLOTS;
+static constexpr uint32_t MAX_DELTA = (1UL << SLOT_BITS * TimingWheel::LEVELS) - 1;
+// Keeps expiries within half the tick counter range, so that wrapped comparisons stay valid.
+static constexpr uint32_t MAX_TICKS = 1UL << 30;
+
+static_assert(TimingWheel::SLOTS == 1 << SLOT_BITS, "SLOTS must match SLOT_BITS");
+
+TimingWheel::TimingWheel(const uint16_t capacity, const uint16_t tick)
+    : nodes(capacity > DISPATCHING - 1 ? DISPATCHING - 1 : capacity), heads(READY + 1, NONE),
+      tails(READY + 1, NONE), free_list(NONE), tick(tick == 0 ? 1 : tick) {
+    for (auto i = static_cast<uint16_t>(nodes.size()); i-- > 0;) {
+        nodes[i].next = free_list;
+        nodes[i].list = NONE;
+        nodes[i].generation = 1;
+        free_list = i;
+    }
+}
+
+uint32_t TimingWheel::schedule(const uint32_t delay, const Callback callback, void *arg, const uint32_t period) {
+    if (callback == nullptr || free_list == NONE) {
+        return INVALID_HANDLE;
+    }
+    const uint16_t index = free_list;
+    free_list = nodes[index].next;
+    timer_node &node = nodes[index];
+    node.expiry = current + to_ticks(delay);
+    node.period = to_ticks(period);
+    node.callback = callback;
+    node.arg = arg;
+    insert(index);
+    pending++;
+    return static_cast<uint32_t>(node.generation) << 16 | index;
+}
+
+bool TimingWheel::cancel(const uint32_t handle) {
+    if (!is_pending(handle)) {
+        return false;
+    }
+    const uint16_t index = handle & 0xFFFF;
+    if (nodes[index].list != DISPATCHING) {
+        unlink(index);
+    }
+    release(index);
+    return true;
+}
+
+bool TimingWheel::is_pending(const uint32_t handle) const {
+    const uint16_t index = handle & 0xFFFF;
+    return index < nodes.size() && nodes[index].generation == handle >> 16 && nodes[index].list != NONE;
+}
+
+uint16_t TimingWheel::size() const {
+    return pending;
+}
+
+uint16_t TimingWheel::loop() {
+    return loop(millis());
+}
+
+uint16_t TimingWheel::loop(const uint32_t now) {
+    if (!started) {
+        started = true;
+        last_time = now;
+    }
+    uint32_t elapsed = (now - last_time) / tick;
+    if (pending == 0) {
+        // Nothing can expire, so the empty ticks are skipped at once.
+        current += elapsed;
+        last_time += elapsed * tick;
+        elapsed = 0;
+    }
+    for (; elapsed > 0; elapsed--) {
+        advance();
+        last_time += tick;
+    }
+    uint16_t dispatched = 0;
+    while (dispatched < budget && heads[READY] != NONE) {
+        const uint16_t index = heads[READY];
+        unlink(index);
+        timer_node &node = nodes[index];
+        node.list = DISPATCHING;
+        const uint16_t generation = node.generation;
+        node.callback(node.arg);
+        dispatched++;
+        // The callback may have cancelled the timer, or cancelled it and reused its node.
+        if (node.generation != generation || node.list != DISPATCHING) {
+            continue;
+        }
+        if (node.period == 0) {
+            release(index);
+            continue;
+        }
+        node.expiry += node.period;
+        if (static_cast<int32_t>(node.expiry - current) < 0) {
+            // Fell behind by more than a period: skip the missed runs instead of running them back to back.
+            node.expiry = current;
+        }
+        insert(index);
+    }
+    return dispatched;
+}
+
+void TimingWheel::set_budget(const uint16_t budget) {
+    this->budget = budget == 0 ? 1 : budget;
+}
+
+uint32_t TimingWheel::to_ticks(const uint32_t milliseconds) const {
+    const uint32_t ticks = milliseconds / tick + (milliseconds % tick != 0);
+    return ticks > MAX_TICKS ? MAX_TICKS : ticks;
+}
+
+void TimingWheel::push(const uint16_t list, const uint16_t index) {
+    timer_node &node = nodes[index];
+    node.list = list;
+    node.next = NONE;
+    node.prev = tails[list];
+    if (tails[list] == NONE) {
+        heads[list] = index;
+    } else {
+        nodes[tails[list]].next = index;
+    }
+    tails[list] = index;
+}
+
+void TimingWheel::unlink(const uint16_t index) {
+    timer_node &node = nodes[index];
+    if (node.prev == NONE) {
+        heads[node.list] = node.next;
+    } else {
+        nodes[node.prev].next = node.next;
+    }
+    if (node.next == NONE) {
+        tails[node.list] = node.prev;
+    } else {
+        nodes[node.next].prev = node.prev;
+    }
+}
+
+void TimingWheel::insert(const uint16_t index) {
+    const uint32_t expiry = nodes[index].expiry;
+    const int32_t delta = static_cast<int32_t>(expiry - current);
+    if (delta <= 0) {
+        // Already due: the slot of the current tick is the next one processed.
+        push(current & (SLOTS - 1), index);
+        return;
+    }
+    // Timers beyond the range of the wheel wait in the farthest slot and are redistributed from there.
+    const uint32_t target = static_cast<uint32_t>(delta) > MAX_DELTA ? current + MAX_DELTA : expiry;
+    const uint32_t distance = target - current;
+    uint8_t level = 0;
+    while (level < LEVELS - 1 && distance >= 1UL << SLOT_BITS * (level + 1)) {
+        level++;
+    }
+    push(level * SLOTS + (target >> SLOT_BITS * level & (SLOTS - 1)), index);
+}
+
+void TimingWheel::cascade(const uint8_t level) {
+    const uint16_t list = level * SLOTS + (current >> SLOT_BITS * level & (SLOTS - 1));
+    uint16_t index = heads[list];
+    heads[list] = NONE;
+    tails[list] = NONE;
+    while (index != NONE) {
+        const uint16_t next = nodes[index].next;
+        insert(index);
+        index = next;
+    }
+}
+
+void TimingWheel::advance() {
+    // When a level wraps around, the next slot of the level above is spread over the levels below.
+    for (uint8_t level = 1; level < LEVELS; level++) {
+        if ((current >> SLOT_BITS * (level - 1) & (SLOTS - 1)) != 0) {
+            break;
+        }
+        cascade(level);
+    }
+    const uint16_t list = current & (SLOTS - 1);
+    if (heads[list] != NONE) {
+        // Every timer of the slot expires in this tick; the whole batch moves to the ready queue at once.
+        for (uint16_t index = heads[list]; index != NONE; index = nodes[index].next) {
+            nodes[index].list = READY;
+        }
+        if (tails[READY] == NONE) {
+            heads[READY] = heads[list];
+        } else {
+            nodes[tails[READY]].next = heads[list];
+            nodes[heads[list]].prev = tails[READY];
+        }
+        tails[READY] = tails[list];
+        heads[list] = NONE;
+        tails[list] = NONE;
+    }
+    current++;
+}
+
+void TimingWheel::release(const uint16_t index) {
+    timer_node &node = nodes[index];
+    node.list = NONE;
+    node.generation = node.generation == 0xFFFF ? 1 : node.generation + 1;
+    node.next = free_list;
+    free_list = index;
+    pending--;
+}
@@ -0,0 +1,144 @@
+#ifndef YEELIGHTARDUINO_TIMINGWHEEL_H
+#define YEELIGHTARDUINO_TIMINGWHEEL_H
+
+#include <Arduino.h>
+#include <vector>
+
+/**
+ * @class TimingWheel
+ * @brief Schedules many timed callbacks (schedules, fades, retries, polling) with constant cost per tick.
+ *
+ * Timers live in a hierarchical timing wheel of LEVELS levels of SLOTS slots each. The first level holds
+ * the timers of the next SLOTS ticks, and each following level covers SLOTS times the range of the one
+ * below it. Timers of an upper level are redistributed to the level below when their slot comes up, so
+ * inserting and cancelling a timer are O(1) and a tick only touches the timers that expire in it.
+ *
+ * Timer nodes come from a pool allocated once at construction. Handles combine the pool index with a
+ * generation counter, so a stale handle of a fired or cancelled timer never affects a newer timer.
+ * Expired timers are moved to a ready queue and their callbacks are run from loop(), in the caller's
+ * context, at most budget callbacks per call so that a burst of expirations is spread over several loops.
+ */
+class TimingWheel {
+public:
+    /**
+     * @brief Callback run when a timer expires.
+     * @param arg The user argument given to schedule.
+     */
+    typedef void (*Callback)(void *arg);
+
+    /**
+     * @brief The handle value that never refers to a timer.
+     */
+    static constexpr uint32_t INVALID_HANDLE = 0;
+
+    /**
+     * @brief The number of levels of the wheel.
+     */
+    static constexpr uint8_t LEVELS = 4;
+
+    /**
+     * @brief The number of slots in each level.
+     */
+    static constexpr uint8_t SLOTS = 64;
+
+    /**
+     * @brief Constructs a timing wheel.
+     * @param capacity The maximum number of pending timers (at most 65535).
+     * @param tick The resolution of the wheel in milliseconds.
+     */
+    explicit TimingWheel(uint16_t capacity = 64, uint16_t tick = 10);
+
+    /**
+     * @brief Schedules a callback.
+     *
+     * The delay and the period are rounded up to the tick resolution, so a callback never runs early and
+     * runs at most two ticks late when loop() is called often enough. Delays longer than the range of the
+     * wheel are supported and cost one extra redistribution per wheel rotation.
+     *
+     * @param delay The delay in milliseconds before the first run.
+     * @param callback The function to run.
+     * @param arg A user argument passed to the callback.
+     * @param period The interval in milliseconds between later runs, or 0 to run once.
+     * @return A handle for the timer, or INVALID_HANDLE if the pool is full.
+     */
+    uint32_t schedule(uint32_t delay, Callback callback, void *arg = nullptr, uint32_t period = 0);
+
+    /**
+     * @brief Cancels a timer. A periodic timer may cancel itself from its own callback.
+     * @param handle The handle returned by schedule.
+     * @return True if the timer was pending, otherwise false.
+     */
+    bool cancel(uint32_t handle);
+
+    /**
+     * @brief Checks whether a timer is still pending.
+     * @param handle The handle returned by schedule.
+     * @return True if the timer has not run yet (or is periodic) and was not cancelled, otherwise false.
+     */
+    bool is_pending(uint32_t handle) const;
+
+    /**
+     * @brief Returns the number of pending timers.
+     * @return The number of pending timers.
+     */
+    uint16_t size() const;
+
+    /**
+     * @brief Advances the wheel to the current time and runs the expired callbacks.
+     * @return The number of callbacks run.
+     */
+    uint16_t loop();
+
+    /**
+     * @brief Advances the wheel to a given time and runs the expired callbacks.
+     * @param now The current time in milliseconds.
+     * @return The number of callbacks run.
+     */
+    uint16_t loop(uint32_t now);
+
+    /**
+     * @brief Sets the maximum number of callbacks run per loop.
+     * @param budget The callback budget.
+     */
+    void set_budget(uint16_t budget);
+
+private:
+    struct timer_node
+    {
+        uint32_t expiry;
+        uint32_t period;
+        Callback callback;
+        void *arg;
+        uint16_t next;
+        uint16_t prev;
+        uint16_t list;
+        uint16_t generation;
+    };
+
+    std::vector<timer_node> nodes;
+    std::vector<uint16_t> heads;
+    std::vector<uint16_t> tails;
+    uint16_t free_list;
+    uint16_t pending = 0;
+    uint16_t tick;
+    uint16_t budget = 32;
+    uint32_t current = 0;
+    uint32_t last_time = 0;
+    bool started = false;
+
+    uint32_t to_ticks(uint32_t milliseconds) const;
+
+    void push(uint16_t list, uint16_t index);
+
+    void unlink(uint16_t index);
+
+    void insert(uint16_t index);
+
+    void cascade(uint8_t level);
+
+    void advance();
+
+    void release(uint16_t index);
+};
+
+#endif
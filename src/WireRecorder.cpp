@@ -0,0 +1,214 @@
+#include "WireRecorder.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(ESP32)
+#include <esp_timer.h>
+#endif
+
+static const uint8_t MAGIC[4] = {'Y', 'W', 'R', '1'};
+
+/**
+ * @brief Returns the time since boot in microseconds, without wrapping.
+ */
+static uint64_t now_us() {
+#if defined(ESP32)
+    // micros() wraps after 71 minutes; the timer it is read from does not.
+    return static_cast<uint64_t>(esp_timer_get_time());
+#else
+    return micros();
+#endif
+}
+
+static size_t write_varint(uint8_t *out, uint64_t value) {
+    size_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = static_cast<uint8_t>(value);
+    return length;
+}
+
+static bool read_varint(const uint8_t *log, const size_t size, size_t &offset, uint64_t &value) {
+    value = 0;
+    for (uint8_t shift = 0; shift < 70; shift += 7) {
+        if (offset >= size) {
+            return false;
+        }
+        const uint8_t byte = log[offset++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void put_u32(uint8_t *out, const uint32_t value) {
+    memcpy(out, &value, sizeof(value));
+}
+
+static uint32_t get_u32(const uint8_t *in) {
+    uint32_t value;
+    memcpy(&value, in, sizeof(value));
+    return value;
+}
+
+static void put_u64(uint8_t *out, const uint64_t value) {
+    memcpy(out, &value, sizeof(value));
+}
+
+static uint64_t get_u64(const uint8_t *in) {
+    uint64_t value;
+    memcpy(&value, in, sizeof(value));
+    return value;
+}
+
+WireRecorder::WireRecorder(const size_t capacity) {
+    size_t size = 64;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    mask = static_cast<uint32_t>(size - 1);
+    for (wire_ring &ring: rings) {
+        ring.bytes.resize(size);
+    }
+}
+
+void WireRecorder::copy_in(wire_ring &ring, const uint32_t position, const void *data, const size_t size) const {
+    const uint32_t start = position & mask;
+    const size_t first = std::min(size, ring.bytes.size() - start);
+    memcpy(ring.bytes.data() + start, data, first);
+    memcpy(ring.bytes.data(), static_cast<const uint8_t *>(data) + first, size - first);
+}
+
+void WireRecorder::copy_out(const wire_ring &ring, const uint32_t position, void *data, const size_t size) const {
+    const uint32_t start = position & mask;
+    const size_t first = std::min(size, ring.bytes.size() - start);
+    memcpy(data, ring.bytes.data() + start, first);
+    memcpy(static_cast<uint8_t *>(data) + first, ring.bytes.data(), size - first);
+}
+
+bool WireRecorder::record(const uint8_t kind, const uint8_t ip[4], const void *data, const size_t size,
+                          const void *more, const size_t more_size) {
+    wire_ring &ring = rings[kind & WIRE_RECEIVED];
+    const size_t total = size + (more == nullptr ? 0 : more_size);
+    const uint32_t head = ring.head.load(std::memory_order_relaxed);
+    const uint32_t tail = ring.tail.load(std::memory_order_acquire);
+    if (HEADER_SIZE + total > ring.bytes.size() - (head - tail)) {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    uint8_t header[HEADER_SIZE];
+    put_u64(header, now_us());
+    header[8] = kind;
+    memcpy(header + 9, ip, 4);
+    put_u32(header + 13, static_cast<uint32_t>(total));
+    copy_in(ring, head, header, HEADER_SIZE);
+    copy_in(ring, head + HEADER_SIZE, data, size);
+    if (more != nullptr) {
+        copy_in(ring, head + HEADER_SIZE + size, more, more_size);
+    }
+    ring.head.store(head + HEADER_SIZE + total, std::memory_order_release);
+    return true;
+}
+
+size_t WireRecorder::drain(const WireSink sink, void *arg) {
+    if (!started) {
+        sink(arg, MAGIC, sizeof(MAGIC));
+        started = true;
+    }
+    // Snapshot both rings, so that records added meanwhile wait for the next drain.
+    uint32_t tails[2], heads[2];
+    for (uint8_t i = 0; i < 2; i++) {
+        tails[i] = rings[i].tail.load(std::memory_order_relaxed);
+        heads[i] = rings[i].head.load(std::memory_order_acquire);
+    }
+    size_t count = 0;
+    while (tails[0] != heads[0] || tails[1] != heads[1]) {
+        uint8_t headers[2][HEADER_SIZE];
+        for (uint8_t i = 0; i < 2; i++) {
+            if (tails[i] != heads[i]) {
+                copy_out(rings[i], tails[i], headers[i], HEADER_SIZE);
+            }
+        }
+        uint8_t pick;
+        if (tails[0] == heads[0]) {
+            pick = 1;
+        } else if (tails[1] == heads[1]) {
+            pick = 0;
+        } else {
+            pick = get_u64(headers[1]) < get_u64(headers[0]) ? 1 : 0;
+        }
+        const uint8_t *header = headers[pick];
+        const uint64_t time = get_u64(header);
+        const uint32_t size = get_u32(header + 13);
+        // A record taken after a later one of the other ring keeps the time of the later one.
+        uint64_t delta = 0;
+        if (!timed) {
+            last_time = time;
+            timed = true;
+        } else if (time > last_time) {
+            delta = time - last_time;
+            last_time = time;
+        }
+
+        uint8_t encoded[1 + 10 + 4 + 5];
+        size_t length = 0;
+        encoded[length++] = header[8];
+        length += write_varint(encoded + length, delta);
+        memcpy(encoded + length, header + 9, 4);
+        length += 4;
+        length += write_varint(encoded + length, size);
+        sink(arg, encoded, length);
+
+        const wire_ring &ring = rings[pick];
+        const uint32_t start = (tails[pick] + HEADER_SIZE) & mask;
+        const size_t first = std::min<size_t>(size, ring.bytes.size() - start);
+        sink(arg, ring.bytes.data() + start, first);
+        if (first < size) {
+            sink(arg, ring.bytes.data(), size - first);
+        }
+        tails[pick] += HEADER_SIZE + size;
+        rings[pick].tail.store(tails[pick], std::memory_order_release);
+        count++;
+    }
+    return count;
+}
+
+uint32_t WireRecorder::get_dropped() const {
+    return rings[WIRE_SENT].dropped.load(std::memory_order_relaxed) +
+           rings[WIRE_RECEIVED].dropped.load(std::memory_order_relaxed);
+}
+
+bool WireRecorder::decode(const uint8_t *log, const size_t size, size_t &offset, WireRecord &record) {
+    if (offset == 0) {
+        if (size < sizeof(MAGIC) || memcmp(log, MAGIC, sizeof(MAGIC)) != 0) {
+            return false;
+        }
+        offset = sizeof(MAGIC);
+        record.time_us = 0;
+    }
+    if (offset >= size) {
+        return false;
+    }
+    const uint8_t kind = log[offset++];
+    uint64_t delta, length;
+    if (!read_varint(log, size, offset, delta) || size - offset < 4) {
+        return false;
+    }
+    memcpy(record.ip, log + offset, 4);
+    offset += 4;
+    if (!read_varint(log, size, offset, length) || size - offset < length) {
+        return false;
+    }
+    record.direction = (kind & WIRE_RECEIVED) != 0 ? WIRE_RECEIVED : WIRE_SENT;
+    record.music = (kind & WIRE_MUSIC) != 0;
+    record.time_us += delta;
+    record.data = log + offset;
+    record.size = static_cast<size_t>(length);
+    offset += length;
+    return true;
+}
@@ -0,0 +1,134 @@
+#ifndef YEELIGHTARDUINO_WIRERECORDER_H
+#define YEELIGHTARDUINO_WIRERECORDER_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Enumeration of the kinds of recorded traffic, stored in the low bits of each record.
+ */
+enum WireDirection
+{
+    WIRE_SENT = 0,    /**< Written to the device */
+    WIRE_RECEIVED = 1 /**< Read from the device */
+};
+
+/**
+ * @brief Flag of the records of music mode connections.
+ */
+static constexpr uint8_t WIRE_MUSIC = 2;
+
+/**
+ * @brief A record decoded from a wire log.
+ */
+struct WireRecord
+{
+    WireDirection direction; /**< Whether the data was sent or received */
+    bool music;              /**< Whether it went over the music mode connection */
+    uint64_t time_us;        /**< Time since the first record of the log in microseconds */
+    uint8_t ip[4];           /**< The address of the device */
+    const uint8_t *data;     /**< The bytes, pointing into the log */
+    size_t size;             /**< The number of bytes */
+};
+
+/**
+ * @brief Receives the bytes of a wire log as it is drained, e.g. to append them to a file or a socket.
+ * @param arg The argument given to drain().
+ * @param data The bytes.
+ * @param size The number of bytes.
+ */
+typedef void (*WireSink)(void *arg, const uint8_t *data, size_t size);
+
+/**
+ * @class WireRecorder
+ * @brief Records the traffic of devices with timestamps, for replaying it later (see Yeelight::set_recorder).
+ *
+ * Recording copies the bytes into a lock-free ring buffer, without allocating or blocking: one ring holds the
+ * frames sent, which are written by the task issuing commands, the other the data received, which AsyncTCP
+ * delivers on its own task. Each ring has a single producer and a single consumer, drain(), which merges them
+ * by time and encodes a compact log. When a ring is full the record is dropped and counted.
+ *
+ * The log starts with the magic `YWR1`, followed by records of a kind byte (WireDirection, plus WIRE_MUSIC),
+ * the varint time in microseconds since the previous record (up to 64 bits, so idle hours are kept), the
+ * device address in 4 bytes, the varint size and the bytes. Received data is kept in the chunks it arrived
+ * in, so a replay splits it the same way.
+ */
+class WireRecorder {
+public:
+    /**
+     * @brief Constructs a recorder.
+     * @param capacity The size of each ring buffer in bytes, rounded up to a power of two.
+     */
+    explicit WireRecorder(size_t capacity = 8192);
+
+    WireRecorder(const WireRecorder &) = delete;
+
+    WireRecorder &operator=(const WireRecorder &) = delete;
+
+    /**
+     * @brief Records data sent or received, in one or two parts. Called by Yeelight while recording.
+     * @param kind The WireDirection, plus WIRE_MUSIC for the music mode connection.
+     * @param ip The address of the device.
+     * @param data The bytes.
+     * @param size The number of bytes.
+     * @param more Bytes following the first ones in the same record, or nullptr.
+     * @param more_size The number of following bytes.
+     * @return False if the record was dropped because the ring buffer was full.
+     */
+    bool record(uint8_t kind, const uint8_t ip[4], const void *data, size_t size, const void *more = nullptr,
+                size_t more_size = 0);
+
+    /**
+     * @brief Encodes the records held so far into the log and frees their space. Call it regularly from one
+     * task, often enough for the ring buffers not to fill up.
+     * @param sink The function receiving the log, in pieces.
+     * @param arg The argument passed to the sink.
+     * @return The number of records drained.
+     */
+    size_t drain(WireSink sink, void *arg);
+
+    /**
+     * @brief Returns the number of records dropped because a ring buffer was full.
+     * @return The number of records.
+     */
+    uint32_t get_dropped() const;
+
+    /**
+     * @brief Decodes the next record of a log.
+     * @param log The log, starting with its magic.
+     * @param size The size of the log in bytes.
+     * @param offset The position of the next record, 0 at the start; advanced past the record.
+     * @param record Receives the record. Its time accumulates the time deltas: keep it between calls.
+     * @return True if a record was decoded, false at the end of the log or if it is malformed.
+     */
+    static bool decode(const uint8_t *log, size_t size, size_t &offset, WireRecord &record);
+
+private:
+    /**
+     * @brief The header of a record in a ring: time (8 bytes), kind, address (4 bytes) and size (4 bytes).
+     */
+    static constexpr size_t HEADER_SIZE = 17;
+
+    struct wire_ring
+    {
+        std::vector<uint8_t> bytes;
+        std::atomic<uint32_t> head{0};
+        std::atomic<uint32_t> tail{0};
+        std::atomic<uint32_t> dropped{0};
+    };
+
+    wire_ring rings[2];
+    uint32_t mask;
+    bool started = false;
+    bool timed = false;
+    uint64_t last_time = 0;
+
+    void copy_in(wire_ring &ring, uint32_t position, const void *data, size_t size) const;
+
+    void copy_out(const wire_ring &ring, uint32_t position, void *data, size_t size) const;
+};
+
+#endif
@@ -1,23 +1,94 @@
 #include "Yeelight.h"
+#include "YeelightValidation.h"
+#include "ColorTemperature.h"
+#include "BrightnessCurve.h"
+#include "WireRecorder.h"
 #include <cJSON.h>
 #include <WiFi.h>
 #include <WiFiUdp.h>
 std::map<uint32_t, Yeelight *> Yeelight::devices;
+bool Yeelight::link_up = true;
 AsyncServer *Yeelight::music_mode_server = nullptr;
 
+// Names of the properties in YeelightProp order, as used by get_prop and props notifications.
+static const char *const property_names[PROP_COUNT] = {
+    "power", "bright", "ct", "rgb", "hue", "sat", "color_mode", "flowing", "delayoff", "music_on", "name",
+    "bg_power", "bg_flowing", "bg_ct", "bg_lmode", "bg_bright", "bg_rgb", "bg_hue", "bg_sat", "nl_br", "active_mode"
+};
+
+static Color_mode to_color_mode(const int32_t mode) {
+    switch (mode) {
+        case 1: return COLOR_MODE_RGB;
+        case 2: return COLOR_MODE_COLOR_TEMPERATURE;
+        case 3: return COLOR_MODE_HSV;
+        default: return COLOR_MODE_UNKNOWN;
+    }
+}
+
+// Formats flow steps as the comma-separated expression of start_cf, converting color temperature steps to RGB
+// for channels that do not support color temperatures and mapping step brightness through the brightness curve.
+static std::string flow_to_string(const flow_expression *flow, const uint32_t size, const bool emulate_ct,
+                                  const BrightnessCurveType curve) {
+    std::string expression;
+    for (uint32_t i = 0; i < size; i++) {
+        flow_expression step = emulate_ct ? ColorTemperature::to_rgb_step(flow[i]) : flow[i];
+        if (step.brightness > 0) {
+            step.brightness = BrightnessCurve::to_device(curve, static_cast<uint8_t>(step.brightness));
+        }
+        expression += std::to_string(step.duration) + "," + std::to_string(step.mode) + "," +
+                std::to_string(step.value) + "," + std::to_string(step.brightness) + ",";
+    }
+    expression.pop_back();
+    return expression;
+}
+
+// Returns the perceived level reached by adjusting the level of a device brightness by a percentage, so that
+// relative adjustments move in even perceived steps on non-linear brightness curves.
+static uint8_t adjusted_level(const BrightnessCurveType curve, const uint8_t bright, const int8_t percentage) {
+    const int16_t level = BrightnessCurve::from_device(curve, bright) + percentage;
+    return static_cast<uint8_t>(level < 1 ? 1 : level > 100 ? 100 : level);
+}
+
 ResponseType Yeelight::checkResponse(const uint16_t id) {
     const auto start_time = millis();
     while (millis() - start_time < timeout) {
-        if (responses.count(id)) {
-            return responses[id];
+        const auto response = responses.find(id);
+        if (response != responses.end()) {
+            const ResponseType result = response->second;
+            responses.erase(response);
+            return result;
         }
         delay(10);
     }
+    // Nobody waits for the response any more: kept, it would stay in responses for good.
+    abandon_response(id);
     return TIMEOUT;
 }
 
+// The number of abandoned responses kept; beyond it the oldest is assumed lost, e.g. dropped by the network.
+static constexpr size_t MAX_ABANDONED_RESPONSES = 32;
+
+void Yeelight::abandon_response(const uint16_t id) {
+    // A closed connection brings no more replies, and reconnecting clears the set anyway.
+    if (client == nullptr || !client->connected()) {
+        return;
+    }
+    abandoned_responses.insert(id);
+    if (abandoned_responses.size() <= MAX_ABANDONED_RESPONSES) {
+        return;
+    }
+    auto oldest = abandoned_responses.begin();
+    for (auto entry = abandoned_responses.begin(); entry != abandoned_responses.end(); ++entry) {
+        if (static_cast<uint16_t>(response_id - *entry) > static_cast<uint16_t>(response_id - *oldest)) {
+            oldest = entry;
+        }
+    }
+    abandoned_responses.erase(oldest);
+}
+
 Yeelight::Yeelight(const uint8_t ip[4], const uint16_t port) : port(port), supported_methods(), timeout(5000),
-                                                               max_retry(3), response_id(1), music_mode(false) {
+                                                               max_retry(3), properties(), response_id(1),
+                                                               music_mode(false) {
     for (int i = 0; i < 4; i++) {
         this->ip[i] = ip[i];
     }
@@ -28,7 +99,8 @@ Yeelight::Yeelight(const uint8_t ip[4], const uint16_t port) : port(port), suppo
 }
 
 Yeelight::Yeelight(const YeelightDevice &device) : port(device.port), supported_methods(device.supported_methods),
-                                                   timeout(5000), max_retry(3), response_id(1), music_mode(false) {
+                                                   timeout(5000), max_retry(3), properties(), response_id(1),
+                                                   music_mode(false) {
     for (int i = 0; i < 4; i++) {
         ip[i] = device.ip[i];
     }
@@ -82,7 +154,11 @@ Yeelight::~Yeelight() {
         client = nullptr;
     }
     if (music_client) {
+        // Its disconnect callback would reconnect this object, which is going away.
+        music_client->onDisconnect(nullptr, nullptr);
+        music_client->onData(nullptr, nullptr);
         music_client->close();
+        delete music_client;
         music_client = nullptr;
     }
     if (music_mode_server) {
@@ -108,12 +184,13 @@ ResponseType Yeelight::connect() {
         closingManually = false;
         return ERROR;
     }
-    /*
-    client->onConnect([](void* arg, AsyncClient* c) {
-        auto* that = static_cast<Yeelight*>(arg);
-        that->onMainClientConnect(c);
+    client->onConnect([](void *arg, AsyncClient *c) {
+        // Keepalive can only be configured once the connection exists.
+        const auto *that = static_cast<Yeelight *>(arg);
+        if (that->keepalive_interval != 0) {
+            c->setKeepAlive(that->keepalive_interval, that->keepalive_count);
+        }
     }, this);
-    */
     client->onDisconnect([](void *arg, const AsyncClient *c) {
         auto *that = static_cast<Yeelight *>(arg);
         that->onMainClientDisconnect(c);
@@ -140,59 +217,262 @@ ResponseType Yeelight::connect() {
     return SUCCESS;
 }
 
-ResponseType Yeelight::send_command(const char *method, cJSON *params) {
+uint16_t Yeelight::next_response_id() {
+    if (response_id == 0) {
+        response_id = 1;
+    }
+    return response_id++;
+}
+
+uint16_t Yeelight::write_frame(AsyncClient *target, const char *method, const char *params, uint16_t id) {
+    if (id == 0) {
+        id = next_response_id();
+    }
+    // Assigning keeps the capacity of the buffer, so frames after the first do not allocate.
+    frameBuffer = "{\"id\":";
+    frameBuffer += std::to_string(id);
+    frameBuffer += ",\"method\":\"";
+    frameBuffer += method;
+    frameBuffer += "\",\"params\":";
+    frameBuffer += params;
+    frameBuffer += "}\r\n";
+    // A frame that does not fit is not written at all: the rest of a partial line would corrupt the next one.
+    if (target->space() < frameBuffer.size() ||
+        target->write(frameBuffer.data(), frameBuffer.size()) != frameBuffer.size()) {
+        return 0;
+    }
+    if (recorder != nullptr) {
+        recorder->record(target == music_client ? WIRE_SENT | WIRE_MUSIC : WIRE_SENT, ip, frameBuffer.data(),
+                         frameBuffer.size());
+    }
+    return id;
+}
+
+uint16_t Yeelight::write_command(AsyncClient *target, const char *method, cJSON *params, const uint16_t id) {
+    char *serialized = cJSON_PrintUnformatted(params);
+    cJSON_Delete(params);
+    if (serialized == nullptr) {
+        return 0;
+    }
+    const uint16_t written = write_frame(target, method, serialized, id);
+    free(serialized);
+    return written;
+}
+
+ResponseType Yeelight::send_command(const char *method, cJSON *params, const uint16_t id) {
+    if (capture != nullptr) {
+        char *serialized = cJSON_PrintUnformatted(params);
+        cJSON_Delete(params);
+        if (serialized == nullptr) {
+            return ERROR;
+        }
+        capture->push_back({method, serialized});
+        free(serialized);
+        return SUCCESS;
+    }
+    if (!online) {
+        // Marked offline by liveness monitoring: fail now instead of waiting out the timeout.
+        cJSON_Delete(params);
+        return DEVICE_OFFLINE;
+    }
+    if (!link_up) {
+        return defer_command(method, params);
+    }
     if (!music_mode) {
         uint8_t current_retries = 0;
         while (!is_connected() && current_retries < max_retry) {
             connect();
             current_retries++;
-            delay(250);
+            // Up to 250 ms per attempt, but no longer than the connection takes.
+            for (const unsigned long start = millis(); is_connecting() && millis() - start < 250;) {
+                delay(1);
+            }
         }
         if (is_connected()) {
-            cJSON *root = cJSON_CreateObject();
-            if (!root) {
-                cJSON_Delete(params);
-                return ERROR;
-            }
-            cJSON_AddNumberToObject(root, "id", response_id++);
-            cJSON_AddStringToObject(root, "method", method);
-            cJSON_AddItemToObject(root, "params", params);
-            char *command = cJSON_PrintUnformatted(root);
-            if (command == nullptr) {
-                cJSON_Delete(root);
-                return ERROR;
-            }
-            client->write(command, strlen(command));
-            client->write("\r\n", 2);
-            cJSON_Delete(root);
-            free(command);
-            return checkResponse(response_id - 1);
+            const uint16_t written = write_command(client, method, params, id);
+            return written == 0 ? ERROR : checkResponse(written);
         }
         cJSON_Delete(params);
         return CONNECTION_LOST;
     }
     if (is_connected_music()) {
-        cJSON *root = cJSON_CreateObject();
-        if (!root) {
-            cJSON_Delete(params);
-            return ERROR;
-        }
-        cJSON_AddNumberToObject(root, "id", response_id++);
-        cJSON_AddStringToObject(root, "method", method);
-        cJSON_AddItemToObject(root, "params", params);
-        char *command = cJSON_PrintUnformatted(root);
-        if (command == nullptr) {
-            cJSON_Delete(root);
-            return ERROR;
+        return write_command(music_client, method, params, id) == 0 ? ERROR : SUCCESS;
+    }
+    cJSON_Delete(params);
+    return CONNECTION_LOST;
+}
+
+ResponseType Yeelight::send_command_async(const char *method, cJSON *params, uint16_t &id) {
+    id = 0;
+    if (params == nullptr) {
+        return ERROR;
+    }
+    char *serialized = cJSON_PrintUnformatted(params);
+    cJSON_Delete(params);
+    if (serialized == nullptr) {
+        return ERROR;
+    }
+    const ResponseType response = dispatch_async(method, serialized, id);
+    free(serialized);
+    return response;
+}
+
+ResponseType Yeelight::send_frame_async(const CommandFrame &frame, uint16_t &id) {
+    id = 0;
+    if (!online) {
+        return DEVICE_OFFLINE;
+    }
+    return dispatch_async(frame.method.c_str(), frame.params.c_str(), id);
+}
+
+ResponseType Yeelight::dispatch_async(const char *method, const char *params, uint16_t &id,
+                                      const uint16_t allocated) {
+    AsyncClient *target = nullptr;
+    const ResponseType response = async_target(target);
+    if (response != SUCCESS) {
+        return response;
+    }
+    const uint16_t written = write_frame(target, method, params, allocated);
+    if (written == 0) {
+        return ERROR;
+    }
+    // Music mode has no replies: the command is sent and no id is returned.
+    id = music_mode ? 0 : written;
+    return SUCCESS;
+}
+
+ResponseType Yeelight::async_target(AsyncClient *&target) {
+    if (!link_up) {
+        return CONNECTION_LOST;
+    }
+    if (music_mode) {
+        if (!is_connected_music()) {
+            return CONNECTION_LOST;
         }
-        music_client->write(command, strlen(command));
-        music_client->write("\r\n", 2);
-        cJSON_Delete(root);
-        free(command);
+        target = music_client;
         return SUCCESS;
     }
+    if (!is_connected()) {
+        // Start reconnecting unless a connection attempt is in progress; the caller retries later.
+        if (client == nullptr) {
+            connect();
+        }
+        return CONNECTION_LOST;
+    }
+    target = client;
+    return SUCCESS;
+}
+
+ResponseType Yeelight::defer_command(const char *method, cJSON *params) {
+    static const char *const state_methods[] = {
+        "set_power", "set_bright", "set_rgb", "set_hsv", "set_ct_abx", "set_scene", "set_name"
+    };
+    // Background methods are the same methods with a "bg_" prefix.
+    const char *base = strncmp(method, "bg_", 3) == 0 ? method + 3 : method;
+    bool state = false;
+    for (const char *name: state_methods) {
+        state = state || strcmp(base, name) == 0;
+    }
+    char *serialized = state ? cJSON_PrintUnformatted(params) : nullptr;
     cJSON_Delete(params);
-    return CONNECTION_LOST;
+    if (serialized == nullptr) {
+        return CONNECTION_LOST;
+    }
+    // Only the last command of a method matters; it moves to the end so the replay order stays right.
+    for (auto frame = deferred.begin(); frame != deferred.end(); ++frame) {
+        if (frame->method == method) {
+            deferred.erase(frame);
+            break;
+        }
+    }
+    deferred.push_back({method, serialized});
+    free(serialized);
+    return PENDING;
+}
+
+void Yeelight::set_link_up(const bool up) {
+    link_up = up;
+}
+
+bool Yeelight::is_link_up() {
+    return link_up;
+}
+
+size_t Yeelight::get_deferred_count() const {
+    return deferred.size();
+}
+
+ResponseType Yeelight::flush_deferred(std::vector<uint16_t> &ids) {
+    size_t sent = 0;
+    ResponseType response = SUCCESS;
+    for (const CommandFrame &frame: deferred) {
+        uint16_t id;
+        response = send_frame_async(frame, id);
+        if (response != SUCCESS) {
+            break;
+        }
+        if (id != 0) {
+            ids.push_back(id);
+        }
+        sent++;
+    }
+    deferred.erase(deferred.begin(), deferred.begin() + static_cast<ptrdiff_t>(sent));
+    return response;
+}
+
+std::string Yeelight::render_frame(const CommandFrame &frame) {
+    std::string rendered = ",\"method\":\"";
+    rendered += frame.method;
+    rendered += "\",\"params\":";
+    rendered += frame.params;
+    rendered += "}\r\n";
+    return rendered;
+}
+
+ResponseType Yeelight::send_rendered_async(const std::string &rendered, uint16_t &id) {
+    id = 0;
+    if (!online) {
+        return DEVICE_OFFLINE;
+    }
+    AsyncClient *target = nullptr;
+    const ResponseType response = async_target(target);
+    if (response != SUCCESS) {
+        return response;
+    }
+    const uint16_t written = next_response_id();
+    char prefix[16];
+    const int length = snprintf(prefix, sizeof(prefix), "{\"id\":%u", written);
+    if (target->space() < static_cast<size_t>(length) + rendered.size()) {
+        return ERROR;
+    }
+    // Both parts go out in one segment, so the device reads a single line.
+    target->add(prefix, length);
+    target->add(rendered.data(), rendered.size());
+    target->send();
+    if (recorder != nullptr) {
+        recorder->record(target == music_client ? WIRE_SENT | WIRE_MUSIC : WIRE_SENT, ip, prefix, length,
+                         rendered.data(), rendered.size());
+    }
+    id = music_mode ? 0 : written;
+    return SUCCESS;
+}
+
+ResponseType Yeelight::poll_response(const uint16_t id) {
+    const auto response = responses.find(id);
+    if (response == responses.end()) {
+        return PENDING;
+    }
+    const ResponseType result = response->second;
+    responses.erase(response);
+    property_requests.erase(id);
+    return result;
+}
+
+void Yeelight::forget_response(const uint16_t id) {
+    property_requests.erase(id);
+    if (responses.erase(id) == 0) {
+        abandon_response(id);
+    }
 }
 
 ResponseType Yeelight::set_power_command(const bool power, const effect effect, const uint16_t duration,
@@ -200,7 +480,7 @@ ResponseType Yeelight::set_power_command(const bool power, const effect effect,
     if (!supported_methods.set_power) {
         return METHOD_NOT_SUPPORTED;
     }
-    if (duration < 30) {
+    if (!YeelightValidation::valid(SPEC_SET_POWER, duration)) {
         return INVALID_PARAMS;
     }
     cJSON *params = cJSON_CreateArray();
@@ -225,8 +505,15 @@ ResponseType Yeelight::toggle_command() {
 }
 
 ResponseType Yeelight::set_ct_abx_command(const uint16_t ct_value, const effect effect, const uint16_t duration) {
+    if (!YeelightValidation::valid(SPEC_SET_CT_ABX, ct_value, duration)) {
+        return INVALID_PARAMS;
+    }
     if (!supported_methods.set_ct_abx) {
-        return METHOD_NOT_SUPPORTED;
+        if (!supported_methods.set_rgb) {
+            return METHOD_NOT_SUPPORTED;
+        }
+        const uint32_t rgb = ColorTemperature::to_rgb(ct_value);
+        return set_rgb_command(rgb >> 16 & 0xFF, rgb >> 8 & 0xFF, rgb & 0xFF, effect, duration);
     }
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
@@ -240,6 +527,9 @@ ResponseType Yeelight::set_ct_abx_command(const uint16_t ct_value, const effect
 
 ResponseType Yeelight::set_rgb_command(const uint8_t r, const uint8_t g, const uint8_t b, const effect effect,
                                        const uint16_t duration) {
+    if (!YeelightValidation::valid(SPEC_SET_RGB, r << 16 | g << 8 | b, duration)) {
+        return INVALID_PARAMS;
+    }
     const uint32_t rgb = r << 16 | g << 8 | b;
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
@@ -253,6 +543,9 @@ ResponseType Yeelight::set_rgb_command(const uint8_t r, const uint8_t g, const u
 
 ResponseType Yeelight::set_hsv_command(const uint16_t hue, const uint8_t sat, const effect effect,
                                        const uint16_t duration) {
+    if (!YeelightValidation::valid(SPEC_SET_HSV, hue, sat, duration)) {
+        return INVALID_PARAMS;
+    }
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
         return ERROR;
@@ -265,11 +558,14 @@ ResponseType Yeelight::set_hsv_command(const uint16_t hue, const uint8_t sat, co
 }
 
 ResponseType Yeelight::set_bright_command(const uint8_t bright, const effect effect, const uint16_t duration) {
+    if (!YeelightValidation::valid(SPEC_SET_BRIGHT, bright, duration)) {
+        return INVALID_PARAMS;
+    }
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
         return ERROR;
     }
-    cJSON_AddItemToArray(params, cJSON_CreateNumber(bright));
+    cJSON_AddItemToArray(params, cJSON_CreateNumber(BrightnessCurve::to_device(brightness_curve, bright)));
     cJSON_AddItemToArray(params, cJSON_CreateString(effect == EFFECT_SMOOTH ? "smooth" : "sudden"));
     cJSON_AddItemToArray(params, cJSON_CreateNumber(duration));
     return send_command("set_bright", params);
@@ -285,18 +581,16 @@ ResponseType Yeelight::set_default() {
 
 ResponseType Yeelight::start_cf_command(const uint8_t count, const flow_action action, const uint8_t size,
                                         const flow_expression *flow) {
+    if (!YeelightValidation::valid(flow, size)) {
+        return INVALID_PARAMS;
+    }
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
         return ERROR;
     }
     cJSON_AddItemToArray(params, cJSON_CreateNumber(count));
     cJSON_AddItemToArray(params, cJSON_CreateNumber(action));
-    std::string flowExpression;
-    for (int i = 0; i < size; i++) {
-        flowExpression += std::to_string(flow[i].duration) + "," + std::to_string(flow[i].mode) + "," +
-                std::to_string(flow[i].value) + "," + std::to_string(flow[i].brightness) + ",";
-    }
-    flowExpression.pop_back();
+    const std::string flowExpression = flow_to_string(flow, size, !supported_methods.set_ct_abx, brightness_curve);
     cJSON_AddItemToArray(params, cJSON_CreateString(flowExpression.c_str()));
     return send_command("start_cf", params);
 }
@@ -310,6 +604,9 @@ ResponseType Yeelight::stop_cf_command() {
 }
 
 ResponseType Yeelight::set_scene_rgb_command(const uint8_t r, const uint8_t g, const uint8_t b, const uint8_t bright) {
+    if (!YeelightValidation::valid(SPEC_SCENE_COLOR, r << 16 | g << 8 | b, bright)) {
+        return INVALID_PARAMS;
+    }
     const uint32_t rgb = r << 16 | g << 8 | b;
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
@@ -317,11 +614,14 @@ ResponseType Yeelight::set_scene_rgb_command(const uint8_t r, const uint8_t g, c
     }
     cJSON_AddItemToArray(params, cJSON_CreateString("color"));
     cJSON_AddItemToArray(params, cJSON_CreateNumber(rgb));
-    cJSON_AddItemToArray(params, cJSON_CreateNumber(bright));
+    cJSON_AddItemToArray(params, cJSON_CreateNumber(BrightnessCurve::to_device(brightness_curve, bright)));
     return send_command("set_scene", params);
 }
 
-ResponseType Yeelight::set_scene_hsv_command(const uint8_t hue, const uint8_t sat, const uint8_t bright) {
+ResponseType Yeelight::set_scene_hsv_command(const uint16_t hue, const uint8_t sat, const uint8_t bright) {
+    if (!YeelightValidation::valid(SPEC_SCENE_HSV, hue, sat, bright)) {
+        return INVALID_PARAMS;
+    }
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
         return ERROR;
@@ -329,34 +629,47 @@ ResponseType Yeelight::set_scene_hsv_command(const uint8_t hue, const uint8_t sa
     cJSON_AddItemToArray(params, cJSON_CreateString("hsv"));
     cJSON_AddItemToArray(params, cJSON_CreateNumber(hue));
     cJSON_AddItemToArray(params, cJSON_CreateNumber(sat));
-    cJSON_AddItemToArray(params, cJSON_CreateNumber(bright));
+    cJSON_AddItemToArray(params, cJSON_CreateNumber(BrightnessCurve::to_device(brightness_curve, bright)));
     return send_command("set_scene", params);
 }
 
 ResponseType Yeelight::set_scene_ct_command(const uint16_t ct, const uint8_t bright) {
+    if (!YeelightValidation::valid(SPEC_SCENE_CT, ct, bright)) {
+        return INVALID_PARAMS;
+    }
+    if (!supported_methods.set_ct_abx) {
+        const uint32_t rgb = ColorTemperature::to_rgb(ct);
+        return set_scene_rgb_command(rgb >> 16 & 0xFF, rgb >> 8 & 0xFF, rgb & 0xFF, bright);
+    }
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
         return ERROR;
     }
     cJSON_AddItemToArray(params, cJSON_CreateString("ct"));
     cJSON_AddItemToArray(params, cJSON_CreateNumber(ct));
-    cJSON_AddItemToArray(params, cJSON_CreateNumber(bright));
+    cJSON_AddItemToArray(params, cJSON_CreateNumber(BrightnessCurve::to_device(brightness_curve, bright)));
     return send_command("set_scene", params);
 }
 
 ResponseType Yeelight::set_scene_auto_delay_off_command(const uint8_t brightness, const uint32_t duration) {
+    if (!YeelightValidation::valid(SPEC_SCENE_AUTO_DELAY_OFF, brightness, duration)) {
+        return INVALID_PARAMS;
+    }
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
         return ERROR;
     }
     cJSON_AddItemToArray(params, cJSON_CreateString("auto_delay_off"));
-    cJSON_AddItemToArray(params, cJSON_CreateNumber(brightness));
+    cJSON_AddItemToArray(params, cJSON_CreateNumber(BrightnessCurve::to_device(brightness_curve, brightness)));
     cJSON_AddItemToArray(params, cJSON_CreateNumber(duration));
     return send_command("set_scene", params);
 }
 
 ResponseType Yeelight::set_scene_cf_command(const uint32_t count, const flow_action action, const uint32_t size,
                                             const flow_expression *flow) {
+    if (!YeelightValidation::valid(flow, size)) {
+        return INVALID_PARAMS;
+    }
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
         return ERROR;
@@ -364,17 +677,15 @@ ResponseType Yeelight::set_scene_cf_command(const uint32_t count, const flow_act
     cJSON_AddItemToArray(params, cJSON_CreateString("cf"));
     cJSON_AddItemToArray(params, cJSON_CreateNumber(count));
     cJSON_AddItemToArray(params, cJSON_CreateNumber(action));
-    std::string flowExpression;
-    for (int i = 0; i < size; i++) {
-        flowExpression += std::to_string(flow[i].duration) + "," + std::to_string(flow[i].mode) + "," +
-                std::to_string(flow[i].value) + "," + std::to_string(flow[i].brightness) + ",";
-    }
-    flowExpression.pop_back();
+    const std::string flowExpression = flow_to_string(flow, size, !supported_methods.set_ct_abx, brightness_curve);
     cJSON_AddItemToArray(params, cJSON_CreateString(flowExpression.c_str()));
     return send_command("set_scene", params);
 }
 
 ResponseType Yeelight::cron_add_command(const uint32_t time) {
+    if (!YeelightValidation::valid(SPEC_CRON_ADD, time)) {
+        return INVALID_PARAMS;
+    }
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
         return ERROR;
@@ -429,7 +740,7 @@ ResponseType Yeelight::bg_set_power_command(const bool power, const effect effec
     if (!supported_methods.bg_set_power) {
         return METHOD_NOT_SUPPORTED;
     }
-    if (duration < 30) {
+    if (!YeelightValidation::valid(SPEC_SET_POWER, duration)) {
         return INVALID_PARAMS;
     }
     cJSON *params = cJSON_CreateArray();
@@ -454,8 +765,15 @@ ResponseType Yeelight::bg_toggle_command() {
 }
 
 ResponseType Yeelight::bg_set_ct_abx_command(const uint16_t ct_value, const effect effect, const uint16_t duration) {
+    if (!YeelightValidation::valid(SPEC_SET_CT_ABX, ct_value, duration)) {
+        return INVALID_PARAMS;
+    }
     if (!supported_methods.bg_set_ct_abx) {
-        return METHOD_NOT_SUPPORTED;
+        if (!supported_methods.bg_set_rgb) {
+            return METHOD_NOT_SUPPORTED;
+        }
+        const uint32_t rgb = ColorTemperature::to_rgb(ct_value);
+        return bg_set_rgb_command(rgb >> 16 & 0xFF, rgb >> 8 & 0xFF, rgb & 0xFF, effect, duration);
     }
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
@@ -469,6 +787,9 @@ ResponseType Yeelight::bg_set_ct_abx_command(const uint16_t ct_value, const effe
 
 ResponseType Yeelight::bg_set_rgb_command(const uint8_t r, const uint8_t g, const uint8_t b, const effect effect,
                                           const uint16_t duration) {
+    if (!YeelightValidation::valid(SPEC_SET_RGB, r << 16 | g << 8 | b, duration)) {
+        return INVALID_PARAMS;
+    }
     const uint32_t rgb = r << 16 | g << 8 | b;
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
@@ -482,6 +803,9 @@ ResponseType Yeelight::bg_set_rgb_command(const uint8_t r, const uint8_t g, cons
 
 ResponseType Yeelight::bg_set_hsv_command(const uint16_t hue, const uint8_t sat, const effect effect,
                                           const uint16_t duration) {
+    if (!YeelightValidation::valid(SPEC_SET_HSV, hue, sat, duration)) {
+        return INVALID_PARAMS;
+    }
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
         return ERROR;
@@ -494,11 +818,14 @@ ResponseType Yeelight::bg_set_hsv_command(const uint16_t hue, const uint8_t sat,
 }
 
 ResponseType Yeelight::bg_set_bright_command(const uint8_t bright, const effect effect, const uint16_t duration) {
+    if (!YeelightValidation::valid(SPEC_SET_BRIGHT, bright, duration)) {
+        return INVALID_PARAMS;
+    }
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
         return ERROR;
     }
-    cJSON_AddItemToArray(params, cJSON_CreateNumber(bright));
+    cJSON_AddItemToArray(params, cJSON_CreateNumber(BrightnessCurve::to_device(brightness_curve, bright)));
     cJSON_AddItemToArray(params, cJSON_CreateString(effect == EFFECT_SMOOTH ? "smooth" : "sudden"));
     cJSON_AddItemToArray(params, cJSON_CreateNumber(duration));
     return send_command("bg_set_bright", params);
@@ -514,6 +841,9 @@ ResponseType Yeelight::bg_set_default() {
 
 ResponseType
 Yeelight::bg_set_scene_rgb_command(const uint8_t r, const uint8_t g, const uint8_t b, const uint8_t bright) {
+    if (!YeelightValidation::valid(SPEC_SCENE_COLOR, r << 16 | g << 8 | b, bright)) {
+        return INVALID_PARAMS;
+    }
     const uint32_t rgb = r << 16 | g << 8 | b;
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
@@ -521,11 +851,14 @@ Yeelight::bg_set_scene_rgb_command(const uint8_t r, const uint8_t g, const uint8
     }
     cJSON_AddItemToArray(params, cJSON_CreateString("color"));
     cJSON_AddItemToArray(params, cJSON_CreateNumber(rgb));
-    cJSON_AddItemToArray(params, cJSON_CreateNumber(bright));
+    cJSON_AddItemToArray(params, cJSON_CreateNumber(BrightnessCurve::to_device(brightness_curve, bright)));
     return send_command("bg_set_scene", params);
 }
 
-ResponseType Yeelight::bg_set_scene_hsv_command(const uint8_t hue, const uint8_t sat, const uint8_t bright) {
+ResponseType Yeelight::bg_set_scene_hsv_command(const uint16_t hue, const uint8_t sat, const uint8_t bright) {
+    if (!YeelightValidation::valid(SPEC_SCENE_HSV, hue, sat, bright)) {
+        return INVALID_PARAMS;
+    }
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
         return ERROR;
@@ -533,34 +866,47 @@ ResponseType Yeelight::bg_set_scene_hsv_command(const uint8_t hue, const uint8_t
     cJSON_AddItemToArray(params, cJSON_CreateString("hsv"));
     cJSON_AddItemToArray(params, cJSON_CreateNumber(hue));
     cJSON_AddItemToArray(params, cJSON_CreateNumber(sat));
-    cJSON_AddItemToArray(params, cJSON_CreateNumber(bright));
+    cJSON_AddItemToArray(params, cJSON_CreateNumber(BrightnessCurve::to_device(brightness_curve, bright)));
     return send_command("bg_set_scene", params);
 }
 
 ResponseType Yeelight::bg_set_scene_ct_command(const uint16_t ct, const uint8_t bright) {
+    if (!YeelightValidation::valid(SPEC_SCENE_CT, ct, bright)) {
+        return INVALID_PARAMS;
+    }
+    if (!supported_methods.bg_set_ct_abx) {
+        const uint32_t rgb = ColorTemperature::to_rgb(ct);
+        return bg_set_scene_rgb_command(rgb >> 16 & 0xFF, rgb >> 8 & 0xFF, rgb & 0xFF, bright);
+    }
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
         return ERROR;
     }
     cJSON_AddItemToArray(params, cJSON_CreateString("ct"));
     cJSON_AddItemToArray(params, cJSON_CreateNumber(ct));
-    cJSON_AddItemToArray(params, cJSON_CreateNumber(bright));
+    cJSON_AddItemToArray(params, cJSON_CreateNumber(BrightnessCurve::to_device(brightness_curve, bright)));
     return send_command("bg_set_scene", params);
 }
 
 ResponseType Yeelight::bg_set_scene_auto_delay_off_command(const uint8_t brightness, const uint32_t duration) {
+    if (!YeelightValidation::valid(SPEC_SCENE_AUTO_DELAY_OFF, brightness, duration)) {
+        return INVALID_PARAMS;
+    }
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
         return ERROR;
     }
     cJSON_AddItemToArray(params, cJSON_CreateString("auto_delay_off"));
-    cJSON_AddItemToArray(params, cJSON_CreateNumber(brightness));
+    cJSON_AddItemToArray(params, cJSON_CreateNumber(BrightnessCurve::to_device(brightness_curve, brightness)));
     cJSON_AddItemToArray(params, cJSON_CreateNumber(duration));
     return send_command("bg_set_scene", params);
 }
 
 ResponseType Yeelight::bg_set_scene_cf_command(const uint32_t count, const flow_action action, const uint32_t size,
                                                const flow_expression *flow) {
+    if (!YeelightValidation::valid(flow, size)) {
+        return INVALID_PARAMS;
+    }
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
         return ERROR;
@@ -568,12 +914,7 @@ ResponseType Yeelight::bg_set_scene_cf_command(const uint32_t count, const flow_
     cJSON_AddItemToArray(params, cJSON_CreateString("cf"));
     cJSON_AddItemToArray(params, cJSON_CreateNumber(count));
     cJSON_AddItemToArray(params, cJSON_CreateNumber(action));
-    std::string flowExpression;
-    for (int i = 0; i < size; i++) {
-        flowExpression += std::to_string(flow[i].duration) + "," + std::to_string(flow[i].mode) + "," +
-                std::to_string(flow[i].value) + "," + std::to_string(flow[i].brightness) + ",";
-    }
-    flowExpression.pop_back();
+    const std::string flowExpression = flow_to_string(flow, size, !supported_methods.bg_set_ct_abx, brightness_curve);
     cJSON_AddItemToArray(params, cJSON_CreateString(flowExpression.c_str()));
     return send_command("bg_set_scene", params);
 }
@@ -609,6 +950,15 @@ ResponseType Yeelight::dev_toggle_command() {
 }
 
 ResponseType Yeelight::adjust_bright_command(const int8_t percentage, const uint16_t duration) {
+    if (!YeelightValidation::valid(SPEC_ADJUST, percentage, duration)) {
+        return INVALID_PARAMS;
+    }
+    // Only a synced brightness can be adjusted here; otherwise the device adjusts its own, linearly. The
+    // device transitions adjust_bright over its duration, as a smooth set_bright does.
+    if (brightness_curve != CURVE_LINEAR && (synced_properties & 1UL << PROP_BRIGHT) != 0) {
+        return set_bright_command(adjusted_level(brightness_curve, properties.bright, percentage), EFFECT_SMOOTH,
+                                  duration);
+    }
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
         return ERROR;
@@ -619,6 +969,9 @@ ResponseType Yeelight::adjust_bright_command(const int8_t percentage, const uint
 }
 
 ResponseType Yeelight::adjust_ct_command(const int8_t percentage, const uint16_t duration) {
+    if (!YeelightValidation::valid(SPEC_ADJUST, percentage, duration)) {
+        return INVALID_PARAMS;
+    }
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
         return ERROR;
@@ -629,6 +982,9 @@ ResponseType Yeelight::adjust_ct_command(const int8_t percentage, const uint16_t
 }
 
 ResponseType Yeelight::adjust_color_command(const int8_t percentage, const uint16_t duration) {
+    if (!YeelightValidation::valid(SPEC_ADJUST, percentage, duration)) {
+        return INVALID_PARAMS;
+    }
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
         return ERROR;
@@ -639,6 +995,13 @@ ResponseType Yeelight::adjust_color_command(const int8_t percentage, const uint1
 }
 
 ResponseType Yeelight::bg_adjust_bright_command(const int8_t percentage, const uint16_t duration) {
+    if (!YeelightValidation::valid(SPEC_ADJUST, percentage, duration)) {
+        return INVALID_PARAMS;
+    }
+    if (brightness_curve != CURVE_LINEAR && (synced_properties & 1UL << PROP_BG_BRIGHT) != 0) {
+        return bg_set_bright_command(adjusted_level(brightness_curve, properties.bg_bright, percentage),
+                                     EFFECT_SMOOTH, duration);
+    }
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
         return ERROR;
@@ -649,6 +1012,9 @@ ResponseType Yeelight::bg_adjust_bright_command(const int8_t percentage, const u
 }
 
 ResponseType Yeelight::bg_adjust_ct_command(const int8_t percentage, const uint16_t duration) {
+    if (!YeelightValidation::valid(SPEC_ADJUST, percentage, duration)) {
+        return INVALID_PARAMS;
+    }
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
         return ERROR;
@@ -659,6 +1025,9 @@ ResponseType Yeelight::bg_adjust_ct_command(const int8_t percentage, const uint1
 }
 
 ResponseType Yeelight::bg_adjust_color_command(const int8_t percentage, const uint16_t duration) {
+    if (!YeelightValidation::valid(SPEC_ADJUST, percentage, duration)) {
+        return INVALID_PARAMS;
+    }
     cJSON *params = cJSON_CreateArray();
     if (params == nullptr) {
         return ERROR;
@@ -713,355 +1082,77 @@ std::vector<YeelightDevice> Yeelight::discoverYeelightDevices(int waitTimeMs) {
 
 void Yeelight::onData(AsyncClient *c, const void *data, const size_t len) {
     const auto chunk = static_cast<const char *>(data);
+    if (recorder != nullptr) {
+        recorder->record(c != nullptr && c == music_client ? WIRE_RECEIVED | WIRE_MUSIC : WIRE_RECEIVED, ip, data,
+                         len);
+    }
+    last_activity = millis();
     partialResponse.append(chunk, len);
-    size_t pos = partialResponse.find('\n');
-    while (pos != std::string::npos) {
-        std::string line = partialResponse.substr(0, pos);
+    for (size_t pos = partialResponse.find('\n'); pos != std::string::npos; pos = partialResponse.find('\n')) {
+        // The line leaves the buffer before it is handled: property callbacks may wait for a response, which
+        // reads more data into it.
+        lineBuffer.assign(partialResponse, 0, pos);
         partialResponse.erase(0, pos + 1);
-        while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t')) {
-            line.pop_back();
-        }
-        if (!line.empty()) {
-            cJSON *root = cJSON_Parse(line.c_str());
-            if (root) {
-                if (cJSON_GetObjectItem(root, "id")) {
-                    uint16_t id = cJSON_GetObjectItem(root, "id")->valueint;
-                    if (cJSON_GetObjectItem(root, "result")) {
-                        const cJSON *result_array = cJSON_GetObjectItem(root, "result");
-                        if (result_array == nullptr) {
-                            responses[id] = UNEXPECTED_RESPONSE;
-                            cJSON_Delete(root);
-                            continue;
-                        }
-                        if (!cJSON_IsArray(result_array)) {
-                            responses[id] = UNEXPECTED_RESPONSE;
-                            cJSON_Delete(root);
-                            continue;
-                        }
-                        const cJSON *firstItem = cJSON_GetArrayItem(result_array, 0);
-                        if (firstItem && cJSON_IsString(firstItem) && strcmp(firstItem->valuestring, "ok") == 0) {
-                            responses[id] = SUCCESS;
-                        } else {
-                            if (cJSON_GetArraySize(result_array) < 21) {
-                                cJSON_Delete(root);
-                                responses[id] = UNEXPECTED_RESPONSE;
-                                continue;
-                            }
-                            const cJSON *item = cJSON_GetArrayItem(result_array, 0);
-                            if (cJSON_IsString(item)) {
-                                properties.power = strcmp(item->valuestring, "on") == 0;
-                            }
-                            item = cJSON_GetArrayItem(result_array, 1);
-                            if (cJSON_IsNumber(item)) {
-                                properties.bright = static_cast<uint8_t>(item->valuedouble);
-                            } else if (cJSON_IsString(item)) {
-                                properties.bright = static_cast<uint8_t>(atoi(item->valuestring));
-                            }
-                            item = cJSON_GetArrayItem(result_array, 2);
-                            if (cJSON_IsNumber(item)) {
-                                properties.ct = static_cast<uint16_t>(item->valuedouble);
-                            } else if (cJSON_IsString(item)) {
-                                properties.ct = static_cast<uint16_t>(atoi(item->valuestring));
-                            }
-                            item = cJSON_GetArrayItem(result_array, 3);
-                            if (cJSON_IsNumber(item)) {
-                                properties.rgb = static_cast<uint32_t>(item->valuedouble);
-                            } else if (cJSON_IsString(item)) {
-                                properties.rgb = static_cast<uint32_t>(atoi(item->valuestring));
-                            }
-                            item = cJSON_GetArrayItem(result_array, 4);
-                            if (cJSON_IsNumber(item)) {
-                                properties.hue = static_cast<uint16_t>(item->valuedouble);
-                            } else if (cJSON_IsString(item)) {
-                                properties.hue = static_cast<uint16_t>(atoi(item->valuestring));
-                            }
-                            item = cJSON_GetArrayItem(result_array, 5);
-                            if (cJSON_IsNumber(item)) {
-                                properties.sat = static_cast<uint8_t>(item->valuedouble);
-                            } else if (cJSON_IsString(item)) {
-                                properties.sat = static_cast<uint8_t>(atoi(item->valuestring));
-                            }
-                            item = cJSON_GetArrayItem(result_array, 6);
-                            if (cJSON_IsNumber(item)) {
-                                const auto cm = static_cast<uint8_t>(item->valuedouble);
-                                if (cm == 1) {
-                                    properties.color_mode = COLOR_MODE_RGB;
-                                } else if (cm == 2) {
-                                    properties.color_mode = COLOR_MODE_COLOR_TEMPERATURE;
-                                } else if (cm == 3) {
-                                    properties.color_mode = COLOR_MODE_HSV;
-                                } else {
-                                    properties.color_mode = COLOR_MODE_UNKNOWN;
-                                }
-                            } else if (cJSON_IsString(item)) {
-                                const auto cm = static_cast<uint8_t>(atoi(item->valuestring));
-                                if (cm == 1) {
-                                    properties.color_mode = COLOR_MODE_RGB;
-                                } else if (cm == 2) {
-                                    properties.color_mode = COLOR_MODE_COLOR_TEMPERATURE;
-                                } else if (cm == 3) {
-                                    properties.color_mode = COLOR_MODE_HSV;
-                                } else {
-                                    properties.color_mode = COLOR_MODE_UNKNOWN;
-                                }
-                            }
-                            item = cJSON_GetArrayItem(result_array, 7);
-                            if (cJSON_IsNumber(item)) {
-                                properties.flowing = static_cast<int>(item->valuedouble) == 1;
-                            } else if (cJSON_IsString(item)) {
-                                properties.flowing = atoi(item->valuestring) == 1;
-                            }
-                            item = cJSON_GetArrayItem(result_array, 8);
-                            if (cJSON_IsNumber(item)) {
-                                properties.delayoff = static_cast<uint8_t>(item->valuedouble);
-                            } else if (cJSON_IsString(item)) {
-                                properties.delayoff = static_cast<uint8_t>(atoi(item->valuestring));
-                            }
-                            item = cJSON_GetArrayItem(result_array, 9);
-                            if (cJSON_IsNumber(item)) {
-                                properties.music_on = static_cast<int>(item->valuedouble) == 1;
-                            } else if (cJSON_IsString(item)) {
-                                properties.music_on = atoi(item->valuestring) == 1;
-                            }
-                            item = cJSON_GetArrayItem(result_array, 10);
-                            if (cJSON_IsString(item)) {
-                                properties.name = String(item->valuestring).c_str();
-                            }
-                            item = cJSON_GetArrayItem(result_array, 11);
-                            if (cJSON_IsString(item)) {
-                                properties.bg_power = strcmp(item->valuestring, "on") == 0;
-                            }
-                            item = cJSON_GetArrayItem(result_array, 12);
-                            if (cJSON_IsNumber(item)) {
-                                properties.bg_flowing = static_cast<int>(item->valuedouble) == 1;
-                            } else if (cJSON_IsString(item)) {
-                                properties.bg_flowing = atoi(item->valuestring) == 1;
-                            }
-                            item = cJSON_GetArrayItem(result_array, 13);
-                            if (cJSON_IsNumber(item)) {
-                                properties.bg_ct = static_cast<uint16_t>(item->valuedouble);
-                            } else if (cJSON_IsString(item)) {
-                                properties.bg_ct = static_cast<uint16_t>(atoi(item->valuestring));
-                            }
-                            item = cJSON_GetArrayItem(result_array, 14);
-                            if (cJSON_IsNumber(item)) {
-                                const auto bg_lmode_int = static_cast<uint8_t>(item->valuedouble);
-                                if (bg_lmode_int == 1) {
-                                    properties.bg_color_mode = COLOR_MODE_RGB;
-                                } else if (bg_lmode_int == 2) {
-                                    properties.bg_color_mode = COLOR_MODE_COLOR_TEMPERATURE;
-                                } else if (bg_lmode_int == 3) {
-                                    properties.bg_color_mode = COLOR_MODE_HSV;
-                                } else {
-                                    properties.bg_color_mode = COLOR_MODE_UNKNOWN;
-                                }
-                            } else if (cJSON_IsString(item)) {
-                                const auto bg_lmode_int = static_cast<uint8_t>(atoi(item->valuestring));
-                                if (bg_lmode_int == 1) {
-                                    properties.bg_color_mode = COLOR_MODE_RGB;
-                                } else if (bg_lmode_int == 2) {
-                                    properties.bg_color_mode = COLOR_MODE_COLOR_TEMPERATURE;
-                                } else if (bg_lmode_int == 3) {
-                                    properties.bg_color_mode = COLOR_MODE_HSV;
-                                } else {
-                                    properties.bg_color_mode = COLOR_MODE_UNKNOWN;
-                                }
-                            }
-                            item = cJSON_GetArrayItem(result_array, 15);
-                            if (cJSON_IsNumber(item)) {
-                                properties.bg_bright = static_cast<uint8_t>(item->valuedouble);
-                            } else if (cJSON_IsString(item)) {
-                                properties.bg_bright = static_cast<uint8_t>(atoi(item->valuestring));
-                            }
-                            item = cJSON_GetArrayItem(result_array, 16);
-                            if (cJSON_IsNumber(item)) {
-                                properties.bg_rgb = static_cast<uint32_t>(item->valuedouble);
-                            } else if (cJSON_IsString(item)) {
-                                properties.bg_rgb = static_cast<uint32_t>(atoi(item->valuestring));
-                            }
-                            item = cJSON_GetArrayItem(result_array, 17);
-                            if (cJSON_IsNumber(item)) {
-                                properties.bg_hue = static_cast<uint16_t>(item->valuedouble);
-                            } else if (cJSON_IsString(item)) {
-                                properties.bg_hue = static_cast<uint16_t>(atoi(item->valuestring));
-                            }
-                            item = cJSON_GetArrayItem(result_array, 18);
-                            if (cJSON_IsNumber(item)) {
-                                properties.bg_sat = static_cast<uint8_t>(item->valuedouble);
-                            } else if (cJSON_IsString(item)) {
-                                properties.bg_sat = static_cast<uint8_t>(atoi(item->valuestring));
-                            }
-                            item = cJSON_GetArrayItem(result_array, 19);
-                            if (cJSON_IsNumber(item)) {
-                                properties.nl_br = static_cast<uint8_t>(item->valuedouble);
-                            } else if (cJSON_IsString(item)) {
-                                properties.nl_br = static_cast<uint8_t>(atoi(item->valuestring));
-                            }
-                            item = cJSON_GetArrayItem(result_array, 20);
-                            if (cJSON_IsNumber(item)) {
-                                properties.active_mode = static_cast<int>(item->valuedouble) == 1;
-                            } else if (cJSON_IsString(item)) {
-                                properties.active_mode = atoi(item->valuestring) == 1;
-                            }
-                            responses[id] = SUCCESS;
-                        }
-                    } else if (cJSON_GetObjectItem(root, "error")) {
-                        responses[id] = ERROR;
-                    }
-                } else if (cJSON_GetObjectItem(root, "method")) {
-                    const char *method = cJSON_GetObjectItem(root, "method")->valuestring;
-                    if (strcmp(method, "props") == 0) {
-                        const cJSON *params = cJSON_GetObjectItem(root, "params");
-                        if (!params || !cJSON_IsObject(params)) {
-                            return;
-                        } {
-                            const cJSON *item = cJSON_GetObjectItem(params, "power");
-                            if (item && cJSON_IsString(item)) {
-                                properties.power = strcmp(item->valuestring, "on") == 0;
-                            }
-                        } {
-                            const cJSON *item = cJSON_GetObjectItem(params, "bright");
-                            if (item && cJSON_IsString(item)) {
-                                properties.bright = static_cast<uint8_t>(atoi(item->valuestring));
-                            }
-                        } {
-                            const cJSON *item = cJSON_GetObjectItem(params, "ct");
-                            if (item && cJSON_IsString(item)) {
-                                properties.ct = static_cast<uint16_t>(atoi(item->valuestring));
-                            }
-                        } {
-                            const cJSON *item = cJSON_GetObjectItem(params, "rgb");
-                            if (item && cJSON_IsString(item)) {
-                                properties.rgb = static_cast<uint32_t>(atoi(item->valuestring));
-                            }
-                        } {
-                            const cJSON *item = cJSON_GetObjectItem(params, "hue");
-                            if (item && cJSON_IsString(item)) {
-                                properties.hue = static_cast<uint16_t>(atoi(item->valuestring));
-                            }
-                        } {
-                            const cJSON *item = cJSON_GetObjectItem(params, "sat");
-                            if (item && cJSON_IsString(item)) {
-                                properties.sat = static_cast<uint8_t>(atoi(item->valuestring));
-                            }
-                        } {
-                            const cJSON *item = cJSON_GetObjectItem(params, "color_mode");
-                            if (item && cJSON_IsString(item)) {
-                                const int cm = atoi(item->valuestring);
-                                switch (cm) {
-                                    case 1: properties.color_mode = COLOR_MODE_RGB;
-                                        break;
-                                    case 2: properties.color_mode = COLOR_MODE_COLOR_TEMPERATURE;
-                                        break;
-                                    case 3: properties.color_mode = COLOR_MODE_HSV;
-                                        break;
-                                    default: properties.color_mode = COLOR_MODE_UNKNOWN;
-                                        break;
-                                }
-                            }
-                        } {
-                            const cJSON *item = cJSON_GetObjectItem(params, "flowing");
-                            if (item && cJSON_IsString(item)) {
-                                properties.flowing = atoi(item->valuestring) == 1;
-                            }
-                        } {
-                            const cJSON *item = cJSON_GetObjectItem(params, "delayoff");
-                            if (item && cJSON_IsString(item)) {
-                                properties.delayoff = static_cast<uint8_t>(atoi(item->valuestring));
-                            }
-                        } {
-                            const cJSON *item = cJSON_GetObjectItem(params, "flow_params");
-                            if (item && cJSON_IsString(item)) {
-                                //properties.flow_params = item->valuestring; // (std::string)
-                            }
-                        } {
-                            const cJSON *item = cJSON_GetObjectItem(params, "music_on");
-                            if (item && cJSON_IsString(item)) {
-                                properties.music_on = atoi(item->valuestring) == 1;
-                            }
-                        } {
-                            const cJSON *item = cJSON_GetObjectItem(params, "name");
-                            if (item && cJSON_IsString(item)) {
-                                properties.name = item->valuestring; // (std::string)
-                            }
-                        } {
-                            const cJSON *item = cJSON_GetObjectItem(params, "bg_power");
-                            if (item && cJSON_IsString(item)) {
-                                properties.bg_power = strcmp(item->valuestring, "on") == 0;
-                            }
-                        } {
-                            const cJSON *item = cJSON_GetObjectItem(params, "bg_flowing");
-                            if (item && cJSON_IsString(item)) {
-                                properties.bg_flowing = atoi(item->valuestring) == 1;
-                            }
-                        } {
-                            const cJSON *item = cJSON_GetObjectItem(params, "bg_flow_params");
-                            if (item && cJSON_IsString(item)) {
-                                //properties.bg_flow_params = item->valuestring;
-                            }
-                        } {
-                            const cJSON *item = cJSON_GetObjectItem(params, "bg_ct");
-                            if (item && cJSON_IsString(item)) {
-                                properties.bg_ct = static_cast<uint16_t>(atoi(item->valuestring));
-                            }
-                        } {
-                            const cJSON *item = cJSON_GetObjectItem(params, "bg_lmode");
-                            if (item && cJSON_IsString(item)) {
-                                const int cm = atoi(item->valuestring);
-                                switch (cm) {
-                                    case 1: properties.bg_color_mode = COLOR_MODE_RGB;
-                                        break;
-                                    case 2: properties.bg_color_mode = COLOR_MODE_COLOR_TEMPERATURE;
-                                        break;
-                                    case 3: properties.bg_color_mode = COLOR_MODE_HSV;
-                                        break;
-                                    default: properties.bg_color_mode = COLOR_MODE_UNKNOWN;
-                                        break;
-                                }
-                            }
-                        } {
-                            const cJSON *item = cJSON_GetObjectItem(params, "bg_bright");
-                            if (item && cJSON_IsString(item)) {
-                                properties.bg_bright = static_cast<uint8_t>(atoi(item->valuestring));
-                            }
-                        } {
-                            const cJSON *item = cJSON_GetObjectItem(params, "bg_rgb");
-                            if (item && cJSON_IsString(item)) {
-                                properties.bg_rgb = static_cast<uint32_t>(atoi(item->valuestring));
-                            }
-                        } {
-                            const cJSON *item = cJSON_GetObjectItem(params, "bg_hue");
-                            if (item && cJSON_IsString(item)) {
-                                properties.bg_hue = static_cast<uint16_t>(atoi(item->valuestring));
-                            }
-                        } {
-                            const cJSON *item = cJSON_GetObjectItem(params, "bg_sat");
-                            if (item && cJSON_IsString(item)) {
-                                properties.bg_sat = static_cast<uint8_t>(atoi(item->valuestring));
-                            }
-                        } {
-                            const cJSON *item = cJSON_GetObjectItem(params, "nl_br");
-                            if (item && cJSON_IsString(item)) {
-                                properties.nl_br = static_cast<uint8_t>(atoi(item->valuestring));
-                            }
-                        } {
-                            const cJSON *item = cJSON_GetObjectItem(params, "active_mode");
-                            if (item && cJSON_IsString(item)) {
-                                properties.active_mode = atoi(item->valuestring) == 1;
-                            }
-                        }
+        while (!lineBuffer.empty() && (lineBuffer.back() == '\r' || lineBuffer.back() == ' ' ||
+                                       lineBuffer.back() == '\t')) {
+            lineBuffer.pop_back();
+        }
+        if (lineBuffer.empty()) {
+            continue;
+        }
+        cJSON *root = cJSON_Parse(lineBuffer.c_str());
+        if (root) {
+            handle_message(root);
+            cJSON_Delete(root);
+        }
+    }
+}
+
+void Yeelight::handle_message(const cJSON *root) {
+    if (cJSON_GetObjectItem(root, "id")) {
+        const uint16_t id = cJSON_GetObjectItem(root, "id")->valueint;
+        if (abandoned_responses.erase(id) != 0) {
+            return;
+        }
+        if (cJSON_GetObjectItem(root, "result")) {
+            const cJSON *result_array = cJSON_GetObjectItem(root, "result");
+            if (!cJSON_IsArray(result_array)) {
+                responses[id] = UNEXPECTED_RESPONSE;
+                return;
+            }
+            const auto request = property_requests.find(id);
+            if (request != property_requests.end()) {
+                responses[id] = apply_properties(request->second, result_array);
+            } else {
+                const cJSON *firstItem = cJSON_GetArrayItem(result_array, 0);
+                if (firstItem && cJSON_IsString(firstItem) && strcmp(firstItem->valuestring, "ok") == 0) {
+                    responses[id] = SUCCESS;
+                } else {
+                    responses[id] = UNEXPECTED_RESPONSE;
+                }
+            }
+        } else if (cJSON_GetObjectItem(root, "error")) {
+            responses[id] = ERROR;
+        }
+    } else if (cJSON_GetObjectItem(root, "method")) {
+        const char *method = cJSON_GetObjectItem(root, "method")->valuestring;
+        if (strcmp(method, "props") == 0) {
+            const cJSON *params = cJSON_GetObjectItem(root, "params");
+            if (params && cJSON_IsObject(params)) {
+                for (uint8_t prop = 0; prop < PROP_COUNT; prop++) {
+                    const cJSON *item = cJSON_GetObjectItem(params, property_names[prop]);
+                    if (item && apply_property(static_cast<YeelightProp>(prop), item)) {
+                        notified_properties |= 1UL << prop;
+                        last_notification = millis();
                     }
                 }
-                cJSON_Delete(root);
             }
         }
-        pos = partialResponse.find('\n');
     }
 }
 
 YeelightDevice Yeelight::parseDiscoveryResponse(const char *response) {
-    YeelightDevice device;
-    memset(&device, 0, sizeof(device));
+    YeelightDevice device{};
     const char *location = strstr(response, "Location: yeelight://");
     if (location) {
         location += strlen("Location: yeelight://");
@@ -1124,116 +1215,125 @@ YeelightDevice Yeelight::parseDiscoveryResponse(const char *response) {
         support += strlen("\r\nsupport: ");
         char supportStr[256];
         sscanf(support, "%255[^\r\n]", supportStr);
-        std::string supportList = supportStr;
-        if (supportList.find("get_prop") != std::string::npos) {
-            device.supported_methods.get_prop = true;
-        }
-        if (supportList.find("set_ct_abx") != std::string::npos) {
-            device.supported_methods.set_ct_abx = true;
-        }
-        if (supportList.find("set_rgb") != std::string::npos) {
-            device.supported_methods.set_rgb = true;
-        }
-        if (supportList.find("set_hsv") != std::string::npos) {
-            device.supported_methods.set_hsv = true;
-        }
-        if (supportList.find("set_bright") != std::string::npos) {
-            device.supported_methods.set_bright = true;
-        }
-        if (supportList.find("set_power") != std::string::npos) {
-            device.supported_methods.set_power = true;
-        }
-        if (supportList.find("toggle") != std::string::npos) {
-            device.supported_methods.toggle = true;
-        }
-        if (supportList.find("set_default") != std::string::npos) {
-            device.supported_methods.set_default = true;
-        }
-        if (supportList.find("start_cf") != std::string::npos) {
-            device.supported_methods.start_cf = true;
-        }
-        if (supportList.find("stop_cf") != std::string::npos) {
-            device.supported_methods.stop_cf = true;
-        }
-        if (supportList.find("set_scene") != std::string::npos) {
-            device.supported_methods.set_scene = true;
-        }
-        if (supportList.find("cron_add") != std::string::npos) {
-            device.supported_methods.cron_add = true;
-        }
-        if (supportList.find("cron_get") != std::string::npos) {
-            device.supported_methods.cron_get = true;
-        }
-        if (supportList.find("cron_del") != std::string::npos) {
-            device.supported_methods.cron_del = true;
-        }
-        if (supportList.find("set_adjust") != std::string::npos) {
-            device.supported_methods.set_adjust = true;
-        }
-        if (supportList.find("set_music") != std::string::npos) {
-            device.supported_methods.set_music = true;
-        }
-        if (supportList.find("set_name") != std::string::npos) {
-            device.supported_methods.set_name = true;
-        }
-        if (supportList.find("bg_set_rgb") != std::string::npos) {
-            device.supported_methods.bg_set_rgb = true;
-        }
-        if (supportList.find("bg_set_hsv") != std::string::npos) {
-            device.supported_methods.bg_set_hsv = true;
-        }
-        if (supportList.find("bg_set_ct_abx") != std::string::npos) {
-            device.supported_methods.bg_set_ct_abx = true;
-        }
-        if (supportList.find("bg_start_cf") != std::string::npos) {
-            device.supported_methods.bg_start_cf = true;
-        }
-        if (supportList.find("bg_stop_cf") != std::string::npos) {
-            device.supported_methods.bg_stop_cf = true;
-        }
-        if (supportList.find("bg_set_scene") != std::string::npos) {
-            device.supported_methods.bg_set_scene = true;
-        }
-        if (supportList.find("bg_set_default") != std::string::npos) {
-            device.supported_methods.bg_set_default = true;
-        }
-        if (supportList.find("bg_set_power") != std::string::npos) {
-            device.supported_methods.bg_set_power = true;
-        }
-        if (supportList.find("bg_set_bright") != std::string::npos) {
-            device.supported_methods.bg_set_bright = true;
-        }
-        if (supportList.find("bg_set_adjust") != std::string::npos) {
-            device.supported_methods.bg_set_adjust = true;
-        }
-        if (supportList.find("bg_toggle") != std::string::npos) {
-            device.supported_methods.bg_toggle = true;
-        }
-        if (supportList.find("dev_toggle") != std::string::npos) {
-            device.supported_methods.dev_toggle = true;
-        }
-        if (supportList.find("adjust_bright") != std::string::npos) {
-            device.supported_methods.adjust_bright = true;
-        }
-        if (supportList.find("adjust_ct") != std::string::npos) {
-            device.supported_methods.adjust_ct = true;
-        }
-        if (supportList.find("adjust_color") != std::string::npos) {
-            device.supported_methods.adjust_color = true;
-        }
-        if (supportList.find("bg_adjust_bright") != std::string::npos) {
-            device.supported_methods.bg_adjust_bright = true;
-        }
-        if (supportList.find("bg_adjust_ct") != std::string::npos) {
-            device.supported_methods.bg_adjust_ct = true;
-        }
-        if (supportList.find("bg_adjust_color") != std::string::npos) {
-            device.supported_methods.bg_adjust_color = true;
-        }
+        device.supported_methods = parseSupportedMethods(supportStr);
     }
     return device;
 }
 
+SupportedMethods Yeelight::parseSupportedMethods(const char *support) {
+    SupportedMethods methods{};
+    if (support == nullptr) {
+        return methods;
+    }
+    const std::string supportList = support;
+    if (supportList.find("get_prop") != std::string::npos) {
+        methods.get_prop = true;
+    }
+    if (supportList.find("set_ct_abx") != std::string::npos) {
+        methods.set_ct_abx = true;
+    }
+    if (supportList.find("set_rgb") != std::string::npos) {
+        methods.set_rgb = true;
+    }
+    if (supportList.find("set_hsv") != std::string::npos) {
+        methods.set_hsv = true;
+    }
+    if (supportList.find("set_bright") != std::string::npos) {
+        methods.set_bright = true;
+    }
+    if (supportList.find("set_power") != std::string::npos) {
+        methods.set_power = true;
+    }
+    if (supportList.find("toggle") != std::string::npos) {
+        methods.toggle = true;
+    }
+    if (supportList.find("set_default") != std::string::npos) {
+        methods.set_default = true;
+    }
+    if (supportList.find("start_cf") != std::string::npos) {
+        methods.start_cf = true;
+    }
+    if (supportList.find("stop_cf") != std::string::npos) {
+        methods.stop_cf = true;
+    }
+    if (supportList.find("set_scene") != std::string::npos) {
+        methods.set_scene = true;
+    }
+    if (supportList.find("cron_add") != std::string::npos) {
+        methods.cron_add = true;
+    }
+    if (supportList.find("cron_get") != std::string::npos) {
+        methods.cron_get = true;
+    }
+    if (supportList.find("cron_del") != std::string::npos) {
+        methods.cron_del = true;
+    }
+    if (supportList.find("set_adjust") != std::string::npos) {
+        methods.set_adjust = true;
+    }
+    if (supportList.find("set_music") != std::string::npos) {
+        methods.set_music = true;
+    }
+    if (supportList.find("set_name") != std::string::npos) {
+        methods.set_name = true;
+    }
+    if (supportList.find("bg_set_rgb") != std::string::npos) {
+        methods.bg_set_rgb = true;
+    }
+    if (supportList.find("bg_set_hsv") != std::string::npos) {
+        methods.bg_set_hsv = true;
+    }
+    if (supportList.find("bg_set_ct_abx") != std::string::npos) {
+        methods.bg_set_ct_abx = true;
+    }
+    if (supportList.find("bg_start_cf") != std::string::npos) {
+        methods.bg_start_cf = true;
+    }
+    if (supportList.find("bg_stop_cf") != std::string::npos) {
+        methods.bg_stop_cf = true;
+    }
+    if (supportList.find("bg_set_scene") != std::string::npos) {
+        methods.bg_set_scene = true;
+    }
+    if (supportList.find("bg_set_default") != std::string::npos) {
+        methods.bg_set_default = true;
+    }
+    if (supportList.find("bg_set_power") != std::string::npos) {
+        methods.bg_set_power = true;
+    }
+    if (supportList.find("bg_set_bright") != std::string::npos) {
+        methods.bg_set_bright = true;
+    }
+    if (supportList.find("bg_set_adjust") != std::string::npos) {
+        methods.bg_set_adjust = true;
+    }
+    if (supportList.find("bg_toggle") != std::string::npos) {
+        methods.bg_toggle = true;
+    }
+    if (supportList.find("dev_toggle") != std::string::npos) {
+        methods.dev_toggle = true;
+    }
+    if (supportList.find("adjust_bright") != std::string::npos) {
+        methods.adjust_bright = true;
+    }
+    if (supportList.find("adjust_ct") != std::string::npos) {
+        methods.adjust_ct = true;
+    }
+    if (supportList.find("adjust_color") != std::string::npos) {
+        methods.adjust_color = true;
+    }
+    if (supportList.find("bg_adjust_bright") != std::string::npos) {
+        methods.bg_adjust_bright = true;
+    }
+    if (supportList.find("bg_adjust_ct") != std::string::npos) {
+        methods.bg_adjust_ct = true;
+    }
+    if (supportList.find("bg_adjust_color") != std::string::npos) {
+        methods.bg_adjust_color = true;
+    }
+    return methods;
+}
+
 bool Yeelight::createMusicModeServer() {
     if (music_mode_server) {
         return false;
@@ -1250,6 +1350,10 @@ ResponseType Yeelight::set_music_command(const bool power, const uint8_t *host,
         return ERROR;
     }
     cJSON_AddItemToArray(params, cJSON_CreateNumber(power));
+    if (!power || host == nullptr) {
+        // Stopping takes no address: `set_music [0]`.
+        return send_command("set_music", params);
+    }
     const std::string hostStr = std::to_string(host[0]) + "." + std::to_string(host[1]) + "." + std::to_string(host[2])
                                 + "." + std::to_string(host[3]);
     cJSON_AddItemToArray(params, cJSON_CreateString(hostStr.c_str()));
@@ -1370,9 +1474,6 @@ ResponseType Yeelight::set_power(const bool power, const effect effect, const ui
     if (!supported_methods.set_power && !supported_methods.bg_set_power) {
         return METHOD_NOT_SUPPORTED;
     }
-    if (duration < 30) {
-        return INVALID_PARAMS;
-    }
     if (lightType == AUTO) {
         if (supported_methods.set_power && supported_methods.bg_set_power) {
             const ResponseType response = set_power_command(power, effect, duration, mode);
@@ -1479,21 +1580,21 @@ ResponseType Yeelight::set_color_temp(const uint16_t ct_value, const LightType l
 
 ResponseType Yeelight::set_color_temp(const uint16_t ct_value, const effect effect, const uint16_t duration,
                                       const LightType lightType) {
-    if (ct_value < 1700 || ct_value > 6500) {
-        return INVALID_PARAMS;
-    }
-    if (!supported_methods.set_ct_abx && !supported_methods.bg_set_ct_abx) {
+    // Channels without set_ct_abx emulate color temperatures with set_rgb.
+    const bool main_ct = supported_methods.set_ct_abx || supported_methods.set_rgb;
+    const bool bg_ct = supported_methods.bg_set_ct_abx || supported_methods.bg_set_rgb;
+    if (!main_ct && !bg_ct) {
         return METHOD_NOT_SUPPORTED;
     }
     if (lightType == AUTO) {
-        if (supported_methods.set_ct_abx && supported_methods.bg_set_ct_abx) {
+        if (main_ct && bg_ct) {
             const ResponseType response = set_ct_abx_command(ct_value, effect, duration);
             if (response != SUCCESS) {
                 return response;
             }
             return bg_set_ct_abx_command(ct_value, effect, duration);
         }
-        if (supported_methods.set_ct_abx) {
+        if (main_ct) {
             return set_ct_abx_command(ct_value, effect, duration);
         }
         return bg_set_ct_abx_command(ct_value, effect, duration);
@@ -1519,12 +1620,6 @@ ResponseType Yeelight::set_color_temp(const uint16_t ct_value, const effect effe
 }
 
 ResponseType Yeelight::set_color_temp(const uint16_t ct_value, const uint8_t bright, const LightType lightType) {
-    if (ct_value < 1700 || ct_value > 6500) {
-        return INVALID_PARAMS;
-    }
-    if (bright < 1 || bright > 100) {
-        return INVALID_PARAMS;
-    }
     if (!supported_methods.set_scene && !supported_methods.bg_set_scene) {
         return METHOD_NOT_SUPPORTED;
     }
@@ -1568,9 +1663,6 @@ ResponseType Yeelight::set_rgb_color(const uint8_t r, const uint8_t g, const uin
 
 ResponseType Yeelight::set_rgb_color(const uint8_t r, const uint8_t g, const uint8_t b, const effect effect,
                                      const uint16_t duration, const LightType lightType) {
-    if (duration < 30) {
-        return INVALID_PARAMS;
-    }
     if (!supported_methods.set_rgb && !supported_methods.bg_set_rgb) {
         return METHOD_NOT_SUPPORTED;
     }
@@ -1605,9 +1697,6 @@ ResponseType Yeelight::set_rgb_color(const uint8_t r, const uint8_t g, const uin
 
 ResponseType Yeelight::set_rgb_color(const uint8_t r, const uint8_t g, const uint8_t b, const uint8_t bright,
                                      const LightType lightType) {
-    if (bright < 1 || bright > 100) {
-        return INVALID_PARAMS;
-    }
     if (!supported_methods.set_scene && !supported_methods.bg_set_scene) {
         return METHOD_NOT_SUPPORTED;
     }
@@ -1650,12 +1739,6 @@ ResponseType Yeelight::set_brightness(const uint8_t bright, const effect effect,
 
 ResponseType Yeelight::set_brightness(const uint8_t bright, const effect effect, const uint16_t duration,
                                       const LightType lightType) {
-    if (bright < 1 || bright > 100) {
-        return INVALID_PARAMS;
-    }
-    if (duration < 30) {
-        return INVALID_PARAMS;
-    }
     if (!supported_methods.set_bright && !supported_methods.bg_set_bright) {
         return METHOD_NOT_SUPPORTED;
     }
@@ -1699,15 +1782,6 @@ ResponseType Yeelight::set_hsv_color(const uint16_t hue, const uint8_t sat, cons
 
 ResponseType Yeelight::set_hsv_color(const uint16_t hue, const uint8_t sat, const effect effect,
                                      const uint16_t duration, const LightType lightType) {
-    if (hue > 359) {
-        return INVALID_PARAMS;
-    }
-    if (sat > 100) {
-        return INVALID_PARAMS;
-    }
-    if (duration < 30) {
-        return INVALID_PARAMS;
-    }
     if (!supported_methods.set_hsv && !supported_methods.bg_set_hsv) {
         return METHOD_NOT_SUPPORTED;
     }
@@ -1742,15 +1816,6 @@ ResponseType Yeelight::set_hsv_color(const uint16_t hue, const uint8_t sat, cons
 
 ResponseType Yeelight::set_hsv_color(const uint16_t hue, const uint8_t sat, const uint8_t bright,
                                      const LightType lightType) {
-    if (bright < 1 || bright > 100) {
-        return INVALID_PARAMS;
-    }
-    if (hue > 359) {
-        return INVALID_PARAMS;
-    }
-    if (sat > 100) {
-        return INVALID_PARAMS;
-    }
     if (!supported_methods.set_scene && !supported_methods.bg_set_scene) {
         return METHOD_NOT_SUPPORTED;
     }
@@ -1785,9 +1850,6 @@ ResponseType Yeelight::set_hsv_color(const uint16_t hue, const uint8_t sat, cons
 
 ResponseType Yeelight::set_scene_rgb(const uint8_t r, const uint8_t g, const uint8_t b, const uint8_t bright,
                                      const LightType lightType) {
-    if (bright < 1 || bright > 100) {
-        return INVALID_PARAMS;
-    }
     if (!supported_methods.set_scene && !supported_methods.bg_set_scene) {
         return METHOD_NOT_SUPPORTED;
     }
@@ -1822,15 +1884,6 @@ ResponseType Yeelight::set_scene_rgb(const uint8_t r, const uint8_t g, const uin
 
 ResponseType Yeelight::set_scene_hsv(const uint16_t hue, const uint8_t sat, const uint8_t bright,
                                      const LightType lightType) {
-    if (bright < 1 || bright > 100) {
-        return INVALID_PARAMS;
-    }
-    if (hue > 359) {
-        return INVALID_PARAMS;
-    }
-    if (sat > 100) {
-        return INVALID_PARAMS;
-    }
     if (!supported_methods.set_scene && !supported_methods.bg_set_scene) {
         return METHOD_NOT_SUPPORTED;
     }
@@ -1864,12 +1917,6 @@ ResponseType Yeelight::set_scene_hsv(const uint16_t hue, const uint8_t sat, cons
 }
 
 ResponseType Yeelight::set_scene_color_temperature(const uint16_t ct, const uint8_t bright, const LightType lightType) {
-    if (bright < 1 || bright > 100) {
-        return INVALID_PARAMS;
-    }
-    if (ct < 1700 || ct > 6500) {
-        return INVALID_PARAMS;
-    }
     if (!supported_methods.set_scene && !supported_methods.bg_set_scene) {
         return METHOD_NOT_SUPPORTED;
     }
@@ -1904,9 +1951,6 @@ ResponseType Yeelight::set_scene_color_temperature(const uint16_t ct, const uint
 
 ResponseType Yeelight::set_scene_auto_delay_off(const uint8_t brightness, const uint32_t duration,
                                                 const LightType lightType) {
-    if (brightness < 1 || brightness > 100) {
-        return INVALID_PARAMS;
-    }
     if (!supported_methods.set_scene && !supported_methods.bg_set_scene) {
         return METHOD_NOT_SUPPORTED;
     }
@@ -2020,10 +2064,10 @@ ResponseType Yeelight::set_music_mode(const bool enabled) {
     if (resp != SUCCESS) {
         return resp;
     }
+    music_mode = false;
     if (music_client) {
         music_client->close();
     }
-    music_mode = false;
     connect();
     return SUCCESS;
 }
@@ -2041,12 +2085,6 @@ ResponseType Yeelight::adjust_brightness(const int8_t percentage, const LightTyp
 }
 
 ResponseType Yeelight::adjust_brightness(const int8_t percentage, const uint16_t duration, const LightType lightType) {
-    if (percentage < -100 || percentage > 100) {
-        return INVALID_PARAMS;
-    }
-    if (duration < 30) {
-        return INVALID_PARAMS;
-    }
     if (!supported_methods.set_adjust && !supported_methods.bg_set_adjust) {
         return METHOD_NOT_SUPPORTED;
     }
@@ -2084,12 +2122,6 @@ ResponseType Yeelight::adjust_color_temp(const int8_t percentage, const LightTyp
 }
 
 ResponseType Yeelight::adjust_color_temp(const int8_t percentage, const uint16_t duration, const LightType lightType) {
-    if (percentage < -100 || percentage > 100) {
-        return INVALID_PARAMS;
-    }
-    if (duration < 30) {
-        return INVALID_PARAMS;
-    }
     if (!supported_methods.adjust_ct && !supported_methods.bg_adjust_ct) {
         return METHOD_NOT_SUPPORTED;
     }
@@ -2127,12 +2159,6 @@ ResponseType Yeelight::adjust_color(const int8_t percentage, const LightType lig
 }
 
 ResponseType Yeelight::adjust_color(const int8_t percentage, const uint16_t duration, const LightType lightType) {
-    if (percentage < -100 || percentage > 100) {
-        return INVALID_PARAMS;
-    }
-    if (duration < 30) {
-        return INVALID_PARAMS;
-    }
     if (!supported_methods.adjust_color && !supported_methods.bg_adjust_color) {
         return METHOD_NOT_SUPPORTED;
     }
@@ -2167,16 +2193,14 @@ ResponseType Yeelight::adjust_color(const int8_t percentage, const uint16_t dura
 
 ResponseType Yeelight::bg_start_cf_command(const uint8_t count, const flow_action action, const uint8_t size,
                                            const flow_expression *flow) {
+    if (!YeelightValidation::valid(flow, size)) {
+        return INVALID_PARAMS;
+    }
     cJSON *params = cJSON_CreateArray();
     cJSON_AddItemToArray(params, cJSON_CreateNumber(count));
     cJSON_AddItemToArray(params, cJSON_CreateNumber(action));
-    std::string flow_str;
-    for (uint8_t i = 0; i < size; i++) {
-        flow_str += std::to_string(flow[i].duration) + "," + std::to_string(flow[i].mode) + "," +
-                std::to_string(flow[i].value) + "," + std::to_string(flow[i].brightness) + ",";
-    }
-    flow_str.pop_back();
-    cJSON_AddItemToArray(params, cJSON_CreateString(flow_str.c_str()));
+    const std::string flowExpression = flow_to_string(flow, size, !supported_methods.bg_set_ct_abx, brightness_curve);
+    cJSON_AddItemToArray(params, cJSON_CreateString(flowExpression.c_str()));
     return send_command("bg_start_cf", params);
 }
 
@@ -2230,36 +2254,75 @@ ResponseType Yeelight::set_scene_flow(Flow flow, const LightType lightType) {
 }
 
 ResponseType Yeelight::refreshProperties() {
+    return refreshProperties(ALL_PROPERTIES);
+}
+
+ResponseType Yeelight::refreshProperties(const uint32_t mask) {
     if (!supported_methods.get_prop) {
         return METHOD_NOT_SUPPORTED;
     }
-    cJSON *params = cJSON_CreateArray();
+    if ((mask & ALL_PROPERTIES) == 0) {
+        return INVALID_PARAMS;
+    }
+    cJSON *params = property_params(mask);
     if (!params) {
-        cJSON_Delete(params);
         return ERROR;
     }
-    cJSON_AddItemToArray(params, cJSON_CreateString("power"));
-    cJSON_AddItemToArray(params, cJSON_CreateString("bright"));
-    cJSON_AddItemToArray(params, cJSON_CreateString("ct"));
-    cJSON_AddItemToArray(params, cJSON_CreateString("rgb"));
-    cJSON_AddItemToArray(params, cJSON_CreateString("hue"));
-    cJSON_AddItemToArray(params, cJSON_CreateString("sat"));
-    cJSON_AddItemToArray(params, cJSON_CreateString("color_mode"));
-    cJSON_AddItemToArray(params, cJSON_CreateString("flowing"));
-    cJSON_AddItemToArray(params, cJSON_CreateString("delayoff"));
-    cJSON_AddItemToArray(params, cJSON_CreateString("music_on"));
-    cJSON_AddItemToArray(params, cJSON_CreateString("name"));
-    cJSON_AddItemToArray(params, cJSON_CreateString("bg_power"));
-    cJSON_AddItemToArray(params, cJSON_CreateString("bg_flowing"));
-    cJSON_AddItemToArray(params, cJSON_CreateString("bg_ct"));
-    cJSON_AddItemToArray(params, cJSON_CreateString("bg_lmode"));
-    cJSON_AddItemToArray(params, cJSON_CreateString("bg_bright"));
-    cJSON_AddItemToArray(params, cJSON_CreateString("bg_rgb"));
-    cJSON_AddItemToArray(params, cJSON_CreateString("bg_hue"));
-    cJSON_AddItemToArray(params, cJSON_CreateString("bg_sat"));
-    cJSON_AddItemToArray(params, cJSON_CreateString("nl_br"));
-    cJSON_AddItemToArray(params, cJSON_CreateString("active_mode"));
-    return send_command("get_prop", params);
+    // The id is allocated first, so the answer is matched to this request whatever the connection does.
+    const uint16_t id = next_response_id();
+    property_requests[id] = mask & ALL_PROPERTIES;
+    const ResponseType response = send_command("get_prop", params, id);
+    property_requests.erase(id);
+    if (response == SUCCESS) {
+        notified_properties &= ~mask;
+    }
+    return response;
+}
+
+ResponseType Yeelight::request_properties(const uint32_t mask, uint16_t &id) {
+    id = 0;
+    if (!supported_methods.get_prop) {
+        return METHOD_NOT_SUPPORTED;
+    }
+    if ((mask & ALL_PROPERTIES) == 0) {
+        return INVALID_PARAMS;
+    }
+    if (music_mode) {
+        // Nothing is answered in music mode.
+        return METHOD_NOT_SUPPORTED;
+    }
+    cJSON *params = property_params(mask);
+    if (!params) {
+        return ERROR;
+    }
+    char *serialized = cJSON_PrintUnformatted(params);
+    cJSON_Delete(params);
+    if (serialized == nullptr) {
+        return ERROR;
+    }
+    const uint16_t allocated = next_response_id();
+    property_requests[allocated] = mask & ALL_PROPERTIES;
+    const ResponseType response = dispatch_async("get_prop", serialized, id, allocated);
+    free(serialized);
+    if (response != SUCCESS) {
+        property_requests.erase(allocated);
+        return response;
+    }
+    notified_properties &= ~mask;
+    return SUCCESS;
+}
+
+cJSON *Yeelight::property_params(const uint32_t mask) {
+    cJSON *params = cJSON_CreateArray();
+    if (!params) {
+        return nullptr;
+    }
+    for (uint8_t prop = 0; prop < PROP_COUNT; prop++) {
+        if (mask & 1UL << prop) {
+            cJSON_AddItemToArray(params, cJSON_CreateString(property_names[prop]));
+        }
+    }
+    return params;
 }
 
 YeelightProperties Yeelight::getProperties() {
@@ -2268,9 +2331,12 @@ YeelightProperties Yeelight::getProperties() {
 
 ResponseType Yeelight::connect(const uint8_t *ip, const uint16_t port) {
     if (is_connected()) {
+        // Not a lost connection: the disconnect callback must not reconnect to the old address.
+        closingManually = true;
         client->close();
         delete client;
         client = nullptr;
+        closingManually = false;
     }
     for (uint8_t i = 0; i < 4; i++) {
         this->ip[i] = ip[i];
@@ -2286,8 +2352,12 @@ void Yeelight::onMainClientDisconnect(const AsyncClient *c) {
     if (client == c) {
         delete client;
         client = nullptr;
+        // Changes made while disconnected were not notified.
+        synced_properties = 0;
+        // Responses are only answered on the connection they were requested on.
+        abandoned_responses.clear();
     }
-    if (!closingManually && !music_mode) {
+    if (!closingManually && !music_mode && link_up) {
         connect();
     }
     closingManually = false;
@@ -2295,10 +2365,15 @@ void Yeelight::onMainClientDisconnect(const AsyncClient *c) {
 
 void Yeelight::onMusicDisconnect(const AsyncClient *c) {
     if (music_client == c) {
+        // Accepted clients belong to the server's user, like the main client belongs to this object.
+        delete music_client;
         music_client = nullptr;
     }
-    music_mode = false;
-    connect();
+    // Leaving music mode on purpose reconnects by itself.
+    if (music_mode) {
+        music_mode = false;
+        connect();
+    }
 }
 
 void Yeelight::handleNewClient(void *arg, AsyncClient *client) {
@@ -2314,9 +2389,17 @@ void Yeelight::handleNewClient(void *arg, AsyncClient *client) {
     const auto it = ip2yee.find(remoteIP32);
     if (it == ip2yee.end()) {
         client->close();
+        delete client;
         return;
     }
     Yeelight *y = it->second;
+    if (y->music_client) {
+        // The bulb dialed back again: the previous connection is replaced without leaving music mode.
+        y->music_client->onDisconnect(nullptr, nullptr);
+        y->music_client->close();
+        delete y->music_client;
+        y->music_client = nullptr;
+    }
     /*
     client->onConnect([](void* arg2, AsyncClient* c) {
         auto* that = static_cast<Yeelight*>(arg2);
@@ -2362,6 +2445,14 @@ bool Yeelight::is_connected() const {
     return client && client->connected();
 }
 
+ResponseType Yeelight::reconnect() {
+    return connect();
+}
+
+bool Yeelight::is_connecting() const {
+    return client && !client->connected();
+}
+
 bool Yeelight::is_connected_music() const {
     return music_client && music_client->connected();
 }
@@ -2373,3 +2464,175 @@ void Yeelight::set_timeout(const uint16_t timeout) {
 std::uint16_t Yeelight::get_timeout() const {
     return timeout;
 }
+
+void Yeelight::set_brightness_curve(const BrightnessCurveType curve) {
+    brightness_curve = curve;
+}
+
+BrightnessCurveType Yeelight::get_brightness_curve() const {
+    return brightness_curve;
+}
+
+const char *Yeelight::get_property_name(const YeelightProp prop) {
+    return prop < PROP_COUNT ? property_names[prop] : nullptr;
+}
+
+uint32_t Yeelight::get_notified_properties() const {
+    return notified_properties;
+}
+
+uint32_t Yeelight::get_last_notification() const {
+    return last_notification;
+}
+
+uint32_t Yeelight::get_property_value(const YeelightProperties &properties, const YeelightProp prop) {
+    switch (prop) {
+        case PROP_POWER: return properties.power;
+        case PROP_BRIGHT: return properties.bright;
+        case PROP_CT: return properties.ct;
+        case PROP_RGB: return properties.rgb;
+        case PROP_HUE: return properties.hue;
+        case PROP_SAT: return properties.sat;
+        case PROP_COLOR_MODE: return properties.color_mode;
+        case PROP_FLOWING: return properties.flowing;
+        case PROP_DELAYOFF: return properties.delayoff;
+        case PROP_MUSIC_ON: return properties.music_on;
+        case PROP_BG_POWER: return properties.bg_power;
+        case PROP_BG_FLOWING: return properties.bg_flowing;
+        case PROP_BG_CT: return properties.bg_ct;
+        case PROP_BG_LMODE: return properties.bg_color_mode;
+        case PROP_BG_BRIGHT: return properties.bg_bright;
+        case PROP_BG_RGB: return properties.bg_rgb;
+        case PROP_BG_HUE: return properties.bg_hue;
+        case PROP_BG_SAT: return properties.bg_sat;
+        case PROP_NL_BR: return properties.nl_br;
+        case PROP_ACTIVE_MODE: return properties.active_mode;
+        default: return 0;
+    }
+}
+
+void Yeelight::set_property_callback(const PropertyCallback callback, void *arg) {
+    property_callback = callback;
+    property_arg = arg;
+}
+
+uint32_t Yeelight::get_synced_properties() const {
+    return synced_properties;
+}
+
+bool Yeelight::apply_property(const YeelightProp prop, const cJSON *item) {
+    int32_t number;
+    if (cJSON_IsNumber(item)) {
+        number = static_cast<int32_t>(item->valuedouble);
+    } else if (cJSON_IsString(item) && item->valuestring[0] != '\0') {
+        // Properties are reported as strings; unsupported ones come back empty and are skipped.
+        number = static_cast<int32_t>(strtol(item->valuestring, nullptr, 10));
+    } else {
+        return false;
+    }
+    const uint32_t previous = get_property_value(properties, prop);
+    switch (prop) {
+        case PROP_POWER: properties.power = cJSON_IsString(item) && strcmp(item->valuestring, "on") == 0;
+            break;
+        case PROP_BRIGHT: properties.bright = static_cast<uint8_t>(number);
+            break;
+        case PROP_CT: properties.ct = static_cast<uint16_t>(number);
+            break;
+        case PROP_RGB: properties.rgb = static_cast<uint32_t>(number);
+            break;
+        case PROP_HUE: properties.hue = static_cast<uint16_t>(number);
+            break;
+        case PROP_SAT: properties.sat = static_cast<uint8_t>(number);
+            break;
+        case PROP_COLOR_MODE: properties.color_mode = to_color_mode(number);
+            break;
+        case PROP_FLOWING: properties.flowing = number == 1;
+            break;
+        case PROP_DELAYOFF: properties.delayoff = static_cast<uint8_t>(number);
+            break;
+        case PROP_MUSIC_ON: properties.music_on = number == 1;
+            break;
+        case PROP_NAME: properties.name = cJSON_IsString(item) ? item->valuestring : "";
+            break;
+        case PROP_BG_POWER: properties.bg_power = cJSON_IsString(item) && strcmp(item->valuestring, "on") == 0;
+            break;
+        case PROP_BG_FLOWING: properties.bg_flowing = number == 1;
+            break;
+        case PROP_BG_CT: properties.bg_ct = static_cast<uint16_t>(number);
+            break;
+        case PROP_BG_LMODE: properties.bg_color_mode = to_color_mode(number);
+            break;
+        case PROP_BG_BRIGHT: properties.bg_bright = static_cast<uint8_t>(number);
+            break;
+        case PROP_BG_RGB: properties.bg_rgb = static_cast<uint32_t>(number);
+            break;
+        case PROP_BG_HUE: properties.bg_hue = static_cast<uint16_t>(number);
+            break;
+        case PROP_BG_SAT: properties.bg_sat = static_cast<uint8_t>(number);
+            break;
+        case PROP_NL_BR: properties.nl_br = static_cast<uint8_t>(number);
+            break;
+        case PROP_ACTIVE_MODE: properties.active_mode = number == 1;
+            break;
+        default: return false;
+    }
+    if (property_callback != nullptr && prop != PROP_NAME) {
+        const uint32_t value = get_property_value(properties, prop);
+        if (value != previous) {
+            property_callback(property_arg, this, prop, value);
+        }
+    }
+    return true;
+}
+
+ResponseType Yeelight::apply_properties(const uint32_t mask, const cJSON *result) {
+    uint8_t count = 0;
+    for (uint8_t prop = 0; prop < PROP_COUNT; prop++) {
+        count += (mask >> prop & 1) != 0;
+    }
+    if (cJSON_GetArraySize(result) < count) {
+        return UNEXPECTED_RESPONSE;
+    }
+    // get_prop returns the values in the order of the request, which follows YeelightProp.
+    const cJSON *item = result->child;
+    for (uint8_t prop = 0; prop < PROP_COUNT; prop++) {
+        if (mask & 1UL << prop) {
+            apply_property(static_cast<YeelightProp>(prop), item);
+            item = item->next;
+        }
+    }
+    synced_properties |= mask;
+    return SUCCESS;
+}
+
+void Yeelight::set_keepalive(const uint32_t interval, const uint8_t count) {
+    keepalive_interval = interval;
+    keepalive_count = count;
+    if (is_connected()) {
+        client->setKeepAlive(interval, count);
+    }
+}
+
+void Yeelight::set_online(const bool online) {
+    this->online = online;
+}
+
+bool Yeelight::is_online() const {
+    return online;
+}
+
+uint32_t Yeelight::get_last_activity() const {
+    return last_activity;
+}
+
+size_t Yeelight::get_unclaimed_responses() const {
+    return responses.size();
+}
+
+void Yeelight::set_capture(std::vector<CommandFrame> *frames) {
+    capture = frames;
+}
+
+void Yeelight::set_recorder(WireRecorder *wire) {
+    recorder = wire;
+}
@@ -17,9 +17,12 @@
 #include <cJSON.h>
 #include <Flow.h>
 #include <map>
+#include <set>
 #include <Yeelight_enums.h>
 #include <Yeelight_structs.h>
 
+class WireRecorder;
+
 /**
  * @class Yeelight
  * @brief The main class for discovering, connecting, and controlling Yeelight devices.
@@ -30,6 +33,11 @@
  * it can enable and disable music mode, which allows sending commands over a custom TCP channel.
  */
 class Yeelight {
+    // The host benchmarks (bench/) measure the serialization and parsing paths directly.
+    friend class YeelightBenchmark;
+    // The wire-traffic replayer (bench/) feeds recorded data to onData.
+    friend class WireReplayer;
+
 private:
     //---------------------------------------------------------------------------------------------------------
     // PRIVATE VARIABLES
@@ -55,6 +63,11 @@ private:
      */
     uint16_t timeout;
 
+    /**
+     * @brief The curve mapping brightness levels to the device brightness.
+     */
+    BrightnessCurveType brightness_curve = CURVE_LINEAR;
+
     /**
      * @brief The maximum number of command retries if a command fails.
      */
@@ -70,6 +83,68 @@ private:
      */
     std::map<uint16_t, ResponseType> responses;
 
+    /**
+     * @brief A map that tracks the property mask requested by each pending `get_prop` command.
+     */
+    std::map<uint16_t, uint32_t> property_requests;
+
+    /**
+     * @brief The ids of commands given up on, so their late responses are dropped. Bounded: the reply of a
+     * command given up on long ago is assumed lost.
+     */
+    std::set<uint16_t> abandoned_responses;
+
+    /**
+     * @brief The mask of properties updated by notifications since they were last requested.
+     */
+    uint32_t notified_properties = 0;
+
+    /**
+     * @brief The time in milliseconds of the last property notification (0 if none was received).
+     */
+    uint32_t last_notification = 0;
+
+    /**
+     * @brief The mask of properties fetched since the connection was established, kept current by notifications.
+     */
+    uint32_t synced_properties = 0;
+
+    /**
+     * @brief The callback receiving property changes, and its argument.
+     */
+    void (*property_callback)(void *arg, Yeelight *bulb, YeelightProp prop, uint32_t value) = nullptr;
+    void *property_arg = nullptr;
+
+    /**
+     * @brief The time in milliseconds of the last data received from the device (0 if none was received).
+     */
+    uint32_t last_activity = 0;
+
+    /**
+     * @brief False while liveness monitoring considers the device offline, so commands fail fast.
+     */
+    bool online = true;
+
+    /**
+     * @brief The TCP keepalive interval in milliseconds (0 if keepalive is disabled).
+     */
+    uint32_t keepalive_interval = 0;
+
+    /**
+     * @brief The number of unanswered keepalive probes before the connection is dropped.
+     */
+    uint8_t keepalive_count = 0;
+
+    /**
+     * @brief When set, commands are serialized into this list instead of being sent.
+     */
+    std::vector<CommandFrame> *capture = nullptr;
+
+    /**
+     * @brief When set, the data sent to and received from the device is recorded into it.
+     */
+    WireRecorder *recorder = nullptr;
+
     /**
      * @brief The identifier for the current command/response.
      */
@@ -90,6 +165,16 @@ private:
      */
     std::string partialResponse;
 
+    /**
+     * @brief The line being parsed, kept between reads so parsing a response does not allocate a string.
+     */
+    std::string lineBuffer;
+
+    /**
+     * @brief The frame being written, kept between commands so sending one does not allocate a string.
+     */
+    std::string frameBuffer;
+
     /**
      * @brief Indicates whether music mode is enabled (true) or disabled (false).
      */
@@ -110,6 +195,16 @@ private:
      */
     static std::map<uint32_t, Yeelight *> devices;
 
+    /**
+     * @brief Whether the network link of the controller is up, shared by every instance.
+     */
+    static bool link_up;
+
+    /**
+     * @brief State commands issued while the link was down, at most one per method, oldest first.
+     */
+    std::vector<CommandFrame> deferred;
+
     //---------------------------------------------------------------------------------------------------------
     // PRIVATE METHODS
     //---------------------------------------------------------------------------------------------------------
@@ -141,6 +236,87 @@ private:
      */
     void onData(AsyncClient *c, const void *data, size_t len);
 
+    /**
+     * @brief Handles a message received from the device: a response or a notification.
+     * @param root The parsed message.
+     */
+    void handle_message(const cJSON *root);
+
+    /**
+     * @brief Stores a property value received from the device.
+     * @param prop The property.
+     * @param item The value, as a number or a string.
+     * @return True if the value was stored, false if it is empty or malformed.
+     */
+    bool apply_property(YeelightProp prop, const cJSON *item);
+
+    /**
+     * @brief Stores the values of a `get_prop` result.
+     * @param mask The mask of requested properties, whose values appear in YeelightProp order.
+     * @param result The result array.
+     * @return SUCCESS, or UNEXPECTED_RESPONSE if values are missing.
+     */
+    ResponseType apply_properties(uint32_t mask, const cJSON *result);
+
+    /**
+     * @brief Builds the parameters of a selective `get_prop`.
+     * @param mask The properties to request.
+     * @return The array of property names, or nullptr on allocation failure.
+     */
+    static cJSON *property_params(uint32_t mask);
+
+    /**
+     * @brief Serializes a command and writes it to a connection.
+     * @param target The connection to write to.
+     * @param method The method name.
+     * @param params The parameters array (always consumed).
+     * @param id The id to write, taken from next_response_id, or 0 for a new one.
+     * @return The id of the command, or 0 if it could not be serialized.
+     */
+    uint16_t write_command(AsyncClient *target, const char *method, cJSON *params, uint16_t id = 0);
+
+    /**
+     * @brief Writes a serialized command to a connection, as a single write.
+     * @param target The connection to write to.
+     * @param method The method name.
+     * @param params The parameters as a JSON array.
+     * @param id The id to write, taken from next_response_id, or 0 for a new one.
+     * @return The id of the command, or 0 if the send buffer could not take the whole frame.
+     */
+    uint16_t write_frame(AsyncClient *target, const char *method, const char *params, uint16_t id = 0);
+
+    /**
+     * @brief Allocates the id of the next command (never 0).
+     * @return The id.
+     */
+    uint16_t next_response_id();
+
+    /**
+     * @brief Selects the connection an asynchronous command is written to, reconnecting in the background if
+     * needed.
+     * @param target Receives the music connection in music mode, otherwise the command connection.
+     * @return SUCCESS if the connection is ready, otherwise CONNECTION_LOST.
+     */
+    ResponseType async_target(AsyncClient *&target);
+
+    /**
+     * @brief Writes a serialized command without waiting, reconnecting in the background if needed.
+     * @param method The method name.
+     * @param params The parameters as a JSON array.
+     * @param id Receives the id of the command, or 0 if no response is expected.
+     * @param allocated The id to write, taken from next_response_id, or 0 for a new one.
+     * @return SUCCESS if the command was written, ERROR if the send buffer was full, otherwise CONNECTION_LOST.
+     */
+    ResponseType dispatch_async(const char *method, const char *params, uint16_t &id, uint16_t allocated = 0);
+
+    /**
+     * @brief Keeps a state command issued while the link is down, replacing the previous one of that method.
+     * @param method The method name.
+     * @param params The parameters array (always consumed).
+     * @return PENDING if the command was kept, CONNECTION_LOST if it cannot be deferred.
+     */
+    ResponseType defer_command(const char *method, cJSON *params);
+
     /**
      * @brief Parses a single discovery response and converts it into a YeelightDevice object.
      * @param response The raw discovery response string.
@@ -157,7 +333,7 @@ private:
     /**
      * @brief Sends the internal `set_music` command to enable or disable music mode.
      * @param power If true, enable music mode; if false, disable it.
-     * @param host (Optional) The IP address for the music mode server (defaults to the Yeelight itself).
+     * @param host The IP address of the music mode server, required to enable it (ignored to disable).
      * @param port (Optional) The port for music mode commands (defaults to 55443).
      * @return The response type indicating success or failure.
      */
@@ -189,9 +365,10 @@ private:
      * @brief Sends a generic JSON-formatted command to the Yeelight device.
      * @param method The method name to call on the device.
      * @param params A cJSON object containing the command parameters.
+     * @param id The id to write, taken from next_response_id, or 0 for a new one.
      * @return The response type indicating success or failure.
      */
-    ResponseType send_command(const char *method, cJSON *params);
+    ResponseType send_command(const char *method, cJSON *params, uint16_t id = 0);
 
     /**
      * @brief Sends a `bg_set_power` command to control the background light's power state.
@@ -234,12 +411,18 @@ private:
     ResponseType dev_toggle_command();
 
     /**
-     * @brief Checks the command response for a specific response ID.
+     * @brief Waits for the response to a command and forgets it. A response arriving after the timeout is dropped.
      * @param id The response ID to check.
      * @return The response type indicating success, failure, or timeout.
      */
     ResponseType checkResponse(uint16_t id);
 
+    /**
+     * @brief Drops the response of a command when it arrives, if the connection it was sent on is still open.
+     * @param id The response ID.
+     */
+    void abandon_response(uint16_t id);
+
     /**
      * @brief Sends a `set_ct_abx` command to set the main light's color temperature.
      * @param ct_value The color temperature to set.
@@ -343,7 +526,7 @@ private:
      * @param bright The brightness level (0-100).
      * @return The response type indicating success or failure.
      */
-    ResponseType set_scene_hsv_command(uint8_t hue, uint8_t sat, uint8_t bright);
+    ResponseType set_scene_hsv_command(uint16_t hue, uint8_t sat, uint8_t bright);
 
     /**
      * @brief Sends a `set_hsv` command to set the main light's color using HSV components.
@@ -372,7 +555,7 @@ private:
      * @param bright The brightness level (0-100).
      * @return The response type indicating success or failure.
      */
-    ResponseType bg_set_scene_hsv_command(uint8_t hue, uint8_t sat, uint8_t bright);
+    ResponseType bg_set_scene_hsv_command(uint16_t hue, uint8_t sat, uint8_t bright);
 
     /**
      * @brief Sends a `set_scene_auto_delay_off` command to schedule a turn-off after a specified time.
@@ -523,6 +706,13 @@ public:
      */
     static std::vector<YeelightDevice> discoverYeelightDevices(int waitTimeMs = 5000);
 
+    /**
+     * @brief Parses the method list advertised in the `support` header of a discovery response.
+     * @param support The space-separated method names.
+     * @return The supported methods.
+     */
+    static SupportedMethods parseSupportedMethods(const char *support);
+
     //
     // 2) CONSTRUCTORS AND DESTRUCTOR
     //
@@ -571,12 +761,24 @@ public:
      */
     ResponseType connect(const YeelightDevice &device);
 
+    /**
+     * @brief Opens a new connection to the current device, closing the previous one.
+     * @return The response type indicating success or failure.
+     */
+    ResponseType reconnect();
+
     /**
      * @brief Checks if the main TCP client is currently connected to the device.
      * @return True if connected, otherwise false.
      */
     bool is_connected() const;
 
+    /**
+     * @brief Checks if a connection attempt of the main TCP client is in progress.
+     * @return True if connecting, otherwise false.
+     */
+    bool is_connecting() const;
+
     /**
      * @brief Checks if the music mode TCP client is currently connected.
      * @return True if music mode connection is established, otherwise false.
@@ -600,12 +802,89 @@ public:
      */
     void refreshSupportedMethods();
 
+    /**
+     * @brief Mask selecting every property in refreshProperties.
+     */
+    static constexpr uint32_t ALL_PROPERTIES = (1UL << PROP_COUNT) - 1;
+
     /**
      * @brief Fetches the latest properties (power state, color, etc.) from the device.
      * @return The response type indicating success or failure.
      */
     ResponseType refreshProperties();
 
+    /**
+     * @brief Fetches a subset of the properties from the device with a single selective `get_prop`.
+     * @param mask The properties to fetch, as a bitmask of `1 << YeelightProp` values.
+     * @return The response type indicating success or failure.
+     */
+    ResponseType refreshProperties(uint32_t mask);
+
+    /**
+     * @brief Requests a subset of the properties without waiting for the answer.
+     *
+     * The properties are updated when the answer arrives; poll_response reports when that happened.
+     *
+     * @param mask The properties to fetch, as a bitmask of `1 << YeelightProp` values.
+     * @param id Receives the id to pass to poll_response.
+     * @return SUCCESS if the request was written, otherwise the reason it was not.
+     */
+    ResponseType request_properties(uint32_t mask, uint16_t &id);
+
+    /**
+     * @brief Gets the protocol name of a property.
+     * @param prop The property.
+     * @return The name used by `get_prop` and notifications, or nullptr for an unknown property.
+     */
+    static const char *get_property_name(YeelightProp prop);
+
+    /**
+     * @brief Reads a numeric property from cached properties.
+     * @param properties The cached properties.
+     * @param prop The property to read.
+     * @return The value of the property (booleans read as 0 or 1, color modes as their protocol number, and 0
+     * for the name).
+     */
+    static uint32_t get_property_value(const YeelightProperties &properties, YeelightProp prop);
+
+    /**
+     * @brief Callback receiving the changes of the cached numeric properties.
+     * @param arg The user argument given to set_property_callback.
+     * @param bulb The device.
+     * @param prop The property that changed.
+     * @param value The new value, as returned by get_property_value.
+     */
+    typedef void (*PropertyCallback)(void *arg, Yeelight *bulb, YeelightProp prop, uint32_t value);
+
+    /**
+     * @brief Sets the callback receiving property changes, from `props` notifications and `get_prop` results.
+     * @param callback The callback, or nullptr for none.
+     * @param arg A user argument passed to the callback.
+     */
+    void set_property_callback(PropertyCallback callback, void *arg = nullptr);
+
+    /**
+     * @brief Gets the properties pushed by `props` notifications since they were last fetched.
+     * @return A bitmask of `1 << YeelightProp` values.
+     */
+    uint32_t get_notified_properties() const;
+
+    /**
+     * @brief Gets the time of the last `props` notification.
+     * @return The time in milliseconds (as returned by millis()), or 0 if no notification was received.
+     */
+    uint32_t get_last_notification() const;
+
+    /**
+     * @brief Gets the properties whose cached value is known to be current.
+     *
+     * A property is current once fetched with `get_prop`, as the device notifies every later change over
+     * the same connection. The mask is cleared when the connection is lost.
+     *
+     * @return A bitmask of `1 << YeelightProp` values.
+     */
+    uint32_t get_synced_properties() const;
+
     /**
      * @brief Gets the most recently retrieved properties of the device.
      * @return A YeelightProperties structure containing the device's state.
@@ -805,6 +1084,10 @@ public:
 
     /**
      * @brief Sets the color temperature with effect and duration.
+     *
+     * On channels without `set_ct_abx` the color temperature is emulated with `set_rgb`, using the color of
+     * the Planckian locus from ColorTemperature.
+     *
      * @param ct_value The color temperature value.
      * @param effect The transition effect.
      * @param duration The duration in milliseconds.
@@ -1080,6 +1363,10 @@ public:
 
     /**
      * @brief Adjusts brightness by a specified percentage over a given duration.
+     *
+     * With a non-linear brightness curve the new level is computed from the cached brightness and set with
+     * `set_bright`, so the adjustment is an even perceived step.
+     *
      * @param percentage The amount (in percent) to adjust brightness (negative to decrease).
      * @param duration The duration in milliseconds.
      * @param lightType The light channel to target.
@@ -1150,6 +1437,179 @@ public:
      * @param timeout The new timeout in milliseconds.
      */
     void set_timeout(std::uint16_t timeout);
+
+    //
+    // 13) BRIGHTNESS CURVES
+    //
+
+    /**
+     * @brief Sets the curve applied to every brightness sent to the device.
+     *
+     * Brightness levels passed to set_brightness, the scene setters and flows are then treated as perceived
+     * levels and mapped to the device brightness with BrightnessCurve. Music mode and the Compositor send
+     * through the same commands, so streamed brightness follows the curve too. adjust_brightness moves in
+     * perceived steps (as a set_bright from the cached level) only while the cached brightness is synced
+     * (see get_synced_properties); otherwise it sends a real adjust_bright, which the device applies linearly.
+     *
+     * @param curve The brightness curve (CURVE_LINEAR sends levels unchanged).
+     */
+    void set_brightness_curve(BrightnessCurveType curve);
+
+    /**
+     * @brief Gets the curve applied to every brightness sent to the device.
+     * @return The brightness curve.
+     */
+    BrightnessCurveType get_brightness_curve() const;
+
+    //
+    // 14) ASYNCHRONOUS COMMANDS AND LIVENESS
+    //
+
+    /**
+     * @brief Sends a raw command without waiting for its response.
+     *
+     * Unlike the blocking commands, this does not wait for a reconnection: if the device is not connected,
+     * a reconnection is started (unless one is in progress) and CONNECTION_LOST is returned. It is also sent while the device is
+     * marked offline, so it can be used to probe it.
+     *
+     * @param method The method name.
+     * @param params The parameters array (always consumed).
+     * @param id Receives the id to pass to poll_response, or 0 in music mode, where there are no responses.
+     * @return SUCCESS if the command was written, otherwise the reason it was not.
+     */
+    ResponseType send_command_async(const char *method, cJSON *params, uint16_t &id);
+
+    /**
+     * @brief Checks for the response of a command sent with send_command_async.
+     * @param id The id of the command.
+     * @return PENDING if the response has not arrived yet, otherwise the response (which is then forgotten).
+     */
+    ResponseType poll_response(uint16_t id);
+
+    /**
+     * @brief Gives up on the response of a command sent with send_command_async, e.g. after a timeout: it is
+     * forgotten if it arrived, and dropped when it arrives, instead of being kept for a poll that never comes.
+     * @param id The id of the command.
+     */
+    void forget_response(uint16_t id);
+
+    /**
+     * @brief Sends a command serialized earlier (see set_capture) without waiting for its response.
+     * @param frame The serialized command.
+     * @param id Receives the id to pass to poll_response, or 0 in music mode, where there are no responses.
+     * @return SUCCESS if the command was written, DEVICE_OFFLINE if the device is marked offline, otherwise
+     * CONNECTION_LOST.
+     */
+    ResponseType send_frame_async(const CommandFrame &frame, uint16_t &id);
+
+    /**
+     * @brief Renders a command into its wire format, except for the id, so it can be sent to many devices.
+     * @param frame The serialized command.
+     * @return Everything that follows the id in the command line, including the line terminator.
+     */
+    static std::string render_frame(const CommandFrame &frame);
+
+    /**
+     * @brief Sends a command rendered with render_frame without waiting for its response.
+     *
+     * Only the id prefix is built for this device; the rendered command is shared and queued as-is in the
+     * same TCP send.
+     *
+     * @param rendered The rendered command.
+     * @param id Receives the id to pass to poll_response, or 0 in music mode, where there are no responses.
+     * @return SUCCESS if the command was written, DEVICE_OFFLINE if the device is marked offline, ERROR if the
+     * send buffer was full, otherwise CONNECTION_LOST.
+     */
+    ResponseType send_rendered_async(const std::string &rendered, uint16_t &id);
+
+    /**
+     * @brief Redirects commands into a list instead of sending them.
+     *
+     * While a list is set, every command (including the channel selection, validation, brightness curve and
+     * color temperature emulation of the high-level methods) is serialized and appended to it, and reports
+     * SUCCESS without contacting the device. This compiles states into frames once, to be sent many times
+     * with send_frame_async.
+     *
+     * @param frames The list to append to, or nullptr to send commands again.
+     */
+    void set_capture(std::vector<CommandFrame> *frames);
+
+    /**
+     * @brief Records the traffic of the device, on both the main and the music mode connection.
+     *
+     * Every frame written and every chunk of data received is copied into the recorder with its time; the
+     * recorder never blocks, and drops records when it is not drained often enough. One recorder can be
+     * shared by many devices.
+     *
+     * @param wire The recorder, or nullptr to stop recording.
+     */
+    void set_recorder(WireRecorder *wire);
+
+    /**
+     * @brief Reports a change of the controller's network link to every device.
+     *
+     * While the link is down, no device reconnects or retries, so nothing is burnt on connections that
+     * cannot succeed. Blocking commands fail at once: state commands (`set_power`, `set_bright`, `set_rgb`,
+     * `set_hsv`, `set_ct_abx`, `set_scene`, `set_name` and their background versions) return PENDING and are
+     * kept, the last one of each method only, to be sent by flush_deferred; the others return
+     * CONNECTION_LOST. Devices reconnect on their next command once the link is back (see LinkMonitor to
+     * reconnect them gradually).
+     *
+     * @param up True if the link is up, false if it is down.
+     */
+    static void set_link_up(bool up);
+
+    /**
+     * @brief Checks whether the controller's network link is up.
+     * @return True if the link is up (the default), false otherwise.
+     */
+    static bool is_link_up();
+
+    /**
+     * @brief Returns the number of state commands kept while the link was down.
+     * @return The number of commands.
+     */
+    size_t get_deferred_count() const;
+
+    /**
+     * @brief Sends the state commands kept while the link was down, without waiting for their responses.
+     * @param ids Receives the ids to pass to poll_response (appended; none in music mode).
+     * @return SUCCESS if every command was written, otherwise the reason the remaining ones were kept.
+     */
+    ResponseType flush_deferred(std::vector<uint16_t> &ids);
+
+    /**
+     * @brief Enables TCP keepalive on the command connection, so a dead peer is detected without traffic.
+     * @param interval The idle time and the interval between keepalive probes in milliseconds (0 disables).
+     * @param count The number of unanswered probes before the connection is dropped.
+     */
+    void set_keepalive(uint32_t interval, uint8_t count = 3);
+
+    /**
+     * @brief Marks the device online or offline. While it is offline, blocking commands return
+     * DEVICE_OFFLINE immediately instead of waiting for a timeout. Usually driven by LivenessMonitor.
+     * @param online True to mark the device online.
+     */
+    void set_online(bool online);
+
+    /**
+     * @brief Checks whether the device is marked online.
+     * @return True if the device is marked online.
+     */
+    bool is_online() const;
+
+    /**
+     * @brief Gets the time data was last received from the device (responses or notifications).
+     * @return The time in milliseconds (as returned by millis()), or 0 if nothing was received.
+     */
+    uint32_t get_last_activity() const;
+
+    /**
+     * @brief Gets the number of responses received and not yet collected with poll_response or
+     * forget_response. It should stay small: a growing count means responses that nobody collects.
+     * @return The number of responses.
+     */
+    size_t get_unclaimed_responses() const;
 };
 
 #endif
@@ -0,0 +1,126 @@
+#include "YeelightGroup.h"
+
+YeelightGroup::YeelightGroup(const size_t capacity) {
+    entries.reserve(capacity);
+}
+
+size_t YeelightGroup::add(Yeelight *bulb) {
+    entries.push_back({bulb, SUCCESS});
+    return entries.size() - 1;
+}
+
+bool YeelightGroup::remove(const Yeelight *bulb) {
+    for (auto entry = entries.begin(); entry != entries.end(); ++entry) {
+        if (entry->bulb == bulb) {
+            entries.erase(entry);
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t YeelightGroup::size() const {
+    return entries.size();
+}
+
+void YeelightGroup::clear() {
+    entries.clear();
+}
+
+size_t YeelightGroup::broadcast(const char *method, cJSON *params, const uint32_t timeout) {
+    if (method == nullptr || params == nullptr) {
+        cJSON_Delete(params);
+        return fail_all(INVALID_PARAMS);
+    }
+    char *serialized = cJSON_PrintUnformatted(params);
+    cJSON_Delete(params);
+    if (serialized == nullptr) {
+        return fail_all(ERROR);
+    }
+    const std::vector<CommandFrame> frames = {{method, serialized}};
+    free(serialized);
+    return broadcast(frames, timeout);
+}
+
+size_t YeelightGroup::broadcast(const Command command, void *arg, const uint32_t timeout) {
+    Yeelight *prototype = nullptr;
+    for (const group_entry &entry: entries) {
+        if (entry.bulb != nullptr) {
+            prototype = entry.bulb;
+            break;
+        }
+    }
+    if (command == nullptr || prototype == nullptr) {
+        return fail_all(command == nullptr ? INVALID_PARAMS : DEVICE_NOT_FOUND);
+    }
+    std::vector<CommandFrame> frames;
+    prototype->set_capture(&frames);
+    const ResponseType response = command(prototype, arg);
+    prototype->set_capture(nullptr);
+    if (response != SUCCESS) {
+        return fail_all(response);
+    }
+    return broadcast(frames, timeout);
+}
+
+size_t YeelightGroup::broadcast(const std::vector<CommandFrame> &frames, const uint32_t timeout) {
+    const uint32_t start = millis();
+    std::vector<std::string> rendered;
+    rendered.reserve(frames.size());
+    for (const CommandFrame &frame: frames) {
+        rendered.push_back(Yeelight::render_frame(frame));
+    }
+    // Every device is written to before any response is awaited, so they all execute the command together.
+    for (size_t index = 0; index < entries.size(); index++) {
+        group_entry &entry = entries[index];
+        entry.result = entry.bulb == nullptr ? DEVICE_NOT_FOUND : SUCCESS;
+        if (entry.result != SUCCESS) {
+            continue;
+        }
+        for (const std::string &line: rendered) {
+            uint16_t id;
+            const ResponseType response = entry.bulb->send_rendered_async(line, id);
+            if (response != SUCCESS) {
+                entry.result = response;
+                break;
+            }
+            pending.add(entry.bulb, id, index);
+        }
+    }
+    // Each device keeps the first failure among its responses.
+    const PendingResponses::ResponseCallback record = [](void *arg, const size_t index, const ResponseType response) {
+        group_entry &entry = static_cast<YeelightGroup *>(arg)->entries[index];
+        if (response != SUCCESS && entry.result == SUCCESS) {
+            entry.result = response;
+        }
+    };
+    pending.wait(start, timeout, record, this);
+    broadcast_time = millis() - start;
+    pending.forget(record, this);
+    failures = 0;
+    for (const group_entry &entry: entries) {
+        failures += entry.result != SUCCESS;
+    }
+    return entries.size() - failures;
+}
+
+ResponseType YeelightGroup::get_result(const size_t index) const {
+    return index < entries.size() ? entries[index].result : DEVICE_NOT_FOUND;
+}
+
+size_t YeelightGroup::get_failure_count() const {
+    return failures;
+}
+
+uint32_t YeelightGroup::get_broadcast_time() const {
+    return broadcast_time;
+}
+
+size_t YeelightGroup::fail_all(const ResponseType response) {
+    for (group_entry &entry: entries) {
+        entry.result = response;
+    }
+    failures = entries.size();
+    broadcast_time = 0;
+    return 0;
+}
@@ -0,0 +1,122 @@
+#ifndef YEELIGHTARDUINO_YEELIGHTGROUP_H
+#define YEELIGHTARDUINO_YEELIGHTGROUP_H
+
+#include <Yeelight.h>
+#include <PendingResponses.h>
+
+/**
+ * @class YeelightGroup
+ * @brief Sends the same command to many devices, serializing it only once.
+ *
+ * A broadcast renders each command once into its wire format (see Yeelight::render_frame); each device only
+ * adds its own id in front of the shared buffer, so the serialization cost does not depend on the size of
+ * the group. Every device is written to before any response is awaited, and the outcome of each device is
+ * kept, so partial failures can be inspected with get_result.
+ *
+ * A command given as a callback is run once, on the first device of the group, with Yeelight::set_capture
+ * enabled, and the commands it produces are sent to every device. It is therefore compiled with the channel
+ * handling, capabilities and brightness curve of that device: groups should hold devices of the same kind.
+ */
+class YeelightGroup {
+public:
+    /**
+     * @brief A command to broadcast, issued on a device with its high-level methods.
+     * @param bulb The device to issue the command on.
+     * @param arg The user argument given to broadcast.
+     * @return The result of the command.
+     */
+    typedef ResponseType (*Command)(Yeelight *bulb, void *arg);
+
+    /**
+     * @brief Constructs an empty group.
+     * @param capacity The number of devices to reserve memory for.
+     */
+    explicit YeelightGroup(size_t capacity = 0);
+
+    /**
+     * @brief Adds a device to the group.
+     * @param bulb The device.
+     * @return The index of the device in the group.
+     */
+    size_t add(Yeelight *bulb);
+
+    /**
+     * @brief Removes a device from the group. The indices of the following devices move down by one.
+     * @param bulb The device to remove.
+     * @return True if the device was removed, false if it was not in the group.
+     */
+    bool remove(const Yeelight *bulb);
+
+    /**
+     * @brief Returns the number of devices in the group.
+     * @return The number of devices.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Removes all devices from the group.
+     */
+    void clear();
+
+    /**
+     * @brief Sends a raw command to every device and waits for their responses.
+     * @param method The method name.
+     * @param params The parameters array (always consumed).
+     * @param timeout The maximum time to wait for the responses, in milliseconds.
+     * @return The number of devices that executed the command successfully.
+     */
+    size_t broadcast(const char *method, cJSON *params, uint32_t timeout = 1000);
+
+    /**
+     * @brief Compiles a command on the first device and sends it to every device.
+     * @param command The command, for example a lambda calling `bulb->set_rgb(255, 0, 0)`.
+     * @param arg A user argument passed to the command.
+     * @param timeout The maximum time to wait for the responses, in milliseconds.
+     * @return The number of devices that executed the command successfully.
+     */
+    size_t broadcast(Command command, void *arg = nullptr, uint32_t timeout = 1000);
+
+    /**
+     * @brief Sends serialized commands to every device and waits for their responses.
+     * @param frames The commands, as produced by Yeelight::set_capture.
+     * @param timeout The maximum time to wait for the responses, in milliseconds.
+     * @return The number of devices that executed every command successfully.
+     */
+    size_t broadcast(const std::vector<CommandFrame> &frames, uint32_t timeout = 1000);
+
+    /**
+     * @brief Returns the outcome of the last broadcast for a device.
+     * @param index The index of the device.
+     * @return SUCCESS, the first error reported for the device, TIMEOUT if it did not answer in time, or
+     * DEVICE_NOT_FOUND for an unknown index.
+     */
+    ResponseType get_result(size_t index) const;
+
+    /**
+     * @brief Returns the number of devices for which the last broadcast failed.
+     * @return The number of devices.
+     */
+    size_t get_failure_count() const;
+
+    /**
+     * @brief Returns the duration of the last broadcast.
+     * @return The time from the first command written to the last response received, in milliseconds.
+     */
+    uint32_t get_broadcast_time() const;
+
+private:
+    struct group_entry
+    {
+        Yeelight *bulb;
+        ResponseType result;
+    };
+
+    std::vector<group_entry> entries;
+    PendingResponses pending;
+    size_t failures = 0;
+    uint32_t broadcast_time = 0;
+
+    size_t fail_all(ResponseType response);
+};
+
+#endif
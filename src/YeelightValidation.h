@@ -0,0 +1,199 @@
+#ifndef YEELIGHTARDUINO_YEELIGHTVALIDATION_H
+#define YEELIGHTARDUINO_YEELIGHTVALIDATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Yeelight_enums.h"
+#include "Yeelight_structs.h"
+
+#if defined(__cpp_consteval) && __cpp_consteval >= 201811L
+#define YEELIGHT_CONSTEVAL consteval
+#else
+#define YEELIGHT_CONSTEVAL constexpr
+#endif
+
+/**
+ * @brief An inclusive range of accepted parameter values.
+ */
+struct param_range
+{
+    int64_t min;   /**< Smallest accepted value */
+    int64_t max;   /**< Largest accepted value */
+    int64_t extra; /**< One additional accepted value outside the range (equal to min if there is none) */
+
+    /**
+     * @brief Checks whether a value is accepted.
+     * @param value The value to check.
+     * @return True if the value is inside the range or equal to the extra value.
+     */
+    constexpr bool contains(const int64_t value) const {
+        return (value >= min && value <= max) || value == extra;
+    }
+};
+
+/**
+ * @brief The parameter ranges of one protocol method (or flow step kind), in the order they are sent.
+ */
+struct method_spec
+{
+    const char *method;     /**< Protocol method name */
+    uint8_t count;          /**< Number of checked parameters */
+    param_range params[3];  /**< Ranges of the checked parameters */
+};
+
+/**
+ * @brief Enumeration of the entries of the validation spec table.
+ */
+enum spec_method : uint8_t
+{
+    SPEC_SET_POWER,            /**< set_power: duration */
+    SPEC_SET_CT_ABX,           /**< set_ct_abx: ct, duration */
+    SPEC_SET_RGB,              /**< set_rgb: rgb, duration */
+    SPEC_SET_HSV,              /**< set_hsv: hue, sat, duration */
+    SPEC_SET_BRIGHT,           /**< set_bright: bright, duration */
+    SPEC_SCENE_COLOR,          /**< set_scene color: rgb, bright */
+    SPEC_SCENE_HSV,            /**< set_scene hsv: hue, sat, bright */
+    SPEC_SCENE_CT,             /**< set_scene ct: ct, bright */
+    SPEC_SCENE_AUTO_DELAY_OFF, /**< set_scene auto_delay_off: bright, minutes */
+    SPEC_CRON_ADD,             /**< cron_add: minutes */
+    SPEC_ADJUST,               /**< adjust_bright / adjust_ct / adjust_color: percentage, duration */
+    SPEC_FLOW_COLOR,           /**< Color flow step: duration, rgb, bright */
+    SPEC_FLOW_CT,              /**< Color temperature flow step: duration, ct, bright */
+    SPEC_FLOW_SLEEP,           /**< Sleep flow step: duration */
+    SPEC_COUNT                 /**< Number of entries */
+};
+
+/**
+ * @class YeelightValidation
+ * @brief Checks command parameters and flows against one table of protocol ranges before anything is sent.
+ *
+ * All checks are `constexpr`: literal presets can be checked at compile time with flow_step() (or a
+ * `static_assert`), while the command functions run the same checks at runtime and return INVALID_PARAMS
+ * without a network round trip.
+ */
+class YeelightValidation {
+public:
+    static constexpr param_range DURATION{30, 0xFFFFFFFF, 30};          /**< Transition duration in ms */
+    static constexpr param_range CT{1700, 6500, 1700};                  /**< Color temperature in Kelvin */
+    static constexpr param_range RGB{0, 0xFFFFFF, 0};                   /**< Packed 24-bit color */
+    static constexpr param_range HUE{0, 359, 0};                        /**< Hue in degrees */
+    static constexpr param_range SAT{0, 100, 0};                        /**< Saturation in percent */
+    static constexpr param_range BRIGHT{1, 100, 1};                     /**< Brightness in percent */
+    static constexpr param_range MINUTES{1, 0xFFFFFFFF, 1};             /**< Timer length in minutes */
+    static constexpr param_range PERCENTAGE{-100, 100, -100};           /**< Relative adjustment in percent */
+    static constexpr param_range FLOW_DURATION{50, 0xFFFFFFFF, 50};     /**< Flow step duration in ms */
+    static constexpr param_range FLOW_BRIGHT{1, 100, -1};               /**< Flow step brightness, -1 to keep */
+
+    /**
+     * @brief The spec table, indexed by spec_method.
+     */
+    static constexpr method_spec methods[SPEC_COUNT] = {
+        {"set_power", 1, {DURATION}},
+        {"set_ct_abx", 2, {CT, DURATION}},
+        {"set_rgb", 2, {RGB, DURATION}},
+        {"set_hsv", 3, {HUE, SAT, DURATION}},
+        {"set_bright", 2, {BRIGHT, DURATION}},
+        {"set_scene", 2, {RGB, BRIGHT}},
+        {"set_scene", 3, {HUE, SAT, BRIGHT}},
+        {"set_scene", 2, {CT, BRIGHT}},
+        {"set_scene", 2, {BRIGHT, MINUTES}},
+        {"cron_add", 1, {MINUTES}},
+        {"adjust", 2, {PERCENTAGE, DURATION}},
+        {"start_cf", 3, {FLOW_DURATION, RGB, FLOW_BRIGHT}},
+        {"start_cf", 3, {FLOW_DURATION, CT, FLOW_BRIGHT}},
+        {"start_cf", 1, {FLOW_DURATION}},
+    };
+
+    /**
+     * @brief Checks the parameters of a command against the spec table.
+     * @param method The spec table entry.
+     * @param a The first parameter.
+     * @param b The second parameter, if the method has one.
+     * @param c The third parameter, if the method has one.
+     * @return True if every parameter is in range.
+     */
+    static constexpr bool valid(const spec_method method, const int64_t a, const int64_t b = 0,
+                                const int64_t c = 0) {
+        const int64_t args[3] = {a, b, c};
+        const method_spec &spec = methods[method];
+        for (uint8_t i = 0; i < spec.count; i++) {
+            if (!spec.params[i].contains(args[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Checks one flow step.
+     * @param step The flow step.
+     * @return True if the step is valid for its mode.
+     */
+    static constexpr bool valid(const flow_expression &step) {
+        switch (step.mode) {
+            case FLOW_COLOR: return valid(SPEC_FLOW_COLOR, step.duration, step.value, step.brightness);
+            case FLOW_COLOR_TEMPERATURE: return valid(SPEC_FLOW_CT, step.duration, step.value, step.brightness);
+            case FLOW_SLEEP: return valid(SPEC_FLOW_SLEEP, step.duration);
+            default: return false;
+        }
+    }
+
+    /**
+     * @brief Checks a sequence of flow steps.
+     * @param steps A pointer to the steps.
+     * @param size The number of steps.
+     * @return True if the sequence is not empty and every step is valid.
+     */
+    static constexpr bool valid(const flow_expression *steps, const size_t size) {
+        if (size == 0) {
+            return false;
+        }
+        for (size_t i = 0; i < size; i++) {
+            if (!valid(steps[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Checks a sequence of flow steps.
+     * @param steps The steps.
+     * @return True if the sequence is not empty and every step is valid.
+     */
+    static bool valid(const std::vector<flow_expression> &steps) {
+        return valid(steps.data(), steps.size());
+    }
+
+    /**
+     * @brief Builds a flow step that is checked at compile time when the compiler supports `consteval`.
+     *
+     * An invalid literal step fails to compile with a call to invalid_flow_step(). Without `consteval` the
+     * check runs wherever the step is evaluated, and an invalid step becomes a step the device rejects.
+     *
+     * @param duration The duration of the step in milliseconds.
+     * @param mode The flow mode.
+     * @param value The color or color temperature.
+     * @param brightness The brightness, or -1 to keep it.
+     * @return The flow step.
+     */
+    static YEELIGHT_CONSTEVAL flow_expression flow_step(const uint32_t duration, const flow_mode mode,
+                                                       const uint32_t value, const int8_t brightness) {
+        return valid(flow_expression{duration, mode, value, brightness})
+                   ? flow_expression{duration, mode, value, brightness}
+                   : invalid_flow_step();
+    }
+
+private:
+    static flow_expression invalid_flow_step() {
+        return {0, FLOW_SLEEP, 0, 0};
+    }
+};
+
+static_assert(YeelightValidation::valid(SPEC_FLOW_CT, 50, 1700, -1), "flow spec rejects a valid step");
+static_assert(!YeelightValidation::valid(SPEC_FLOW_COLOR, 49, 0xFF0000, 100), "flow spec accepts a short step");
+static_assert(!YeelightValidation::valid(SPEC_FLOW_COLOR, 50, 0xFF0000, 0), "flow spec accepts brightness 0");
+static_assert(!YeelightValidation::valid(SPEC_SET_CT_ABX, 6501, 30), "ct spec accepts 6501 K");
+
+#endif
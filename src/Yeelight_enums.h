@@ -69,7 +69,9 @@ enum ResponseType
     UNEXPECTED_RESPONSE,  /**< Unexpected response */
     TIMEOUT,              /**< Timeout response */
     CONNECTION_FAILED,    /**< Connection failed response */
-    CONNECTION_LOST       /**< Connection lost response */
+    CONNECTION_LOST,      /**< Connection lost response */
+    DEVICE_OFFLINE,       /**< Device marked offline, the command was not sent */
+    PENDING               /**< Response not received yet */
 };
 /**
  * @brief Enumeration of light types for controlling Yeelight devices.
@@ -93,4 +95,72 @@ enum Color_mode
     COLOR_MODE_HSV                /**< HSV color mode */
 };
 
+/**
+ * @brief Enumeration of device properties, in the order used by `get_prop` in refreshProperties.
+ */
+enum YeelightProp
+{
+    PROP_POWER,       /**< Power state */
+    PROP_BRIGHT,      /**< Brightness level */
+    PROP_CT,          /**< Color temperature */
+    PROP_RGB,         /**< RGB color value */
+    PROP_HUE,         /**< Hue value */
+    PROP_SAT,         /**< Saturation value */
+    PROP_COLOR_MODE,  /**< Color mode */
+    PROP_FLOWING,     /**< Flowing state */
+    PROP_DELAYOFF,    /**< Delay off time */
+    PROP_MUSIC_ON,    /**< Music mode state */
+    PROP_NAME,        /**< Device name */
+    PROP_BG_POWER,    /**< Background power state */
+    PROP_BG_FLOWING,  /**< Background flowing state */
+    PROP_BG_CT,       /**< Background color temperature */
+    PROP_BG_LMODE,    /**< Background color mode */
+    PROP_BG_BRIGHT,   /**< Background brightness level */
+    PROP_BG_RGB,      /**< Background RGB color value */
+    PROP_BG_HUE,      /**< Background hue value */
+    PROP_BG_SAT,      /**< Background saturation value */
+    PROP_NL_BR,       /**< Night light brightness level */
+    PROP_ACTIVE_MODE, /**< Active mode state */
+    PROP_COUNT        /**< Number of properties */
+};
+
+/**
+ * @brief Enumeration of compositor layer priorities, from the bottom of the stack to the top.
+ */
+enum LayerPriority
+{
+    LAYER_BASE,   /**< Base scene layer (e.g. a circadian schedule) */
+    LAYER_EFFECT, /**< Effect layer drawn over the base (e.g. an ambient effect) */
+    LAYER_ALERT   /**< Alert layer drawn over everything (e.g. a doorbell flash) */
+};
+
+/**
+ * @brief Enumeration of blend modes used to combine a compositor layer with the layers below it.
+ */
+enum BlendMode
+{
+    BLEND_REPLACE,             /**< The layer replaces the state below it */
+    BLEND_MULTIPLY_BRIGHTNESS, /**< The layer scales the brightness below it, color is kept */
+    BLEND_ADDITIVE             /**< The layer light is added to the light below it */
+};
+
+/**
+ * @brief Enumeration of brightness curves mapping perceived brightness levels to device brightness.
+ */
+enum BrightnessCurveType
+{
+    CURVE_LINEAR,    /**< Levels are sent unchanged */
+    CURVE_GAMMA,     /**< Power curve with a gamma of 2.2 */
+    CURVE_CIE_LSTAR  /**< CIE 1976 lightness (L*) curve */
+};
+
+/**
+ * @brief Enumeration of the values an InputSmoother can drive.
+ */
+enum SmoothedInput
+{
+    INPUT_BRIGHTNESS,       /**< Brightness, in levels (1-100) */
+    INPUT_COLOR_TEMPERATURE /**< Color temperature, in Kelvin */
+};
+
 #endif
@@ -109,4 +109,70 @@ struct YeelightProperties
     bool active_mode;                     /**< Active mode state of the device */
 };
 
+/**
+ * @brief Struct representing the state of a single light channel.
+ *
+ * The color mode selects which of the color fields is meaningful: rgb for COLOR_MODE_RGB,
+ * ct for COLOR_MODE_COLOR_TEMPERATURE and hue/sat for COLOR_MODE_HSV.
+ */
+struct LightState
+{
+    bool power;            /**< Power state of the channel */
+    Color_mode color_mode; /**< Color mode of the channel */
+    uint32_t rgb;          /**< RGB color value */
+    uint16_t ct;           /**< Color temperature in Kelvin */
+    uint16_t hue;          /**< Hue value (0-359) */
+    uint8_t sat;           /**< Saturation value (0-100) */
+    uint8_t bright;        /**< Brightness level (1-100) */
+};
+
+/**
+ * @brief Checks whether two light states show the same color, comparing only the fields of their color mode.
+ * @param a The first state.
+ * @param b The second state.
+ * @return True if the color modes and their color fields match; power and brightness are not compared.
+ */
+inline bool same_color(const LightState &a, const LightState &b) {
+    if (a.color_mode != b.color_mode) {
+        return false;
+    }
+    switch (a.color_mode) {
+        case COLOR_MODE_COLOR_TEMPERATURE: return a.ct == b.ct;
+        case COLOR_MODE_HSV: return a.hue == b.hue && a.sat == b.sat;
+        default: return a.rgb == b.rgb;
+    }
+}
+
+/**
+ * @brief Struct representing a recorded change of a numeric property.
+ */
+struct PropertySample
+{
+    uint32_t time;     /**< Time of the change in seconds (see PropertyHistory::now) */
+    YeelightProp prop; /**< The property that changed */
+    uint32_t value;    /**< The new value */
+};
+
+/**
+ * @brief Struct representing a serialized command, ready to be written to a device.
+ */
+struct CommandFrame
+{
+    std::string method; /**< Method name */
+    std::string params; /**< Parameters as an unformatted JSON array */
+};
+
+/**
+ * @brief Struct representing the color calibration of a single device.
+ *
+ * A normalized target color c (0-1 per channel) is corrected as clamp(matrix * c + offset) ^ gamma.
+ * The default values leave colors unchanged.
+ */
+struct ColorCalibration
+{
+    float matrix[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1}; /**< Row-major 3x3 channel mixing matrix */
+    float offset[3] = {0, 0, 0};                   /**< White-balance offsets added per channel */
+    float gamma = 1;                               /**< Exponent applied after the matrix and offsets */
+};
+
 #endif